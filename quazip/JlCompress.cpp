@@ -24,7 +24,12 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "JlCompress.h"
+#include "quacrc32.h"
+#include "quazipmethodpolicy.h"
 #include <QDebug>
+#include <QSaveFile>
+#include <QSet>
+#include <QTemporaryFile>
 
 static bool copyData(QIODevice &inFile, QIODevice &outFile)
 {
@@ -39,7 +44,41 @@ static bool copyData(QIODevice &inFile, QIODevice &outFile)
     return true;
 }
 
-bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest) {
+// Copies the entry fileDest of previous to zip if the file fileInfo didn't
+// change since. Returns 1 if it was copied, 0 if it has to be compressed
+// again and -1 on error.
+static int reuseEntry(QuaZip *zip, QuaZip *previous, const QFileInfo &fileInfo,
+                      const QString &fileDest, bool checkCrc)
+{
+    if (!previous->setCurrentFile(fileDest, QuaZip::csSensitive))
+        return 0;
+    QuaZipFileInfo64 info;
+    if (!previous->getCurrentFileInfo(&info))
+        return 0;
+    // DOS times have a two seconds precision, rounded down
+    qint64 age = info.dateTime.secsTo(fileInfo.lastModified());
+    if (static_cast<qint64>(info.uncompressedSize) != fileInfo.size()
+            || age < 0 || age >= 2 || (info.flags & 1) != 0)
+        return 0;
+    if (checkCrc) {
+        QFile inFile(fileInfo.absoluteFilePath());
+        if (!inFile.open(QIODevice::ReadOnly))
+            return 0;
+        QuaCrc32 crc;
+        while (!inFile.atEnd()) {
+            QByteArray buf = inFile.read(64 * 1024);
+            if (buf.isEmpty())
+                return 0;
+            crc.update(buf);
+        }
+        if (crc.value() != info.crc)
+            return 0;
+    }
+    return zip->copyEntryRaw(*previous, QString()) ? 1 : -1;
+}
+
+bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest,
+                              const QuaZipMethodPolicy *policy) {
     // zip: oggetto dove aggiungere il file
     // fileName: nome del file reale
     // fileDest: nome del file all'interno del file compresso
@@ -55,8 +94,9 @@ bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest) {
     inFile.setFileName(fileName);
     if(!inFile.open(QIODevice::ReadOnly)) return false;
 
-    // Apro il file risulato
+    // Apro il file risulato, memorizzando i dati incomprimibili se richiesto
     QuaZipFile outFile(zip);
+    outFile.setMethodPolicy(policy);
     if(!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(fileDest, inFile.fileName()))) return false;
 
     // Copio i dati
@@ -72,7 +112,8 @@ bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest) {
     return true;
 }
 
-bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool recursive, QDir::Filters filters) {
+bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool recursive, QDir::Filters filters,
+                                QuaZip *previous, bool checkCrc, UpdateStats *stats) {
     // zip: oggetto dove aggiungere il file
     // dir: cartella reale corrente
     // origDir: cartella reale originale
@@ -110,7 +151,8 @@ bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool
                 continue;
 #endif
             // Comprimo la sotto cartella
-            if(!compressSubDir(zip,file.absoluteFilePath(),origDir,recursive,filters)) return false;
+            if(!compressSubDir(zip,file.absoluteFilePath(),origDir,recursive,filters,previous,checkCrc,stats))
+                return false;
         }
     }
 
@@ -120,17 +162,102 @@ bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool
         const QFileInfo & file( files.at( index ) );
         // Se non e un file o e il file compresso che sto creando
         if(!file.isFile()||file.absoluteFilePath()==zip->getZipName()) continue;
+        if (previous && file.absoluteFilePath()==previous->getZipName()) continue;
 
         // Creo il nome relativo da usare all'interno del file compresso
         QString filename = origDirectory.relativeFilePath(file.absoluteFilePath());
 
+        // Riuso il file se non e cambiato
+        if (previous) {
+            int reused = reuseEntry(zip, previous, file, filename, checkCrc);
+            if (reused < 0) return false;
+            if (reused > 0) {
+                if (stats) {
+                    ++stats->reusedFiles;
+                    stats->reusedBytes += file.size();
+                }
+                continue;
+            }
+        }
+
         // Comprimo il file
         if (!compressFile(zip,file.absoluteFilePath(),filename)) return false;
+        if (stats) {
+            ++stats->compressedFiles;
+            stats->compressedBytes += file.size();
+        }
     }
 
     return true;
 }
 
+bool JlCompress::updateDir(QString fileCompressed, QString dir, bool recursive,
+                           QDir::Filters filters, bool checkCrc, UpdateStats *stats)
+{
+    if (stats)
+        *stats = UpdateStats();
+    // compressSubDir() skips the archive by its absolute name
+    QString zipPath = QFileInfo(fileCompressed).absoluteFilePath();
+    if (!QFileInfo(fileCompressed).exists()) {
+        // Nothing to reuse
+        QuaZip zip(zipPath);
+        QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
+        if (!zip.open(QuaZip::mdCreate)) {
+            QFile::remove(fileCompressed);
+            return false;
+        }
+        if (!compressSubDir(&zip, dir, dir, recursive, filters, NULL, false, stats)) {
+            QFile::remove(fileCompressed);
+            return false;
+        }
+        zip.close();
+        if (zip.getZipError() != 0) {
+            QFile::remove(fileCompressed);
+            return false;
+        }
+        return true;
+    }
+    QuaZip previous(zipPath);
+    if (!previous.open(QuaZip::mdUnzip))
+        return false;
+
+    // The new archive replaces the previous one once complete. The temporary
+    // file of QSaveFile has no name we could skip, so if the archive lies in
+    // dir, the new one is built outside and copied in at the end.
+    QString dirPath = QDir(dir).absolutePath();
+    bool inside = zipPath.startsWith(dirPath.endsWith('/') ? dirPath : dirPath + '/');
+    QSaveFile saveFile(fileCompressed);
+    QTemporaryFile tempFile;
+    QuaZip zip;
+    if (inside) {
+        if (!tempFile.open())
+            return false;
+        tempFile.close();
+        zip.setZipName(tempFile.fileName());
+    } else {
+        if (!saveFile.open(QIODevice::WriteOnly))
+            return false;
+        zip.setIoDevice(&saveFile);
+        zip.setAutoClose(false);
+    }
+    if (!zip.open(QuaZip::mdCreate))
+        return false;
+    if (!compressSubDir(&zip, dir, dir, recursive, filters, &previous, checkCrc, stats))
+        return false;
+    zip.close();
+    previous.close();
+    if (zip.getZipError() != 0 || previous.getZipError() != UNZ_OK)
+        return false;
+    if (inside) {
+        QFile built(tempFile.fileName());
+        if (!built.open(QIODevice::ReadOnly)
+                || !saveFile.open(QIODevice::WriteOnly)
+                || !copyData(built, saveFile))
+            return false;
+    }
+    return saveFile.commit();
+}
+
 bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
     // zip: oggetto dove aggiungere il file
     // filename: nome del file reale
@@ -207,6 +334,16 @@ bool JlCompress::removeFile(QStringList listFile) {
 }
 
 bool JlCompress::compressFile(QString fileCompressed, QString file) {
+    return compressFileWith(fileCompressed, file, NULL);
+}
+
+bool JlCompress::compressFile(QString fileCompressed, QString file,
+                              const QuaZipMethodPolicy &policy) {
+    return compressFileWith(fileCompressed, file, &policy);
+}
+
+bool JlCompress::compressFileWith(QString fileCompressed, QString file,
+                                  const QuaZipMethodPolicy *policy) {
     // Creo lo zip
     QuaZip zip(fileCompressed);
     QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
@@ -216,7 +353,7 @@ bool JlCompress::compressFile(QString fileCompressed, QString file) {
     }
 
     // Aggiungo il file
-    if (!compressFile(&zip,file,QFileInfo(file).fileName())) {
+    if (!compressFile(&zip,file,QFileInfo(file).fileName(),policy)) {
         QFile::remove(fileCompressed);
         return false;
     }
@@ -452,3 +589,69 @@ QStringList JlCompress::extractFiles(QIODevice *ioDevice, QStringList files, QSt
     QuaZip zip(ioDevice);
     return extractFiles(zip, files, dir);
 } 
+
+bool JlCompress::mergeArchives(QString fileDest, QStringList archives)
+{
+    QuaZip zip(fileDest);
+    QDir().mkpath(QFileInfo(fileDest).absolutePath());
+    if (!zip.open(QuaZip::mdCreate)) {
+        QFile::remove(fileDest);
+        return false;
+    }
+    QSet<QString> names;
+    for (int i = 0; i < archives.size(); ++i) {
+        QuaZip source(archives.at(i));
+        if (!source.open(QuaZip::mdUnzip)) {
+            zip.close();
+            QFile::remove(fileDest);
+            return false;
+        }
+        for (bool more = source.goToFirstFile(); more; more = source.goToNextFile()) {
+            QString name = source.getCurrentFileName();
+            if (names.contains(name))
+                continue;
+            names.insert(name);
+            if (!zip.copyEntryRaw(source, QString())) {
+                zip.close();
+                QFile::remove(fileDest);
+                return false;
+            }
+        }
+        source.close();
+        if (source.getZipError() != UNZ_OK) {
+            zip.close();
+            QFile::remove(fileDest);
+            return false;
+        }
+    }
+    zip.close();
+    if (zip.getZipError() != 0) {
+        QFile::remove(fileDest);
+        return false;
+    }
+    return true;
+}
+
+bool JlCompress::filterArchive(QString fileCompressed, QString fileDest, QStringList nameFilters)
+{
+    QuaZip source(fileCompressed);
+    if (!source.open(QuaZip::mdUnzip))
+        return false;
+    QuaZip zip(fileDest);
+    QDir().mkpath(QFileInfo(fileDest).absolutePath());
+    if (!zip.open(QuaZip::mdCreate)) {
+        QFile::remove(fileDest);
+        return false;
+    }
+    if (zip.copyEntriesRaw(source, nameFilters) < 0) {
+        zip.close();
+        QFile::remove(fileDest);
+        return false;
+    }
+    zip.close();
+    if (zip.getZipError() != 0) {
+        QFile::remove(fileDest);
+        return false;
+    }
+    return true;
+}
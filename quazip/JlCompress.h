@@ -29,6 +29,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "quazip.h"
 #include "quazipfile.h"
 #include "quazipfileinfo.h"
+#include "quazipmethodpolicy.h"
 #include <QString>
 #include <QDir>
 #include <QFileInfo>
@@ -40,6 +41,21 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
   simple operations, such as mass ZIP packing or extraction.
   */
 class QUAZIP_EXPORT JlCompress {
+public:
+    /// What updateDir() did.
+    struct UpdateStats {
+        /// The number of files copied from the previous archive.
+        int reusedFiles;
+        /// The uncompressed size of the files copied from the previous archive.
+        qint64 reusedBytes;
+        /// The number of new or modified files compressed.
+        int compressedFiles;
+        /// The size of the new or modified files compressed.
+        qint64 compressedBytes;
+        /// Constructs zero statistics.
+        UpdateStats(): reusedFiles(0), reusedBytes(0), compressedFiles(0), compressedBytes(0) {}
+    };
+
 private:
     static QStringList extractDir(QuaZip &zip, const QString &dir);
     static QStringList getFileList(QuaZip *zip);
@@ -50,9 +66,20 @@ private:
       \param zip Opened zip to compress the file to.
       \param fileName The full path to the source file.
       \param fileDest The full name of the file inside the archive.
+      \param policy The policy choosing the method, or NULL to deflate.
+      \return true if success, false otherwise.
+      */
+    static bool compressFile(QuaZip* zip, QString fileName, QString fileDest,
+                             const QuaZipMethodPolicy *policy = NULL);
+    /// Compress a single file to a new archive.
+    /**
+      \param fileCompressed The name of the archive.
+      \param file The file to compress.
+      \param policy The policy choosing the method, or NULL to deflate.
       \return true if success, false otherwise.
       */
-    static bool compressFile(QuaZip* zip, QString fileName, QString fileDest);
+    static bool compressFileWith(QString fileCompressed, QString file,
+                                 const QuaZipMethodPolicy *policy);
     /// Compress a subdirectory.
     /**
       \param parentZip Opened zip containing the parent directory.
@@ -61,10 +88,15 @@ private:
       the root of the ZIP.
       \param recursive Whether to pack sub-directories as well or only
       files.
+      \param previous An opened archive to copy the unchanged files from,
+      see updateDir().
+      \param checkCrc Whether to compare the CRC of the files too.
+      \param stats Where to count the reused and compressed files.
       \return true if success, false otherwise.
       */
     static bool compressSubDir(QuaZip* parentZip, QString dir, QString parentDir, bool recursive,
-                               QDir::Filters filters);
+                               QDir::Filters filters, QuaZip *previous = NULL,
+                               bool checkCrc = false, UpdateStats *stats = NULL);
     /// Extract a single file.
     /**
       \param zip The opened zip archive to extract from.
@@ -88,6 +120,14 @@ public:
       \return true if success, false otherwise.
       */
     static bool compressFile(QString fileCompressed, QString file);
+    /// Compress a single file, letting \a policy choose the method.
+    /**
+      Same as compressFile(QString, QString), except that the file is
+      stored rather than deflated if \a policy says so, see
+      QuaZipMethodPolicy.
+      */
+    static bool compressFile(QString fileCompressed, QString file,
+                             const QuaZipMethodPolicy &policy);
     /// Compress a list of files.
     /**
       \param fileCompressed The name of the archive.
@@ -124,6 +164,39 @@ public:
      */
     static bool compressDir(QString fileCompressed, QString dir,
                             bool recursive, QDir::Filters filters);
+    /**
+     * @brief Compress a whole directory again, reusing the unchanged files.
+     *
+     * Packs the same files as compressDir(QString, QString, bool, QDir::Filters),
+     * but the files that were already packed in @c fileCompressed are copied
+     * from it without being recompressed (see QuaZip::copyEntryRaw()), unless
+     * their size or modification time changed. Only the new and modified files
+     * are compressed. The files that were removed from the directory are
+     * dropped from the archive.
+     *
+     * The modification times are stored in the archive with a two seconds
+     * precision, so a file modified twice within two seconds may be missed,
+     * unless @c checkCrc is true: the CRC of every candidate for reuse is then
+     * computed and compared too, which costs reading the files, but still
+     * spares compressing them.
+     *
+     * The new archive replaces the previous one only once complete, so the
+     * previous one is left untouched on failure. If @c fileCompressed doesn't
+     * exist yet, this is the same as compressDir(). The archive may lie in
+     * @c dir, it is never packed into itself.
+     *
+     * @param fileCompressed path to the archive to update
+     * @param dir path to the directory being compressed
+     * @param recursive if true, then the subdirectories are packed as well
+     * @param filters what to pack, as for compressDir()
+     * @param checkCrc whether to compare the CRC of the files as well
+     * @param stats if not null, receives how many files were reused
+     * and compressed
+     * @return true on success, false otherwise
+     */
+    static bool updateDir(QString fileCompressed, QString dir, bool recursive = true,
+                          QDir::Filters filters = 0, bool checkCrc = false,
+                          UpdateStats *stats = NULL);
 
 public:
     /// Extract a single file.
@@ -192,6 +265,34 @@ public:
       are present separately.
       */
     static QStringList getFileList(QIODevice *ioDevice); 
+
+public:
+    /// Merge several archives into one.
+    /**
+      The entries are copied without being recompressed (see
+      QuaZip::copyEntryRaw()), archive after archive, in their original
+      order. When several entries have the same name, only the first one
+      is kept.
+
+      \param fileDest The name of the resulting archive, which must not be
+      one of \a archives.
+      \param archives The archives to merge.
+      \return true if success, false otherwise.
+      */
+    static bool mergeArchives(QString fileDest, QStringList archives);
+    /// Copy the entries of an archive matching some wildcards.
+    /**
+      The entries are copied without being recompressed (see
+      QuaZip::copyEntriesRaw()).
+
+      \param fileCompressed The name of the source archive.
+      \param fileDest The name of the resulting archive, which must not be
+      \a fileCompressed.
+      \param nameFilters Wildcards matched against the entry names, such as
+      <tt>"*.txt"</tt> or <tt>"doc/*"</tt>.
+      \return true if success, false otherwise.
+      */
+    static bool filterArchive(QString fileCompressed, QString fileDest, QStringList nameFilters);
 };
 
 #endif /* JLCOMPRESSFOLDER_H_ */
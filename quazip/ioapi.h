@@ -136,6 +136,7 @@ typedef int      (ZCALLBACK *close_file_func)     OF((voidpf opaque, voidpf stre
 typedef int      (ZCALLBACK *testerror_file_func) OF((voidpf opaque, voidpf stream));
 
 typedef uLong     (ZCALLBACK *tell_file_func)      OF((voidpf opaque, voidpf stream));
+typedef const void* (ZCALLBACK *map_file_func)     OF((voidpf opaque, voidpf stream, ZPOS64_T offset, ZPOS64_T size));
 typedef int     (ZCALLBACK *seek_file_func)      OF((voidpf opaque, voidpf stream, uLong offset, int origin));
 
 
@@ -179,8 +180,11 @@ typedef struct zlib_filefunc64_32_def_s
     open_file_func      zopen32_file;
     tell_file_func      ztell32_file;
     seek_file_func      zseek32_file;
+    map_file_func       zmap_file; /* NULL unless the stream is memory-mapped */
 } zlib_filefunc64_32_def;
 
+void fill_qiodevice64_mapped_filefunc OF((zlib_filefunc64_32_def* p_filefunc64_32));
+
 
 #define ZREAD64(filefunc,filestream,buf,size)     ((*((filefunc).zfile_func64.zread_file))   ((filefunc).zfile_func64.opaque,filestream,buf,size))
 #define ZWRITE64(filefunc,filestream,buf,size)    ((*((filefunc).zfile_func64.zwrite_file))  ((filefunc).zfile_func64.opaque,filestream,buf,size))
@@ -189,6 +193,8 @@ typedef struct zlib_filefunc64_32_def_s
 #define ZCLOSE64(filefunc,filestream)             ((*((filefunc).zfile_func64.zclose_file))  ((filefunc).zfile_func64.opaque,filestream))
 #define ZFAKECLOSE64(filefunc,filestream)             ((*((filefunc).zfile_func64.zfakeclose_file))  ((filefunc).zfile_func64.opaque,filestream))
 #define ZERROR64(filefunc,filestream)             ((*((filefunc).zfile_func64.zerror_file))  ((filefunc).zfile_func64.opaque,filestream))
+/* Returns a pointer to size bytes at offset in the mapping, or NULL. */
+#define ZMAP64(filefunc,filestream,offset,size)   ((filefunc).zmap_file == NULL ? NULL : (*((filefunc).zmap_file)) ((filefunc).zfile_func64.opaque,filestream,offset,size))
 
 voidpf call_zopen64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf file,int mode));
 int    call_zseek64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf filestream, ZPOS64_T offset, int origin));
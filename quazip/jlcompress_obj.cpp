@@ -24,9 +24,286 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "jlcompress_obj.hpp"
+#include "jlcopypipeline.hpp"
+#include "quacrc32engine.h"
+#include "quazipstreamreader.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDirIterator>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QRunnable>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <string.h>
+#include <zlib.h>
+
+/// @cond internal
+
+/// Size of the chunks read from the source files and written to the archive by the parallel compression.
+static const int JL_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * @brief A single entry deflated by a worker thread of JlCompressObj::compressParallel.
+ * @details
+ * The compressed bytes are kept in <i>data</i> until they outgrow the per job memory share, in which case they are
+ * spilled to a temporary file.
+ */
+struct JlDeflateJob {
+    QString source;
+    QString name;
+    qint64 reserved;
+    bool done;
+    bool ok;
+    quint32 crc;
+    qint64 usize;
+    qint64 csize;
+    int method;
+    int level;
+    QByteArray data;
+    QTemporaryFile *spill;
+    JlDeflateJob()
+        : reserved(0), done(false), ok(false), crc(0), usize(0), csize(0), method(Z_DEFLATED),
+          level(Z_DEFAULT_COMPRESSION), spill(Q_NULLPTR) {}
+    ~JlDeflateJob() { delete spill; }
+};
+
+/// State shared by the writer and the workers of JlCompressObj::compressParallel.
+struct JlDeflateQueue {
+    QMutex mutex;
+    QWaitCondition jobDone;
+    QAtomicInt abort;
+    qint64 memoryShare;
+    const QuaZipMethodPolicy *policy;
+};
+
+/// Deflates one file of JlCompressObj::compressParallel into a JlDeflateJob.
+class JlDeflateTask : public QRunnable {
+  public:
+    JlDeflateTask(JlDeflateJob *job, JlDeflateQueue *queue) : mJob(job), mQueue(queue) {}
+    void run() Q_DECL_OVERRIDE;
+
+  private:
+    bool deflateFile();
+    bool deflateData(QFile &inFile);
+    bool storeData(QFile &inFile);
+    bool store(const char *data, int len);
+    JlDeflateJob *mJob;
+    JlDeflateQueue *mQueue;
+};
+
+void JlDeflateTask::run() {
+    bool ok = deflateFile();
+    QMutexLocker locker(&mQueue->mutex);
+    mJob->ok = ok;
+    mJob->done = true;
+    mQueue->jobDone.wakeAll();
+}
+
+bool JlDeflateTask::store(const char *data, int len) {
+    mJob->csize += len;
+    if (!mJob->spill && mJob->data.size() + len > mQueue->memoryShare) {
+        mJob->spill = new QTemporaryFile();
+        if (!mJob->spill->open() || mJob->spill->write(mJob->data) != mJob->data.size())
+            return false;
+        mJob->data = QByteArray();
+    }
+    if (mJob->spill)
+        return mJob->spill->write(data, len) == len;
+    mJob->data.append(data, len);
+    return true;
+}
+
+bool JlDeflateTask::deflateFile() {
+    QFile inFile(mJob->source);
+    if (!inFile.open(QIODevice::ReadOnly))
+        return false;
+    const QuaZipMethodPolicy *policy = mQueue->policy;
+    if (policy)
+        policy->choose(mJob->name, inFile.peek(policy->sampleSize()), &mJob->method, &mJob->level);
+    bool ok = mJob->method == Z_DEFLATED ? deflateData(inFile) : storeData(inFile);
+    if (ok && policy && mJob->method == Z_DEFLATED && mJob->csize >= mJob->usize) {
+        // deflating made it bigger after all, store it instead
+        delete mJob->spill;
+        mJob->spill = Q_NULLPTR;
+        mJob->data = QByteArray();
+        mJob->usize = 0;
+        mJob->csize = 0;
+        mJob->method = 0;
+        mJob->level = 0;
+        ok = inFile.seek(0) && storeData(inFile);
+    }
+    if (ok && mJob->spill)
+        ok = mJob->spill->flush() && mJob->spill->seek(0);
+    return ok;
+}
+
+bool JlDeflateTask::storeData(QFile &inFile) {
+    QByteArray in(JL_CHUNK_SIZE, Qt::Uninitialized);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (!inFile.atEnd()) {
+        if (mQueue->abort.load())
+            return false;
+        qint64 readLen = inFile.read(in.data(), in.size());
+        if (readLen <= 0)
+            return false;
+        crc = quacrc32(crc, reinterpret_cast<const Bytef *>(in.constData()), static_cast<size_t>(readLen));
+        mJob->usize += readLen;
+        if (!store(in.constData(), static_cast<int>(readLen)))
+            return false;
+    }
+    mJob->crc = static_cast<quint32>(crc);
+    return true;
+}
+
+bool JlDeflateTask::deflateData(QFile &inFile) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // same parameters as zipOpenNewFileInZip3_64 uses through QuaZipFile::open() defaults, at the chosen level
+    if (deflateInit2(&stream, mJob->level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return false;
+    QByteArray in(JL_CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray out(JL_CHUNK_SIZE, Qt::Uninitialized);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    bool ok = true;
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH) {
+        if (mQueue->abort.load()) {
+            ok = false;
+            break;
+        }
+        qint64 readLen = inFile.read(in.data(), in.size());
+        if (readLen < 0) {
+            ok = false;
+            break;
+        }
+        crc = quacrc32(crc, reinterpret_cast<const Bytef *>(in.constData()), static_cast<size_t>(readLen));
+        mJob->usize += readLen;
+        flush = inFile.atEnd() ? Z_FINISH : Z_NO_FLUSH;
+        stream.next_in = reinterpret_cast<Bytef *>(in.data());
+        stream.avail_in = static_cast<uInt>(readLen);
+        do {
+            stream.next_out = reinterpret_cast<Bytef *>(out.data());
+            stream.avail_out = static_cast<uInt>(out.size());
+            int err = deflate(&stream, flush);
+            if (err == Z_STREAM_ERROR) {
+                ok = false;
+                break;
+            }
+            int have = out.size() - static_cast<int>(stream.avail_out);
+            if (have > 0 && !store(out.constData(), have)) {
+                ok = false;
+                break;
+            }
+        } while (stream.avail_out == 0);
+    }
+    deflateEnd(&stream);
+    mJob->crc = static_cast<quint32>(crc);
+    return ok;
+}
+
+/**
+ * @brief A single entry inflated by a worker thread of JlCompressObj::extractParallel.
+ */
+struct JlInflateJob {
+    unz64_file_pos pos;
+    QString dest;
+    qint64 csize;
+    QFile::Permissions perm;
+};
+
+/// State shared by the coordinator and the workers of JlCompressObj::extractParallel.
+struct JlInflateQueue {
+    QMutex mutex;
+    QWaitCondition changed;
+    QAtomicInt abort;
+    QString zipName;
+    qint64 bytes;
+    QStringList finished;
+    int running;
+    bool failed;
+};
+
+/// Inflates a bucket of entries of JlCompressObj::extractParallel through its own unzip handle.
+class JlInflateTask : public QRunnable {
+  public:
+    JlInflateTask(const QList<JlInflateJob> &jobs, JlInflateQueue *queue) : mJobs(jobs), mQueue(queue) {}
+    void run() Q_DECL_OVERRIDE;
+
+  private:
+    bool inflateEntry(QuaZip &zip, const JlInflateJob &job, QByteArray &buf);
+    QList<JlInflateJob> mJobs;
+    JlInflateQueue *mQueue;
+};
+
+void JlInflateTask::run() {
+    QuaZip zip(mQueue->zipName);
+    bool ok = zip.open(QuaZip::mdUnzip);
+    QByteArray buf(JL_CHUNK_SIZE, Qt::Uninitialized);
+    for (int i = 0; ok && i < mJobs.size(); ++i) {
+        if (mQueue->abort.load()) {
+            ok = false;
+            break;
+        }
+        ok = inflateEntry(zip, mJobs.at(i), buf);
+        QMutexLocker locker(&mQueue->mutex);
+        if (ok)
+            mQueue->finished << mJobs.at(i).dest;
+        mQueue->changed.wakeAll();
+    }
+    zip.close();
+    QMutexLocker locker(&mQueue->mutex);
+    if (!ok) {
+        mQueue->failed = true;
+        mQueue->abort.store(1);
+    }
+    --mQueue->running;
+    mQueue->changed.wakeAll();
+}
+
+bool JlInflateTask::inflateEntry(QuaZip &zip, const JlInflateJob &job, QByteArray &buf) {
+    if (!zip.goToFilePos(job.pos))
+        return false;
+    QuaZipFile inFile(&zip);
+    if (!inFile.open(QIODevice::ReadOnly) || inFile.getZipError() != UNZ_OK)
+        return false;
+    if (!QDir().mkpath(QFileInfo(job.dest).absolutePath()))
+        return false;
+    QFile outFile(job.dest);
+    if (!outFile.open(QIODevice::WriteOnly))
+        return false;
+    bool ok = true;
+    while (ok && !inFile.atEnd()) {
+        if (mQueue->abort.load()) {
+            ok = false;
+            break;
+        }
+        qint64 readLen = inFile.read(buf.data(), buf.size());
+        ok = readLen > 0 && outFile.write(buf.constData(), readLen) == readLen;
+        if (ok) {
+            QMutexLocker locker(&mQueue->mutex);
+            mQueue->bytes += readLen;
+        }
+    }
+    outFile.close();
+    inFile.close();
+    ok = ok && inFile.getZipError() == UNZ_OK;
+    if (!ok) {
+        QFile::remove(job.dest);
+        return false;
+    }
+    if (job.perm != 0)
+        outFile.setPermissions(job.perm);
+    return true;
+}
+
+/// @endcond
 
 /**
  * @brief Copy data from <i>inFile</i> to <i>outFile</i>
@@ -41,6 +318,9 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
  *   - JlCompressObj::valueProgressChanged is emitted each JlCompressObj::mFPReport percent of the total uncompressed
  * size written.
  *   - JlCompressObj::filesProgressChanged is emitted when the copy is done (regardless it has been successful).
+ *
+ * Files and archive entries larger than JlCompressObj::copyBufferSize are read by a second thread into one buffer
+ * while this thread writes the other (see JlCopyPipeline), so that reading and writing overlap.
  */
 bool JlCompressObj::copyData(QIODevice &inFile, QIODevice &outFile) {
     qint64 sz = 0;
@@ -56,17 +336,14 @@ bool JlCompressObj::copyData(QIODevice &inFile, QIODevice &outFile) {
         emit maxPerFileProgressChanged(100);
     }
     bool ret = true;
-    while (!inFile.atEnd()) {
-        char buf[4096];
-        qint64 readLen = inFile.read(buf, 4096);
-        if (readLen <= 0) {
-            ret = false;
-            break;
-        }
+    JlCopyPipeline pipeline(inFile, mCopyBufferSize);
+    qint64 readLen;
+    while (const char *buf = pipeline.take(&readLen)) {
         if (outFile.write(buf, readLen) != readLen) {
             ret = false;
             break;
         }
+        pipeline.release();
         fileBytes += readLen;
         mCurBytes += readLen;
         if (mReportProgress) {
@@ -82,6 +359,8 @@ bool JlCompressObj::copyData(QIODevice &inFile, QIODevice &outFile) {
             }
         }
     }
+    if (pipeline.failed())
+        ret = false;
     if (mReportProgress) {
         emit perFileProgressChanged(100);
         emit overallProgressChanged(mCurBytes * 100 / mTotalBytes);
@@ -109,7 +388,12 @@ bool JlCompressObj::compressFile(QuaZip *zip, QString fileName, QString fileDest
 
     // Apro il file risulato
     QuaZipFile outFile(zip);
-    if (!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(fileDest, inFile.fileName())))
+    outFile.setMethodPolicy(mAutoMethod ? &mMethodPolicy : Q_NULLPTR);
+    QuaZipNewInfo info(fileDest, inFile.fileName());
+    // The size lets the one-shot deflate backend compress the file at once
+    if (static_cast<quint64>(inFile.size()) <= 0xffffffffu)
+        info.uncompressedSize = static_cast<ulong>(inFile.size());
+    if (!outFile.open(QIODevice::WriteOnly, info, Q_NULLPTR, 0, mMethod, mLevel))
         return false;
 
     // PATCH
@@ -187,6 +471,160 @@ bool JlCompressObj::compressSubDir(QuaZip *zip, QString dir, QString origDir, bo
     return true;
 }
 
+/**
+ * @brief List the entries that compressSubDir would write, in the same order.
+ * @param sources Receives the full paths of the files and directories to pack.
+ * @param names Receives the matching names inside the archive, directories ending with a '/'.
+ * @param dir The full path to the directory to pack.
+ * @param origDir The full path to the directory corresponding to the root of the ZIP.
+ * @param recursive Whether to list sub-directories as well or only files.
+ * @param filters Same as for compressSubDir.
+ * @param zipName Path of the archive being created, skipped if it lies within <i>dir</i>.
+ */
+void JlCompressObj::collectSubDir(QStringList &sources, QStringList &names, const QString &dir,
+                                  const QString &origDir, bool recursive, QDir::Filters filters,
+                                  const QString &zipName) {
+    QDir directory(dir);
+    QDir origDirectory(origDir);
+    if (dir != origDir) {
+        sources << dir;
+        names << origDirectory.relativeFilePath(dir) + "/";
+    }
+    if (recursive) {
+        QFileInfoList files = directory.entryInfoList(QDir::AllDirs | QDir::NoDotAndDotDot | filters);
+        Q_FOREACH (QFileInfo file, files) {
+            collectSubDir(sources, names, file.absoluteFilePath(), origDir, recursive, filters, zipName);
+        }
+    }
+    QFileInfoList files = directory.entryInfoList(QDir::Files | filters);
+    Q_FOREACH (QFileInfo file, files) {
+        if (!file.isFile() || file.absoluteFilePath() == zipName)
+            continue;
+        sources << file.absoluteFilePath();
+        names << origDirectory.relativeFilePath(file.absoluteFilePath());
+    }
+}
+
+/**
+ * @brief Compress a list of entries using several threads.
+ * @param zip Opened zip to compress the entries to.
+ * @param sources Full paths of the files (or directories) to pack.
+ * @param names Names of the entries inside the archive. Names ending with a '/' are written as directories.
+ * @return @ti{true} on success, @ti{false} otherwise.
+ * @details
+ * Up to JlCompressObj::threadCount worker threads deflate whole files into private buffers, computing the CRC and
+ * sizes on the fly. The calling thread is the only writer: it appends the deflated entries to <i>zip</i> in order
+ * through the raw mode of QuaZipFile (zipOpenNewFileInZip3_64 with raw=1 and zipCloseFileInZipRaw64), so the result
+ * is the same standard archive as the serial path produces.
+ *
+ * Buffers are taken from a budget of JlCompressObj::memoryCeiling bytes: a file is only dispatched when its share
+ * fits in what is left, and deflated data outgrowing that share is spilled to a temporary file.
+ *
+ * Progress signals are emitted by the writer once per entry.
+ */
+bool JlCompressObj::compressParallel(QuaZip *zip, const QStringList &sources, const QStringList &names) {
+    if (!zip)
+        return false;
+    if (zip->getMode() != QuaZip::mdCreate && zip->getMode() != QuaZip::mdAppend && zip->getMode() != QuaZip::mdAdd)
+        return false;
+
+    JlDeflateQueue queue;
+    queue.memoryShare = qMax<qint64>(JL_CHUNK_SIZE, mMemoryCeiling / mThreads);
+    queue.policy = mAutoMethod ? &mMethodPolicy : Q_NULLPTR;
+    QList<JlDeflateJob *> jobs;
+    for (int i = 0; i < sources.size(); ++i) {
+        JlDeflateJob *job = new JlDeflateJob();
+        job->source = sources.at(i);
+        job->name = names.at(i);
+        job->level = mLevel;
+        job->done = job->name.endsWith('/');
+        job->ok = job->done;
+        jobs << job;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(mThreads);
+    qint64 reserved = 0;
+    int inFlight = 0;
+    int next = 0;
+    bool ret = true;
+    QByteArray buf(JL_CHUNK_SIZE, Qt::Uninitialized);
+    for (int i = 0; ret && i < jobs.size(); ++i) {
+        // keep the workers busy as long as the memory budget allows it
+        for (; next < jobs.size(); ++next) {
+            JlDeflateJob *job = jobs.at(next);
+            if (job->done)
+                continue;
+            qint64 cost = qMin(QFileInfo(job->source).size() + JL_CHUNK_SIZE, queue.memoryShare);
+            if (inFlight > 0 && (inFlight >= 2 * mThreads || reserved + cost > mMemoryCeiling))
+                break;
+            job->reserved = cost;
+            reserved += cost;
+            ++inFlight;
+            pool.start(new JlDeflateTask(job, &queue));
+        }
+
+        JlDeflateJob *job = jobs.at(i);
+        queue.mutex.lock();
+        while (!job->done) {
+            queue.jobDone.wait(&queue.mutex, 100);
+            if (!job->done && isAborted())
+                break;
+        }
+        bool done = job->done;
+        queue.mutex.unlock();
+        if (!done || !job->ok) {
+            ret = false;
+            break;
+        }
+
+        QuaZipFile outFile(zip);
+        if (job->name.endsWith('/')) {
+            if (!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(job->name, job->source), 0, 0, 0)) {
+                ret = false;
+                break;
+            }
+            outFile.close();
+            continue;
+        }
+        if (mReportProgress) {
+            emit fileChanged(job->source);
+            emit maxPerFileProgressChanged(100);
+        }
+        QuaZipNewInfo info(job->name, job->source);
+        info.uncompressedSize = job->usize;
+        if (!outFile.open(QIODevice::WriteOnly, info, Q_NULLPTR, job->crc, job->method, job->level, true)) {
+            ret = false;
+            break;
+        }
+        if (job->spill) {
+            while (ret && !job->spill->atEnd()) {
+                qint64 readLen = job->spill->read(buf.data(), buf.size());
+                ret = readLen > 0 && outFile.write(buf.constData(), readLen) == readLen;
+            }
+        } else {
+            ret = outFile.write(job->data) == job->data.size();
+        }
+        outFile.close();
+        ret = ret && outFile.getZipError() == ZIP_OK;
+        reserved -= job->reserved;
+        --inFlight;
+        delete job;
+        jobs[i] = Q_NULLPTR;
+        if (ret && mReportProgress) {
+            mCurBytes += info.uncompressedSize;
+            emit perFileProgressChanged(100);
+            emit overallProgressChanged(mTotalBytes ? mCurBytes * 100 / mTotalBytes : 100);
+            emit filesProgressChanged(++mCurFiles);
+        }
+    }
+
+    queue.abort.store(1);
+    pool.waitForDone();
+    qDeleteAll(jobs);
+    return ret;
+}
+
 bool JlCompressObj::extractFile(QuaZip *zip, QString fileName, QString fileDest) {
     // zip: oggetto dove aggiungere il file
     // filename: nome del file reale
@@ -323,12 +761,28 @@ bool JlCompressObj::compressFiles(QString fileCompressed, QStringList files) {
 
     // Comprimo i file
     QFileInfo info;
-    Q_FOREACH (QString file, files) {
-        info.setFile(file);
-        if (!info.exists() || !compressFile(&zip, file, info.fileName())) {
+    if (mThreads > 1 && mMethod == Z_DEFLATED) {
+        QStringList names;
+        Q_FOREACH (QString file, files) {
+            info.setFile(file);
+            if (!info.exists()) {
+                QFile::remove(fileCompressed);
+                return false;
+            }
+            names << info.fileName();
+        }
+        if (!compressParallel(&zip, files, names)) {
             QFile::remove(fileCompressed);
             return false;
         }
+    } else {
+        Q_FOREACH (QString file, files) {
+            info.setFile(file);
+            if (!info.exists() || !compressFile(&zip, file, info.fileName())) {
+                QFile::remove(fileCompressed);
+                return false;
+            }
+        }
     }
 
     // Chiudo il file zip
@@ -364,7 +818,18 @@ bool JlCompressObj::compressDir(QString fileCompressed, QString dir, bool recurs
     }
 
     // Aggiungo i file e le sotto cartelle
-    if (!compressSubDir(&zip, dir, dir, recursive, filters)) {
+    if (mThreads > 1 && mMethod == Z_DEFLATED) {
+        QStringList sources, names;
+        if (!QDir(dir).exists()) {
+            QFile::remove(fileCompressed);
+            return false;
+        }
+        collectSubDir(sources, names, dir, dir, recursive, filters, zip.getZipName());
+        if (!compressParallel(&zip, sources, names)) {
+            QFile::remove(fileCompressed);
+            return false;
+        }
+    } else if (!compressSubDir(&zip, dir, dir, recursive, filters)) {
         QFile::remove(fileCompressed);
         return false;
     }
@@ -437,6 +902,23 @@ QStringList JlCompressObj::extractFiles(QuaZip &zip, const QStringList &files, c
 
     // Estraggo i file
     QStringList extracted;
+    if (mThreads > 1 && !zip.getIoDevice()) {
+        QList<unz64_file_pos> positions;
+        for (int i = 0; i < files.count(); i++) {
+            unz64_file_pos pos;
+            if (!zip.setCurrentFile(files.at(i)) || !zip.getCurrentFilePos(&pos))
+                return QStringList();
+            positions << pos;
+            extracted << QDir(dir).absoluteFilePath(files.at(i));
+        }
+        extracted = extractParallel(zip, positions, extracted);
+        zip.close();
+        if (zip.getZipError() != 0) {
+            removeFile(extracted);
+            return QStringList();
+        }
+        return extracted;
+    }
     for (int i = 0; i < files.count(); i++) {
         QString absPath = QDir(dir).absoluteFilePath(files.at(i));
         if (!extractFile(&zip, files.at(i), absPath)) {
@@ -482,15 +964,29 @@ QStringList JlCompressObj::extractDir(QuaZip &zip, const QString &dir) {
     if (!zip.goToFirstFile()) {
         return QStringList();
     }
-    do {
-        QString name = zip.getCurrentFileName();
-        QString absFilePath = directory.absoluteFilePath(name);
-        if (!extractFile(&zip, "", absFilePath)) {
-            removeFile(extracted);
+    if (mThreads > 1 && !zip.getIoDevice()) {
+        QList<unz64_file_pos> positions;
+        do {
+            unz64_file_pos pos;
+            if (!zip.getCurrentFilePos(&pos))
+                return QStringList();
+            positions << pos;
+            extracted << directory.absoluteFilePath(zip.getCurrentFileName());
+        } while (zip.goToNextFile());
+        extracted = extractParallel(zip, positions, extracted);
+        if (extracted.isEmpty())
             return QStringList();
-        }
-        extracted.append(absFilePath);
-    } while (zip.goToNextFile());
+    } else {
+        do {
+            QString name = zip.getCurrentFileName();
+            QString absFilePath = directory.absoluteFilePath(name);
+            if (!extractFile(&zip, "", absFilePath)) {
+                removeFile(extracted);
+                return QStringList();
+            }
+            extracted.append(absFilePath);
+        } while (zip.goToNextFile());
+    }
 
     // Chiudo il file zip
     zip.close();
@@ -502,6 +998,130 @@ QStringList JlCompressObj::extractDir(QuaZip &zip, const QString &dir) {
     return extracted;
 }
 
+/**
+ * @brief Extract entries using several threads.
+ * @param zip Archive opened in QuaZip::mdUnzip mode from a file name.
+ * @param positions Positions of the entries to extract (see QuaZip::getCurrentFilePos).
+ * @param dests Full paths of the destination files, directories ending with a '/'.
+ * @return <i>dests</i> on success, an empty list otherwise (in which case the files written are removed).
+ * @details
+ * Directories are created first by the calling thread. Files are then split into JlCompressObj::threadCount buckets
+ * balanced by compressed size, each bucket being inflated by a worker thread through its own QuaZip handle on the
+ * same archive. Entries with the same destination go to the same bucket in archive order, so that the last one wins
+ * as when extracting serially.
+ *
+ * The calling thread emits the progress signals: the overall progress as bytes are written, and the per file
+ * progress, JlCompressObj::fileChanged and JlCompressObj::filesProgressChanged as each file is completed.
+ */
+QStringList JlCompressObj::extractParallel(QuaZip &zip, const QList<unz64_file_pos> &positions,
+                                           const QStringList &dests) {
+    // the files, grouped by destination
+    QList<QList<JlInflateJob> > groups;
+    QHash<QString, int> groupOf;
+    QStringList dirs;
+    QuaZipFileInfo64 info;
+    for (int i = 0; i < positions.size(); ++i) {
+        if (!zip.goToFilePos(positions.at(i)) || !zip.getCurrentFileInfo(&info))
+            return QStringList();
+        const QString &dest = dests.at(i);
+        if (dest.endsWith('/')) {
+            if (!QDir().mkpath(dest)) {
+                removeFile(dirs);
+                return QStringList();
+            }
+            if (info.getPermissions() != 0)
+                QFile(dest).setPermissions(info.getPermissions());
+            dirs << dest;
+            continue;
+        }
+        JlInflateJob job;
+        job.pos = positions.at(i);
+        job.dest = dest;
+        job.csize = info.compressedSize;
+        job.perm = info.getPermissions();
+        const QString key = QDir::cleanPath(dest);
+        if (!groupOf.contains(key)) {
+            groupOf.insert(key, groups.size());
+            groups << QList<JlInflateJob>();
+        }
+        groups[groupOf.value(key)] << job;
+    }
+
+    // greedy balancing: biggest groups first, each one to the least loaded bucket
+    QVector<qint64> groupSize(groups.size(), 0);
+    QVector<int> order(groups.size());
+    for (int g = 0; g < groups.size(); ++g) {
+        for (const JlInflateJob &job : groups.at(g))
+            groupSize[g] += job.csize + 1;
+        order[g] = g;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&groupSize](int a, int b) { return groupSize.at(a) > groupSize.at(b); });
+    int buckets = qMin(mThreads, groups.size());
+    QVector<QList<JlInflateJob> > work(buckets);
+    QVector<qint64> load(buckets, 0);
+    for (int g : order) {
+        int best = 0;
+        for (int b = 1; b < buckets; ++b) {
+            if (load.at(b) < load.at(best))
+                best = b;
+        }
+        work[best] << groups.at(g);
+        load[best] += groupSize.at(g);
+    }
+
+    JlInflateQueue queue;
+    queue.zipName = zip.getZipName();
+    queue.bytes = 0;
+    queue.running = buckets;
+    queue.failed = false;
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, buckets));
+    for (int b = 0; b < buckets; ++b)
+        pool.start(new JlInflateTask(work.at(b), &queue));
+
+    qint64 startBytes = mCurBytes;
+    int opm1 = 0;
+    int reported = 0;
+    QStringList written;
+    queue.mutex.lock();
+    while (queue.running > 0) {
+        queue.changed.wait(&queue.mutex, 100);
+        if (isAborted())
+            queue.abort.store(1);
+        QStringList finished = queue.finished.mid(reported);
+        reported = queue.finished.size();
+        qint64 bytes = queue.bytes;
+        queue.mutex.unlock();
+        if (mReportProgress) {
+            mCurBytes = startBytes + bytes;
+            int op = mTotalBytes ? mCurBytes * 100 / mTotalBytes : 100;
+            for (const QString &dest : finished) {
+                emit fileChanged(dest);
+                emit perFileProgressChanged(100);
+                emit filesProgressChanged(qMin(++mCurFiles, mTotalFiles));
+            }
+            if (op >= opm1) {
+                emit overallProgressChanged(op);
+                opm1 = op + mTPReport;
+            }
+        }
+        queue.mutex.lock();
+    }
+    written = queue.finished;
+    bool failed = queue.failed || queue.abort.load();
+    queue.mutex.unlock();
+    pool.waitForDone();
+
+    if (failed) {
+        removeFile(written);
+        return QStringList();
+    }
+    if (mReportProgress)
+        emit overallProgressChanged(mTotalBytes ? mCurBytes * 100 / mTotalBytes : 100);
+    return dests;
+}
+
 QStringList JlCompressObj::getFileList(QString fileCompressed) {
     // Apro lo zip
     QuaZip *zip = new QuaZip(QFileInfo(fileCompressed).absoluteFilePath());
@@ -537,10 +1157,91 @@ QStringList JlCompressObj::getFileList(QuaZip *zip) {
 }
 
 QStringList JlCompressObj::extractDir(QIODevice *ioDevice, QString dir) {
+    if (ioDevice->isSequential())
+        return extractStream(ioDevice, dir);
     QuaZip zip(ioDevice);
     return extractDir(zip, dir);
 }
 
+/**
+ * @brief Extract a whole archive as it arrives on a sequential device.
+ * @param ioDevice Sequential device the archive is read from (socket, process output...).
+ * @param dir Directory to extract to.
+ * @return The list of the full paths of the files extracted, empty on failure (in which case the files written are
+ * removed).
+ * @details
+ * Entries are read in turn with a QuaZipStreamReader and written as their data arrives, so that the extraction
+ * overlaps the transfer and no temporary copy of the archive is made. The reader blocks while waiting for data, so
+ * this is meant to run in a worker thread (see JlWorker).
+ *
+ * As the archive size is unknown, only JlCompressObj::fileChanged, JlCompressObj::perFileProgressChanged (for entries
+ * whose size is known up front) and JlCompressObj::filesProgressChanged are emitted. Permissions are not restored,
+ * since they are only recorded in the central directory.
+ */
+QStringList JlCompressObj::extractStream(QIODevice *ioDevice, const QString &dir) {
+    QDir directory(dir);
+    QStringList extracted;
+    QuaZipStreamReader reader(ioDevice);
+    if (mReportProgress)
+        emit maxPerFileProgressChanged(100);
+    QByteArray buf(64 * 1024, 0);
+    while (reader.nextEntry()) {
+        QString absFilePath = directory.absoluteFilePath(reader.entryInfo().name);
+        if (absFilePath.endsWith('/')) {
+            if (!QDir().mkpath(absFilePath)) {
+                removeFile(extracted);
+                return QStringList();
+            }
+            extracted.append(absFilePath);
+            continue;
+        }
+        if (!QDir().mkpath(QFileInfo(absFilePath).absolutePath())) {
+            removeFile(extracted);
+            return QStringList();
+        }
+        QFile outFile(absFilePath);
+        if (!outFile.open(QIODevice::WriteOnly)) {
+            removeFile(extracted);
+            return QStringList();
+        }
+        if (mReportProgress)
+            emit fileChanged(absFilePath);
+        QIODevice *entry = reader.entry();
+        qint64 sz = entry->size();
+        qint64 fileBytes = 0;
+        int fpm1 = mFPReport;
+        bool ok = true;
+        while (ok && !entry->atEnd()) {
+            qint64 readLen = entry->read(buf.data(), buf.size());
+            ok = !isAborted() && readLen > 0 && outFile.write(buf.constData(), readLen) == readLen;
+            fileBytes += readLen;
+            if (ok && mReportProgress && sz > 0) {
+                int fp = static_cast<int>(qMin<qint64>(fileBytes * 100 / sz, 100));
+                if (fp >= fpm1) {
+                    emit perFileProgressChanged(fp);
+                    fpm1 = fp + mFPReport;
+                }
+            }
+        }
+        outFile.close();
+        if (!ok || reader.getZipError() != UNZ_OK) {
+            extracted.append(absFilePath);
+            removeFile(extracted);
+            return QStringList();
+        }
+        extracted.append(absFilePath);
+        if (mReportProgress) {
+            emit perFileProgressChanged(100);
+            emit filesProgressChanged(++mCurFiles);
+        }
+    }
+    if (reader.getZipError() != UNZ_OK) {
+        removeFile(extracted);
+        return QStringList();
+    }
+    return extracted;
+}
+
 QStringList JlCompressObj::getFileList(QIODevice *ioDevice) {
     QuaZip *zip = new QuaZip(ioDevice);
     return getFileList(zip);
@@ -590,6 +1291,104 @@ void JlCompressObj::setGlobalProgressReport(int percent) { mTPReport = qBound(1,
  */
 void JlCompressObj::setFileProgressReport(int percent) { mFPReport = qBound(1, percent, 100); }
 
+/**
+ * @brief Set the number of threads used to compress.
+ * @param threads Number of threads, 0 for QThread::idealThreadCount().
+ * @details
+ * With more than one thread, compressFiles and compressDir deflate several entries concurrently (see
+ * JlCompressObj::compressParallel). The default, 1, keeps the original serial behaviour.
+ */
+void JlCompressObj::setThreadCount(int threads) {
+    mThreads = threads > 0 ? threads : qMax(1, QThread::idealThreadCount());
+}
+
+/// @brief Get the number of threads used to compress.
+int JlCompressObj::threadCount() const { return mThreads; }
+
+/**
+ * @brief Set the memory ceiling of the parallel compression.
+ * @param bytes Maximum number of bytes held by deflated entries waiting to be written.
+ * @details
+ * Each worker thread gets an equal share of the ceiling. Entries that do not fit in their share once deflated are
+ * spilled to temporary files. Defaults to JLCOMPRESS_DEFAULT_MEMORY_CEILING.
+ */
+void JlCompressObj::setMemoryCeiling(qint64 bytes) { mMemoryCeiling = qMax<qint64>(JL_CHUNK_SIZE, bytes); }
+
+/// @brief Get the memory ceiling of the parallel compression.
+qint64 JlCompressObj::memoryCeiling() const { return mMemoryCeiling; }
+
+/**
+ * @brief Set the size of the buffers of JlCompressObj::copyData.
+ * @param bytes Size of each of the two buffers, bounded to [JLCOMPRESS_MIN_COPY_BUFFER, JLCOMPRESS_MAX_COPY_BUFFER].
+ * @details
+ * Larger buffers mean fewer, larger reads and writes, which suits fast storage; the cancellation and the progress
+ * signals are checked once per buffer. Defaults to JLCOMPRESS_DEFAULT_COPY_BUFFER.
+ */
+void JlCompressObj::setCopyBufferSize(int bytes) {
+    mCopyBufferSize = qBound(JLCOMPRESS_MIN_COPY_BUFFER, bytes, JLCOMPRESS_MAX_COPY_BUFFER);
+}
+
+/// @brief Get the size of the buffers of JlCompressObj::copyData.
+int JlCompressObj::copyBufferSize() const { return mCopyBufferSize; }
+
+/**
+ * @brief Enable or disable the automatic choice of the compression method.
+ * @param enabled @ti{true} to let JlCompressObj::methodPolicy choose, @ti{false} to always deflate.
+ * @details
+ * When enabled, which is the default, the files that would not shrink (known compressed formats, random looking
+ * data) are stored instead of deflated, and data that barely shrinks is deflated at the fastest level. Files that
+ * still end up bigger once deflated are stored as well when the whole file is known before it is written: small files
+ * and the parallel compression (see QuaZipFile::setMethodPolicy).
+ */
+void JlCompressObj::setAutoMethod(bool enabled) { mAutoMethod = enabled; }
+
+/// @brief Get whether the compression method is chosen automatically.
+bool JlCompressObj::autoMethod() const { return mAutoMethod; }
+
+/**
+ * @brief Set the policy choosing the compression method.
+ * @param policy Policy used when JlCompressObj::autoMethod is enabled.
+ * @details
+ * The default policy stores the usual compressed formats, found by their name suffix or their signature, and measures
+ * the entropy of the first bytes of the other files (see QuaZipMethodPolicy).
+ */
+void JlCompressObj::setMethodPolicy(const QuaZipMethodPolicy &policy) { mMethodPolicy = policy; }
+
+/// @brief Get the policy choosing the compression method.
+QuaZipMethodPolicy JlCompressObj::methodPolicy() const { return mMethodPolicy; }
+
+/**
+ * @brief Set the compression method and level of the files compressed.
+ * @param method 0 (stored), Z_DEFLATED (the default), or Z_BZIP2ED and Z_LZMAED when QuaZIP is built with
+ * them (see QuaZipFile::isMethodSupported).
+ * @param level Level of the method, Z_DEFAULT_COMPRESSION for its default.
+ * @return @ti{false}, leaving the settings unchanged, if <i>method</i> is not supported.
+ * @details
+ * The method policy (see JlCompressObj::setAutoMethod) and the parallel compression (see
+ * JlCompressObj::setThreadCount) only apply to Z_DEFLATED: the other methods always compress with the given level, on a
+ * single thread.
+ */
+bool JlCompressObj::setCompression(int method, int level) {
+    if (!QuaZipFile::isMethodSupported(method))
+        return false;
+    mMethod = method;
+    mLevel = level;
+    return true;
+}
+
+/// @brief Get the compression method set by JlCompressObj::setCompression.
+int JlCompressObj::compressionMethod() const { return mMethod; }
+
+/// @brief Get the compression level set by JlCompressObj::setCompression.
+int JlCompressObj::compressionLevel() const { return mLevel; }
+
+/**
+ * @brief Check whether the current operation should stop.
+ * @details
+ * Polled by the parallel code paths, which do not go through JlCompressObj::copyData. Always @ti{false} here.
+ */
+bool JlCompressObj::isAborted() const { return false; }
+
 /**
  * @brief Count the total number of bytes of <i>path</i>.
  * @param Path path of a single file or a directory.
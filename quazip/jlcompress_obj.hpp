@@ -29,11 +29,36 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "quazip.h"
 #include "quazipfile.h"
 #include "quazipfileinfo.h"
+#include "quazipmethodpolicy.h"
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QString>
 
+/*!
+  @def JLCOMPRESS_DEFAULT_MEMORY_CEILING
+  Default amount of memory (in bytes) that the parallel compression may use to hold deflated entries waiting to be
+  written to the archive. See JlCompressObj::setMemoryCeiling.
+*/
+#define JLCOMPRESS_DEFAULT_MEMORY_CEILING (Q_INT64_C(256) * 1024 * 1024)
+
+/*!
+  @def JLCOMPRESS_DEFAULT_COPY_BUFFER
+  Default size (in bytes) of each of the two buffers used by JlCompressObj::copyData. See
+  JlCompressObj::setCopyBufferSize.
+*/
+#define JLCOMPRESS_DEFAULT_COPY_BUFFER (256 * 1024)
+/*!
+  @def JLCOMPRESS_MIN_COPY_BUFFER
+  Smallest size (in bytes) accepted by JlCompressObj::setCopyBufferSize.
+*/
+#define JLCOMPRESS_MIN_COPY_BUFFER 4096
+/*!
+  @def JLCOMPRESS_MAX_COPY_BUFFER
+  Largest size (in bytes) accepted by JlCompressObj::setCopyBufferSize.
+*/
+#define JLCOMPRESS_MAX_COPY_BUFFER (16 * 1024 * 1024)
+
 /// Utility class for typical operations.
 /**
   This class contains a number of useful static functions to perform
@@ -69,6 +94,16 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
  *      JlCompressObj::overallProgressChanged, in term of percent of the overall progress.
  *    - JlCompressObj::setFileProgressReport. The method sets the rate of emission of
  *      JlCompressObj::perFileProgressChanged, in term of percent of the file progress.
+ *
+ * compressFiles and compressDir can deflate several entries at once (see JlCompressObj::setThreadCount and
+ * JlCompressObj::setMemoryCeiling). Likewise, extractFiles and extractDir inflate several entries at once when the
+ * archive is given by its file name. In those modes, the per file progress is only reported once an entry is done.
+ *
+ * Otherwise, the data goes through JlCompressObj::copyData, which reads the next buffer while writing the current one
+ * (see JlCompressObj::setCopyBufferSize).
+ *
+ * Files that would not shrink, such as pictures, videos or archives, are stored rather than deflated (see
+ * JlCompressObj::setAutoMethod and JlCompressObj::setMethodPolicy).
  */
 class QUAZIP_EXPORT JlCompressObj : public QObject {
     Q_OBJECT
@@ -77,7 +112,10 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
      * @brief Constructor
      * @param parent Parent object
      */
-    JlCompressObj(QObject *parent = Q_NULLPTR) : QObject(parent), mReportProgress(false), mTPReport(1), mFPReport(5) {}
+    JlCompressObj(QObject *parent = Q_NULLPTR)
+        : QObject(parent), mReportProgress(false), mTPReport(1), mFPReport(5), mThreads(1),
+          mMemoryCeiling(JLCOMPRESS_DEFAULT_MEMORY_CEILING), mCopyBufferSize(JLCOMPRESS_DEFAULT_COPY_BUFFER), mAutoMethod(true),
+          mMethod(Z_DEFLATED), mLevel(Z_DEFAULT_COMPRESSION) {}
 
     /**
      * @brief Constructor
@@ -85,7 +123,9 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
      * @param parent Parent object
      */
     JlCompressObj(bool reportProgress, QObject *parent = Q_NULLPTR)
-        : QObject(parent), mReportProgress(reportProgress), mTPReport(1), mFPReport(5) {}
+        : QObject(parent), mReportProgress(reportProgress), mTPReport(1), mFPReport(5), mThreads(1),
+          mMemoryCeiling(JLCOMPRESS_DEFAULT_MEMORY_CEILING), mCopyBufferSize(JLCOMPRESS_DEFAULT_COPY_BUFFER), mAutoMethod(true),
+          mMethod(Z_DEFLATED), mLevel(Z_DEFAULT_COMPRESSION) {}
 
     /**
      * @brief Constructor
@@ -97,11 +137,26 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
      */
     JlCompressObj(bool reportProgress, int totalProgressReport, int fileProgressReport, QObject *parent = Q_NULLPTR)
         : QObject(parent), mReportProgress(reportProgress), mTPReport(qBound(1, totalProgressReport, 100)),
-          mFPReport(qBound(1, fileProgressReport, 100)) {}
+          mFPReport(qBound(1, fileProgressReport, 100)), mThreads(1),
+          mMemoryCeiling(JLCOMPRESS_DEFAULT_MEMORY_CEILING), mCopyBufferSize(JLCOMPRESS_DEFAULT_COPY_BUFFER), mAutoMethod(true),
+          mMethod(Z_DEFLATED), mLevel(Z_DEFAULT_COMPRESSION) {}
 
     virtual void setGlobalProgressReport(int percent);
     virtual void setFileProgressReport(int percent);
     virtual void enableProgression(bool enabled);
+    virtual void setThreadCount(int threads);
+    int threadCount() const;
+    virtual void setMemoryCeiling(qint64 bytes);
+    qint64 memoryCeiling() const;
+    virtual void setCopyBufferSize(int bytes);
+    int copyBufferSize() const;
+    virtual void setAutoMethod(bool enabled);
+    bool autoMethod() const;
+    virtual void setMethodPolicy(const QuaZipMethodPolicy &policy);
+    QuaZipMethodPolicy methodPolicy() const;
+    virtual bool setCompression(int method, int level = Z_DEFAULT_COMPRESSION);
+    int compressionMethod() const;
+    int compressionLevel() const;
 
     /// Compress a single file.
     /**
@@ -203,6 +258,9 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
       \param dir The directory to extract to, the current directory if
       left empty.
       \return The list of the full paths of the files extracted, empty on failure.
+
+      If the device is sequential (QTcpSocket, QProcess...), the archive is
+      extracted as it arrives, without spooling it, see extractStream().
       */
     QStringList extractDir(QIODevice *ioDevice, QString dir = QString());
     /// Get the file list.
@@ -215,6 +273,7 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
 
   protected:
     QStringList extractDir(QuaZip &zip, const QString &dir);
+    QStringList extractStream(QIODevice *ioDevice, const QString &dir);
     QStringList getFileList(QuaZip *zip);
     QString extractFile(QuaZip &zip, QString fileName, QString fileDest);
     QStringList extractFiles(QuaZip &zip, const QStringList &files, const QString &dir);
@@ -258,6 +317,11 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
     void computeSizesInZip(QuaZip &zip, const QStringList paths = QStringList());
     qint64 countBytes(QStringList files, int *fileCount = Q_NULLPTR);
     qint64 countBytes(const QString &path, int *fileCount = Q_NULLPTR, bool recurse = true);
+    virtual bool isAborted() const;
+    void collectSubDir(QStringList &sources, QStringList &names, const QString &dir, const QString &origDir,
+                       bool recursive, QDir::Filters filters, const QString &zipName);
+    bool compressParallel(QuaZip *zip, const QStringList &sources, const QStringList &names);
+    QStringList extractParallel(QuaZip &zip, const QList<unz64_file_pos> &positions, const QStringList &dests);
 
   protected:
     bool mReportProgress;
@@ -267,6 +331,13 @@ class QUAZIP_EXPORT JlCompressObj : public QObject {
     int mCurFiles;
     int mTPReport;
     int mFPReport;
+    int mThreads;
+    qint64 mMemoryCeiling;
+    int mCopyBufferSize;
+    bool mAutoMethod;
+    QuaZipMethodPolicy mMethodPolicy;
+    int mMethod;
+    int mLevel;
 
 signals:
 
@@ -0,0 +1,130 @@
+#include <QFile>
+#include <QMutexLocker>
+#include "jlcopypipeline.hpp"
+#include "quazipfile.h"
+
+/**
+ * @brief Constructor
+ * @param inFile Opened device to read from.
+ * @param bufferSize Size of each of the two buffers.
+ * @details
+ * Starts the reader thread right away when <i>inFile</i> is a file or an archive entry larger than a buffer.
+ */
+JlCopyPipeline::JlCopyPipeline(QIODevice &inFile, int bufferSize)
+    : mInFile(inFile), mReady(0), mNext(0), mThreaded(false), mEnd(false), mFailed(false), mStop(false) {
+    mLengths[0] = mLengths[1] = 0;
+    qint64 size = -1;
+    if (QuaZipFile *zipFile = qobject_cast<QuaZipFile *>(&inFile))
+        size = zipFile->usize();
+    else if (qobject_cast<QFileDevice *>(&inFile))
+        size = inFile.size() - inFile.pos();
+    if (size >= 0 && size < bufferSize) {
+        // a single read will do, don't bother with a thread nor a full-sized buffer
+        mBuffers[0] = QByteArray(qMax<int>(int(size), 4096), Qt::Uninitialized);
+        return;
+    }
+    mBuffers[0] = QByteArray(bufferSize, Qt::Uninitialized);
+    if (size < 0)
+        return;
+    mBuffers[1] = QByteArray(bufferSize, Qt::Uninitialized);
+    mThreaded = true;
+    start();
+}
+
+/// @brief Destructor. Stops the reader thread and waits for it.
+JlCopyPipeline::~JlCopyPipeline() {
+    if (!mThreaded)
+        return;
+    mMutex.lock();
+    mStop = true;
+    mCond.wakeAll();
+    mMutex.unlock();
+    wait();
+}
+
+/**
+ * @brief Get the next filled buffer.
+ * @param len Set to the number of bytes of the buffer.
+ * @return The buffer, or @ti{Q_NULLPTR} once the input is exhausted or on read error (see JlCopyPipeline::failed).
+ * @details
+ * The buffer stays valid until JlCopyPipeline::release is called.
+ */
+const char *JlCopyPipeline::take(qint64 *len) {
+    if (!mThreaded) {
+        if (mEnd)
+            return Q_NULLPTR;
+        *len = fill(mBuffers[0]);
+        if (*len <= 0) {
+            mFailed = *len < 0;
+            mEnd = true;
+            return Q_NULLPTR;
+        }
+        return mBuffers[0].constData();
+    }
+    QMutexLocker locker(&mMutex);
+    while (mReady == 0 && !mEnd)
+        mCond.wait(&mMutex);
+    if (mReady == 0)
+        return Q_NULLPTR;
+    *len = mLengths[mNext];
+    return mBuffers[mNext].constData();
+}
+
+/// @brief Hand the buffer returned by JlCopyPipeline::take back to the reader.
+void JlCopyPipeline::release() {
+    if (!mThreaded)
+        return;
+    QMutexLocker locker(&mMutex);
+    --mReady;
+    mNext ^= 1;
+    mCond.wakeAll();
+}
+
+/// @brief Check whether reading the input device failed.
+bool JlCopyPipeline::failed() const {
+    QMutexLocker locker(&mMutex);
+    return mFailed;
+}
+
+/// @brief Reader thread: fills the free buffers until the end of the input.
+void JlCopyPipeline::run() {
+    int index = 0;
+    forever {
+        mMutex.lock();
+        while (mReady == 2 && !mStop)
+            mCond.wait(&mMutex);
+        bool stop = mStop;
+        mMutex.unlock();
+        if (stop)
+            break;
+        // the consumer never holds buffer <index> at this point: it is (mNext + mReady) % 2 with mReady < 2
+        qint64 len = fill(mBuffers[index]);
+        QMutexLocker locker(&mMutex);
+        if (len <= 0) {
+            mFailed = len < 0;
+            mEnd = true;
+            mCond.wakeAll();
+            break;
+        }
+        mLengths[index] = len;
+        ++mReady;
+        index ^= 1;
+        mCond.wakeAll();
+    }
+}
+
+/**
+ * @brief Read into <i>buffer</i> until it is full or the input is exhausted.
+ * @return The number of bytes read, 0 at the end of the input, -1 on error.
+ */
+qint64 JlCopyPipeline::fill(QByteArray &buffer) {
+    char *data = buffer.data();
+    qint64 len = 0;
+    while (len < buffer.size() && !mInFile.atEnd()) {
+        qint64 readLen = mInFile.read(data + len, buffer.size() - len);
+        if (readLen <= 0)
+            return -1;
+        len += readLen;
+    }
+    return len;
+}
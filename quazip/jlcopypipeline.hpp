@@ -0,0 +1,55 @@
+#ifndef JLCOPYPIPELINE_HPP
+#define JLCOPYPIPELINE_HPP
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+/// @cond internal
+/**
+ * @brief The JlCopyPipeline class
+ * @details
+ * Double-buffered reader used by JlCompressObj::copyData and JlWorker::copyData: a thread fills one buffer from the
+ * input device while the caller writes the other one to the output device.
+ *
+ * The caller loops over JlCopyPipeline::take, writes the returned buffer, and hands it back with
+ * JlCopyPipeline::release. Destroying the pipeline stops the reader, so the caller may leave the loop at any time
+ * (write error, cancellation).
+ *
+ * The input device is only touched by the reader thread until the pipeline is destroyed, which is safe for files and
+ * archive entries, but not for devices relying on an event loop (sockets, processes...). Those, as well as inputs
+ * fitting in a single buffer, are read in the calling thread instead.
+ */
+class JlCopyPipeline : public QThread {
+  public:
+    JlCopyPipeline(QIODevice &inFile, int bufferSize);
+    virtual ~JlCopyPipeline();
+
+    const char *take(qint64 *len);
+    void release();
+    bool failed() const;
+
+  protected:
+    void run() Q_DECL_OVERRIDE;
+
+  private:
+    qint64 fill(QByteArray &buffer);
+
+    Q_DISABLE_COPY(JlCopyPipeline)
+    QIODevice &mInFile;
+    QByteArray mBuffers[2];
+    qint64 mLengths[2];
+    int mReady;
+    int mNext;
+    bool mThreaded;
+    bool mEnd;
+    bool mFailed;
+    bool mStop;
+    mutable QMutex mMutex;
+    QWaitCondition mCond;
+};
+/// @endcond
+
+#endif // JLCOPYPIPELINE_HPP
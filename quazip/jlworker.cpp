@@ -2,6 +2,7 @@
 #include <QMutexLocker>
 #include <QElapsedTimer>
 #include "jlworker.hpp"
+#include "jlcopypipeline.hpp"
 
 /// @brief Default Constructor.
 JlWorker::JlWorker(QObject *parent) : JlCompressObj(parent) {
@@ -200,6 +201,71 @@ void JlWorker::setAbortPercentCheck(int percent) {
     mCPReport = qBound(1, percent, 100);
 }
 
+/**
+ * @brief Set the number of threads used to compress.
+ * @param threads Number of threads, 0 for QThread::idealThreadCount().
+ * @see JlCompressObj::setThreadCount
+ */
+void JlWorker::setThreadCount(int threads) {
+    QMutexLocker locker(&mDataMutex);
+    JlCompressObj::setThreadCount(threads);
+}
+
+/**
+ * @brief Set the memory ceiling of the parallel compression.
+ * @param bytes Maximum number of bytes held by deflated entries waiting to be written.
+ * @see JlCompressObj::setMemoryCeiling
+ */
+void JlWorker::setMemoryCeiling(qint64 bytes) {
+    QMutexLocker locker(&mDataMutex);
+    JlCompressObj::setMemoryCeiling(bytes);
+}
+
+/**
+ * @brief Set the size of the copy buffers.
+ * @param bytes Size of each of the two buffers.
+ * @see JlCompressObj::setCopyBufferSize
+ */
+void JlWorker::setCopyBufferSize(int bytes) {
+    QMutexLocker locker(&mDataMutex);
+    JlCompressObj::setCopyBufferSize(bytes);
+}
+
+/**
+ * @brief Enable or disable the automatic choice of the compression method.
+ * @param enabled @ti{true} to let the method policy choose, @ti{false} to always deflate.
+ * @see JlCompressObj::setAutoMethod
+ */
+void JlWorker::setAutoMethod(bool enabled) {
+    QMutexLocker locker(&mDataMutex);
+    JlCompressObj::setAutoMethod(enabled);
+}
+
+/**
+ * @brief Set the policy choosing the compression method.
+ * @param policy Policy used when the automatic choice is enabled.
+ * @see JlCompressObj::setMethodPolicy
+ */
+void JlWorker::setMethodPolicy(const QuaZipMethodPolicy &policy) {
+    QMutexLocker locker(&mDataMutex);
+    JlCompressObj::setMethodPolicy(policy);
+}
+
+/**
+ * @brief Set the compression method and level of the files compressed.
+ * @param method Compression method.
+ * @param level Level of the method.
+ * @return @ti{false} if <i>method</i> is not supported.
+ * @see JlCompressObj::setCompression
+ */
+bool JlWorker::setCompression(int method, int level) {
+    QMutexLocker locker(&mDataMutex);
+    return JlCompressObj::setCompression(method, level);
+}
+
+/// @brief Let the parallel code paths of JlCompressObj stop on cancellation.
+bool JlWorker::isAborted() const { return canceled(); }
+
 /// @brief Get the total time of the last operation.
 qint64 JlWorker::elapsedTime() const { return mElapsed; }
 
@@ -280,32 +346,29 @@ void JlWorker::process() {
 bool JlWorker::copyData(QIODevice &inFile, QIODevice &outFile) {
     qint64 sz = 0;
     qint64 fileBytes = 0;
-    int fp, fpm1, op, opm1, cp, cpm1;
+    int fp, fpm1, op, opm1, cp;
+    int cpm1 = mCPReport;
     if (mReportProgress) {
         QuaZipFile *zipFile = qobject_cast<QuaZipFile *>(&inFile);
         sz = zipFile ? zipFile->usize() : inFile.size();
-        fp = cp = 0;
+        fp = 0;
         fpm1 = mFPReport;
-        cpm1 = mCPReport;
         op = mCurBytes * 100 / mTotalBytes;
         opm1 = op + mTPReport;
         emit maxPerFileProgressChanged(100);
     }
     bool ret = true;
-    while (!inFile.atEnd()) {
-        char buf[4096];
-        qint64 readLen = inFile.read(buf, 4096);
-        if (readLen <= 0) {
-            ret = false;
-            break;
-        }
+    JlCopyPipeline pipeline(inFile, mCopyBufferSize);
+    qint64 readLen;
+    while (const char *buf = pipeline.take(&readLen)) {
         if (outFile.write(buf, readLen) != readLen) {
             ret = false;
             break;
         }
+        pipeline.release();
         fileBytes += readLen;
         mCurBytes += readLen;
-        cp = fileBytes * 100 / sz;
+        cp = sz > 0 ? fileBytes * 100 / sz : cpm1;
 
         if (mReportProgress) {
             fp = fileBytes * 100 / sz;
@@ -331,6 +394,8 @@ bool JlWorker::copyData(QIODevice &inFile, QIODevice &outFile) {
             cpm1 = cp + mCPReport;
         }
     }
+    if (pipeline.failed())
+        ret = false;
     if (mReportProgress) {
         emit perFileProgressChanged(100);
         emit overallProgressChanged(mCurBytes * 100 / mTotalBytes);
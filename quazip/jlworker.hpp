@@ -40,6 +40,12 @@ class QUAZIP_EXPORT JlWorker : public JlCompressObj {
     virtual void setGlobalProgressReport(int percent) Q_DECL_OVERRIDE;
     virtual void setFileProgressReport(int percent) Q_DECL_OVERRIDE;
     virtual void setAbortPercentCheck(int percent);
+    virtual void setThreadCount(int threads) Q_DECL_OVERRIDE;
+    virtual void setMemoryCeiling(qint64 bytes) Q_DECL_OVERRIDE;
+    virtual void setCopyBufferSize(int bytes) Q_DECL_OVERRIDE;
+    virtual void setAutoMethod(bool enabled) Q_DECL_OVERRIDE;
+    virtual void setMethodPolicy(const QuaZipMethodPolicy &policy) Q_DECL_OVERRIDE;
+    virtual bool setCompression(int method, int level = Z_DEFAULT_COMPRESSION) Q_DECL_OVERRIDE;
     qint64 elapsedTime() const;
 signals:
     void finished();
@@ -59,6 +65,7 @@ signals:
 
     // before we make intensive use of mutex let see if it works without it... it should
     virtual bool copyData(QIODevice &inFile, QIODevice &outFile) Q_DECL_OVERRIDE;
+    virtual bool isAborted() const Q_DECL_OVERRIDE;
     enum Operation {
         None,
         SingleFile,
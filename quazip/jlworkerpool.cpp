@@ -0,0 +1,354 @@
+
+#include <QMutexLocker>
+#include <QThread>
+#include <limits.h>
+#include "jlworkerpool.hpp"
+
+/// @cond internal
+/// A thread of JlWorkerPool, running jobs until the pool is destroyed.
+class JlPoolRunner : public QThread {
+  public:
+    JlPoolRunner(JlWorkerPool *pool, int index) : mPool(pool), mIndex(index) {}
+
+  protected:
+    void run() Q_DECL_OVERRIDE {
+        while (JlWorkerPool::Job *job = mPool->takeJob(mIndex))
+            mPool->runJob(job);
+    }
+
+  private:
+    JlWorkerPool *mPool;
+    int mIndex;
+};
+/// @endcond
+
+/**
+ * @brief Constructor.
+ * @param threads Number of threads running jobs, 0 for QThread::idealThreadCount().
+ * @param capacity Maximum number of jobs waiting to run.
+ * @param parent Parent object.
+ */
+JlWorkerPool::JlWorkerPool(int threads, int capacity, QObject *parent)
+    : QObject(parent), mCapacity(qMax(1, capacity)), mPending(0), mActive(0), mNextId(1), mBatchJobs(0),
+      mBatchDone(0), mNotifying(0), mStopping(false) {
+    if (threads <= 0)
+        threads = qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < threads; ++i) {
+        mQueues << QList<Job *>();
+        mRunners << new JlPoolRunner(this, i);
+    }
+    Q_FOREACH (JlPoolRunner *runner, mRunners)
+        runner->start();
+}
+
+/**
+ * @brief Destructor.
+ * @details
+ * Cancels all the jobs, then waits for the running ones to stop.
+ */
+JlWorkerPool::~JlWorkerPool() {
+    cancelAll();
+    mMutex.lock();
+    mStopping = true;
+    mWorkAvailable.wakeAll();
+    mMutex.unlock();
+    Q_FOREACH (JlPoolRunner *runner, mRunners) {
+        runner->wait();
+        delete runner;
+    }
+}
+
+/**
+ * @brief Queue a compression job.
+ * @param compressedFile Path of the compressed file.
+ * @param filedir Either a directory or file path to compress.
+ * @param recursive For directory, @ti{true} to compress the directory contents recursively.
+ * @param filters For directory, what to pack (see JlWorker::setupCompression).
+ * @param priority Jobs with a higher priority run first.
+ * @return The job identifier, or -1 if the queue is full.
+ */
+int JlWorkerPool::submitCompression(const QString &compressedFile, const QString &filedir, bool recursive,
+                                    QDir::Filters filters, int priority) {
+    Job *job = new Job();
+    job->extract = false;
+    job->single = true;
+    job->compressedFile = compressedFile;
+    job->path = filedir;
+    job->recursive = recursive;
+    job->filters = filters;
+    job->priority = priority;
+    return enqueue(job);
+}
+
+/**
+ * @brief Queue a compression job.
+ * @param compressedFile Path of the compressed file.
+ * @param files List of files to compress.
+ * @param priority Jobs with a higher priority run first.
+ * @return The job identifier, or -1 if the queue is full.
+ */
+int JlWorkerPool::submitCompression(const QString &compressedFile, const QStringList &files, int priority) {
+    Job *job = new Job();
+    job->extract = false;
+    job->single = false;
+    job->compressedFile = compressedFile;
+    job->files = files;
+    job->recursive = false;
+    job->filters = 0;
+    job->priority = priority;
+    return enqueue(job);
+}
+
+/**
+ * @brief Queue an extraction job.
+ * @param compressedFile Path of the compressed file.
+ * @param source Optional file of the archive to extract, the whole archive if empty.
+ * @param dest Optional destination path on filesystem.
+ * @param priority Jobs with a higher priority run first.
+ * @return The job identifier, or -1 if the queue is full.
+ */
+int JlWorkerPool::submitExtraction(const QString &compressedFile, const QString &source, const QString &dest,
+                                   int priority) {
+    Job *job = new Job();
+    job->extract = true;
+    job->single = true;
+    job->compressedFile = compressedFile;
+    job->path = source;
+    job->dest = dest;
+    job->recursive = false;
+    job->filters = 0;
+    job->priority = priority;
+    return enqueue(job);
+}
+
+/**
+ * @brief Queue an extraction job.
+ * @param compressedFile Path of the compressed file.
+ * @param files List of files to extract, the whole archive if empty.
+ * @param dest Optional destination path on filesystem.
+ * @param priority Jobs with a higher priority run first.
+ * @return The job identifier, or -1 if the queue is full.
+ */
+int JlWorkerPool::submitExtraction(const QString &compressedFile, const QStringList &files, const QString &dest,
+                                   int priority) {
+    Job *job = new Job();
+    job->extract = true;
+    job->single = false;
+    job->compressedFile = compressedFile;
+    job->files = files;
+    job->dest = dest;
+    job->recursive = false;
+    job->filters = 0;
+    job->priority = priority;
+    return enqueue(job);
+}
+
+/// @brief Get the number of threads running jobs.
+int JlWorkerPool::threadCount() const { return mRunners.size(); }
+
+/// @brief Get the maximum number of jobs waiting to run.
+int JlWorkerPool::capacity() const { return mCapacity; }
+
+/// @brief Get the number of jobs waiting to run.
+int JlWorkerPool::pendingJobs() const {
+    QMutexLocker locker(&mMutex);
+    return mPending;
+}
+
+/// @brief Get the number of jobs running.
+int JlWorkerPool::activeJobs() const {
+    QMutexLocker locker(&mMutex);
+    return mActive;
+}
+
+/**
+ * @brief Get the list of the files extracted by a finished extraction job.
+ * @param jobId Job identifier.
+ * @details
+ * The list is kept by the pool until this method is called, so it can only be taken once.
+ */
+QStringList JlWorkerPool::takeExtractedFiles(int jobId) {
+    QMutexLocker locker(&mMutex);
+    return mExtracted.take(jobId);
+}
+
+/**
+ * @brief Wait for all the jobs to be over.
+ * @param msecs Maximum time to wait, -1 to wait forever.
+ * @return @ti{true} if the pool is idle, @ti{false} on timeout.
+ */
+bool JlWorkerPool::waitForDone(int msecs) {
+    QMutexLocker locker(&mMutex);
+    while (mPending > 0 || mActive > 0 || mNotifying > 0) {
+        if (!mIdle.wait(&mMutex, msecs < 0 ? ULONG_MAX : static_cast<unsigned long>(msecs)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Cancel a job.
+ * @param jobId Job identifier.
+ * @details
+ * A waiting job is removed from its queue and reported as failed right away. A running job is asked to stop, it
+ * is reported when its worker is done.
+ */
+void JlWorkerPool::cancel(int jobId) {
+    mMutex.lock();
+    Job *job = mJobs.value(jobId);
+    if (!job) {
+        mMutex.unlock();
+        return;
+    }
+    job->canceled = true;
+    bool queued = false;
+    for (int i = 0; i < mQueues.size() && !queued; ++i)
+        queued = mQueues[i].removeOne(job);
+    if (queued)
+        --mPending;
+    else if (job->worker)
+        job->worker->cancel();
+    mMutex.unlock();
+    if (queued)
+        jobDone(job, false, false);
+}
+
+/// @brief Cancel all the jobs, waiting and running.
+void JlWorkerPool::cancelAll() {
+    mMutex.lock();
+    QList<int> ids = mJobs.keys();
+    mMutex.unlock();
+    Q_FOREACH (int id, ids)
+        cancel(id);
+}
+
+/// @cond internal
+int JlWorkerPool::enqueue(Job *job) {
+    QMutexLocker locker(&mMutex);
+    if (mStopping || mPending >= mCapacity) {
+        delete job;
+        return -1;
+    }
+    job->id = mNextId++;
+    job->worker = Q_NULLPTR;
+    job->canceled = false;
+    job->progress = 0;
+    if (mPending == 0 && mActive == 0 && mNotifying == 0) {
+        mBatchJobs = 0;
+        mBatchDone = 0;
+    }
+    ++mBatchJobs;
+    // least loaded queue, ordered by priority then submission
+    int best = 0;
+    for (int i = 1; i < mQueues.size(); ++i) {
+        if (mQueues.at(i).size() < mQueues.at(best).size())
+            best = i;
+    }
+    QList<Job *> &queue = mQueues[best];
+    int pos = queue.size();
+    while (pos > 0 && queue.at(pos - 1)->priority < job->priority)
+        --pos;
+    queue.insert(pos, job);
+    mJobs.insert(job->id, job);
+    ++mPending;
+    mWorkAvailable.wakeOne();
+    return job->id;
+}
+
+JlWorkerPool::Job *JlWorkerPool::takeJob(int runner) {
+    QMutexLocker locker(&mMutex);
+    for (;;) {
+        if (mStopping)
+            return Q_NULLPTR;
+        int victim = runner;
+        if (mQueues.at(runner).isEmpty()) {
+            // steal the most urgent job of the busiest thread
+            for (int i = 0; i < mQueues.size(); ++i) {
+                if (mQueues.at(i).size() > mQueues.at(victim).size())
+                    victim = i;
+            }
+        }
+        if (!mQueues.at(victim).isEmpty()) {
+            --mPending;
+            ++mActive;
+            return mQueues[victim].takeFirst();
+        }
+        mWorkAvailable.wait(&mMutex);
+    }
+}
+
+void JlWorkerPool::runJob(Job *job) {
+    JlWorker worker(true);
+    worker.setThreadCount(1);
+    mMutex.lock();
+    bool canceled = job->canceled;
+    if (!canceled)
+        job->worker = &worker;
+    mMutex.unlock();
+    if (canceled) {
+        jobDone(job, false, true);
+        return;
+    }
+    emit jobStarted(job->id);
+    connect(&worker, &JlCompressObj::overallProgressChanged, [this, job](int value) { setJobProgress(job, value); });
+    if (job->extract) {
+        if (job->single)
+            worker.setupExtraction(job->compressedFile, job->path, job->dest);
+        else
+            worker.setupExtraction(job->compressedFile, job->files, job->dest);
+    } else {
+        if (job->single)
+            worker.setupCompression(job->compressedFile, job->path, job->recursive, job->filters);
+        else
+            worker.setupCompression(job->compressedFile, job->files);
+    }
+    worker.process();
+    mMutex.lock();
+    job->worker = Q_NULLPTR;
+    bool success = !worker.failed() && !job->canceled;
+    if (job->extract && success)
+        mExtracted.insert(job->id, worker.extractedFiles());
+    mMutex.unlock();
+    jobDone(job, success, true);
+}
+
+void JlWorkerPool::setJobProgress(Job *job, int value) {
+    mMutex.lock();
+    // JlWorker::process() clears the cancel flag when it starts, so repeat a cancellation that came early
+    if (job->canceled && job->worker)
+        job->worker->cancel();
+    job->progress = qBound(0, value, 100);
+    int total = mBatchDone * 100;
+    Q_FOREACH (Job *j, mJobs)
+        total += j->progress;
+    int overall = mBatchJobs ? total / mBatchJobs : 100;
+    mMutex.unlock();
+    emit jobProgressChanged(job->id, value);
+    emit overallProgressChanged(overall);
+}
+
+void JlWorkerPool::jobDone(Job *job, bool success, bool active) {
+    mMutex.lock();
+    mJobs.remove(job->id);
+    if (active)
+        --mActive;
+    ++mBatchDone;
+    int total = mBatchDone * 100;
+    Q_FOREACH (Job *j, mJobs)
+        total += j->progress;
+    int overall = total / mBatchJobs;
+    bool idle = mPending == 0 && mActive == 0;
+    // keep waitForDone() blocked until the signals are out
+    ++mNotifying;
+    mMutex.unlock();
+    emit jobFinished(job->id, success);
+    emit overallProgressChanged(overall);
+    if (idle)
+        emit allFinished();
+    delete job;
+    mMutex.lock();
+    if (--mNotifying == 0 && mPending == 0 && mActive == 0)
+        mIdle.wakeAll();
+    mMutex.unlock();
+}
+/// @endcond
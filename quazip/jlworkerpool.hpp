@@ -0,0 +1,139 @@
+#ifndef JLWORKERPOOL_HPP
+#define JLWORKERPOOL_HPP
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include "jlworker.hpp"
+
+class JlPoolRunner;
+
+/*!
+  @def JLPOOL_DEFAULT_CAPACITY
+  Default maximum number of jobs waiting in a JlWorkerPool (running jobs are not accounted for).
+*/
+#define JLPOOL_DEFAULT_CAPACITY 256
+
+/**
+ * @brief The JlWorkerPool class
+ * @details
+ * Runs many JlWorker jobs on a fixed set of threads, sparing the callers the QThread wiring shown in
+ * jlworkerguitest.
+ *
+ * Jobs are submitted with JlWorkerPool::submitCompression and JlWorkerPool::submitExtraction, which mirror
+ * JlWorker::setupCompression and JlWorker::setupExtraction and return a job identifier. The queue is bounded: when
+ * JlWorkerPool::capacity jobs are already waiting, submission fails and returns -1.
+ *
+ * Each pool thread owns a queue of jobs ordered by priority (higher first, then by submission order). New jobs go to
+ * the least loaded thread, and a thread whose queue is empty steals the most urgent job of the busiest one, so all
+ * threads stay busy as long as there is work. Jobs run with a single compression thread each
+ * (see JlCompressObj::setThreadCount) so that a busy pool does not oversubscribe the cores.
+ *
+ * A job can be canceled at any time with JlWorkerPool::cancel, whether it is still waiting or already running.
+ *
+ * Signals are emitted from the pool threads, so receivers living in other threads should use queued (or automatic)
+ * connections:
+ *    - JlWorkerPool::jobStarted
+ *    - JlWorkerPool::jobProgressChanged
+ *    - JlWorkerPool::jobFinished
+ *    - JlWorkerPool::overallProgressChanged
+ *    - JlWorkerPool::allFinished
+ */
+class QUAZIP_EXPORT JlWorkerPool : public QObject {
+    Q_OBJECT
+  public:
+    JlWorkerPool(int threads = 0, int capacity = JLPOOL_DEFAULT_CAPACITY, QObject *parent = Q_NULLPTR);
+    virtual ~JlWorkerPool();
+
+    int submitCompression(const QString &compressedFile, const QString &filedir = QString(), bool recursive = true,
+                          QDir::Filters filters = 0, int priority = 0);
+    int submitCompression(const QString &compressedFile, const QStringList &files, int priority = 0);
+    int submitExtraction(const QString &compressedFile, const QString &source = QString(),
+                         const QString &dest = QString(), int priority = 0);
+    int submitExtraction(const QString &compressedFile, const QStringList &files, const QString &dest = QString(),
+                         int priority = 0);
+
+    int threadCount() const;
+    int capacity() const;
+    int pendingJobs() const;
+    int activeJobs() const;
+    QStringList takeExtractedFiles(int jobId);
+    bool waitForDone(int msecs = -1);
+
+  public slots:
+    void cancel(int jobId);
+    void cancelAll();
+
+  signals:
+    /**
+     * @brief Emitted when a job starts running.
+     * @param jobId Job identifier.
+     */
+    void jobStarted(int jobId);
+    /**
+     * @brief Emitted whenever the overall progress of a job has changed.
+     * @param jobId Job identifier.
+     * @param value Percent done of the job.
+     */
+    void jobProgressChanged(int jobId, int value);
+    /**
+     * @brief Emitted when a job is over, either done, failed or canceled.
+     * @param jobId Job identifier.
+     * @param success @ti{true} if the job succeeded.
+     */
+    void jobFinished(int jobId, bool success);
+    /**
+     * @brief Emitted whenever the aggregated progress of all the jobs submitted since the pool was last idle has
+     * changed.
+     * @param value Percent done.
+     */
+    void overallProgressChanged(int value);
+    /// @brief Emitted when the last job is over and the pool becomes idle.
+    void allFinished();
+
+  private:
+    /// @cond internal
+    struct Job {
+        int id;
+        int priority;
+        bool extract;
+        bool single;
+        QString compressedFile;
+        QString path;
+        QStringList files;
+        QString dest;
+        bool recursive;
+        QDir::Filters filters;
+        JlWorker *worker;
+        bool canceled;
+        int progress;
+    };
+    /// @endcond
+    friend class JlPoolRunner;
+
+    int enqueue(Job *job);
+    Job *takeJob(int runner);
+    void runJob(Job *job);
+    void jobDone(Job *job, bool success, bool active);
+    void setJobProgress(Job *job, int value);
+
+    Q_DISABLE_COPY(JlWorkerPool)
+    QList<JlPoolRunner *> mRunners;
+    QList<QList<Job *> > mQueues;
+    QHash<int, Job *> mJobs;
+    QHash<int, QStringList> mExtracted;
+    mutable QMutex mMutex;
+    QWaitCondition mWorkAvailable;
+    QWaitCondition mIdle;
+    int mCapacity;
+    int mPending;
+    int mActive;
+    int mNextId;
+    int mBatchJobs;
+    int mBatchDone;
+    int mNotifying;
+    bool mStopping;
+};
+
+#endif // JLWORKERPOOL_HPP
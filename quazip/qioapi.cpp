@@ -22,6 +22,11 @@
 #ifdef QUAZIP_QSAVEFILE_BUG_WORKAROUND
 #include <QSaveFile>
 #endif
+#include <QFileDevice>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 /* I've found an old Unix (a SunOS 4.1.3_U1) without all SEEK_* defined.... */
 
@@ -360,4 +365,215 @@ void fill_zlib_filefunc64_32_def_from_filefunc32(zlib_filefunc64_32_def* p_filef
     p_filefunc64_32->zfile_func64.zfakeclose_file = NULL;
     p_filefunc64_32->zseek32_file = p_filefunc32->zseek_file;
     p_filefunc64_32->ztell32_file = p_filefunc32->ztell_file;
+    p_filefunc64_32->zmap_file = NULL;
+}
+
+/// @cond internal
+struct QIODevice_mapped_descriptor: public QIODevice_descriptor {
+    // The mapping of the whole file, NULL if the device can't be mapped.
+    uchar *map;
+    qint64 size;
+    inline QIODevice_mapped_descriptor():
+        map(NULL),
+        size(0)
+    {}
+};
+/// @endcond
+
+static void qiodevice_mapped_advise(uchar *addr, qint64 len, int advice)
+{
+#ifdef Q_OS_UNIX
+    // madvise() wants a page-aligned address
+    static const quintptr pageSize = static_cast<quintptr>(sysconf(_SC_PAGESIZE));
+    quintptr start = reinterpret_cast<quintptr>(addr) & ~(pageSize - 1);
+    len += reinterpret_cast<quintptr>(addr) - start;
+    madvise(reinterpret_cast<void*>(start), static_cast<size_t>(len), advice);
+#else
+    Q_UNUSED(addr);
+    Q_UNUSED(len);
+    Q_UNUSED(advice);
+#endif
+}
+
+static void qiodevice_mapped_release(QIODevice_mapped_descriptor *d,
+                                     QIODevice *iodevice)
+{
+    if (d->map != NULL) {
+        QFileDevice *file = qobject_cast<QFileDevice*>(iodevice);
+        if (file != NULL)
+            file->unmap(d->map);
+    }
+    delete d;
+}
+
+voidpf ZCALLBACK qiodevice_mapped_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_mapped_descriptor *d =
+        reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    // Mappings are read-only.
+    if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER)
+            != ZLIB_FILEFUNC_MODE_READ) {
+        delete d;
+        return NULL;
+    }
+    bool opened = false;
+    if (iodevice->isOpen()) {
+        if ((iodevice->openMode() & QIODevice::ReadOnly) == 0) {
+            delete d;
+            return NULL;
+        }
+    } else if (iodevice->open(QIODevice::ReadOnly)) {
+        opened = true;
+    } else {
+        delete d;
+        return NULL;
+    }
+    if (iodevice->isSequential()) {
+        if (opened)
+            iodevice->close();
+        delete d;
+        return NULL;
+    }
+    QFileDevice *fileDevice = qobject_cast<QFileDevice*>(iodevice);
+    if (fileDevice != NULL && fileDevice->size() > 0) {
+        d->map = fileDevice->map(0, fileDevice->size());
+        if (d->map != NULL) {
+            d->size = fileDevice->size();
+            d->pos = 0;
+            // Headers are read all over the place, entries get
+            // their own hint when they are opened.
+#ifdef Q_OS_UNIX
+            qiodevice_mapped_advise(d->map, d->size, MADV_RANDOM);
+#endif
+        }
+    }
+    // If mapping failed, fall back to plain device reads.
+    return iodevice;
+}
+
+uLong ZCALLBACK qiodevice_mapped_read_file_func (
+   voidpf opaque,
+   voidpf stream,
+   void* buf,
+   uLong size)
+{
+    QIODevice_mapped_descriptor *d =
+        reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->map == NULL)
+        return qiodevice_read_file_func(
+                static_cast<QIODevice_descriptor*>(d), stream, buf, size);
+    if (d->pos >= d->size)
+        return 0;
+    if (static_cast<qint64>(size) > d->size - d->pos)
+        size = static_cast<uLong>(d->size - d->pos);
+    memcpy(buf, d->map + d->pos, size);
+    d->pos += size;
+    return size;
+}
+
+ZPOS64_T ZCALLBACK qiodevice_mapped_tell_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_mapped_descriptor *d =
+        reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->map == NULL)
+        return qiodevice64_tell_file_func(
+                static_cast<QIODevice_descriptor*>(d), stream);
+    return static_cast<ZPOS64_T>(d->pos);
+}
+
+int ZCALLBACK qiodevice_mapped_seek_file_func (
+   voidpf opaque,
+   voidpf stream,
+   ZPOS64_T offset,
+   int origin)
+{
+    QIODevice_mapped_descriptor *d =
+        reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->map == NULL)
+        return qiodevice64_seek_file_func(
+                static_cast<QIODevice_descriptor*>(d), stream, offset, origin);
+    qint64 pos;
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        pos = d->pos + offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        pos = d->size - offset;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        pos = offset;
+        break;
+    default:
+        return -1;
+    }
+    if (pos < 0 || pos > d->size)
+        return -1;
+    d->pos = pos;
+    return 0;
+}
+
+int ZCALLBACK qiodevice_mapped_close_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    qiodevice_mapped_release(
+            reinterpret_cast<QIODevice_mapped_descriptor*>(opaque), device);
+    device->close();
+    return 0;
+}
+
+int ZCALLBACK qiodevice_mapped_fakeclose_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    qiodevice_mapped_release(
+            reinterpret_cast<QIODevice_mapped_descriptor*>(opaque),
+            reinterpret_cast<QIODevice*>(stream));
+    return 0;
+}
+
+const void* ZCALLBACK qiodevice_mapped_map_file_func (
+   voidpf opaque,
+   voidpf /*stream UNUSED*/,
+   ZPOS64_T offset,
+   ZPOS64_T size)
+{
+    QIODevice_mapped_descriptor *d =
+        reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->map == NULL || offset > static_cast<ZPOS64_T>(d->size)
+            || size > static_cast<ZPOS64_T>(d->size) - offset)
+        return NULL;
+    if (size != 0) {
+#ifdef Q_OS_UNIX
+        qiodevice_mapped_advise(d->map + offset, size, MADV_WILLNEED);
+#endif
+    }
+    return d->map + offset;
+}
+
+void fill_qiodevice64_mapped_filefunc (
+  zlib_filefunc64_32_def* p_filefunc64_32)
+{
+    zlib_filefunc64_def *pzlib_filefunc_def = &p_filefunc64_32->zfile_func64;
+    pzlib_filefunc_def->zopen64_file = qiodevice_mapped_open_file_func;
+    pzlib_filefunc_def->zread_file = qiodevice_mapped_read_file_func;
+    pzlib_filefunc_def->zwrite_file = qiodevice_write_file_func;
+    pzlib_filefunc_def->ztell64_file = qiodevice_mapped_tell_file_func;
+    pzlib_filefunc_def->zseek64_file = qiodevice_mapped_seek_file_func;
+    pzlib_filefunc_def->zclose_file = qiodevice_mapped_close_file_func;
+    pzlib_filefunc_def->zerror_file = qiodevice_error_file_func;
+    pzlib_filefunc_def->opaque = new QIODevice_mapped_descriptor;
+    pzlib_filefunc_def->zfakeclose_file = qiodevice_mapped_fakeclose_file_func;
+    p_filefunc64_32->zopen32_file = NULL;
+    p_filefunc64_32->ztell32_file = NULL;
+    p_filefunc64_32->zseek32_file = NULL;
+    p_filefunc64_32->zmap_file = qiodevice_mapped_map_file_func;
 }
@@ -25,7 +25,9 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "quaadler32.h"
 
-#include "zlib.h"
+#include "quaadler32engine.h"
+
+#define QUAADLER32_MOD 65521u
 
 QuaAdler32::QuaAdler32()
 {
@@ -34,7 +36,7 @@ QuaAdler32::QuaAdler32()
 
 quint32 QuaAdler32::calculate(const QByteArray &data)
 {
-	return adler32( adler32(0L, Z_NULL, 0), (const Bytef*)data.data(), data.size() );
+	return quaadler32( adler32(0L, Z_NULL, 0), (const Bytef*)data.data(), data.size() );
 }
 
 void QuaAdler32::reset()
@@ -44,10 +46,27 @@ void QuaAdler32::reset()
 
 void QuaAdler32::update(const QByteArray &buf)
 {
-	checksum = adler32( checksum, (const Bytef*)buf.data(), buf.size() );
+	checksum = quaadler32( checksum, (const Bytef*)buf.data(), buf.size() );
 }
 
 quint32 QuaAdler32::value()
 {
 	return checksum;
 }
+
+quint32 QuaAdler32::combine(quint32 adler1, quint32 adler2, qint64 len2)
+{
+	// zlib's adler32_combine(), which takes an z_off_t that may be 32-bit
+	if (len2 < 0)
+		return 0xffffffffu;
+	quint32 rem = static_cast<quint32>(len2 % QUAADLER32_MOD);
+	quint32 sum1 = adler1 & 0xffff;
+	quint32 sum2 = (rem * sum1) % QUAADLER32_MOD;
+	sum1 += (adler2 & 0xffff) + QUAADLER32_MOD - 1;
+	sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + QUAADLER32_MOD - rem;
+	if (sum1 >= QUAADLER32_MOD) sum1 -= QUAADLER32_MOD;
+	if (sum1 >= QUAADLER32_MOD) sum1 -= QUAADLER32_MOD;
+	if (sum2 >= (QUAADLER32_MOD << 1)) sum2 -= (QUAADLER32_MOD << 1);
+	if (sum2 >= QUAADLER32_MOD) sum2 -= QUAADLER32_MOD;
+	return sum1 | (sum2 << 16);
+}
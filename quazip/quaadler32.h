@@ -34,6 +34,10 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 /** \class QuaAdler32 quaadler32.h <quazip/quaadler32.h>
  * This class wrappers the adler32 function with the QuaChecksum32 interface.
  * See QuaChecksum32 for more info.
+ *
+ * The checksum is computed by the Adler-32 engine of quaadler32engine.h,
+ * which sums 32 bytes at a time with the SSSE3, AVX2 or NEON instructions
+ * of the CPU when available.
  */
 class QUAZIP_EXPORT QuaAdler32 : public QuaChecksum32
 {
@@ -47,6 +51,24 @@ public:
 	void update(const QByteArray &buf);
 	quint32 value();
 
+	/// Combines the checksums of two consecutive blocks of data.
+	/**
+	 * Returns the Adler-32 of the first block followed by the second
+	 * one, given the checksum \a adler1 of the first one, the
+	 * checksum \a adler2 of the second one and the size \a len2 of the
+	 * second one in bytes, the same as zlib's adler32_combine().
+	 *
+	 * This allows to checksum a large buffer in parallel: each thread
+	 * calculates the checksum of its own chunk, then the results are
+	 * combined in order:
+	 * \code
+	 * quint32 total = QuaAdler32().calculate(QByteArray());
+	 * for (int i = 0; i < chunks.size(); ++i)
+	 *     total = QuaAdler32::combine(total, sums[i], chunks[i].size());
+	 * \endcode
+	 */
+	static quint32 combine(quint32 adler1, quint32 adler2, qint64 len2);
+
 private:
 	quint32 checksum;
 };
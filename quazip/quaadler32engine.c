@@ -0,0 +1,385 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quaadler32engine.h"
+
+#ifndef QUAADLER32_NO_SIMD
+#  if (defined(__x86_64__) || defined(_M_X64)) \
+      && (defined(__GNUC__) || defined(_MSC_VER))
+#    define QUAADLER32_HAVE_X86
+#  endif
+#  if (defined(__aarch64__) || defined(_M_ARM64)) \
+      && (defined(__GNUC__) || defined(_MSC_VER))
+#    define QUAADLER32_HAVE_NEON
+#  endif
+#endif
+
+#ifdef QUAADLER32_HAVE_X86
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#    include <immintrin.h>
+#    define QUAADLER32_SSSE3_TARGET
+#    define QUAADLER32_AVX2_TARGET
+#  else
+#    include <cpuid.h>
+#    include <immintrin.h>
+#    define QUAADLER32_SSSE3_TARGET __attribute__((target("ssse3")))
+#    define QUAADLER32_AVX2_TARGET __attribute__((target("avx2")))
+#  endif
+#endif
+
+#ifdef QUAADLER32_HAVE_NEON
+#  include <arm_neon.h>
+#endif
+
+#define QUAADLER32_BASE 65521UL
+/* the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits in 32 bits */
+#define QUAADLER32_NMAX 5552
+/* the SIMD implementations sum blocks of 32 bytes */
+#define QUAADLER32_BLOCK 32
+
+static volatile int quaadler32_ready = 0;
+static int quaadler32_best = QUAADLER32_PORTABLE;
+
+#ifdef QUAADLER32_HAVE_X86
+static int quaadler32_cpuid(unsigned int leaf, unsigned int* regs)
+{
+#  ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if ((unsigned int)info[0] < leaf)
+        return 0;
+    __cpuidex(info, (int)leaf, 0);
+    regs[0] = (unsigned int)info[0];
+    regs[1] = (unsigned int)info[1];
+    regs[2] = (unsigned int)info[2];
+    regs[3] = (unsigned int)info[3];
+    return 1;
+#  else
+    if (__get_cpuid_max(0, NULL) < leaf)
+        return 0;
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+    return 1;
+#  endif
+}
+
+/* Whether the OS saves the AVX registers on context switches. */
+static int quaadler32_avx_enabled(void)
+{
+#  ifdef _MSC_VER
+    return (_xgetbv(0) & 6) == 6;
+#  else
+    unsigned int eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (eax & 6) == 6;
+#  endif
+}
+#endif
+
+static int quaadler32_detect(int impl)
+{
+#ifdef QUAADLER32_HAVE_X86
+    unsigned int regs[4];
+#endif
+    switch (impl)
+    {
+    case QUAADLER32_PORTABLE:
+        return 1;
+#ifdef QUAADLER32_HAVE_X86
+    case QUAADLER32_SSSE3:
+        return quaadler32_cpuid(1, regs) && (regs[2] & (1 << 9)) != 0;
+    case QUAADLER32_AVX2:
+        /* AVX and OSXSAVE, then AVX2 */
+        if (!quaadler32_cpuid(1, regs) || (regs[2] & (3u << 27)) != (3u << 27)
+                || !quaadler32_avx_enabled())
+            return 0;
+        return quaadler32_cpuid(7, regs) && (regs[1] & (1 << 5)) != 0;
+#endif
+#ifdef QUAADLER32_HAVE_NEON
+    case QUAADLER32_NEON:
+        /* always there on AArch64 */
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+static void quaadler32_init(void)
+{
+    if (quaadler32_detect(QUAADLER32_AVX2))
+        quaadler32_best = QUAADLER32_AVX2;
+    else if (quaadler32_detect(QUAADLER32_SSSE3))
+        quaadler32_best = QUAADLER32_SSSE3;
+    else if (quaadler32_detect(QUAADLER32_NEON))
+        quaadler32_best = QUAADLER32_NEON;
+    else
+        quaadler32_best = QUAADLER32_PORTABLE;
+    quaadler32_ready = 1;
+}
+
+#define QUAADLER32_DO1(buf, i)  {s1 += (buf)[i]; s2 += s1;}
+#define QUAADLER32_DO4(buf, i)  QUAADLER32_DO1(buf, i); QUAADLER32_DO1(buf, i + 1); \
+                                QUAADLER32_DO1(buf, i + 2); QUAADLER32_DO1(buf, i + 3);
+#define QUAADLER32_DO16(buf)    QUAADLER32_DO4(buf, 0); QUAADLER32_DO4(buf, 4); \
+                                QUAADLER32_DO4(buf, 8); QUAADLER32_DO4(buf, 12);
+
+/* zlib's loop: the sums are only reduced every NMAX bytes. */
+static uLong quaadler32_portable(uLong adler, const unsigned char* buf, size_t len)
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    while (len > 0)
+    {
+        size_t n = len < QUAADLER32_NMAX ? len : QUAADLER32_NMAX;
+        len -= n;
+        while (n >= 16)
+        {
+            QUAADLER32_DO16(buf);
+            buf += 16;
+            n -= 16;
+        }
+        while (n-- > 0)
+        {
+            s1 += *buf++;
+            s2 += s1;
+        }
+        s1 %= QUAADLER32_BASE;
+        s2 %= QUAADLER32_BASE;
+    }
+    return s1 | (s2 << 16);
+}
+
+/*
+  The SIMD implementations sum up to NMAX / 32 blocks of 32 bytes before
+  reducing. For each block, s1 gets the sum of the bytes and s2 gets
+  32 times the s1 of the previous blocks plus the bytes weighted by
+  32, 31, ..., 1; the weighted sums come from multiply-add instructions,
+  the previous s1 are accumulated separately and multiplied by 32 (a
+  shift) once per run.
+*/
+
+#ifdef QUAADLER32_HAVE_X86
+static unsigned long quaadler32_hsum128(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return (unsigned long)(unsigned int)_mm_cvtsi128_si32(v);
+}
+
+QUAADLER32_SSSE3_TARGET
+static uLong quaadler32_ssse3(uLong adler, const unsigned char* buf, size_t len)
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    size_t blocks = len / QUAADLER32_BLOCK;
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    len -= blocks * QUAADLER32_BLOCK;
+    while (blocks > 0)
+    {
+        size_t n = QUAADLER32_NMAX / QUAADLER32_BLOCK;
+        __m128i v_ps, v_s1, v_s2;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+        v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+        v_s1 = zero;
+        v_s2 = _mm_cvtsi32_si128((int)s2);
+        do
+        {
+            const __m128i bytes1 = _mm_loadu_si128((const __m128i*)buf);
+            const __m128i bytes2 = _mm_loadu_si128((const __m128i*)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes1, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes2, zero));
+            v_s2 = _mm_add_epi32(v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+            buf += QUAADLER32_BLOCK;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+        s1 = (s1 + quaadler32_hsum128(v_s1)) % QUAADLER32_BASE;
+        s2 = quaadler32_hsum128(v_s2) % QUAADLER32_BASE;
+    }
+    return quaadler32_portable(s1 | (s2 << 16), buf, len);
+}
+
+QUAADLER32_AVX2_TARGET
+static uLong quaadler32_avx2(uLong adler, const unsigned char* buf, size_t len)
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    size_t blocks = len / QUAADLER32_BLOCK;
+    const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                         24, 23, 22, 21, 20, 19, 18, 17,
+                                         16, 15, 14, 13, 12, 11, 10, 9,
+                                         8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    len -= blocks * QUAADLER32_BLOCK;
+    while (blocks > 0)
+    {
+        size_t n = QUAADLER32_NMAX / QUAADLER32_BLOCK;
+        __m256i v_ps, v_s1, v_s2;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+        v_ps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        v_s1 = zero;
+        v_s2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+        do
+        {
+            const __m256i bytes = _mm256_loadu_si256((const __m256i*)buf);
+            v_ps = _mm256_add_epi32(v_ps, v_s1);
+            v_s1 = _mm256_add_epi32(v_s1, _mm256_sad_epu8(bytes, zero));
+            v_s2 = _mm256_add_epi32(v_s2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, tap), ones));
+            buf += QUAADLER32_BLOCK;
+        } while (--n);
+        v_s2 = _mm256_add_epi32(v_s2, _mm256_slli_epi32(v_ps, 5));
+        s1 = (s1 + quaadler32_hsum128(_mm_add_epi32(_mm256_castsi256_si128(v_s1),
+                                                    _mm256_extracti128_si256(v_s1, 1))))
+            % QUAADLER32_BASE;
+        s2 = quaadler32_hsum128(_mm_add_epi32(_mm256_castsi256_si128(v_s2),
+                                              _mm256_extracti128_si256(v_s2, 1)))
+            % QUAADLER32_BASE;
+    }
+    return quaadler32_portable(s1 | (s2 << 16), buf, len);
+}
+#endif
+
+#ifdef QUAADLER32_HAVE_NEON
+static uLong quaadler32_neon(uLong adler, const unsigned char* buf, size_t len)
+{
+    static const unsigned short taps[32] = {
+        32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+        16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1
+    };
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    size_t blocks = len / QUAADLER32_BLOCK;
+    len -= blocks * QUAADLER32_BLOCK;
+    while (blocks > 0)
+    {
+        size_t n = QUAADLER32_NMAX / QUAADLER32_BLOCK;
+        uint32x4_t v_s1 = vdupq_n_u32(0);
+        uint32x4_t v_s2;
+        /* the sums of each of the 32 columns, at most 173 * 255 */
+        uint16x8_t v_col1 = vdupq_n_u16(0);
+        uint16x8_t v_col2 = vdupq_n_u16(0);
+        uint16x8_t v_col3 = vdupq_n_u16(0);
+        uint16x8_t v_col4 = vdupq_n_u16(0);
+        uint32x2_t sum1, sum2, s1s2;
+        if (n > blocks)
+            n = blocks;
+        blocks -= n;
+        v_s2 = vsetq_lane_u32((uint32_t)(s1 * n), vdupq_n_u32(0), 3);
+        do
+        {
+            const uint8x16_t bytes1 = vld1q_u8(buf);
+            const uint8x16_t bytes2 = vld1q_u8(buf + 16);
+            v_s2 = vaddq_u32(v_s2, v_s1);
+            v_s1 = vpadalq_u16(v_s1, vpadalq_u8(vpaddlq_u8(bytes1), bytes2));
+            v_col1 = vaddw_u8(v_col1, vget_low_u8(bytes1));
+            v_col2 = vaddw_u8(v_col2, vget_high_u8(bytes1));
+            v_col3 = vaddw_u8(v_col3, vget_low_u8(bytes2));
+            v_col4 = vaddw_u8(v_col4, vget_high_u8(bytes2));
+            buf += QUAADLER32_BLOCK;
+        } while (--n);
+        v_s2 = vshlq_n_u32(v_s2, 5);
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col1), vld1_u16(taps + 0));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col1), vld1_u16(taps + 4));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col2), vld1_u16(taps + 8));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col2), vld1_u16(taps + 12));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col3), vld1_u16(taps + 16));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col3), vld1_u16(taps + 20));
+        v_s2 = vmlal_u16(v_s2, vget_low_u16(v_col4), vld1_u16(taps + 24));
+        v_s2 = vmlal_u16(v_s2, vget_high_u16(v_col4), vld1_u16(taps + 28));
+        sum1 = vpadd_u32(vget_low_u32(v_s1), vget_high_u32(v_s1));
+        sum2 = vpadd_u32(vget_low_u32(v_s2), vget_high_u32(v_s2));
+        s1s2 = vpadd_u32(sum1, sum2);
+        s1 = (s1 + vget_lane_u32(s1s2, 0)) % QUAADLER32_BASE;
+        s2 = (s2 + vget_lane_u32(s1s2, 1)) % QUAADLER32_BASE;
+    }
+    return quaadler32_portable(s1 | (s2 << 16), buf, len);
+}
+#endif
+
+uLong quaadler32_using(int impl, uLong adler, const unsigned char* buf, size_t len)
+{
+    if (buf == NULL)
+        return 1;
+    switch (impl)
+    {
+#ifdef QUAADLER32_HAVE_X86
+    case QUAADLER32_SSSE3:
+        return quaadler32_ssse3(adler, buf, len);
+    case QUAADLER32_AVX2:
+        return quaadler32_avx2(adler, buf, len);
+#endif
+#ifdef QUAADLER32_HAVE_NEON
+    case QUAADLER32_NEON:
+        return quaadler32_neon(adler, buf, len);
+#endif
+    default:
+        return quaadler32_portable(adler, buf, len);
+    }
+}
+
+uLong quaadler32(uLong adler, const unsigned char* buf, size_t len)
+{
+    if (!quaadler32_ready)
+        quaadler32_init();
+    return quaadler32_using(quaadler32_best, adler, buf, len);
+}
+
+int quaadler32_available(int impl)
+{
+    return quaadler32_detect(impl);
+}
+
+int quaadler32_implementation(void)
+{
+    if (!quaadler32_ready)
+        quaadler32_init();
+    return quaadler32_best;
+}
+
+const char* quaadler32_name(int impl)
+{
+    switch (impl)
+    {
+    case QUAADLER32_SSSE3:
+        return "ssse3";
+    case QUAADLER32_AVX2:
+        return "avx2";
+    case QUAADLER32_NEON:
+        return "neon";
+    default:
+        return "portable";
+    }
+}
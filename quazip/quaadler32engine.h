@@ -0,0 +1,75 @@
+#ifndef QUAADLER32ENGINE_H
+#define QUAADLER32ENGINE_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+/*
+  The Adler-32 used by QuaAdler32, a drop-in replacement for zlib's
+  adler32().
+
+  The implementation is picked at run time, on the first call:
+    - QUAADLER32_AVX2 and QUAADLER32_SSSE3 sum 32 bytes at a time with
+      multiply-add instructions (x86-64);
+    - QUAADLER32_NEON does the same with NEON (AArch64);
+    - QUAADLER32_PORTABLE, zlib's unrolled loop, everywhere else.
+  Define QUAADLER32_NO_SIMD to build the portable one only.
+*/
+
+#include <stddef.h>
+
+#include "zlib.h"
+
+#include "quazip_global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUAADLER32_PORTABLE 0
+#define QUAADLER32_SSSE3 1
+#define QUAADLER32_AVX2 2
+#define QUAADLER32_NEON 3
+
+/* Updates adler with len bytes of buf, like adler32(). */
+QUAZIP_EXPORT uLong quaadler32(uLong adler, const unsigned char* buf, size_t len);
+
+/* Same as quaadler32(), with the implementation impl, which must be available. */
+QUAZIP_EXPORT uLong quaadler32_using(int impl, uLong adler,
+                                     const unsigned char* buf, size_t len);
+
+/* Returns 1 if the implementation impl can run on this CPU, 0 otherwise. */
+QUAZIP_EXPORT int quaadler32_available(int impl);
+
+/* Returns the implementation used by quaadler32(). */
+QUAZIP_EXPORT int quaadler32_implementation(void);
+
+/* Returns the name of the implementation impl. */
+QUAZIP_EXPORT const char* quaadler32_name(int impl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUAADLER32ENGINE_H */
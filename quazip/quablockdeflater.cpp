@@ -0,0 +1,315 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quablockdeflater.h"
+#include "quacrc32engine.h"
+
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <string.h>
+
+/// \cond internal
+
+/// Size of the window used to prime a block with the previous one.
+#define QUABLOCK_DICT_SIZE 32768
+
+struct QuaDeflateBlock {
+  QByteArray input;
+  QByteArray dictionary;
+  QByteArray output;
+  qint64 inputSize;
+  quint32 crc;
+  bool last;
+  bool done;
+  bool ok;
+  QuaDeflateBlock(): inputSize(0), crc(0), last(false), done(false),
+    ok(false) {}
+};
+
+class QuaBlockDeflaterPrivate {
+  friend class QuaBlockDeflater;
+  friend class QuaDeflateBlockTask;
+  QuaBlockDeflaterPrivate(int level, int threads, int blockSize,
+      int queueDepth, int memLevel, int strategy, bool gzipMembers);
+  QThreadPool pool;
+  QMutex mutex;
+  QWaitCondition blockDone;
+  QList<QuaDeflateBlock*> queue;
+  QByteArray pending;
+  QByteArray previous;
+  int level;
+  int memLevel;
+  int strategy;
+  int blockSize;
+  int queueDepth;
+  bool gzipMembers;
+  int running;
+  quint32 crc;
+  quint64 totalIn;
+  quint64 totalOut;
+  bool failed;
+  bool finished;
+  void submit(bool last);
+  static bool deflateBlock(QuaDeflateBlock *block, int level, int memLevel,
+      int strategy, bool gzipMember);
+  static void wrapMember(QuaDeflateBlock *block);
+};
+
+class QuaDeflateBlockTask: public QRunnable {
+public:
+  QuaDeflateBlockTask(QuaBlockDeflaterPrivate *d, QuaDeflateBlock *block):
+    d(d), block(block) {}
+  void run();
+private:
+  QuaBlockDeflaterPrivate *d;
+  QuaDeflateBlock *block;
+};
+
+void QuaDeflateBlockTask::run()
+{
+  bool ok = QuaBlockDeflaterPrivate::deflateBlock(block, d->level,
+      d->memLevel, d->strategy, d->gzipMembers);
+  QMutexLocker locker(&d->mutex);
+  block->ok = ok;
+  block->done = true;
+  --d->running;
+  if (!ok)
+    d->failed = true;
+  d->blockDone.wakeAll();
+}
+
+QuaBlockDeflaterPrivate::QuaBlockDeflaterPrivate(int level, int threads,
+    int blockSize, int queueDepth, int memLevel, int strategy,
+    bool gzipMembers):
+  level(level),
+  memLevel(memLevel),
+  strategy(strategy),
+  blockSize(qMax(blockSize, QUABLOCK_DICT_SIZE)),
+  queueDepth(queueDepth > 0 ? queueDepth : 2 * qMax(threads, 1)),
+  gzipMembers(gzipMembers),
+  running(0),
+  crc(crc32(0L, Z_NULL, 0)),
+  totalIn(0),
+  totalOut(0),
+  failed(false),
+  finished(false)
+{
+  pool.setMaxThreadCount(threads > 0 ? threads
+      : qMax(1, QThread::idealThreadCount()));
+  pending.reserve(this->blockSize);
+}
+
+bool QuaBlockDeflaterPrivate::deflateBlock(QuaDeflateBlock *block, int level,
+    int memLevel, int strategy, bool gzipMember)
+{
+  const QByteArray &input = block->input;
+  block->inputSize = input.size();
+  block->crc = quacrc32(crc32(0L, Z_NULL, 0),
+      reinterpret_cast<const Bytef*>(input.constData()), input.size());
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, memLevel,
+        strategy) != Z_OK)
+    return false;
+  if (!block->dictionary.isEmpty() && deflateSetDictionary(&stream,
+        reinterpret_cast<const Bytef*>(block->dictionary.constData()),
+        block->dictionary.size()) != Z_OK) {
+    deflateEnd(&stream);
+    return false;
+  }
+  // deflateBound() does not account for the sync flush marker
+  block->output.resize(deflateBound(&stream, input.size()) + 16);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(
+        input.constData()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef*>(block->output.data());
+  stream.avail_out = block->output.size();
+  bool end = block->last || gzipMember;
+  int flush = end ? Z_FINISH : Z_SYNC_FLUSH;
+  int err;
+  for (;;) {
+    err = deflate(&stream, flush);
+    if (err == Z_STREAM_END || (err != Z_OK && err != Z_BUF_ERROR))
+      break;
+    if (stream.avail_out != 0) {
+      if (!end || err == Z_BUF_ERROR)
+        break;
+      continue;
+    }
+    // out of room, should not happen given deflateBound()
+    int used = block->output.size() - stream.avail_out;
+    block->output.resize(block->output.size() * 2);
+    stream.next_out = reinterpret_cast<Bytef*>(block->output.data() + used);
+    stream.avail_out = block->output.size() - used;
+  }
+  block->output.resize(block->output.size() - stream.avail_out);
+  deflateEnd(&stream);
+  block->input = QByteArray();
+  block->dictionary = QByteArray();
+  if (gzipMember && err == Z_STREAM_END)
+    wrapMember(block);
+  return end ? err == Z_STREAM_END : err == Z_OK;
+}
+
+static void putLittleEndian(char *p, quint32 value, int size)
+{
+  for (int i = 0; i < size; ++i)
+    p[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+}
+
+void QuaBlockDeflaterPrivate::wrapMember(QuaDeflateBlock *block)
+{
+  // the BGZF header when the member fits in its 16-bit size field
+  static const char bgzfHeader[18] = {
+    '\x1f', '\x8b', 8, 4, 0, 0, 0, 0, 0, '\xff', 6, 0, 'B', 'C', 2, 0, 0, 0
+  };
+  int total = 18 + block->output.size() + 8;
+  int headerSize = total <= 65536 ? 18 : 10;
+  QByteArray member(bgzfHeader, headerSize);
+  if (headerSize == 18) {
+    putLittleEndian(member.data() + 16, static_cast<quint32>(total - 1), 2);
+  } else {
+    member[3] = 0;
+  }
+  member.append(block->output);
+  char trailer[8];
+  putLittleEndian(trailer, block->crc, 4);
+  putLittleEndian(trailer + 4, static_cast<quint32>(block->inputSize), 4);
+  member.append(trailer, 8);
+  block->output = member;
+}
+
+void QuaBlockDeflaterPrivate::submit(bool last)
+{
+  QuaDeflateBlock *block = new QuaDeflateBlock();
+  block->last = last;
+  block->input = pending;
+  if (!gzipMembers) {
+    if (!previous.isEmpty())
+      block->dictionary = previous.right(QUABLOCK_DICT_SIZE);
+    previous = pending;
+  }
+  pending = QByteArray();
+  pending.reserve(blockSize);
+  QMutexLocker locker(&mutex);
+  while (running >= queueDepth)
+    blockDone.wait(&mutex);
+  queue.append(block);
+  ++running;
+  pool.start(new QuaDeflateBlockTask(this, block));
+}
+/// \endcond
+
+QuaBlockDeflater::QuaBlockDeflater(int level, int threads, int blockSize,
+    int queueDepth, int memLevel, int strategy, bool gzipMembers):
+  d(new QuaBlockDeflaterPrivate(level, threads, blockSize, queueDepth,
+        memLevel, strategy, gzipMembers))
+{
+}
+
+QuaBlockDeflater::~QuaBlockDeflater()
+{
+  d->pool.waitForDone();
+  qDeleteAll(d->queue);
+  delete d;
+}
+
+bool QuaBlockDeflater::write(const char *data, qint64 size)
+{
+  if (d->finished)
+    return false;
+  while (size > 0) {
+    int n = static_cast<int>(qMin<qint64>(size,
+          d->blockSize - d->pending.size()));
+    d->pending.append(data, n);
+    data += n;
+    size -= n;
+    if (d->pending.size() == d->blockSize)
+      d->submit(false);
+  }
+  QMutexLocker locker(&d->mutex);
+  return !d->failed;
+}
+
+bool QuaBlockDeflater::flush()
+{
+  if (d->finished)
+    return false;
+  if (!d->pending.isEmpty())
+    d->submit(false);
+  QMutexLocker locker(&d->mutex);
+  while (d->running > 0)
+    d->blockDone.wait(&d->mutex);
+  return !d->failed;
+}
+
+bool QuaBlockDeflater::finish()
+{
+  if (!d->finished) {
+    // members end with an empty one, the BGZF end-of-file marker
+    if (d->gzipMembers && !d->pending.isEmpty())
+      d->submit(false);
+    d->submit(true);
+    d->finished = true;
+  }
+  d->pool.waitForDone();
+  QMutexLocker locker(&d->mutex);
+  return !d->failed;
+}
+
+QByteArray QuaBlockDeflater::takeOutput()
+{
+  QByteArray output;
+  QMutexLocker locker(&d->mutex);
+  while (!d->queue.isEmpty() && d->queue.first()->done) {
+    QuaDeflateBlock *block = d->queue.takeFirst();
+    if (block->ok) {
+      output.append(block->output);
+      d->crc = crc32_combine(d->crc, block->crc, block->inputSize);
+      d->totalIn += block->inputSize;
+      d->totalOut += block->output.size();
+    }
+    delete block;
+  }
+  return output;
+}
+
+quint32 QuaBlockDeflater::crc() const
+{
+  return d->crc;
+}
+
+quint64 QuaBlockDeflater::totalIn() const
+{
+  return d->totalIn;
+}
+
+quint64 QuaBlockDeflater::totalOut() const
+{
+  return d->totalOut;
+}
@@ -0,0 +1,108 @@
+#ifndef QUAZIP_QUABLOCKDEFLATER_H
+#define QUAZIP_QUABLOCKDEFLATER_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QByteArray>
+#include <QList>
+
+#include "quazip_global.h"
+
+#include <zlib.h>
+
+/// \cond internal
+class QuaBlockDeflaterPrivate;
+
+/// Block-parallel raw deflate compressor.
+/**
+  Splits its input into fixed-size blocks that are deflated on a thread
+  pool, pigz style. Each block is primed with the last 32 KiB of the
+  previous one and ends on a sync flush boundary, except the last one
+  which ends the stream. Concatenated in order, the blocks form a single
+  raw deflate stream that any inflater can read.
+
+  The CRC-32 of the whole input is computed block by block and combined
+  with crc32_combine().
+
+  In the GZIP members mode, each block is deflated on its own instead,
+  into a whole GZIP member. A member that fits in 64 KiB has the BGZF
+  extra field, so that BgzfBlockSize blocks make a BGZF file, and
+  finish() ends the output with the empty BGZF end-of-file member.
+
+  This class is not thread-safe: write(), finish() and takeOutput() must
+  be called from the same thread.
+  */
+class QuaBlockDeflater {
+public:
+  enum {
+    /// Default size of an input block.
+    DefaultBlockSize = 128 * 1024,
+    /// The largest input block that always fits in a BGZF member.
+    BgzfBlockSize = 65280
+  };
+  /// Constructor.
+  /**
+    \param level The compression level.
+    \param threads The number of threads deflating blocks.
+    \param blockSize The size of an input block, at least 32 KiB.
+    \param queueDepth How many blocks may be in flight at once, 0 meaning
+    twice the number of threads. write() blocks while the queue is full.
+    \param memLevel The zlib memory level.
+    \param strategy The zlib strategy.
+    \param gzipMembers Whether to make a GZIP member of each block
+    rather than a single raw deflate stream.
+    */
+  QuaBlockDeflater(int level, int threads, int blockSize = DefaultBlockSize,
+      int queueDepth = 0, int memLevel = 8,
+      int strategy = Z_DEFAULT_STRATEGY, bool gzipMembers = false);
+  /// Destructor. Waits for the pending blocks and discards them.
+  ~QuaBlockDeflater();
+  /// Feeds data to the compressor.
+  /** Returns false if a previous block failed to compress. */
+  bool write(const char *data, qint64 size);
+  /// Compresses the pending input as a block and waits for all.
+  /** The output then has all the input so far, and can be inflated up to
+    there. Returns false if a block failed to compress. */
+  bool flush();
+  /// Compresses the pending input as the last block and waits for all.
+  bool finish();
+  /// Returns the compressed bytes that are ready, in order.
+  /** Blocks that are still being compressed are not waited for, unless
+    finish() has been called. */
+  QByteArray takeOutput();
+  /// The CRC-32 of the input taken into account by takeOutput() so far.
+  quint32 crc() const;
+  /// The number of input bytes taken into account by takeOutput() so far.
+  quint64 totalIn() const;
+  /// The number of compressed bytes returned by takeOutput() so far.
+  quint64 totalOut() const;
+private:
+  QuaBlockDeflater(const QuaBlockDeflater &that);
+  QuaBlockDeflater &operator=(const QuaBlockDeflater &that);
+  QuaBlockDeflaterPrivate *d;
+};
+/// \endcond
+
+#endif // QUAZIP_QUABLOCKDEFLATER_H
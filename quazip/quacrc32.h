@@ -31,6 +31,10 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 /** \class QuaCrc32 quacrc32.h <quazip/quacrc32.h>
 * This class wrappers the crc32 function with the QuaChecksum32 interface.
 * See QuaChecksum32 for more info.
+*
+* The checksum is computed by the CRC engine of quacrc32engine.h, which
+* uses the carry-less multiplication or CRC instructions of the CPU when
+* available.
 */
 class QUAZIP_EXPORT QuaCrc32 : public QuaChecksum32 {
 
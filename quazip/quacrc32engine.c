@@ -0,0 +1,369 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quacrc32engine.h"
+
+#ifndef QUACRC32_NO_SIMD
+#  if (defined(__x86_64__) || defined(_M_X64)) \
+      && (defined(__GNUC__) || defined(_MSC_VER))
+#    define QUACRC32_HAVE_PCLMUL
+#  endif
+#  if (defined(__aarch64__) || defined(_M_ARM64)) \
+      && (defined(__GNUC__) || defined(_MSC_VER))
+#    define QUACRC32_HAVE_ARMV8
+#  endif
+#endif
+
+#ifdef QUACRC32_HAVE_PCLMUL
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#    define QUACRC32_PCLMUL_TARGET
+#  else
+#    include <cpuid.h>
+#    define QUACRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#  endif
+#  include <emmintrin.h>
+#  include <smmintrin.h>
+#  include <wmmintrin.h>
+#endif
+
+#ifdef QUACRC32_HAVE_ARMV8
+#  if defined(_MSC_VER)
+#    include <windows.h>
+#    include <arm64intr.h>
+#    define QUACRC32_ARMV8_TARGET
+#  else
+#    include <arm_acle.h>
+#    if defined(__ARM_FEATURE_CRC32)
+#      define QUACRC32_ARMV8_TARGET
+#    elif defined(__clang__)
+#      define QUACRC32_ARMV8_TARGET __attribute__((target("crc")))
+#    else
+#      define QUACRC32_ARMV8_TARGET __attribute__((target("arch=armv8-a+crc")))
+#    endif
+#    if defined(__linux__)
+#      include <sys/auxv.h>
+#      ifndef HWCAP_CRC32
+#        define HWCAP_CRC32 (1 << 7)
+#      endif
+#    endif
+#  endif
+#endif
+
+/* The reflected CRC-32 polynomial of ZIP, gzip and PNG. */
+#define QUACRC32_POLY 0xedb88320UL
+
+/* quacrc32_tables[k][n] is the CRC of the byte n followed by k zero bytes,
+   so that 16 bytes can be folded with 16 independent lookups. */
+static z_crc_t quacrc32_tables[16][256];
+static volatile int quacrc32_ready = 0;
+static int quacrc32_best = QUACRC32_PORTABLE;
+
+static int quacrc32_detect(int impl)
+{
+    switch (impl)
+    {
+    case QUACRC32_PORTABLE:
+        return 1;
+#ifdef QUACRC32_HAVE_PCLMUL
+    case QUACRC32_PCLMUL:
+    {
+#  ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;
+#  else
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return 0;
+        return (ecx & bit_PCLMUL) != 0 && (ecx & bit_SSE4_1) != 0;
+#  endif
+    }
+#endif
+#ifdef QUACRC32_HAVE_ARMV8
+    case QUACRC32_ARMV8:
+#  if defined(_MSC_VER)
+        return IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#  elif defined(__ARM_FEATURE_CRC32) || defined(__APPLE__)
+        return 1;
+#  elif defined(__linux__)
+        return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#  else
+        return 0;
+#  endif
+#endif
+    default:
+        return 0;
+    }
+}
+
+/* Builds the tables and picks the implementation. Running it from several
+   threads at once is harmless: they all write the same values. */
+static void quacrc32_init(void)
+{
+    int n, k;
+    for (n = 0; n < 256; n++)
+    {
+        z_crc_t c = (z_crc_t)n;
+        for (k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ QUACRC32_POLY : c >> 1;
+        quacrc32_tables[0][n] = c;
+    }
+    for (n = 0; n < 256; n++)
+    {
+        z_crc_t c = quacrc32_tables[0][n];
+        for (k = 1; k < 16; k++)
+        {
+            c = quacrc32_tables[0][c & 0xff] ^ (c >> 8);
+            quacrc32_tables[k][n] = c;
+        }
+    }
+    if (quacrc32_detect(QUACRC32_PCLMUL))
+        quacrc32_best = QUACRC32_PCLMUL;
+    else if (quacrc32_detect(QUACRC32_ARMV8))
+        quacrc32_best = QUACRC32_ARMV8;
+    else
+        quacrc32_best = QUACRC32_PORTABLE;
+    quacrc32_ready = 1;
+}
+
+/* The implementations work on the inverted CRC. */
+
+static z_crc_t quacrc32_portable(z_crc_t c, const unsigned char* buf, size_t len)
+{
+    while (len >= 16)
+    {
+        c ^= (z_crc_t)buf[0] | ((z_crc_t)buf[1] << 8)
+            | ((z_crc_t)buf[2] << 16) | ((z_crc_t)buf[3] << 24);
+        c = quacrc32_tables[15][c & 0xff] ^ quacrc32_tables[14][(c >> 8) & 0xff]
+            ^ quacrc32_tables[13][(c >> 16) & 0xff] ^ quacrc32_tables[12][(c >> 24) & 0xff]
+            ^ quacrc32_tables[11][buf[4]] ^ quacrc32_tables[10][buf[5]]
+            ^ quacrc32_tables[9][buf[6]] ^ quacrc32_tables[8][buf[7]]
+            ^ quacrc32_tables[7][buf[8]] ^ quacrc32_tables[6][buf[9]]
+            ^ quacrc32_tables[5][buf[10]] ^ quacrc32_tables[4][buf[11]]
+            ^ quacrc32_tables[3][buf[12]] ^ quacrc32_tables[2][buf[13]]
+            ^ quacrc32_tables[1][buf[14]] ^ quacrc32_tables[0][buf[15]];
+        buf += 16;
+        len -= 16;
+    }
+    while (len-- > 0)
+        c = quacrc32_tables[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+    return c & 0xffffffffUL;
+}
+
+#ifdef QUACRC32_HAVE_PCLMUL
+/* Folds four 128-bit lanes over the data, then reduces them to 32 bits
+   with a Barrett reduction, as described in Intel's "Fast CRC Computation
+   for Generic Polynomials Using PCLMULQDQ Instruction". len must be at
+   least 64 and a multiple of 16. */
+QUACRC32_PCLMUL_TARGET
+static z_crc_t quacrc32_pclmul_blocks(z_crc_t c, const unsigned char* buf, size_t len)
+{
+    __m128i x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)c));
+    buf += 64;
+    len -= 64;
+
+    while (len >= 64)
+    {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+        y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+        y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+        y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        buf += 64;
+        len -= 64;
+    }
+
+    /* fold the four lanes into one */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* then the remaining blocks of 16 bytes */
+    while (len >= 16)
+    {
+        x2 = _mm_loadu_si128((const __m128i*)buf);
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    /* 128 bits to 64 */
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits */
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (z_crc_t)(unsigned int)_mm_extract_epi32(x1, 1);
+}
+
+static z_crc_t quacrc32_pclmul(z_crc_t c, const unsigned char* buf, size_t len)
+{
+    if (len >= 64)
+    {
+        size_t blocks = len & ~(size_t)15;
+        c = quacrc32_pclmul_blocks(c, buf, blocks);
+        buf += blocks;
+        len -= blocks;
+    }
+    return quacrc32_portable(c, buf, len);
+}
+#endif
+
+#ifdef QUACRC32_HAVE_ARMV8
+QUACRC32_ARMV8_TARGET
+static z_crc_t quacrc32_armv8(z_crc_t c, const unsigned char* buf, size_t len)
+{
+    unsigned int crc = (unsigned int)c;
+    while (len > 0 && ((size_t)buf & 7) != 0)
+    {
+        crc = __crc32b(crc, *buf++);
+        len--;
+    }
+    /* four independent loads per iteration keep the pipeline busy */
+    while (len >= 32)
+    {
+        const unsigned long long* words = (const unsigned long long*)buf;
+        crc = __crc32d(crc, words[0]);
+        crc = __crc32d(crc, words[1]);
+        crc = __crc32d(crc, words[2]);
+        crc = __crc32d(crc, words[3]);
+        buf += 32;
+        len -= 32;
+    }
+    while (len >= 8)
+    {
+        crc = __crc32d(crc, *(const unsigned long long*)buf);
+        buf += 8;
+        len -= 8;
+    }
+    while (len-- > 0)
+        crc = __crc32b(crc, *buf++);
+    return (z_crc_t)crc;
+}
+#endif
+
+uLong quacrc32_using(int impl, uLong crc, const unsigned char* buf, size_t len)
+{
+    z_crc_t c;
+    if (buf == NULL)
+        return 0;
+    if (!quacrc32_ready)
+        quacrc32_init();
+    c = (z_crc_t)(crc ^ 0xffffffffUL);
+    switch (impl)
+    {
+#ifdef QUACRC32_HAVE_PCLMUL
+    case QUACRC32_PCLMUL:
+        c = quacrc32_pclmul(c, buf, len);
+        break;
+#endif
+#ifdef QUACRC32_HAVE_ARMV8
+    case QUACRC32_ARMV8:
+        c = quacrc32_armv8(c, buf, len);
+        break;
+#endif
+    default:
+        c = quacrc32_portable(c, buf, len);
+        break;
+    }
+    return (uLong)(c ^ 0xffffffffUL);
+}
+
+uLong quacrc32(uLong crc, const unsigned char* buf, size_t len)
+{
+    if (!quacrc32_ready)
+        quacrc32_init();
+    return quacrc32_using(quacrc32_best, crc, buf, len);
+}
+
+int quacrc32_available(int impl)
+{
+    return quacrc32_detect(impl);
+}
+
+int quacrc32_implementation(void)
+{
+    if (!quacrc32_ready)
+        quacrc32_init();
+    return quacrc32_best;
+}
+
+const char* quacrc32_name(int impl)
+{
+    switch (impl)
+    {
+    case QUACRC32_PCLMUL:
+        return "pclmul";
+    case QUACRC32_ARMV8:
+        return "armv8";
+    default:
+        return "slicing-by-16";
+    }
+}
+
+const z_crc_t* quacrc32_table(void)
+{
+    if (!quacrc32_ready)
+        quacrc32_init();
+    return quacrc32_tables[0];
+}
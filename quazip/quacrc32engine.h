@@ -0,0 +1,79 @@
+#ifndef QUACRC32ENGINE_H
+#define QUACRC32ENGINE_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+/*
+  The CRC-32 used by QuaZIP, a drop-in replacement for zlib's crc32().
+
+  The implementation is picked at run time, on the first call:
+    - QUACRC32_PCLMUL folds 64 bytes at a time with carry-less
+      multiplications (x86-64 with PCLMULQDQ and SSE4.1);
+    - QUACRC32_ARMV8 uses the CRC32 instructions of ARMv8;
+    - QUACRC32_PORTABLE, slicing-by-16 tables, everywhere else.
+  Define QUACRC32_NO_SIMD to build the portable one only.
+*/
+
+#include <stddef.h>
+
+#include "zlib.h"
+#if (ZLIB_VERNUM < 0x1270)
+typedef uLongf z_crc_t;
+#endif
+
+#include "quazip_global.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUACRC32_PORTABLE 0
+#define QUACRC32_PCLMUL 1
+#define QUACRC32_ARMV8 2
+
+/* Updates crc with len bytes of buf, like crc32(). */
+QUAZIP_EXPORT uLong quacrc32(uLong crc, const unsigned char* buf, size_t len);
+
+/* Same as quacrc32(), with the implementation impl, which must be available. */
+QUAZIP_EXPORT uLong quacrc32_using(int impl, uLong crc,
+                                   const unsigned char* buf, size_t len);
+
+/* Returns 1 if the implementation impl can run on this CPU, 0 otherwise. */
+QUAZIP_EXPORT int quacrc32_available(int impl);
+
+/* Returns the implementation used by quacrc32(). */
+QUAZIP_EXPORT int quacrc32_implementation(void);
+
+/* Returns the name of the implementation impl. */
+QUAZIP_EXPORT const char* quacrc32_name(int impl);
+
+/* The byte-wise CRC-32 table, like get_crc_table(). */
+QUAZIP_EXPORT const z_crc_t* quacrc32_table(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUACRC32ENGINE_H */
@@ -22,24 +22,228 @@ Original ZIP package is copyrighted by Gilles Vollant and contributors,
 see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
+#include <QDataStream>
 #include <QFile>
 
 #include "quagzipfile.h"
+#include "quablockdeflater.h"
+#include "quacrc32engine.h"
+#include "quamemberinflater.h"
 
 /// \cond internal
+/// A point where inflating can be restarted.
+struct QuaGzipCheckpoint {
+    quint64 uncompressedOffset;
+    quint64 compressedOffset;
+    /// The bits of the byte before, -1 at the start of a member.
+    int bits;
+    /// The data before the checkpoint, compressed with qCompress().
+    QByteArray window;
+};
+
 class QuaGzipFilePrivate {
     friend class QuaGzipFile;
+    /// Where the inflater is in the GZIP stream.
+    /**
+      The header states come in the order of the header fields.
+      */
+    enum State {
+        Header,
+        HeaderExtraLength,
+        HeaderExtra,
+        HeaderName,
+        HeaderComment,
+        HeaderCrc,
+        Deflate,
+        Trailer,
+        End
+    };
     QString fileName;
+    /// The device set by setIoDevice(), if any.
+    QIODevice *ioDevice;
     gzFile gzd;
-    inline QuaGzipFilePrivate(): gzd(NULL) {}
+    /// The least distance between two seek checkpoints, 0 if off.
+    qint64 checkpointSpan;
+    /// The number of threads set by setThreadCount().
+    int threads;
+    /// The queue depth set by setQueueDepth().
+    int queueDepth;
+    QuaGzipFile::WriteFormat writeFormat;
+    /// The GZIP file read by the inflater, NULL when gzread() is used.
+    QIODevice *source;
+    /// The GZIP file written by the deflater, NULL when gzwrite() is used.
+    QIODevice *sink;
+    /// Whether \ref source or \ref sink was created by open(), to be
+    /// deleted by close().
+    bool ownSource;
+    /// Whether \ref source or \ref sink was opened by open(), to be
+    /// closed by close().
+    bool closeSource;
+    /// The parallel deflater, when writing to \ref sink.
+    QuaBlockDeflater *deflater;
+    /// Whether the file is open for random access.
+    bool seekable;
+    z_stream stream;
+    QByteArray input;
+    /// The offset in \ref source right after the \ref input.
+    quint64 inputEnd;
+    State state;
+    /// The flags byte of the current member header.
+    int flags;
+    /// The header or trailer field being collected.
+    char field[10];
+    int fieldSize;
+    /// The bytes of the extra header field left to skip.
+    uInt extraLeft;
+    /// The CRC and the size of the data of the current member.
+    uLong crc;
+    quint32 memberSize;
+    /// Whether the member was read from its start, so the trailer can be checked.
+    bool checkTrailer;
+    /// Whether the last read() stopped in the deflate data because the buffer was full.
+    bool pending;
+    /// The uncompressed offset of the next byte to inflate.
+    quint64 outPos;
+    /// The uncompressed size, -1 until the end of the input was reached.
+    qint64 size;
+    /// The seek checkpoints, sorted by their uncompressed offsets.
+    /**
+      They always cover a prefix of the data: from the beginning up to
+      the farthest position reached so far, possibly in an earlier run.
+      */
+    QList<QuaGzipCheckpoint> checkpoints;
+    /// The length and the CRC of the start of the file the checkpoints belong to.
+    quint32 fingerprintLength;
+    quint32 fingerprintCrc;
+    /// The parallel inflater, when reading with several threads.
+    QuaMemberInflater *members;
+    /// Whether \ref members gave up, until the end of the current member.
+    bool serial;
+    /// Set by read() at the end of a member if \ref serial.
+    bool memberEnded;
+    /// The end of the piece that made \ref members give up.
+    quint64 serialEnd;
+    /// The data read ahead and not cut into pieces yet, and its offset.
+    QByteArray scan;
+    quint64 scanOffset;
+    /// How far member headers were looked for in \ref scan.
+    int scanned;
+    /// Whether \ref scan goes up to the end of the file.
+    bool scanEnd;
+    /// Whether \ref scan was cut without finding a member header.
+    bool scanStalled;
+    /// The output of the last piece and how much of it was read.
+    QByteArray output;
+    int outputUsed;
+    /// The last inflater error.
+    QString error;
+    inline QuaGzipFilePrivate(): ioDevice(NULL), gzd(NULL),
+        checkpointSpan(0), threads(1), queueDepth(0),
+        writeFormat(QuaGzipFile::SingleMember), source(NULL), sink(NULL),
+        ownSource(false), closeSource(false), deflater(NULL),
+        seekable(false), fingerprintLength(0), fingerprintCrc(0),
+        members(NULL) {}
     inline QuaGzipFilePrivate(const QString &fileName): 
-        fileName(fileName), gzd(NULL) {}
+        fileName(fileName), ioDevice(NULL), gzd(NULL),
+        checkpointSpan(0), threads(1), queueDepth(0),
+        writeFormat(QuaGzipFile::SingleMember), source(NULL), sink(NULL),
+        ownSource(false), closeSource(false), deflater(NULL),
+        seekable(false), fingerprintLength(0), fingerprintCrc(0),
+        members(NULL) {}
+    inline QuaGzipFilePrivate(QIODevice *ioDevice):
+        ioDevice(ioDevice), gzd(NULL), checkpointSpan(0), threads(1),
+        queueDepth(0), writeFormat(QuaGzipFile::SingleMember),
+        source(NULL), sink(NULL), ownSource(false), closeSource(false),
+        deflater(NULL), seekable(false), fingerprintLength(0),
+        fingerprintCrc(0), members(NULL) {}
     template<typename FileId> bool open(FileId id, 
         QIODevice::OpenMode mode, QString &error);
     gzFile open(int fd, const char *modeString);
     gzFile open(const QString &name, const char *modeString);
+    QIODevice *openFile(int fd, QIODevice::OpenMode mode);
+    QIODevice *openFile(const QString &name, QIODevice::OpenMode mode);
+    /// Opens \ref ioDevice for the inflater or the deflater.
+    bool openDevice(QIODevice::OpenMode mode, QString &error);
+    /// Starts deflating to \a file, which it takes ownership of if \a own.
+    bool openDeflater(QIODevice *file, bool own, QString &error);
+    /// Writes what the deflater has ready to \ref sink.
+    bool writeOutput();
+    /// Finishes the deflate stream, returns false on error.
+    bool closeDeflater();
+    /// Starts inflating \a file, which it takes ownership of if \a own.
+    bool openInflater(QIODevice *file, bool own, QString &error);
+    void closeInflater();
+    /// Checks the checkpoints against the file just opened.
+    /**
+      Drops them if they belong to another file.
+      */
+    bool openIndex();
+    /// Computes the CRC of the first \a length bytes of the file.
+    bool fingerprint(quint32 length, quint32 *crc);
+    /// Returns the offset in the file of the next byte to inflate.
+    inline quint64 position() const {return inputEnd - stream.avail_in;}
+    /// Reads more of the file once the input is used up.
+    /**
+      Returns 1 if there is some input, 0 if there is none yet, or -1 on
+      error.
+      */
+    int fill();
+    /// Collects the bytes of \ref field until there are \a size of them.
+    bool collect(int size);
+    /// Moves on to the next header field present, or to the deflate data.
+    void nextField();
+    /// Parses what is available of a member header or trailer.
+    bool parse();
+    /// Inflates at most \a maxSize bytes into \a data.
+    /**
+      Returns the number of bytes inflated, which is less than \a maxSize
+      only at the end of the data available so far, or -1 on error.
+      */
+    qint64 read(char *data, qint64 maxSize);
+    /// Checks whether there is nothing left to inflate, for now.
+    /**
+      Parses the header or trailer that comes next, if it is there.
+      */
+    bool atEnd();
+    /// Cuts the next piece for \ref members out of the data read ahead.
+    /**
+      Returns 1 if there is a piece, 0 if there is none for now, or -1
+      on error.
+      */
+    int nextPiece(QByteArray *piece);
+    /// Keeps \ref members busy.
+    bool fillQueue();
+    /// Same as read(), with \ref members.
+    qint64 readParallel(char *data, qint64 maxSize);
+    /// Records a checkpoint here, if it is far enough from the last one.
+    void addCheckpoint(int bits);
+    /// Restarts inflating at \a point, or at the beginning if it's NULL.
+    bool restart(const QuaGzipCheckpoint *point);
+    /// Moves the inflater to \a pos, from the nearest checkpoint.
+    /**
+      A negative \a pos means the end of the data.
+      */
+    bool seekTo(qint64 pos);
 };
 
+/// The first bytes of a saved seek index, "QZGX".
+static const quint32 SEEK_INDEX_MAGIC=0x515A4758u;
+static const quint16 SEEK_INDEX_VERSION=1;
+/// The size of the input buffer, and the most of the file fingerprinted.
+static const int INPUT_SIZE=64*1024;
+/// The least compressed size of a piece inflated in parallel.
+static const int PIECE_SIZE=1024*1024;
+/// The size a piece is cut at if no member header comes before.
+static const int MAX_PIECE_SIZE=4*PIECE_SIZE;
+
+/// Checks whether the 10 bytes at \a p look like a member header.
+static bool isMemberHeader(const uchar *p)
+{
+    return p[0] == 0x1f && p[1] == 0x8b && p[2] == Z_DEFLATED
+        && (p[3] & 0xe0) == 0 && (p[8] == 0 || p[8] == 2 || p[8] == 4)
+        && (p[9] <= 13 || p[9] == 255);
+}
+
 gzFile QuaGzipFilePrivate::open(const QString &name, const char *modeString)
 {
     return gzopen(QFile::encodeName(name).constData(), modeString);
@@ -50,6 +254,33 @@ gzFile QuaGzipFilePrivate::open(int fd, const char *modeString)
     return gzdopen(fd, modeString);
 }
 
+QIODevice *QuaGzipFilePrivate::openFile(const QString &name,
+                                        QIODevice::OpenMode mode)
+{
+    QFile *file = new QFile(name);
+    if (!file->open(mode | QIODevice::Unbuffered)) {
+        delete file;
+        return NULL;
+    }
+    return file;
+}
+
+QIODevice *QuaGzipFilePrivate::openFile(int fd, QIODevice::OpenMode mode)
+{
+    QFile *file = new QFile();
+#if (QT_VERSION >= 0x050000)
+    bool opened = file->open(fd, mode | QIODevice::Unbuffered,
+                             QFileDevice::AutoCloseHandle);
+#else
+    bool opened = file->open(fd, mode | QIODevice::Unbuffered);
+#endif
+    if (!opened) {
+        delete file;
+        return NULL;
+    }
+    return file;
+}
+
 template<typename FileId>
 bool QuaGzipFilePrivate::open(FileId id, QIODevice::OpenMode mode, 
                               QString &error)
@@ -75,6 +306,10 @@ bool QuaGzipFilePrivate::open(FileId id, QIODevice::OpenMode mode,
             " or for writing. Which is it?");
         return false;
     }
+    if (modeString[0] == 'r' && (checkpointSpan > 0 || threads != 1))
+        return openInflater(openFile(id, QIODevice::ReadOnly), true, error);
+    if (modeString[0] == 'w' && threads != 1)
+        return openDeflater(openFile(id, QIODevice::WriteOnly), true, error);
     gzd = open(id, modeString);
     if (gzd == NULL) {
         error = QuaGzipFile::trUtf8("Could not gzopen() file");
@@ -82,6 +317,653 @@ bool QuaGzipFilePrivate::open(FileId id, QIODevice::OpenMode mode,
     }
     return true;
 }
+
+bool QuaGzipFilePrivate::openDevice(QIODevice::OpenMode mode,
+                                    QString &error)
+{
+    QIODevice::OpenMode direction = mode & QIODevice::ReadWrite;
+    if ((mode & QIODevice::Append) != 0
+            || (direction != QIODevice::ReadOnly
+                && direction != QIODevice::WriteOnly)) {
+        error = QuaGzipFile::trUtf8("A gzip on a QIODevice can be opened"
+            " either for reading or for writing");
+        return false;
+    }
+    if (!ioDevice->isOpen()) {
+        if (!ioDevice->open(direction)) {
+            error = QuaGzipFile::trUtf8("Could not open the IO device");
+            return false;
+        }
+        closeSource = true;
+    } else if ((ioDevice->openMode() & direction) == 0) {
+        error = QuaGzipFile::trUtf8("The IO device is not open in the"
+            " same mode");
+        return false;
+    }
+    if (direction == QIODevice::WriteOnly)
+        return openDeflater(ioDevice, false, error);
+    return openInflater(ioDevice, false, error);
+}
+
+bool QuaGzipFilePrivate::openDeflater(QIODevice *file, bool own,
+                                      QString &error)
+{
+    if (file == NULL) {
+        error = QuaGzipFile::trUtf8("Could not open file");
+        return false;
+    }
+    sink = file;
+    ownSource = own;
+    bool members = writeFormat == QuaGzipFile::BgzfMembers;
+    deflater = new QuaBlockDeflater(Z_DEFAULT_COMPRESSION, threads,
+        members ? QuaBlockDeflater::BgzfBlockSize
+                : QuaBlockDeflater::DefaultBlockSize,
+        queueDepth, 8, Z_DEFAULT_STRATEGY, members);
+    // no name, no time, unknown OS
+    static const char header[10] = {
+        '\x1f', '\x8b', Z_DEFLATED, 0, 0, 0, 0, 0, 0, '\xff'
+    };
+    if (!members && sink->write(header, sizeof(header)) != sizeof(header)) {
+        error = QuaGzipFile::trUtf8("Could not write file");
+        delete deflater;
+        deflater = NULL;
+        if (ownSource)
+            delete sink;
+        else if (closeSource)
+            sink->close();
+        sink = NULL;
+        closeSource = false;
+        return false;
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::writeOutput()
+{
+    QByteArray output = deflater->takeOutput();
+    if (sink->write(output) != output.size()) {
+        error = QuaGzipFile::trUtf8("Could not write file");
+        return false;
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::closeDeflater()
+{
+    bool ok = deflater->finish();
+    if (!ok)
+        error = QuaGzipFile::trUtf8("Could not compress data");
+    else
+        ok = writeOutput();
+    if (ok && writeFormat == QuaGzipFile::SingleMember) {
+        char trailer[8];
+        quint32 crc = deflater->crc();
+        quint32 size = (quint32) deflater->totalIn();
+        for (int i = 0; i < 4; ++i) {
+            trailer[i] = (char) (crc >> (8 * i));
+            trailer[4 + i] = (char) (size >> (8 * i));
+        }
+        if (sink->write(trailer, sizeof(trailer)) != sizeof(trailer)) {
+            error = QuaGzipFile::trUtf8("Could not write file");
+            ok = false;
+        }
+    }
+    delete deflater;
+    deflater = NULL;
+    if (ownSource)
+        delete sink;
+    else if (closeSource)
+        sink->close();
+    sink = NULL;
+    closeSource = false;
+    return ok;
+}
+
+bool QuaGzipFilePrivate::openInflater(QIODevice *file, bool own,
+                                      QString &error)
+{
+    if (file == NULL) {
+        error = QuaGzipFile::trUtf8("Could not open file");
+        return false;
+    }
+    source = file;
+    ownSource = own;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        error = QuaGzipFile::trUtf8("Could not initialize the inflater");
+        if (ownSource)
+            delete source;
+        else if (closeSource)
+            source->close();
+        source = NULL;
+        closeSource = false;
+        return false;
+    }
+    input.resize(INPUT_SIZE);
+    // random access takes checkpoints, members in parallel don't
+    seekable = checkpointSpan > 0 && !source->isSequential();
+    if (threads != 1 && checkpointSpan == 0 && !source->isSequential()) {
+        members = new QuaMemberInflater(threads, queueDepth);
+        serial = false;
+        scan.clear();
+        scanOffset = 0;
+        scanned = 0;
+        scanEnd = false;
+        scanStalled = false;
+        output.clear();
+        outputUsed = 0;
+    }
+    memberEnded = false;
+    size = -1;
+    if ((seekable && !openIndex()) || !restart(NULL)) {
+        error = QuaGzipFile::trUtf8("Could not read file");
+        closeInflater();
+        return false;
+    }
+    return true;
+}
+
+void QuaGzipFilePrivate::closeInflater()
+{
+    delete members;
+    members = NULL;
+    inflateEnd(&stream);
+    if (ownSource)
+        delete source;
+    else if (closeSource)
+        source->close();
+    source = NULL;
+    closeSource = false;
+    seekable = false;
+    input.clear();
+    scan.clear();
+    output.clear();
+}
+
+bool QuaGzipFilePrivate::openIndex()
+{
+    quint32 fileCrc = 0;
+    if (!checkpoints.isEmpty() && (!fingerprint(fingerprintLength, &fileCrc)
+            || fileCrc != fingerprintCrc))
+        checkpoints.clear();
+    if (checkpoints.isEmpty()) {
+        fingerprintLength = (quint32) qMin<qint64>(source->size(), INPUT_SIZE);
+        return fingerprint(fingerprintLength, &fingerprintCrc);
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::fingerprint(quint32 length, quint32 *crc)
+{
+    QByteArray prefix((int) length, Qt::Uninitialized);
+    if (!source->seek(0)
+            || source->read(prefix.data(), length) != (qint64) length)
+        return false;
+    *crc = (quint32) quacrc32(0, reinterpret_cast<const unsigned char*>(
+            prefix.constData()), length);
+    return true;
+}
+
+int QuaGzipFilePrivate::fill()
+{
+    if (stream.avail_in != 0)
+        return 1;
+    // a plain read() at the end, so that a growing file can be followed
+    qint64 read = source->read(input.data(), input.size());
+    if (read < 0) {
+        error = QuaGzipFile::trUtf8("Could not read file");
+        return -1;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(input.data());
+    stream.avail_in = (uInt) read;
+    inputEnd += read;
+    return read > 0 ? 1 : 0;
+}
+
+bool QuaGzipFilePrivate::collect(int size)
+{
+    uInt take = qMin<uInt>((uInt) (size - fieldSize), stream.avail_in);
+    memcpy(field + fieldSize, stream.next_in, take);
+    stream.next_in += take;
+    stream.avail_in -= take;
+    fieldSize += (int) take;
+    return fieldSize == size;
+}
+
+void QuaGzipFilePrivate::nextField()
+{
+    fieldSize = 0;
+    for (;;) {
+        state = static_cast<State>(state + 1);
+        switch (state) {
+        case HeaderExtraLength:
+        case HeaderExtra:
+            if ((flags & 4) != 0)
+                return;
+            break;
+        case HeaderName:
+            if ((flags & 8) != 0)
+                return;
+            break;
+        case HeaderComment:
+            if ((flags & 16) != 0)
+                return;
+            break;
+        case HeaderCrc:
+            if ((flags & 2) != 0)
+                return;
+            break;
+        default:
+            inflateReset(&stream);
+            crc = quacrc32(0, NULL, 0);
+            memberSize = 0;
+            checkTrailer = true;
+            return;
+        }
+    }
+}
+
+bool QuaGzipFilePrivate::parse()
+{
+    const Bytef *zero;
+    switch (state) {
+    case Header:
+        if (!collect(2))
+            return true;
+        if ((uchar) field[0] != 0x1f || (uchar) field[1] != 0x8b) {
+            if (position() == 2) {
+                error = QuaGzipFile::trUtf8("Not in GZIP format");
+                return false;
+            }
+            // like gzread(), ignore whatever follows the last member
+            stream.avail_in = 0;
+            state = End;
+            size = (qint64) outPos;
+            return true;
+        }
+        if (!collect(10))
+            return true;
+        if (field[2] != Z_DEFLATED || (field[3] & 0xe0) != 0) {
+            error = QuaGzipFile::trUtf8("Unsupported GZIP header");
+            return false;
+        }
+        // more data after what was known to be the end
+        if (size >= 0 && outPos >= (quint64) size)
+            size = -1;
+        flags = field[3];
+        nextField();
+        return true;
+    case HeaderExtraLength:
+        if (!collect(2))
+            return true;
+        extraLeft = (uchar) field[0] | ((uInt) (uchar) field[1] << 8);
+        nextField();
+        if (extraLeft == 0)
+            nextField();
+        return true;
+    case HeaderExtra: {
+        uInt take = qMin(extraLeft, stream.avail_in);
+        stream.next_in += take;
+        stream.avail_in -= take;
+        extraLeft -= take;
+        if (extraLeft == 0)
+            nextField();
+        return true;
+    }
+    case HeaderName:
+    case HeaderComment:
+        zero = static_cast<const Bytef*>(memchr(stream.next_in, 0, stream.avail_in));
+        if (zero == NULL) {
+            stream.next_in += stream.avail_in;
+            stream.avail_in = 0;
+        } else {
+            stream.avail_in -= (uInt) (zero + 1 - stream.next_in);
+            stream.next_in = const_cast<Bytef*>(zero + 1);
+            nextField();
+        }
+        return true;
+    case HeaderCrc:
+        if (collect(2))
+            nextField();
+        return true;
+    case Trailer:
+        if (!collect(8))
+            return true;
+        if (checkTrailer) {
+            quint32 storedCrc = 0, storedSize = 0;
+            for (int i = 3; i >= 0; --i) {
+                storedCrc = (storedCrc << 8) | (uchar) field[i];
+                storedSize = (storedSize << 8) | (uchar) field[4 + i];
+            }
+            if (storedCrc != (quint32) crc || storedSize != memberSize) {
+                error = QuaGzipFile::trUtf8("CRC error");
+                return false;
+            }
+        }
+        state = Header;
+        fieldSize = 0;
+        addCheckpoint(-1);
+        memberEnded = members != NULL;
+        return true;
+    default:
+        return true;
+    }
+}
+
+qint64 QuaGzipFilePrivate::read(char *data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize && state != End && !memberEnded) {
+        if (state == Deflate) {
+            uInt avail = (uInt) qMin<qint64>(maxSize - done, 1 << 30);
+            stream.next_out = reinterpret_cast<Bytef*>(data + done);
+            stream.avail_out = avail;
+            int ret = inflate(&stream, Z_BLOCK);
+            uInt produced = avail - stream.avail_out;
+            if (produced != 0) {
+                if (checkTrailer)
+                    crc = quacrc32(crc, reinterpret_cast<const unsigned char*>(
+                            data + done), produced);
+                memberSize += produced;
+                outPos += produced;
+                done += produced;
+            }
+            if (ret == Z_STREAM_END) {
+                state = Trailer;
+                fieldSize = 0;
+            } else if (ret == Z_BUF_ERROR) {
+                int filled = fill();
+                if (filled < 0)
+                    return -1;
+                if (filled == 0)
+                    break;
+            } else if (ret != Z_OK) {
+                error = QuaGzipFile::trUtf8("Corrupted GZIP data");
+                return -1;
+            } else if ((stream.data_type & 128) != 0) {
+                // Z_BLOCK stops after the last block too, before Z_STREAM_END
+                if ((stream.data_type & 64) != 0) {
+                    state = Trailer;
+                    fieldSize = 0;
+                } else {
+                    addCheckpoint(stream.data_type & 7);
+                }
+            }
+            continue;
+        }
+        // the header and the trailer are parsed as they come
+        if (stream.avail_in == 0) {
+            int filled = fill();
+            if (filled < 0)
+                return -1;
+            if (filled == 0) {
+                // the end, at least for now
+                if (state == Header && fieldSize == 0)
+                    size = (qint64) outPos;
+                break;
+            }
+        }
+        if (!parse())
+            return -1;
+    }
+    pending = state == Deflate && done == maxSize;
+    return done;
+}
+
+bool QuaGzipFilePrivate::atEnd()
+{
+    if (members != NULL && !serial) {
+        return outputUsed == output.size() && members->isEmpty()
+            && scanEnd && scan.isEmpty();
+    }
+    // the next member is left to the parallel inflater
+    if (memberEnded)
+        return false;
+    while (state != Deflate && state != End && !memberEnded) {
+        if (fill() <= 0) {
+            if (state == Header && fieldSize == 0)
+                size = (qint64) outPos;
+            return true;
+        }
+        // read() will report the error
+        if (!parse())
+            return false;
+    }
+    if (memberEnded)
+        return false;
+    return state == End
+        || (!pending && stream.avail_in == 0 && source->atEnd());
+}
+
+int QuaGzipFilePrivate::nextPiece(QByteArray *piece)
+{
+    if (scanStalled)
+        return 0;
+    for (;;) {
+        // cut at the first member header after PIECE_SIZE bytes
+        int cut = -1;
+        const uchar *data = reinterpret_cast<const uchar*>(scan.constData());
+        for (int i = qMax(scanned, PIECE_SIZE); i + 10 <= scan.size(); ++i) {
+            const void *magic = memchr(data + i, 0x1f, scan.size() - 9 - i);
+            if (magic == NULL)
+                break;
+            i = (int) (static_cast<const uchar*>(magic) - data);
+            if (isMemberHeader(data + i)) {
+                cut = i;
+                break;
+            }
+        }
+        if (cut < 0 && (scanEnd || scan.size() >= MAX_PIECE_SIZE)) {
+            if (scan.isEmpty())
+                return 0;
+            // a long member, or the last piece
+            cut = scan.size();
+            scanStalled = !scanEnd;
+        }
+        if (cut >= 0) {
+            *piece = scan.left(cut);
+            scan.remove(0, cut);
+            scanOffset += cut;
+            scanned = 0;
+            return 1;
+        }
+        scanned = qMax(scanned, scan.size() - 9);
+        int size = scan.size();
+        scan.resize(size + PIECE_SIZE);
+        qint64 read = source->read(scan.data() + size, PIECE_SIZE);
+        scan.resize(size + (int) qMax<qint64>(read, 0));
+        if (read < 0) {
+            error = QuaGzipFile::trUtf8("Could not read file");
+            return -1;
+        }
+        if (read == 0)
+            scanEnd = true;
+    }
+}
+
+bool QuaGzipFilePrivate::fillQueue()
+{
+    while (!members->isFull()) {
+        QByteArray piece;
+        quint64 offset = scanOffset;
+        int found = nextPiece(&piece);
+        if (found < 0)
+            return false;
+        if (found == 0)
+            break;
+        members->submit(piece, offset);
+    }
+    return true;
+}
+
+qint64 QuaGzipFilePrivate::readParallel(char *data, qint64 maxSize)
+{
+    qint64 done = 0;
+    while (done < maxSize) {
+        if (outputUsed < output.size()) {
+            int n = (int) qMin<qint64>(maxSize - done,
+                                       output.size() - outputUsed);
+            memcpy(data + done, output.constData() + outputUsed, n);
+            outputUsed += n;
+            outPos += n;
+            done += n;
+            continue;
+        }
+        if (serial) {
+            qint64 read = this->read(data + done, maxSize - done);
+            if (read < 0)
+                return done > 0 ? done : -1;
+            done += read;
+            if (!memberEnded)
+                break;
+            memberEnded = false;
+            // the rest of that piece is known not to be whole members
+            if (position() < serialEnd)
+                continue;
+            // back to parallel from the next member
+            serial = false;
+            scanOffset = position();
+            scan.clear();
+            scanned = 0;
+            scanEnd = false;
+            scanStalled = false;
+            stream.avail_in = 0;
+            inputEnd = scanOffset;
+            if (!source->seek((qint64) scanOffset)) {
+                error = QuaGzipFile::trUtf8("Could not read file");
+                return done > 0 ? done : -1;
+            }
+            continue;
+        }
+        if (!fillQueue())
+            return done > 0 ? done : -1;
+        if (members->isEmpty())
+            break;
+        quint64 offset = 0;
+        bool whole = members->take(&output, &offset, &serialEnd);
+        outputUsed = 0;
+        if (whole)
+            continue;
+        // not cut at a member boundary: inflate up to the end of a member
+        members->clear();
+        QuaGzipCheckpoint point;
+        point.uncompressedOffset = outPos;
+        point.compressedOffset = offset;
+        point.bits = -1;
+        if (!restart(&point)) {
+            error = QuaGzipFile::trUtf8("Could not read file");
+            return done > 0 ? done : -1;
+        }
+        serial = true;
+    }
+    return done;
+}
+
+void QuaGzipFilePrivate::addCheckpoint(int bits)
+{
+    if (!seekable)
+        return;
+    quint64 last = checkpoints.isEmpty() ? 0
+        : checkpoints.last().uncompressedOffset;
+    // after a seek, the checkpoints already known come again
+    if (outPos <= last || outPos - last < (quint64) checkpointSpan)
+        return;
+    QuaGzipCheckpoint point;
+    point.uncompressedOffset = outPos;
+    point.compressedOffset = position();
+    point.bits = bits;
+    if (bits >= 0) {
+#if (ZLIB_VERNUM >= 0x1271)
+        QByteArray window(32768, Qt::Uninitialized);
+        uInt windowSize = 0;
+        if (inflateGetDictionary(&stream, reinterpret_cast<Bytef*>(
+                window.data()), &windowSize) != Z_OK)
+            return;
+        point.window = qCompress(reinterpret_cast<const uchar*>(
+                window.constData()), (int) windowSize);
+#else
+        // without inflateGetDictionary(), only the members can be restarted
+        return;
+#endif
+    }
+    checkpoints.append(point);
+}
+
+bool QuaGzipFilePrivate::restart(const QuaGzipCheckpoint *point)
+{
+    quint64 offset = point != NULL ? point->compressedOffset : 0;
+    inflateReset(&stream);
+    stream.avail_in = 0;
+    fieldSize = 0;
+    pending = false;
+    if (point == NULL || point->bits < 0) {
+        state = Header;
+    } else {
+        if (point->bits > 0) {
+            char byte;
+            if (!source->seek((qint64) offset - 1)
+                    || source->read(&byte, 1) != 1)
+                return false;
+            inflatePrime(&stream, point->bits,
+                         (uchar) byte >> (8 - point->bits));
+        }
+        QByteArray window = qUncompress(point->window);
+        if (inflateSetDictionary(&stream, reinterpret_cast<const Bytef*>(
+                window.constData()), (uInt) window.size()) != Z_OK)
+            return false;
+        state = Deflate;
+        // the data before is unknown, and so is its CRC
+        checkTrailer = false;
+        memberSize = 0;
+    }
+    if (!source->isSequential() && !source->seek((qint64) offset))
+        return false;
+    inputEnd = offset;
+    outPos = point != NULL ? point->uncompressedOffset : 0;
+    return true;
+}
+
+bool QuaGzipFilePrivate::seekTo(qint64 pos)
+{
+    quint64 target = pos < 0 ? ~(quint64) 0 : (quint64) pos;
+    if (target == outPos)
+        return true;
+    // the last checkpoint at or before the target
+    int lo = 0, hi = checkpoints.size();
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (checkpoints.at(mid).uncompressedOffset <= target)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    const QuaGzipCheckpoint *point = lo > 0 ? &checkpoints.at(lo - 1) : NULL;
+    quint64 from = point != NULL ? point->uncompressedOffset : 0;
+    if (target < outPos || from > outPos) {
+        if (!restart(point)) {
+            error = QuaGzipFile::trUtf8("Could not read file");
+            return false;
+        }
+    }
+    // inflate what is left up to the target, recording the checkpoints on the way
+    QByteArray skipped(INPUT_SIZE, Qt::Uninitialized);
+    while (outPos < target) {
+        qint64 read = this->read(skipped.data(),
+                (qint64) qMin<quint64>(target - outPos, skipped.size()));
+        if (read < 0)
+            return false;
+        if (read == 0) {
+            if (pos >= 0)
+                error = QuaGzipFile::trUtf8("Position past the end of file");
+            return pos < 0;
+        }
+    }
+    return true;
+}
 /// \endcond
 
 QuaGzipFile::QuaGzipFile():
@@ -101,6 +983,12 @@ d(new QuaGzipFilePrivate(fileName))
 {
 }
 
+QuaGzipFile::QuaGzipFile(QIODevice *ioDevice, QObject *parent):
+  QIODevice(parent),
+d(new QuaGzipFilePrivate(ioDevice))
+{
+}
+
 QuaGzipFile::~QuaGzipFile()
 {
   if (isOpen()) {
@@ -111,7 +999,12 @@ QuaGzipFile::~QuaGzipFile()
 
 void QuaGzipFile::setFileName(const QString& fileName)
 {
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setFileName(): file is already open");
+        return;
+    }
     d->fileName = fileName;
+    d->ioDevice = NULL;
 }
 
 QString QuaGzipFile::getFileName() const
@@ -119,15 +1012,79 @@ QString QuaGzipFile::getFileName() const
     return d->fileName;
 }
 
+void QuaGzipFile::setIoDevice(QIODevice *ioDevice)
+{
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setIoDevice(): file is already open");
+        return;
+    }
+    d->ioDevice = ioDevice;
+    d->fileName = QString();
+}
+
+QIODevice *QuaGzipFile::getIoDevice() const
+{
+    return d->ioDevice;
+}
+
+void QuaGzipFile::setThreadCount(int threads)
+{
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setThreadCount(): file is already open");
+        return;
+    }
+    d->threads = qMax(threads, 0);
+}
+
+int QuaGzipFile::getThreadCount() const
+{
+    return d->threads;
+}
+
+void QuaGzipFile::setQueueDepth(int depth)
+{
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setQueueDepth(): file is already open");
+        return;
+    }
+    d->queueDepth = qMax(depth, 0);
+}
+
+int QuaGzipFile::getQueueDepth() const
+{
+    return d->queueDepth;
+}
+
+void QuaGzipFile::setWriteFormat(WriteFormat format)
+{
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setWriteFormat(): file is already open");
+        return;
+    }
+    d->writeFormat = format;
+}
+
+QuaGzipFile::WriteFormat QuaGzipFile::getWriteFormat() const
+{
+    return d->writeFormat;
+}
+
 bool QuaGzipFile::isSequential() const
 {
-  return true;
+  return !d->seekable;
 }
 
 bool QuaGzipFile::open(QIODevice::OpenMode mode)
 {
     QString error;
-    if (!d->open(d->fileName, mode, error)) {
+    if (d->ioDevice != NULL) {
+        if (!d->openDevice(mode, error)) {
+            setErrorString(error);
+            return false;
+        }
+        if (d->source != NULL && d->ioDevice->isSequential())
+            connect(d->ioDevice, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+    } else if (!d->open(d->fileName, mode, error)) {
         setErrorString(error);
         return false;
     }
@@ -146,24 +1103,211 @@ bool QuaGzipFile::open(int fd, QIODevice::OpenMode mode)
 
 bool QuaGzipFile::flush()
 {
+    if (d->deflater != NULL) {
+        if (!d->deflater->flush()) {
+            setErrorString(trUtf8("Could not compress data"));
+            return false;
+        }
+        if (!d->writeOutput()) {
+            setErrorString(d->error);
+            return false;
+        }
+        return true;
+    }
+    if (d->gzd == NULL)
+        return false;
     return gzflush(d->gzd, Z_SYNC_FLUSH) == Z_OK;
 }
 
 void QuaGzipFile::close()
 {
   QIODevice::close();
-  gzclose(d->gzd);
+  if (d->ioDevice != NULL)
+      disconnect(d->ioDevice, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+  if (d->deflater != NULL) {
+      if (!d->closeDeflater())
+          setErrorString(d->error);
+  } else if (d->source != NULL) {
+      d->closeInflater();
+  } else {
+      gzclose(d->gzd);
+      d->gzd = NULL;
+  }
+}
+
+bool QuaGzipFile::seek(qint64 pos)
+{
+    if (!d->seekable)
+        return QIODevice::seek(pos);
+    if (pos < 0 || (d->size >= 0 && pos > d->size)) {
+        qWarning("QuaGzipFile::seek(): position %lld is out of range",
+                 (long long) pos);
+        return false;
+    }
+    // where QIODevice thinks the inflater is
+    quint64 here = d->outPos;
+    if (!d->seekTo(pos)) {
+        QString error = d->error;
+        // go back there, so that the next read() goes on from pos()
+        d->seekTo((qint64) here);
+        setErrorString(error);
+        return false;
+    }
+    return QIODevice::seek(pos);
+}
+
+qint64 QuaGzipFile::size() const
+{
+    if (!d->seekable)
+        return QIODevice::size();
+    return d->size >= 0 ? d->size : 0;
+}
+
+bool QuaGzipFile::waitForReadyRead(int msecs)
+{
+    if (d->source == NULL || !d->source->isSequential())
+        return QIODevice::waitForReadyRead(msecs);
+    return d->source->waitForReadyRead(msecs);
+}
+
+bool QuaGzipFile::atEnd() const
+{
+    if (d->source == NULL)
+        return QIODevice::atEnd();
+    // nothing buffered, and nothing left to inflate
+    return bytesAvailable() == 0 && d->atEnd();
+}
+
+qint64 QuaGzipFile::bytesAvailable() const
+{
+    if (d->members != NULL)
+        return QIODevice::bytesAvailable() + d->output.size() - d->outputUsed;
+    if (!d->seekable)
+        return QIODevice::bytesAvailable();
+    // what QIODevice has buffered is between pos() and the inflater
+    if (d->size < 0)
+        return (qint64) d->outPos - pos();
+    return qMax<qint64>(d->size - pos(), 0);
+}
+
+void QuaGzipFile::setSeekCheckpointSpan(qint64 span)
+{
+    if (isOpen()) {
+        qWarning("QuaGzipFile::setSeekCheckpointSpan(): file is already open");
+        return;
+    }
+    d->checkpointSpan = qMax<qint64>(span, 0);
+}
+
+qint64 QuaGzipFile::getSeekCheckpointSpan() const
+{
+    return d->checkpointSpan;
+}
+
+bool QuaGzipFile::buildSeekIndex()
+{
+    if (!d->seekable) {
+        qWarning("QuaGzipFile::buildSeekIndex(): file is not open for random access");
+        return false;
+    }
+    qint64 here = pos();
+    if (!d->seekTo(-1)) {
+        setErrorString(d->error);
+        return false;
+    }
+    return seek(here);
+}
+
+int QuaGzipFile::getSeekCheckpointCount() const
+{
+    return d->checkpoints.size();
+}
+
+void QuaGzipFile::clearSeekIndex()
+{
+    d->checkpoints.clear();
+}
+
+bool QuaGzipFile::saveSeekIndex(QIODevice *device) const
+{
+    QDataStream out(device);
+    out.setVersion(QDataStream::Qt_4_6);
+    out << SEEK_INDEX_MAGIC << SEEK_INDEX_VERSION << d->fingerprintLength
+        << d->fingerprintCrc << (quint32) d->checkpoints.size();
+    foreach (const QuaGzipCheckpoint &point, d->checkpoints) {
+        out << point.uncompressedOffset << point.compressedOffset
+            << (qint8) point.bits << point.window;
+    }
+    return out.status() == QDataStream::Ok;
+}
+
+bool QuaGzipFile::loadSeekIndex(QIODevice *device)
+{
+    QDataStream in(device);
+    in.setVersion(QDataStream::Qt_4_6);
+    quint32 magic = 0, length = 0, crc = 0, count = 0;
+    quint16 version = 0;
+    in >> magic >> version >> length >> crc >> count;
+    if (in.status() != QDataStream::Ok || magic != SEEK_INDEX_MAGIC
+            || version != SEEK_INDEX_VERSION)
+        return false;
+    QList<QuaGzipCheckpoint> checkpoints;
+    for (quint32 i = 0; i < count; ++i) {
+        QuaGzipCheckpoint point;
+        qint8 bits = 0;
+        in >> point.uncompressedOffset >> point.compressedOffset >> bits
+           >> point.window;
+        point.bits = bits;
+        if (in.status() != QDataStream::Ok || bits < -1 || bits > 7
+                || (bits >= 0) == point.window.isEmpty()
+                || (!checkpoints.isEmpty() && point.uncompressedOffset
+                    <= checkpoints.last().uncompressedOffset))
+            return false;
+        checkpoints.append(point);
+    }
+    // an open file can only take its own index
+    if (d->seekable) {
+        quint32 fileCrc = 0;
+        bool same = d->fingerprint(length, &fileCrc) && fileCrc == crc;
+        if (!d->source->seek((qint64) d->inputEnd)) {
+            d->error = trUtf8("Could not read file");
+            setErrorString(d->error);
+        }
+        if (!same)
+            return false;
+    }
+    d->checkpoints = checkpoints;
+    d->fingerprintLength = length;
+    d->fingerprintCrc = crc;
+    return true;
 }
 
 qint64 QuaGzipFile::readData(char *data, qint64 maxSize)
 {
-    return gzread(d->gzd, (voidp)data, (unsigned)maxSize);
+    if (d->source == NULL)
+        return gzread(d->gzd, (voidp)data, (unsigned)maxSize);
+    qint64 read = d->members != NULL ? d->readParallel(data, maxSize)
+        : d->read(data, maxSize);
+    if (read < 0)
+        setErrorString(d->error);
+    return read;
 }
 
 qint64 QuaGzipFile::writeData(const char *data, qint64 maxSize)
 {
     if (maxSize == 0)
         return 0;
+    if (d->deflater != NULL) {
+        if (!d->deflater->write(data, maxSize)) {
+            setErrorString(trUtf8("Could not compress data"));
+            return -1;
+        }
+        if (!d->writeOutput()) {
+            setErrorString(d->error);
+            return -1;
+        }
+        return maxSize;
+    }
     int written = gzwrite(d->gzd, (voidp)data, (unsigned)maxSize);
     if (written == 0)
         return -1;
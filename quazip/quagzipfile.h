@@ -34,11 +34,26 @@ class QuaGzipFilePrivate;
 
 /// GZIP file
 /**
-  This class is a wrapper around GZIP file access functions in zlib. Unlike QuaZip classes, it doesn't allow reading from a GZIP file opened as QIODevice, for example, if your GZIP file is in QBuffer. It only provides QIODevice access to a GZIP file contents, but the GZIP file itself must be identified by its name on disk or by descriptor id.
+  This class is a wrapper around GZIP file access functions in zlib. It provides QIODevice access to a GZIP file contents, the GZIP file itself being identified by its name on disk, by descriptor id or by a QIODevice, for example, if your GZIP file is in QBuffer.
+
+  For reading, setSeekCheckpointSpan() switches from gzread() to an
+  inflater of its own, which makes the file a random-access device and
+  follows a GZIP file that is still being written. setThreadCount()
+  inflates a file made of many members, such as the output of pigz or
+  BGZF, on several threads, and deflates on several threads when
+  writing.
   */
 class QUAZIP_EXPORT QuaGzipFile: public QIODevice {
   Q_OBJECT
 public:
+  /// The layout of a file written on several threads.
+  /** \sa setWriteFormat() */
+  enum WriteFormat {
+    /// A single member, as written by gzwrite().
+    SingleMember,
+    /// BGZF: members of at most 64 KB, with the BGZF end-of-file marker.
+    BgzfMembers
+  };
   /// Empty constructor.
   /**
     Must call setFileName() before trying to open.
@@ -56,21 +71,203 @@ public:
     \param parent The parent object, as per QObject logic.
     */
   QuaGzipFile(const QString &fileName, QObject *parent = NULL);
+  /// Constructor.
+  /**
+    \param ioDevice The device to read the GZIP file from, see
+    setIoDevice().
+    \param parent The parent object, as per QObject logic.
+    */
+  QuaGzipFile(QIODevice *ioDevice, QObject *parent = NULL);
   /// Destructor.
   virtual ~QuaGzipFile();
   /// Sets the name of the GZIP file to be opened.
+  /**
+    Forgets the device set by setIoDevice(), if any. Will do nothing if
+    the file is currently open.
+    */
   void setFileName(const QString& fileName);
   /// Returns the name of the GZIP file.
   QString getFileName() const;
-  /// Returns true.
+  /// Sets the device to read the GZIP file from or write it to.
+  /**
+    The device is read with the inflater of setSeekCheckpointSpan(),
+    whatever the span, and written with the deflater of
+    setThreadCount(), with one thread if the count is 1. If it isn't
+    open, open() opens it in the same mode and close() closes it;
+    otherwise it must be open in that mode and stays open. A
+    random-access device is read from the start, a sequential one from
+    where it is, and then readyRead() and waitForReadyRead() follow the
+    device, so that a GZIP stream can be read from a socket as it
+    arrives.
+
+    Forgets the file name set by setFileName(), if any. QuaGzipFile
+    doesn't take ownership of the device. Will do nothing if the file is
+    currently open.
+    */
+  void setIoDevice(QIODevice *ioDevice);
+  /// Returns the device set by setIoDevice(), or NULL.
+  QIODevice *getIoDevice() const;
+  /// Sets the number of threads to inflate or deflate on.
+  /**
+    When writing with a thread count other than 1, the data is cut into
+    blocks that are deflated on a thread pool and written in order, as
+    set by setWriteFormat(). Each block is primed with the end of the
+    previous one for a single member, so that the file is only slightly
+    bigger than with gzwrite(). flush() then ends the current block, and
+    close() waits for the last one.
+
+
+    When reading a random-access file made of several members with a
+    thread count other than 1, the file is cut into pieces of a
+    megabyte or so, at what looks like the start of a member, and the
+    pieces are inflated in parallel, checking the trailers. A piece
+    that turns out to be cut in the middle of a member is inflated
+    again, on the calling thread, up to the end of that member. A file
+    made of a single member is read on the calling thread only, but
+    reads its first few megabytes twice.
+
+    0 means QThread::idealThreadCount(). 1, the default, reads and
+    writes on the calling thread only. Ignored when reading with random
+    access enabled by setSeekCheckpointSpan(), or a sequential file.
+    Will do nothing if the file is currently open.
+    */
+  void setThreadCount(int threads);
+  /// Returns the number of threads set by setThreadCount().
+  int getThreadCount() const;
+  /// Sets how many blocks or pieces may be in flight at once.
+  /**
+    With setThreadCount(), this is how far reading goes ahead, or how
+    many blocks write() queues before it waits for the oldest one. The
+    default, 0, means twice the number of threads. Will do nothing if
+    the file is currently open.
+    */
+  void setQueueDepth(int depth);
+  /// Returns the queue depth set by setQueueDepth().
+  int getQueueDepth() const;
+  /// Sets the layout of a file written on several threads.
+  /**
+    SingleMember, the default, can be read by anything that reads GZIP.
+    BgzfMembers is what samtools and friends expect, and can be read
+    back on several threads, see setThreadCount(). Will do nothing if
+    the file is currently open.
+    */
+  void setWriteFormat(WriteFormat format);
+  /// Returns the format set by setWriteFormat().
+  WriteFormat getWriteFormat() const;
+  /// Returns true, unless the file is open for random access.
   /**
     Strictly speaking, zlib supports seeking for GZIP files, but it is
     poorly implemented, because there is no way to implement it
     properly. For reading, seeking backwards is very slow, and for
     writing, it is downright impossible. Therefore, QuaGzipFile does not
-    support seeking at all.
+    support seeking, unless it is open for reading with
+    setSeekCheckpointSpan().
     */
   virtual bool isSequential() const;
+  /// Enables random access when reading.
+  /**
+    When \a span is greater than 0, the next open() for reading inflates
+    the file with an inflater of its own instead of gzread(). If the
+    file is a regular file, it is then a random-access device:
+    isSequential() returns \c false and seek() goes anywhere in the
+    uncompressed data.
+
+    While the file is read, a checkpoint is recorded at the end of the
+    first deflate block, or at the start of the first member, at least
+    \a span bytes after the previous one, along with the 32 KB of data
+    before it (kept compressed). seek() restarts inflating at the last
+    checkpoint before the target, so it never inflates much more than
+    \a span bytes. Seeking past the last checkpoint inflates everything
+    up to the target, recording the checkpoints on the way. Call
+    buildSeekIndex() to do it right away.
+
+    The checkpoints are kept as long as the same file is opened again,
+    and saveSeekIndex() and loadSeekIndex() persist them next to it, so
+    that the next run can seek right away:
+    \code
+    QuaGzipFile gzip("access.log.gz");
+    gzip.setSeekCheckpointSpan(1024 * 1024);
+    QFile sidecar("access.log.gz.idx");
+    if (sidecar.open(QIODevice::ReadOnly))
+        gzip.loadSeekIndex(&sidecar);
+    gzip.open(QIODevice::ReadOnly);
+    gzip.buildSeekIndex(); // only inflates what is after the last checkpoint
+    gzip.seek(gzip.size() - 1024);
+    \endcode
+
+    The inflater reads the file as it grows: once everything written so
+    far is read, read() returns 0 and atEnd() returns \c true, but the
+    next read() continues where the last one stopped, from a partial
+    deflate block or from a new member. A file can be tailed that way
+    without reading it again. Use read() for that rather than readAll(),
+    which stops at size().
+
+    Unlike gzread(), the inflater only reads GZIP data. Whatever follows
+    the last member is ignored, as with gzread().
+
+    Smaller spans make seeking faster and the index bigger. Pass 0, the
+    default, for gzread().
+
+    Will do nothing if the file is currently open.
+    */
+  void setSeekCheckpointSpan(qint64 span);
+  /// Returns the span set by setSeekCheckpointSpan().
+  qint64 getSeekCheckpointSpan() const;
+  /// Records the checkpoints of the whole file.
+  /**
+    Inflates the rest of the file after the last checkpoint, then goes
+    back to the current position, so that size() is known. The file must
+    be open for random access, see setSeekCheckpointSpan().
+
+    Returns \c false on error, see errorString().
+    */
+  bool buildSeekIndex();
+  /// Returns the number of seek checkpoints recorded so far.
+  int getSeekCheckpointCount() const;
+  /// Forgets the seek checkpoints.
+  void clearSeekIndex();
+  /// Writes the seek checkpoints to \a device.
+  /**
+    Saves what loadSeekIndex() needs, including a CRC of the beginning
+    of the file, to tell whether the index is still valid.
+
+    Returns \c false if writing failed.
+    */
+  bool saveSeekIndex(QIODevice *device) const;
+  /// Reads the seek checkpoints saved by saveSeekIndex() from \a device.
+  /**
+    If the file is open for random access, the index must belong to it.
+    Otherwise, it is checked when the file is opened, and dropped if the
+    file is not the one it was saved for. A file that only grew since is
+    still the same file.
+
+    Returns \c false if the index is invalid or belongs to another file.
+    */
+  bool loadSeekIndex(QIODevice *device);
+  /// Moves to \a pos in the uncompressed data.
+  /**
+    Only works if the file is open for random access, see
+    setSeekCheckpointSpan(). Returns \c false on error, or if \a pos is
+    past the end of the file.
+    */
+  virtual bool seek(qint64 pos);
+  /// Returns the uncompressed size, if known.
+  /**
+    When the file is open for random access, this is the size of the
+    data once the end of the file has been reached, or 0 before that.
+    Otherwise, this is what QIODevice::size() returns.
+    */
+  virtual qint64 size() const;
+  /// Returns \c true if there is nothing more to read, for now.
+  /**
+    When reading with the inflater of setSeekCheckpointSpan(), more may
+    be read later if the file grows.
+    */
+  virtual bool atEnd() const;
+  /// Returns the number of bytes that can be read right away.
+  virtual qint64 bytesAvailable() const;
+  /// Waits for the device set by setIoDevice() if it is sequential.
+  virtual bool waitForReadyRead(int msecs);
   /// Opens the file.
   /**
     \param mode Can be either QIODevice::Write or QIODevice::Read.
@@ -87,8 +284,9 @@ public:
   virtual bool open(int fd, QIODevice::OpenMode mode);
   /// Flushes data to file.
   /**
-    The data is written using Z_SYNC_FLUSH mode. Doesn't make any sense
-    when reading.
+    The data is written using Z_SYNC_FLUSH mode, or as a block of its
+    own when written on several threads. Doesn't make any sense when
+    reading.
     */
   virtual bool flush();
   /// Closes the file.
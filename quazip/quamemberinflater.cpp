@@ -0,0 +1,197 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quamemberinflater.h"
+
+#include <QList>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <string.h>
+#include <zlib.h>
+
+/// \cond internal
+
+struct QuaInflatePiece {
+  QByteArray input;
+  QByteArray output;
+  quint64 offset;
+  quint64 end;
+  bool done;
+  bool ok;
+  QuaInflatePiece(): offset(0), end(0), done(false), ok(false) {}
+};
+
+class QuaMemberInflaterPrivate {
+  friend class QuaMemberInflater;
+  friend class QuaInflatePieceTask;
+  QuaMemberInflaterPrivate(int threads, int queueDepth, int maxOutput);
+  QThreadPool pool;
+  QMutex mutex;
+  QWaitCondition pieceDone;
+  QList<QuaInflatePiece*> queue;
+  int queueDepth;
+  int maxOutput;
+  static bool inflatePiece(QuaInflatePiece *piece, int maxOutput);
+};
+
+class QuaInflatePieceTask: public QRunnable {
+public:
+  QuaInflatePieceTask(QuaMemberInflaterPrivate *d, QuaInflatePiece *piece):
+    d(d), piece(piece) {}
+  void run();
+private:
+  QuaMemberInflaterPrivate *d;
+  QuaInflatePiece *piece;
+};
+
+void QuaInflatePieceTask::run()
+{
+  bool ok = QuaMemberInflaterPrivate::inflatePiece(piece, d->maxOutput);
+  QMutexLocker locker(&d->mutex);
+  piece->ok = ok;
+  piece->done = true;
+  d->pieceDone.wakeAll();
+}
+
+QuaMemberInflaterPrivate::QuaMemberInflaterPrivate(int threads,
+    int queueDepth, int maxOutput):
+  maxOutput(maxOutput)
+{
+  pool.setMaxThreadCount(threads > 0 ? threads
+      : qMax(1, QThread::idealThreadCount()));
+  this->queueDepth = queueDepth > 0 ? queueDepth
+      : 2 * pool.maxThreadCount();
+}
+
+bool QuaMemberInflaterPrivate::inflatePiece(QuaInflatePiece *piece,
+    int maxOutput)
+{
+  const QByteArray &input = piece->input;
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  // zlib parses the headers and checks the trailers
+  if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    return false;
+  piece->output.resize(qMin(qMax(input.size(), 1024) * 4, maxOutput));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(
+        input.constData()));
+  stream.avail_in = input.size();
+  stream.next_out = reinterpret_cast<Bytef*>(piece->output.data());
+  stream.avail_out = piece->output.size();
+  bool ok = false;
+  for (;;) {
+    int err = inflate(&stream, Z_NO_FLUSH);
+    if (err == Z_STREAM_END) {
+      if (stream.avail_in == 0) {
+        ok = true;
+        break;
+      }
+      // the next member, or whatever was cut there
+      inflateReset(&stream);
+      continue;
+    }
+    if (err != Z_OK && err != Z_BUF_ERROR)
+      break;
+    // the input ended in the middle of a member
+    if (stream.avail_out != 0)
+      break;
+    int used = piece->output.size();
+    if (used >= maxOutput)
+      break;
+    piece->output.resize(qMin(used * 2, maxOutput));
+    stream.next_out = reinterpret_cast<Bytef*>(piece->output.data() + used);
+    stream.avail_out = piece->output.size() - used;
+  }
+  piece->output.resize(ok ? piece->output.size() - stream.avail_out : 0);
+  inflateEnd(&stream);
+  piece->input = QByteArray();
+  return ok;
+}
+/// \endcond
+
+QuaMemberInflater::QuaMemberInflater(int threads, int queueDepth,
+    int maxOutput):
+  d(new QuaMemberInflaterPrivate(threads, queueDepth, maxOutput))
+{
+}
+
+QuaMemberInflater::~QuaMemberInflater()
+{
+  d->pool.waitForDone();
+  qDeleteAll(d->queue);
+  delete d;
+}
+
+bool QuaMemberInflater::isFull() const
+{
+  return d->queue.size() >= d->queueDepth;
+}
+
+bool QuaMemberInflater::isEmpty() const
+{
+  return d->queue.isEmpty();
+}
+
+void QuaMemberInflater::submit(const QByteArray &piece, quint64 offset)
+{
+  QuaInflatePiece *inflatePiece = new QuaInflatePiece();
+  inflatePiece->input = piece;
+  inflatePiece->offset = offset;
+  inflatePiece->end = offset + piece.size();
+  QMutexLocker locker(&d->mutex);
+  d->queue.append(inflatePiece);
+  d->pool.start(new QuaInflatePieceTask(d, inflatePiece));
+}
+
+bool QuaMemberInflater::take(QByteArray *output, quint64 *offset,
+    quint64 *end)
+{
+  QuaInflatePiece *piece;
+  {
+    QMutexLocker locker(&d->mutex);
+    if (d->queue.isEmpty())
+      return false;
+    piece = d->queue.first();
+    while (!piece->done)
+      d->pieceDone.wait(&d->mutex);
+    d->queue.removeFirst();
+  }
+  bool ok = piece->ok;
+  *output = piece->output;
+  *offset = piece->offset;
+  *end = piece->end;
+  delete piece;
+  return ok;
+}
+
+void QuaMemberInflater::clear()
+{
+  d->pool.waitForDone();
+  qDeleteAll(d->queue);
+  d->queue.clear();
+}
@@ -0,0 +1,86 @@
+#ifndef QUAZIP_QUAMEMBERINFLATER_H
+#define QUAZIP_QUAMEMBERINFLATER_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QByteArray>
+
+#include "quazip_global.h"
+
+/// \cond internal
+class QuaMemberInflaterPrivate;
+
+/// Parallel inflater of GZIP members.
+/**
+  Inflates pieces of a GZIP stream on a thread pool, member by member,
+  checking the trailers. A piece starts at a member header and should
+  end right after a member, but the caller can only guess where members
+  start, so a piece may turn out to be cut in the middle of one. Such a
+  piece fails, and so does the next one, and the caller has to inflate
+  that part of the stream by itself.
+
+  The pieces are taken in the order they were submitted.
+
+  This class is not thread-safe: all its functions must be called from
+  the same thread.
+  */
+class QuaMemberInflater {
+public:
+  /// Constructor.
+  /**
+    \param threads The number of threads inflating pieces, 0 meaning
+    QThread::idealThreadCount().
+    \param queueDepth How many pieces may be in flight at once, 0 meaning
+    twice the number of threads.
+    \param maxOutput The largest output of a piece. A piece that inflates
+    to more than that fails.
+    */
+  QuaMemberInflater(int threads, int queueDepth = 0,
+      int maxOutput = 64 * 1024 * 1024);
+  /// Destructor. Waits for the pending pieces and discards them.
+  ~QuaMemberInflater();
+  /// Returns true if no more pieces should be submitted for now.
+  bool isFull() const;
+  /// Returns true if there are no pieces to take.
+  bool isEmpty() const;
+  /// Starts inflating \a piece, found at \a offset in the stream.
+  void submit(const QByteArray &piece, quint64 offset);
+  /// Waits for the oldest piece and takes it.
+  /**
+    Returns false if the piece is not made of whole members, in which
+    case \a output is left empty. \a offset and \a end are set to where
+    the piece was in the stream in both cases.
+    */
+  bool take(QByteArray *output, quint64 *offset, quint64 *end);
+  /// Waits for all the pieces and discards them.
+  void clear();
+private:
+  QuaMemberInflater(const QuaMemberInflater &that);
+  QuaMemberInflater &operator=(const QuaMemberInflater &that);
+  QuaMemberInflaterPrivate *d;
+};
+/// \endcond
+
+#endif // QUAZIP_QUAMEMBERINFLATER_H
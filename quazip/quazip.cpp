@@ -22,11 +22,14 @@ Original ZIP package is copyrighted by Gilles Vollant, see
 quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
+#include <QDir>
 #include <QFile>
 #include <QFlags>
 #include <QHash>
 
 #include "quazip.h"
+#include "quazipentrytable.h"
+#include "quazipfile.h"
 
 /// All the internal stuff for the QuaZip class.
 /**
@@ -70,6 +73,16 @@ class QuaZipPrivate {
     bool zip64;
     /// The auto-close flag.
     bool autoClose;
+    /// Whether \ref QuaZip::setMapped() "the memory-mapped mode" is enabled.
+    bool mapped;
+    /// Whether \ref QuaZip::setIndexFileEnabled() "the index file" is used.
+    bool indexFileEnabled;
+    /// Whether \ref QuaZip::setEagerIndexEnabled() "the eager index" is enabled.
+    bool eagerIndexEnabled;
+    /// The \ref QuaZip::setDeflateBackend() "deflate backend".
+    QuaZip::DeflateBackend deflateBackend;
+    /// The budget of the one-shot deflate backend.
+    qint64 deflateBudget;
     inline QTextCodec *getDefaultFileNameCodec()
     {
         if (defaultFileNameCodec == NULL) {
@@ -89,7 +102,13 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      mapped(false),
+      indexFileEnabled(false),
+      eagerIndexEnabled(false),
+      deflateBackend(QuaZip::dbDefault),
+      deflateBudget(QuaZip::DefaultDeflateBudget),
+      entryTableFailed(false)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -108,7 +127,13 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      mapped(false),
+      indexFileEnabled(false),
+      eagerIndexEnabled(false),
+      deflateBackend(QuaZip::dbDefault),
+      deflateBudget(QuaZip::DefaultDeflateBudget),
+      entryTableFailed(false)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -126,7 +151,13 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      mapped(false),
+      indexFileEnabled(false),
+      eagerIndexEnabled(false),
+      deflateBackend(QuaZip::dbDefault),
+      deflateBudget(QuaZip::DefaultDeflateBudget),
+      entryTableFailed(false)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -145,6 +176,20 @@ class QuaZipPrivate {
       QHash<QString, unz64_file_pos> directoryCaseInsensitive;
       unz64_file_pos lastMappedDirectoryEntry;
       static QTextCodec *defaultFileNameCodec;
+    /// The decoded central directory, loaded on demand in mdUnzip.
+    QuaZipEntryTable entryTable;
+    /// Whether the central directory failed to decode.
+    bool entryTableFailed;
+    /// Loads the entry table if needed, returns false if it's unusable.
+    bool ensureEntryTable();
+    /// The name of the archive file, if it is one.
+    QString archiveFileName() const;
+    /// Drops the entry table.
+    inline void clearEntryTable();
+    /// Checks the modes of copyEntryRaw() and copyEntriesRaw().
+    bool canCopyRaw(const QuaZip &source, const char *function);
+    /// Copies the current file of \a source, see QuaZip::copyEntryRaw().
+    bool copyCurrentFileRaw(QuaZip &source, const QString &newName);
 };
 
 QTextCodec *QuaZipPrivate::defaultFileNameCodec = NULL;
@@ -162,6 +207,9 @@ void QuaZipPrivate::addCurrentFileToDirectoryMap(const QString &fileName)
     if (!hasCurrentFile_f || fileName.isEmpty()) {
         return;
     }
+    // The entry table serves the lookups, no need to copy the names
+    if (entryTable.isLoaded())
+        return;
     // Adds current file to filename map as fileName
     unz64_file_pos fileDirectoryPos;
     unzGetFilePos64(unzFile_f, &fileDirectoryPos);
@@ -176,6 +224,48 @@ void QuaZipPrivate::addCurrentFileToDirectoryMap(const QString &fileName)
         lastMappedDirectoryEntry = fileDirectoryPos;
 }
 
+bool QuaZipPrivate::ensureEntryTable()
+{
+    if (mode != QuaZip::mdUnzip)
+        return false;
+    if (entryTable.isLoaded())
+        return true;
+    if (entryTableFailed)
+        return false;
+    QString indexName;
+    QString archiveName;
+    if (indexFileEnabled) {
+        archiveName = archiveFileName();
+        if (!archiveName.isEmpty()) {
+            indexName = QuaZip::indexFileName(archiveName);
+            if (entryTable.loadIndex(indexName, archiveName, unzFile_f,
+                                     fileNameCodec))
+                return true;
+        }
+    }
+    // On failure, the caller falls back to walking the archive
+    entryTableFailed = !entryTable.load(unzFile_f, fileNameCodec);
+    // A missing or stale index is rewritten, failing silently if the
+    // directory is read-only
+    if (!entryTableFailed && !indexName.isEmpty())
+        entryTable.saveIndex(indexName, archiveName, unzFile_f);
+    return !entryTableFailed;
+}
+
+QString QuaZipPrivate::archiveFileName() const
+{
+    if (!zipName.isEmpty())
+        return zipName;
+    QFileDevice *file = qobject_cast<QFileDevice*>(ioDevice);
+    return file != NULL ? file->fileName() : QString();
+}
+
+void QuaZipPrivate::clearEntryTable()
+{
+    entryTable.clear();
+    entryTableFailed = false;
+}
+
 bool QuaZipPrivate::goToFirstUnmappedFile()
 {
     zipError = UNZ_OK;
@@ -241,6 +331,8 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
       if (ioApi == NULL) {
           if (p->autoClose)
               flags |= UNZ_AUTO_CLOSE;
+          if (p->mapped)
+              flags |= UNZ_MAPPED;
           p->unzFile_f=unzOpenInternal(ioDevice, NULL, 1, flags);
       } else {
           // QuaZIP pre-zip64 compatibility mode
@@ -265,6 +357,9 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
         }
         p->mode=mode;
         p->ioDevice = ioDevice;
+        // On failure, lookups fall back to walking the archive
+        if (p->eagerIndexEnabled)
+            p->ensureEntryTable();
         return true;
       } else {
         p->zipError=UNZ_OPENERROR;
@@ -355,6 +450,7 @@ void QuaZip::close()
       p->ioDevice = NULL;
   }
   p->clearDirectoryMap();
+  p->clearEntryTable();
   if(p->zipError==UNZ_OK)
     p->mode=mdNotOpen;
 }
@@ -434,12 +530,25 @@ bool QuaZip::setCurrentFile(const QString& fileName, CaseSensitivity cs)
   }
   // Find the file by name
   bool sens = convertCaseSensitivity(cs) == Qt::CaseSensitive;
-  QString lower, current;
-  if(!sens) lower=fileName.toLower();
   p->hasCurrentFile_f=false;
 
-  // Check the appropriate Map
+  // Look the name up in the decoded central directory
   unz64_file_pos fileDirPos;
+  if (p->ensureEntryTable()) {
+      int index = p->entryTable.indexOf(fileName,
+                                        sens ? Qt::CaseSensitive
+                                             : Qt::CaseInsensitive);
+      if (index == -1)
+          return false;
+      fileDirPos = p->entryTable.filePos(index);
+      p->zipError = unzGoToFilePos64(p->unzFile_f, &fileDirPos);
+      p->hasCurrentFile_f = p->zipError == UNZ_OK;
+      return p->hasCurrentFile_f;
+  }
+
+  // Otherwise check the appropriate Map
+  QString lower, current;
+  if(!sens) lower=fileName.toLower();
   fileDirPos.pos_in_zip_directory = 0;
   if (sens) {
       if (p->directoryCaseSensitive.contains(fileName))
@@ -579,11 +688,13 @@ QString QuaZip::getCurrentFileName()const
 void QuaZip::setFileNameCodec(QTextCodec *fileNameCodec)
 {
   p->fileNameCodec=fileNameCodec;
+  // names have to be decoded again
+  p->clearEntryTable();
 }
 
 void QuaZip::setFileNameCodec(const char *fileNameCodecName)
 {
-  p->fileNameCodec=QTextCodec::codecForName(fileNameCodecName);
+  setFileNameCodec(QTextCodec::codecForName(fileNameCodecName));
 }
 
 QTextCodec *QuaZip::getFileNameCodec()const
@@ -643,6 +754,31 @@ bool QuaZip::hasCurrentFile()const
   return p->hasCurrentFile_f;
 }
 
+bool QuaZip::getCurrentFilePos(unz64_file_pos *pos)const
+{
+  QuaZip *fakeThis=(QuaZip*)this; // non-const
+  fakeThis->p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::getCurrentFilePos(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  if(!hasCurrentFile() || pos==NULL) return false;
+  fakeThis->p->zipError=unzGetFilePos64(p->unzFile_f, pos);
+  return p->zipError==UNZ_OK;
+}
+
+bool QuaZip::goToFilePos(const unz64_file_pos &pos)
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::goToFilePos(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  p->zipError=unzGoToFilePos64(p->unzFile_f, &pos);
+  p->hasCurrentFile_f=p->zipError==UNZ_OK;
+  return p->hasCurrentFile_f;
+}
+
 unzFile QuaZip::getUnzFile()
 {
   return p->unzFile_f;
@@ -663,6 +799,24 @@ bool QuaZip::isDataDescriptorWritingEnabled() const
     return p->dataDescriptorWritingEnabled;
 }
 
+const qint64 QuaZip::DefaultDeflateBudget = ZIP_DEFLATE_DEFAULT_BUDGET;
+
+void QuaZip::setDeflateBackend(DeflateBackend backend, qint64 budget)
+{
+    p->deflateBackend = backend;
+    p->deflateBudget = qBound<qint64>(0, budget, 1024 * 1024 * 1024);
+}
+
+QuaZip::DeflateBackend QuaZip::getDeflateBackend() const
+{
+    return p->deflateBackend;
+}
+
+qint64 QuaZip::getDeflateBudget() const
+{
+    return p->deflateBudget;
+}
+
 template<typename TFileInfo>
 TFileInfo QuaZip_getFileInfo(QuaZip *zip, bool *ok);
 
@@ -690,6 +844,33 @@ QString QuaZip_getFileInfo(QuaZip *zip, bool *ok)
     return name;
 }
 
+template<typename TFileInfo>
+void QuaZip_getTableFileInfo(const QuaZipEntryTable &table, int i,
+                             QTextCodec *commentCodec, TFileInfo *info);
+
+template<>
+void QuaZip_getTableFileInfo(const QuaZipEntryTable &table, int i,
+                             QTextCodec *commentCodec, QuaZipFileInfo *info)
+{
+    QuaZipFileInfo64 info64;
+    table.fileInfo(i, &info64, commentCodec);
+    info64.toQuaZipFileInfo(*info);
+}
+
+template<>
+void QuaZip_getTableFileInfo(const QuaZipEntryTable &table, int i,
+                             QTextCodec *commentCodec, QuaZipFileInfo64 *info)
+{
+    table.fileInfo(i, info, commentCodec);
+}
+
+template<>
+void QuaZip_getTableFileInfo(const QuaZipEntryTable &table, int i,
+                             QTextCodec * /*commentCodec*/, QString *info)
+{
+    *info = table.names().at(i);
+}
+
 template<typename TFileInfo>
 bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
 {
@@ -700,6 +881,22 @@ bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
             "ZIP is not open in mdUnzip mode");
     return false;
   }
+  if (fakeThis->ensureEntryTable()) {
+      // served from the decoded central directory
+      int count = entryTable.count();
+      result->reserve(count);
+      // decodes all the names at once, on several threads
+      entryTable.names();
+      for (int i = 0; i < count; ++i) {
+          TFileInfo info;
+          QuaZip_getTableFileInfo(entryTable, i, commentCodec, &info);
+          result->append(info);
+      }
+      // like the walk below, which leaves the first file current
+      if (!hasCurrentFile_f && count > 0 && !q->goToFirstFile())
+          return false;
+      return true;
+  }
   QString currentFile;
   if (q->hasCurrentFile()) {
       currentFile = q->getCurrentFileName();
@@ -751,6 +948,139 @@ QList<QuaZipFileInfo64> QuaZip::getFileInfoList64() const
         return QList<QuaZipFileInfo64>();
 }
 
+/// Returns \a extra without its zip64 blocks (header ID 0x0001).
+/** Unlike zipRemoveExtraInfoBlock(), doesn't trust the block sizes: a
+  truncated last block is kept as is. */
+static QByteArray QuaZip_removeZip64Extra(const QByteArray &extra)
+{
+  QByteArray result;
+  const uchar *data = reinterpret_cast<const uchar*>(extra.constData());
+  int pos = 0;
+  while (pos + 4 <= extra.size()) {
+    quint16 id = data[pos] | (data[pos + 1] << 8);
+    int size = 4 + (data[pos + 2] | (data[pos + 3] << 8));
+    if (pos + size > extra.size())
+      break;
+    if (id != 0x0001)
+      result.append(extra.constData() + pos, size);
+    pos += size;
+  }
+  result.append(extra.constData() + pos, extra.size() - pos);
+  return result;
+}
+
+bool QuaZipPrivate::canCopyRaw(const QuaZip &source, const char *function)
+{
+  zipError = UNZ_OK;
+  if (mode != QuaZip::mdCreate && mode != QuaZip::mdAppend
+      && mode != QuaZip::mdAdd) {
+    qWarning("QuaZip::%s(): ZIP is not open in a writing mode", function);
+    return false;
+  }
+  if (source.getMode() != QuaZip::mdUnzip) {
+    qWarning("QuaZip::%s(): source ZIP is not open in mdUnzip mode",
+             function);
+    return false;
+  }
+  return true;
+}
+
+bool QuaZipPrivate::copyCurrentFileRaw(QuaZip &source, const QString &newName)
+{
+  QuaZipFileInfo64 info;
+  if (!source.getCurrentFileInfo(&info)) {
+    zipError = source.getZipError();
+    return false;
+  }
+  if ((info.flags & 1) != 0) {
+    // the raw mode doesn't decrypt, and writing would encrypt again
+    qWarning("QuaZip::copyEntryRaw(): %s is encrypted",
+             info.name.toUtf8().constData());
+    zipError = UNZ_PARAMERROR;
+    return false;
+  }
+  QuaZipFile inFile(&source);
+  int method, level;
+  if (!inFile.open(QIODevice::ReadOnly, &method, &level, true)) {
+    zipError = inFile.getZipError();
+    return false;
+  }
+  QuaZipNewInfo newInfo(info);
+  if (!newName.isEmpty())
+    newInfo.name = newName;
+  // zip.c adds its own zip64 extra field when needed
+  newInfo.extraLocal = QuaZip_removeZip64Extra(info.extra);
+  newInfo.extraGlobal = newInfo.extraLocal;
+  // the sizes are known upfront, unlike when compressing
+  bool zip64Enabled = zip64;
+  if (info.uncompressedSize >= 0xffffffffu
+      || info.compressedSize >= 0xffffffffu)
+    zip64 = true;
+  QuaZipFile outFile(q);
+  bool opened = outFile.open(QIODevice::WriteOnly, newInfo, NULL, info.crc,
+                             method, level, true);
+  zip64 = zip64Enabled;
+  if (!opened) {
+    zipError = outFile.getZipError();
+    return false;
+  }
+  QByteArray buffer(64 * 1024, Qt::Uninitialized);
+  bool ok = true;
+  while (ok && !inFile.atEnd()) {
+    qint64 readLen = inFile.read(buffer.data(), buffer.size());
+    ok = readLen > 0 && outFile.write(buffer.constData(), readLen) == readLen;
+  }
+  outFile.close();
+  inFile.close();
+  if (inFile.getZipError() != UNZ_OK)
+    zipError = inFile.getZipError();
+  else if (outFile.getZipError() != ZIP_OK)
+    zipError = outFile.getZipError();
+  else if (!ok)
+    zipError = UNZ_ERRNO;
+  return zipError == UNZ_OK;
+}
+
+bool QuaZip::copyEntryRaw(QuaZip &source, const QString &name,
+                          const QString &newName)
+{
+  if (!p->canCopyRaw(source, "copyEntryRaw"))
+    return false;
+  if (name.isEmpty()) {
+    if (!source.hasCurrentFile()) {
+      qWarning("QuaZip::copyEntryRaw(): source ZIP has no current file");
+      p->zipError = UNZ_END_OF_LIST_OF_FILE;
+      return false;
+    }
+  } else if (!source.setCurrentFile(name)) {
+    p->zipError = source.getZipError() != UNZ_OK
+        ? source.getZipError() : UNZ_END_OF_LIST_OF_FILE;
+    return false;
+  }
+  return p->copyCurrentFileRaw(source, newName);
+}
+
+int QuaZip::copyEntriesRaw(QuaZip &source, const QStringList &nameFilters)
+{
+  if (!p->canCopyRaw(source, "copyEntriesRaw"))
+    return -1;
+  int copied = 0;
+  for (bool more = source.goToFirstFile(); more;
+       more = source.goToNextFile()) {
+    if (!nameFilters.isEmpty()
+        && !QDir::match(nameFilters, source.getCurrentFileName()))
+      continue;
+    if (!p->copyCurrentFileRaw(source, QString()))
+      return -1;
+    ++copied;
+  }
+  if (source.getZipError() != UNZ_OK) {
+    p->zipError = source.getZipError();
+    return -1;
+  }
+  return copied;
+}
+
 Qt::CaseSensitivity QuaZip::convertCaseSensitivity(QuaZip::CaseSensitivity cs)
 {
   if (cs == csDefault) {
@@ -793,3 +1123,38 @@ void QuaZip::setAutoClose(bool autoClose) const
 {
     p->autoClose = autoClose;
 }
+
+void QuaZip::setMapped(bool mapped)
+{
+    p->mapped = mapped;
+}
+
+bool QuaZip::isMapped() const
+{
+    return p->mapped;
+}
+
+void QuaZip::setIndexFileEnabled(bool enabled)
+{
+    p->indexFileEnabled = enabled;
+}
+
+bool QuaZip::isIndexFileEnabled() const
+{
+    return p->indexFileEnabled;
+}
+
+void QuaZip::setEagerIndexEnabled(bool enabled)
+{
+    p->eagerIndexEnabled = enabled;
+}
+
+bool QuaZip::isEagerIndexEnabled() const
+{
+    return p->eagerIndexEnabled;
+}
+
+QString QuaZip::indexFileName(const QString &zipName)
+{
+    return zipName + QLatin1String(".qzidx");
+}
@@ -116,6 +116,18 @@ class QUAZIP_EXPORT QuaZip {
       csSensitive=1, ///< Case sensitive.
       csInsensitive=2 ///< Case insensitive.
     };
+    /// How the deflated files are compressed and decompressed.
+    /** \sa setDeflateBackend()
+     **/
+    enum DeflateBackend {
+      dbDefault=0, /**< dbOneShot if QuaZIP was built with libdeflate,
+                     dbStream otherwise. */
+      dbStream=1, ///< zlib streaming, a buffer at a time.
+      dbOneShot=2 /**< Whole files at once with libdeflate if they fit
+                    the budget, dbStream without libdeflate. */
+    };
+    /// The default budget of setDeflateBackend(), 16 MiB.
+    static const qint64 DefaultDeflateBudget;
     /// Returns the actual case sensitivity for the specified QuaZIP one.
     /**
       \param cs The value to convert.
@@ -343,6 +355,11 @@ class QUAZIP_EXPORT QuaZip {
      * file first if it is open! See
      * QuaZipFile::QuaZipFile(QuaZip*,QObject*) for the details.
      *
+     * The name is looked up in the name index, built on the first call
+     * (or on open(), see setEagerIndexEnabled()), which takes constant time
+     * whatever the number of entries. If there are several files with the
+     * same name, the first one is set.
+     *
      * Should be used only in QuaZip::mdUnzip mode.
      *
      * \sa setFileNameCodec(), CaseSensitivity
@@ -350,6 +367,24 @@ class QUAZIP_EXPORT QuaZip {
     bool setCurrentFile(const QString& fileName, CaseSensitivity cs =csDefault);
     /// Returns \c true if the current file has been set.
     bool hasCurrentFile() const;
+    /// Retrieves the position of the current file in the central directory.
+    /** Fills \a pos with a value that can later be passed to
+     * goToFilePos(), on this instance or on another QuaZip opened on
+     * the same archive. Returns \c true on success.
+     *
+     * Should be used only in QuaZip::mdUnzip mode.
+     **/
+    bool getCurrentFilePos(unz64_file_pos *pos) const;
+    /// Sets the current file by its position in the central directory.
+    /** This is much faster than setCurrentFile() when the position is
+     * already known, since no name lookup is involved. Returns \c true
+     * on success.
+     *
+     * Should be used only in QuaZip::mdUnzip mode.
+     *
+     * \sa getCurrentFilePos()
+     **/
+    bool goToFilePos(const unz64_file_pos &pos);
     /// Retrieves information about the current file.
     /** Fills the structure pointed by \a info. Returns \c true on
      * success, \c false otherwise. In the latter case structure pointed
@@ -448,6 +483,43 @@ class QUAZIP_EXPORT QuaZip {
       \sa setDataDescriptorWritingEnabled()
       */
     bool isDataDescriptorWritingEnabled() const;
+    /// Selects how the deflated files are compressed and decompressed.
+    /**
+      With dbOneShot, a deflated file of at most \a budget bytes
+      (uncompressed) is compressed or decompressed in a single call
+      instead of a buffer at a time. When writing, the data is kept in
+      memory until the file is closed; a file that outgrows the budget
+      is streamed after all. QuaZipNewInfo::uncompressedSize, if set,
+      lets larger files be streamed from the start. When reading, the
+      whole compressed data is read by the first QuaZipFile::read().
+
+      One-shot needs libdeflate (QUAZIP_LIBDEFLATE with CMake,
+      CONFIG+=quazip_libdeflate with qmake), and dbDefault selects it in
+      such builds. Without libdeflate, dbOneShot streams like dbStream.
+      Pointing QUAZIP_ZLIB_NG_ROOT at a zlib-ng built in zlib compatible
+      mode only links it instead of zlib; the streaming code is the same.
+
+      Either way, the output is standard deflate and the archive can be
+      read with any backend.
+
+      Setting the backend affects all the QuaZipFile instances that are
+      opened afterwards.
+
+      \param backend The backend.
+      \param budget The largest file handled in one shot, up to 1 GiB.
+      */
+    void setDeflateBackend(DeflateBackend backend,
+                           qint64 budget = DefaultDeflateBudget);
+    /// Returns the deflate backend.
+    /**
+      \sa setDeflateBackend()
+      */
+    DeflateBackend getDeflateBackend() const;
+    /// Returns the budget of the one-shot deflate backend.
+    /**
+      \sa setDeflateBackend()
+      */
+    qint64 getDeflateBudget() const;
     /// Returns a list of files inside the archive.
     /**
       \return A list of file names or an empty list if there
@@ -480,6 +552,51 @@ class QUAZIP_EXPORT QuaZip {
       \sa getFileInfoList()
       */
     QList<QuaZipFileInfo64> getFileInfoList64() const;
+    /// Copies an entry of another archive without recompressing it.
+    /**
+      Adds the entry \a name of \a source, which must be open in the
+      mdUnzip mode, to this archive, which must be open in the mdCreate,
+      mdAppend or mdAdd mode. The compressed data is moved as is, through
+      QuaZipFile opened in the raw mode on both sides, and the CRC, the
+      sizes, the compression method and level, the timestamp, the
+      attributes, the extra field and the comment are carried over. This
+      is much faster than extracting and compressing the entry again.
+
+      The zip64 extra field of the source entry is dropped, as it is
+      rewritten if needed. Entries larger than 4 GB are written in the zip64
+      mode even if isZip64Enabled() is \c false.
+
+      Encrypted entries can't be copied this way.
+
+      \param source The archive to copy from.
+      \param name The name of the entry to copy, looked up the same way
+      setCurrentFile() does, in which case the current file of \a source
+      is changed. If empty, the current file of \a source is copied, which
+      allows walking \a source with goToFirstFile() and goToNextFile().
+      \param newName The name of the copy, the same as the source entry if
+      empty.
+      \return \c true on success, \c false otherwise, in which case
+      getZipError() tells why.
+
+      \sa copyEntriesRaw()
+      */
+    bool copyEntryRaw(QuaZip &source, const QString &name,
+                      const QString &newName = QString());
+    /// Copies the entries of another archive without recompressing them.
+    /**
+      Copies the entries of \a source matching \a nameFilters, in their
+      order in \a source, like copyEntryRaw() does. The filters are
+      wildcards, matched against the whole entry names as QDir::match()
+      does: for example, \c "*.txt" matches \c "dir/file.txt". If there
+      are no filters, all the entries are copied.
+
+      Stops at the first entry that can't be copied.
+
+      \return The number of entries copied, or -1 on error, in which case
+      getZipError() tells why.
+      */
+    int copyEntriesRaw(QuaZip &source,
+                       const QStringList &nameFilters = QStringList());
     /// Enables the zip64 mode.
     /**
      * @param zip64 If \c true, the zip64 mode is enabled, disabled otherwise.
@@ -529,6 +646,92 @@ class QUAZIP_EXPORT QuaZip {
       @sa setIoDevice()
       */
     void setAutoClose(bool autoClose) const;
+    /// Enables the memory-mapped mode.
+    /**
+     * @param mapped If \c true, the archive is memory-mapped when it is
+     * opened in the mdUnzip mode.
+     *
+     * In this mode the whole archive file is mapped into memory on open(),
+     * and the central directory, the local headers and the entry data are
+     * read straight from the mapping instead of going through QIODevice
+     * calls. Deflated data is inflated in place, and the data of stored
+     * entries can be accessed without any copy through
+     * QuaZipFile::mappedData().
+     *
+     * Only takes effect on the next call to open(), with the mdUnzip mode
+     * and a NULL \a ioApi. If the device is not a file (QFileDevice) or
+     * can't be mapped, the archive is read as usual.
+     *
+     * \sa isMapped()
+     */
+    void setMapped(bool mapped);
+    /// Returns whether the memory-mapped mode is enabled.
+    /**
+     * \sa setMapped()
+     */
+    bool isMapped() const;
+    /// Enables the index file.
+    /**
+     * @param enabled If \c true, the decoded central directory is kept in
+     * an index file next to the archive, named by indexFileName().
+     *
+     * The first listing or lookup of an archive opened in the mdUnzip mode
+     * decodes its whole central directory. With the index file enabled, the
+     * decoded directory is saved to the index file, and the next time the
+     * archive is opened the index file is memory-mapped instead, which
+     * takes constant time however many entries the archive has.
+     *
+     * The index file records the size and the modification time of the
+     * archive and its end of central directory record. If any of them
+     * changed, the index file is stale: it is ignored, the central
+     * directory is decoded again and the index file is rewritten. If the
+     * index file can't be written, for example because the directory is
+     * read-only, the archive is read as usual.
+     *
+     * Only archives that are files, either set by name or as a QFile
+     * device, can have an index file. Index files are caches for the local
+     * machine and should not be distributed with the archives.
+     *
+     * \sa isIndexFileEnabled()
+     */
+    void setIndexFileEnabled(bool enabled);
+    /// Returns whether the index file is enabled.
+    /**
+     * \sa setIndexFileEnabled()
+     */
+    bool isIndexFileEnabled() const;
+    /// Enables building the name index on open.
+    /**
+     * @param enabled If \c true, open() decodes the whole central directory
+     * and builds the name index right away, instead of on the first
+     * lookup or listing.
+     *
+     * The name index is a compact open-addressing table of name hashes and
+     * central directory positions, which setCurrentFile() looks names up
+     * in, in constant time, whether case sensitive or not. Large central
+     * directories are decoded and hashed on several threads. Building it
+     * at open time moves that cost out of the first lookup.
+     *
+     * Combined with setIndexFileEnabled(), the name index is saved to and
+     * mapped from the index file as well.
+     *
+     * Only takes effect on the next call to open() with the mdUnzip mode.
+     *
+     * \sa isEagerIndexEnabled()
+     */
+    void setEagerIndexEnabled(bool enabled);
+    /// Returns whether the name index is built on open.
+    /**
+     * \sa setEagerIndexEnabled()
+     */
+    bool isEagerIndexEnabled() const;
+    /// Returns the name of the index file of the archive \a zipName.
+    /**
+     * This is \a zipName with the \c .qzidx suffix appended.
+     *
+     * \sa setIndexFileEnabled()
+     */
+    static QString indexFileName(const QString &zipName);
     /// Sets the default file name codec to use.
     /**
      * The default codec is used by the constructors, so calling this function
@@ -45,30 +45,46 @@ HEADERS += \
         $$PWD/ioapi.h \
         $$PWD/JlCompress.h \
         $$PWD/quaadler32.h \
+        $$PWD/quaadler32engine.h \
+        $$PWD/quablockdeflater.h \
         $$PWD/quachecksum32.h \
         $$PWD/quacrc32.h \
+        $$PWD/quacrc32engine.h \
         $$PWD/quagzipfile.h \
+        $$PWD/quamemberinflater.h \
         $$PWD/quaziodevice.h \
         $$PWD/quazipdir.h \
+        $$PWD/quazipeditor.h \
+        $$PWD/quazipentrytable.h \
         $$PWD/quazipfile.h \
         $$PWD/quazipfileinfo.h \
         $$PWD/quazip_global.h \
         $$PWD/quazip.h \
+        $$PWD/quazipmethodpolicy.h \
         $$PWD/quazipnewinfo.h \
+        $$PWD/quazipstreamreader.h \
         $$PWD/unzip.h \
         $$PWD/zip.h
 
 SOURCES += $$PWD/qioapi.cpp \
            $$PWD/JlCompress.cpp \
            $$PWD/quaadler32.cpp \
+           $$PWD/quaadler32engine.c \
+           $$PWD/quablockdeflater.cpp \
            $$PWD/quacrc32.cpp \
+           $$PWD/quacrc32engine.c \
            $$PWD/quagzipfile.cpp \
+           $$PWD/quamemberinflater.cpp \
            $$PWD/quaziodevice.cpp \
            $$PWD/quazip.cpp \
            $$PWD/quazipdir.cpp \
+           $$PWD/quazipeditor.cpp \
+           $$PWD/quazipentrytable.cpp \
            $$PWD/quazipfile.cpp \
            $$PWD/quazipfileinfo.cpp \
+           $$PWD/quazipmethodpolicy.cpp \
            $$PWD/quazipnewinfo.cpp \
+           $$PWD/quazipstreamreader.cpp \
            $$PWD/unzip.c \
            $$PWD/zip.c
 
@@ -78,9 +94,13 @@ INCLUDEPATH += $$absolute_path($$[QT_INSTALL_PREFIX]/../Src/qtbase/src/3rdparty/
 
 # JB 11052018: additions for progress report
 HEADERS += $$PWD/jlcompress_obj.hpp \
-           $$PWD/jlworker.hpp
+           $$PWD/jlcopypipeline.hpp \
+           $$PWD/jlworker.hpp \
+           $$PWD/jlworkerpool.hpp
 SOURCES += $$PWD/jlcompress_obj.cpp \
-           $$PWD/jlworker.cpp
+           $$PWD/jlcopypipeline.cpp \
+           $$PWD/jlworker.cpp \
+           $$PWD/jlworkerpool.cpp
 
 
 # add QT5 src zlib header to Quazip installation.
@@ -104,6 +124,21 @@ QZP_EXTRA_MODULES       =
 QZP_EXTRA_LIBS          =
 QZP_CPP_FLAGS           =
 
+# optional compression methods, e.g. qmake CONFIG+=quazip_lzma
+quazip_bzip2{
+    DEFINES += HAVE_BZIP2
+    QZP_EXTRA_LIBS += -lbz2
+}
+quazip_lzma{
+    DEFINES += HAVE_LZMA
+    QZP_EXTRA_LIBS += -llzma
+}
+# one-shot deflate of the files that fit in memory, see QuaZip::setDeflateBackend()
+quazip_libdeflate{
+    DEFINES += HAVE_LIBDEFLATE
+    QZP_EXTRA_LIBS += -ldeflate
+}
+
 
 LIBS += $$QZP_EXTRA_LIBS
 
@@ -162,15 +162,14 @@ QString QuaZipDir::dirName() const
     return QDir(d->dir).dirName();
 }
 
-QuaZipFileInfo64 QuaZipDir_getFileInfo(QuaZip *zip, bool *ok,
-                                  const QString &relativeName,
-                                  bool isReal)
+static QuaZipFileInfo64 QuaZipDir_getFileInfo(const QuaZipFileInfo64 &entry,
+                                              const QString &relativeName,
+                                              bool isReal)
 {
     QuaZipFileInfo64 info;
     if (isReal) {
-        *ok = zip->getCurrentFileInfo(&info);
+        info = entry;
     } else {
-        *ok = true;
         info.compressedSize = 0;
         info.crc = 0;
         info.diskNumberStart = 0;
@@ -215,24 +214,6 @@ static void QuaZipDir_convertInfoList(const QList<QuaZipFileInfo64> &from,
     }
 }
 
-/// \cond internal
-/**
-  An utility class to restore the current file.
-  */
-class QuaZipDirRestoreCurrent {
-public:
-    inline QuaZipDirRestoreCurrent(QuaZip *zip):
-        zip(zip), currentFile(zip->getCurrentFileName()) {}
-    inline ~QuaZipDirRestoreCurrent()
-    {
-        zip->setCurrentFile(currentFile);
-    }
-private:
-    QuaZip *zip;
-    QString currentFile;
-};
-/// \endcond
-
 /// \cond internal
 class QuaZipDirComparator
 {
@@ -328,8 +309,10 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
         basePath += "/";
     int baseLength = basePath.length();
     result.clear();
-    QuaZipDirRestoreCurrent saveCurrent(zip);
-    if (!zip->goToFirstFile()) {
+    // one pass over the archive's central directory, which QuaZip serves
+    // without moving through the entries when it can
+    QList<QuaZipFileInfo64> entries = zip->getFileInfoList64();
+    if (entries.isEmpty()) {
         return zip->getZipError() == UNZ_OK;
     }
     QDir::Filters fltr = filter;
@@ -342,8 +325,8 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
         nmfltr = this->nameFilters;
     QSet<QString> dirsFound;
     QList<QuaZipFileInfo64> list;
-    do {
-        QString name = zip->getCurrentFileName();
+    foreach (const QuaZipFileInfo64 &entry, entries) {
+        const QString &name = entry.name;
         if (!name.startsWith(basePath))
             continue;
         QString relativeName = name.mid(baseLength);
@@ -367,14 +350,8 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
             continue;
         if (!nmfltr.isEmpty() && !QDir::match(nmfltr, relativeName))
             continue;
-        bool ok;
-        QuaZipFileInfo64 info = QuaZipDir_getFileInfo(zip, &ok, relativeName,
-            isReal);
-        if (!ok) {
-            return false;
-        }
-        list.append(info);
-    } while (zip->goToNextFile());
+        list.append(QuaZipDir_getFileInfo(entry, relativeName, isReal));
+    }
     QDir::SortFlags srt = sort;
     if (srt == QDir::NoSort)
         srt = sorting;
@@ -0,0 +1,557 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipeditor.h"
+#include "quazip.h"
+#include "quazipentrytable.h"
+#include "quazipfile.h"
+
+#include <QFile>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include <algorithm>
+
+/// \cond internal
+
+/// Size of the chunks moved at once by the compaction.
+#define QUAZIP_EDITOR_CHUNK (1024 * 1024)
+/// Size of a local file header, without the name and the extra field.
+#define QUAZIP_EDITOR_HEADER_SIZE 30
+/// Local file header signature.
+#define QUAZIP_EDITOR_HEADER_MAGIC 0x04034b50u
+/// Optional data descriptor signature.
+#define QUAZIP_EDITOR_DESCRIPTOR_MAGIC 0x08074b50u
+
+static inline quint16 QuaZipEditor_le16(const char *p)
+{
+  const uchar *u = reinterpret_cast<const uchar*>(p);
+  return static_cast<quint16>(u[0] | (u[1] << 8));
+}
+
+static inline quint32 QuaZipEditor_le32(const char *p)
+{
+  return static_cast<quint32>(QuaZipEditor_le16(p))
+    | (static_cast<quint32>(QuaZipEditor_le16(p + 2)) << 16);
+}
+
+static inline void QuaZipEditor_put(char *p, quint64 value, int bytes)
+{
+  for (int i = 0; i < bytes; ++i) {
+    p[i] = static_cast<char>(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+/// Whether the extra field \a extra holds a zip64 block.
+static bool QuaZipEditor_hasZip64(const QByteArray &extra)
+{
+  int pos = 0;
+  while (pos + 4 <= extra.size()) {
+    if (QuaZipEditor_le16(extra.constData() + pos) == 0x0001)
+      return true;
+    pos += 4 + QuaZipEditor_le16(extra.constData() + pos + 2);
+  }
+  return false;
+}
+
+/// Sets the local header offset of the central directory \a record.
+/** The offset is either in the record itself or in its zip64 extra field,
+  after the sizes that don't fit in the record. Returns false if the record
+  is malformed or the offset doesn't fit. */
+static bool QuaZipEditor_setOffset(QByteArray &record, quint64 offset)
+{
+  char *r = record.data();
+  if (QuaZipEditor_le32(r + 42) != 0xFFFFFFFFu) {
+    if (offset >= 0xFFFFFFFFu)
+      return false;
+    QuaZipEditor_put(r + 42, offset, 4);
+    return true;
+  }
+  int pos = 46 + QuaZipEditor_le16(r + 28);
+  int end = pos + QuaZipEditor_le16(r + 30);
+  if (end > record.size())
+    return false;
+  int skip = 0;
+  if (QuaZipEditor_le32(r + 24) == 0xFFFFFFFFu)
+    skip += 8;
+  if (QuaZipEditor_le32(r + 20) == 0xFFFFFFFFu)
+    skip += 8;
+  while (pos + 4 <= end) {
+    int length = QuaZipEditor_le16(r + pos + 2);
+    if (pos + 4 + length > end)
+      return false;
+    if (QuaZipEditor_le16(r + pos) == 0x0001) {
+      if (skip + 8 > length)
+        return false;
+      QuaZipEditor_put(r + pos + 4 + skip, offset, 8);
+      return true;
+    }
+    pos += 4 + length;
+  }
+  return false;
+}
+
+/// Sorts entry indexes by local header offset.
+struct QuaZipEditorOffsetLess {
+  const QuaZipEntryTable *table;
+  bool operator()(int a, int b) const
+  {
+    return table->headerOffset(a) < table->headerOffset(b);
+  }
+};
+
+class QuaZipEditorPrivate {
+  friend class QuaZipEditor;
+  QuaZipEditorPrivate(const QString &zipName);
+  bool open(QuaZip &reader, QuaZipEntryTable &table);
+  bool measure(QFile &file, const QuaZipEntryTable &table,
+               QVector<quint64> *sizes);
+  bool move(QFile &file, quint64 from, quint64 to, quint64 size);
+  bool apply(bool compact);
+  QString zipName;
+  QTextCodec *fileNameCodec;
+  bool compaction;
+  int zipError;
+  QStringList removed;
+  QList<QPair<QString, QString> > renamed;
+  QList<QPair<QuaZipNewInfo, QIODevice*> > replaced;
+  /// The offset of the central directory, where the entries end.
+  quint64 directoryPos;
+  /// The number of bytes before the archive in the file (SFX stubs).
+  quint64 bias;
+};
+
+QuaZipEditorPrivate::QuaZipEditorPrivate(const QString &zipName):
+  zipName(zipName),
+  fileNameCodec(QuaZip().getFileNameCodec()),
+  compaction(true),
+  zipError(UNZ_OK),
+  directoryPos(0),
+  bias(0)
+{
+}
+
+bool QuaZipEditorPrivate::open(QuaZip &reader, QuaZipEntryTable &table)
+{
+  reader.setZipName(zipName);
+  reader.setFileNameCodec(fileNameCodec);
+  if (!reader.open(QuaZip::mdUnzip)) {
+    zipError = reader.getZipError();
+    return false;
+  }
+  ZPOS64_T size = 0, endPos = 0;
+  if (unzGetCentralDirInfo64(reader.getUnzFile(), &directoryPos, &size)
+          != UNZ_OK
+      || unzGetEndOfCentralDirPos64(reader.getUnzFile(), &endPos) != UNZ_OK
+      || endPos < directoryPos + size
+      || !table.load(reader.getUnzFile(), fileNameCodec)) {
+    zipError = UNZ_BADZIPFILE;
+    return false;
+  }
+  bias = endPos - (directoryPos + size);
+  return true;
+}
+
+bool QuaZipEditorPrivate::measure(QFile &file, const QuaZipEntryTable &table,
+                                  QVector<quint64> *sizes)
+{
+  int count = table.count();
+  sizes->resize(count);
+  for (int i = 0; i < count; ++i) {
+    char header[QUAZIP_EDITOR_HEADER_SIZE];
+    if (!file.seek(bias + table.headerOffset(i))
+        || file.read(header, sizeof(header)) != sizeof(header)
+        || QuaZipEditor_le32(header) != QUAZIP_EDITOR_HEADER_MAGIC) {
+      zipError = UNZ_BADZIPFILE;
+      return false;
+    }
+    quint16 flags = QuaZipEditor_le16(header + 6);
+    int nameLength = QuaZipEditor_le16(header + 26);
+    int extraLength = QuaZipEditor_le16(header + 28);
+    quint64 size = QUAZIP_EDITOR_HEADER_SIZE + nameLength + extraLength
+        + table.compressedSize(i);
+    if ((flags & 8) != 0) {
+      // the data descriptor: an optional signature, the CRC and the sizes,
+      // 64-bit ones if the local header has a zip64 extra field
+      QByteArray extra;
+      char descriptor[8];
+      if (!file.seek(bias + table.headerOffset(i)
+                     + QUAZIP_EDITOR_HEADER_SIZE + nameLength)
+          || (extra = file.read(extraLength)).size() != extraLength
+          || !file.seek(bias + table.headerOffset(i) + size)
+          || file.read(descriptor, sizeof(descriptor))
+              != sizeof(descriptor)) {
+        zipError = UNZ_BADZIPFILE;
+        return false;
+      }
+      // a CRC can look like a signature, but is then followed by itself
+      bool signature = QuaZipEditor_le32(descriptor)
+            == QUAZIP_EDITOR_DESCRIPTOR_MAGIC
+          && (table.crc(i) != QUAZIP_EDITOR_DESCRIPTOR_MAGIC
+              || QuaZipEditor_le32(descriptor + 4) == table.crc(i));
+      size += (signature ? 4 : 0) + 4
+          + (QuaZipEditor_hasZip64(extra) ? 16 : 8);
+    }
+    (*sizes)[i] = size;
+  }
+  // the entries must not overlap each other nor the central directory
+  QVector<int> order(count);
+  for (int i = 0; i < count; ++i)
+    order[i] = i;
+  QuaZipEditorOffsetLess less = {&table};
+  std::sort(order.begin(), order.end(), less);
+  for (int k = 0; k < count; ++k) {
+    quint64 end = table.headerOffset(order[k]) + sizes->at(order[k]);
+    quint64 next = k + 1 < count ? table.headerOffset(order[k + 1])
+                                 : directoryPos;
+    if (end > next) {
+      zipError = UNZ_BADZIPFILE;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool QuaZipEditorPrivate::move(QFile &file, quint64 from, quint64 to,
+                               quint64 size)
+{
+  // to < from, so copying forward never overwrites what is still to read
+  QByteArray buffer(static_cast<int>(qMin<quint64>(size,
+      QUAZIP_EDITOR_CHUNK)), Qt::Uninitialized);
+  quint64 done = 0;
+  while (done < size) {
+    qint64 length = static_cast<qint64>(qMin<quint64>(size - done,
+        buffer.size()));
+    if (!file.seek(from + done)
+        || file.read(buffer.data(), length) != length
+        || !file.seek(to + done)
+        || file.write(buffer.constData(), length) != length) {
+      zipError = UNZ_ERRNO;
+      return false;
+    }
+    done += length;
+  }
+  return true;
+}
+
+bool QuaZipEditorPrivate::apply(bool compact)
+{
+  zipError = UNZ_OK;
+  if (removed.isEmpty() && renamed.isEmpty() && replaced.isEmpty()
+      && !compact)
+    return true;
+  QuaZip reader;
+  QuaZipEntryTable table;
+  if (!open(reader, table))
+    return false;
+  int count = table.count();
+  const QVector<QString> &names = table.names();
+  // what becomes of each entry
+  QVector<bool> kept(count, true);
+  QList<int> renamedEntries;
+  QStringList newNames;
+  foreach (const QString &name, removed) {
+    bool found = false;
+    for (int i = 0; i < count; ++i) {
+      if (names.at(i) == name) {
+        kept[i] = false;
+        found = true;
+      }
+    }
+    if (!found) {
+      zipError = UNZ_END_OF_LIST_OF_FILE;
+      return false;
+    }
+  }
+  for (int r = 0; r < renamed.size(); ++r) {
+    bool found = false;
+    for (int i = 0; i < count; ++i) {
+      if (names.at(i) != renamed.at(r).first)
+        continue;
+      QuaZipFileInfo64 info;
+      table.fileInfo(i, &info, fileNameCodec);
+      if ((info.flags & 1) != 0) {
+        // can't be copied raw, see QuaZip::copyEntryRaw()
+        zipError = UNZ_PARAMERROR;
+        return false;
+      }
+      kept[i] = false;
+      renamedEntries << i;
+      newNames << renamed.at(r).second;
+      found = true;
+    }
+    if (!found) {
+      zipError = UNZ_END_OF_LIST_OF_FILE;
+      return false;
+    }
+  }
+  QSet<QString> replacedNames;
+  for (int r = 0; r < replaced.size(); ++r)
+    replacedNames.insert(replaced.at(r).first.name);
+  for (int i = 0; i < count; ++i) {
+    if (replacedNames.contains(names.at(i)))
+      kept[i] = false;
+  }
+  // a new name must not be taken, by a kept entry or by another renamed or
+  // replaced one
+  QSet<QString> taken = replacedNames;
+  for (int i = 0; i < count; ++i) {
+    if (kept.at(i))
+      taken.insert(names.at(i));
+  }
+  foreach (const QString &newName, newNames) {
+    if (taken.contains(newName)) {
+      zipError = ZIP_PARAMERROR;
+      return false;
+    }
+    taken.insert(newName);
+  }
+  QFile file(zipName);
+  if (!file.open(QIODevice::ReadWrite)) {
+    zipError = UNZ_ERRNO;
+    return false;
+  }
+  QVector<quint64> offsets(count);
+  for (int i = 0; i < count; ++i)
+    offsets[i] = table.headerOffset(i);
+  // where the entries written again go
+  quint64 end = directoryPos;
+  QTemporaryFile stagingFile;
+  QuaZip staging(&stagingFile);
+  // the new central directory, and the compaction, overwrite what the
+  // renamed entries are read from, keep them aside
+  if (!renamedEntries.isEmpty()) {
+    staging.setAutoClose(false);
+    staging.setFileNameCodec(fileNameCodec);
+    if (!stagingFile.open() || !staging.open(QuaZip::mdCreate)) {
+      zipError = UNZ_ERRNO;
+      return false;
+    }
+    for (int r = 0; r < renamedEntries.size(); ++r) {
+      if (!reader.goToFilePos(table.filePos(renamedEntries.at(r)))
+          || !staging.copyEntryRaw(reader, QString(), newNames.at(r))) {
+        zipError = staging.getZipError() != UNZ_OK
+            ? staging.getZipError() : reader.getZipError();
+        return false;
+      }
+    }
+    staging.close();
+    if (staging.getZipError() != ZIP_OK
+        || !staging.open(QuaZip::mdUnzip)) {
+      zipError = UNZ_ERRNO;
+      return false;
+    }
+  }
+  if (compact) {
+    QVector<quint64> sizes;
+    if (!measure(file, table, &sizes))
+      return false;
+    reader.close();
+    // the kept entries are moved down over the gaps, in file order
+    QVector<int> order;
+    for (int i = 0; i < count; ++i) {
+      if (kept.at(i))
+        order << i;
+    }
+    QuaZipEditorOffsetLess less = {&table};
+    std::sort(order.begin(), order.end(), less);
+    end = 0;
+    foreach (int i, order) {
+      if (offsets.at(i) != end
+          && !move(file, bias + offsets.at(i), bias + end, sizes.at(i)))
+        return false;
+      offsets[i] = end;
+      end += sizes.at(i);
+    }
+  }
+  QuaZip writer(&file);
+  writer.setAutoClose(false);
+  writer.setFileNameCodec(fileNameCodec);
+  if (!writer.open(QuaZip::mdAdd)) {
+    zipError = writer.getZipError() != UNZ_OK ? writer.getZipError()
+                                              : UNZ_ERRNO;
+    return false;
+  }
+  int err = zipResetCentralDir(writer.getZipFile(), end);
+  for (int i = 0; i < count && err == ZIP_OK; ++i) {
+    if (!kept.at(i))
+      continue;
+    QByteArray record = table.record(i);
+    if (record.isEmpty() || (offsets.at(i) != table.headerOffset(i)
+                             && !QuaZipEditor_setOffset(record, offsets.at(i))))
+      err = UNZ_BADZIPFILE;
+    else
+      err = zipAddCentralDirRecord(writer.getZipFile(), record.constData(),
+                                   record.size());
+  }
+  if (err != ZIP_OK) {
+    zipError = err;
+    return false;
+  }
+  if (!renamedEntries.isEmpty()
+      && staging.getEntriesCount() != writer.copyEntriesRaw(staging)) {
+    zipError = writer.getZipError();
+    return false;
+  }
+  QuaZipFile outFile(&writer);
+  QByteArray buffer(64 * 1024, Qt::Uninitialized);
+  for (int r = 0; r < replaced.size(); ++r) {
+    QIODevice *data = replaced.at(r).second;
+    if ((!data->isOpen() && !data->open(QIODevice::ReadOnly))
+        || !outFile.open(QIODevice::WriteOnly, replaced.at(r).first)) {
+      zipError = outFile.getZipError() != UNZ_OK ? outFile.getZipError()
+                                                 : UNZ_ERRNO;
+      return false;
+    }
+    bool ok = true;
+    while (ok && !data->atEnd()) {
+      qint64 length = data->read(buffer.data(), buffer.size());
+      ok = length > 0 && outFile.write(buffer.constData(), length) == length;
+    }
+    outFile.close();
+    if (!ok || outFile.getZipError() != ZIP_OK) {
+      zipError = outFile.getZipError() != ZIP_OK ? outFile.getZipError()
+                                                 : UNZ_ERRNO;
+      return false;
+    }
+  }
+  writer.close();
+  if (writer.getZipError() != ZIP_OK) {
+    zipError = writer.getZipError();
+    return false;
+  }
+  // drop whatever the old archive left after the new end
+  if (!file.resize(file.pos())) {
+    zipError = UNZ_ERRNO;
+    return false;
+  }
+  return true;
+}
+
+/// \endcond
+
+QuaZipEditor::QuaZipEditor(const QString &zipName):
+  d(new QuaZipEditorPrivate(zipName))
+{
+}
+
+QuaZipEditor::~QuaZipEditor()
+{
+  delete d;
+}
+
+void QuaZipEditor::setFileNameCodec(QTextCodec *fileNameCodec)
+{
+  d->fileNameCodec = fileNameCodec;
+}
+
+QTextCodec *QuaZipEditor::getFileNameCodec() const
+{
+  return d->fileNameCodec;
+}
+
+void QuaZipEditor::setCompactionEnabled(bool enabled)
+{
+  d->compaction = enabled;
+}
+
+bool QuaZipEditor::isCompactionEnabled() const
+{
+  return d->compaction;
+}
+
+void QuaZipEditor::removeEntry(const QString &name)
+{
+  d->removed << name;
+}
+
+void QuaZipEditor::renameEntry(const QString &name, const QString &newName)
+{
+  d->renamed << qMakePair(name, newName);
+}
+
+void QuaZipEditor::replaceEntry(const QuaZipNewInfo &info, QIODevice *data)
+{
+  d->replaced << qMakePair(info, data);
+}
+
+bool QuaZipEditor::hasPendingEdits() const
+{
+  return !d->removed.isEmpty() || !d->renamed.isEmpty()
+      || !d->replaced.isEmpty();
+}
+
+void QuaZipEditor::clear()
+{
+  d->removed.clear();
+  d->renamed.clear();
+  d->replaced.clear();
+}
+
+bool QuaZipEditor::commit()
+{
+  if (!d->apply(d->compaction))
+    return false;
+  clear();
+  return true;
+}
+
+bool QuaZipEditor::compact()
+{
+  if (!d->apply(true))
+    return false;
+  clear();
+  return true;
+}
+
+qint64 QuaZipEditor::deadSpace()
+{
+  d->zipError = UNZ_OK;
+  QuaZip reader;
+  QuaZipEntryTable table;
+  if (!d->open(reader, table))
+    return -1;
+  QFile file(d->zipName);
+  QVector<quint64> sizes;
+  if (!file.open(QIODevice::ReadOnly)) {
+    d->zipError = UNZ_ERRNO;
+    return -1;
+  }
+  if (!d->measure(file, table, &sizes))
+    return -1;
+  quint64 used = 0;
+  for (int i = 0; i < sizes.size(); ++i)
+    used += sizes.at(i);
+  return static_cast<qint64>(d->directoryPos - used);
+}
+
+int QuaZipEditor::getZipError() const
+{
+  return d->zipError;
+}
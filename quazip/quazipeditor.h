@@ -0,0 +1,155 @@
+#ifndef QUAZIP_QUAZIPEDITOR_H
+#define QUAZIP_QUAZIPEDITOR_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QString>
+
+#include "quazip_global.h"
+#include "quazipnewinfo.h"
+
+class QIODevice;
+class QTextCodec;
+class QuaZipEditorPrivate;
+
+/// Edits the entries of an existing ZIP archive in place.
+/**
+  QuaZip can add entries to an archive (QuaZip::mdAdd), but not remove or
+  replace them. This class removes, renames and replaces entries while
+  rewriting only what has to be: the pending edits are applied at once by
+  commit(), and a new central directory is written through zip.c.
+
+  \code
+  QuaZipEditor editor("archive.zip");
+  editor.removeEntry("obsolete.txt");
+  editor.renameEntry("old/name.txt", "new/name.txt");
+  QBuffer config(&configData);
+  editor.replaceEntry(QuaZipNewInfo("config.ini"), &config);
+  if (!editor.commit()) {
+      // error, see editor.getZipError()
+  }
+  \endcode
+
+  Renamed and replaced entries are written again after the last kept
+  entry: renamed ones are copied without being recompressed (see
+  QuaZip::copyEntryRaw()), replaced ones are compressed from the data
+  given to replaceEntry().
+
+  What happens to the space of the removed entries depends on the
+  compaction mode (see setCompactionEnabled()):
+    - With compaction (the default), the kept entries that follow the
+      first removed one are moved down over the gaps, so the archive ends
+      up as small as if it had been created from scratch. Only the tail
+      following the first edited entry is rewritten.
+    - Without compaction, the removed entries are merely dropped from the
+      central directory and left as dead space, so an edit costs as much
+      as the central directory and the entries written again, whatever
+      the size of the archive. The dead space can be reclaimed later by
+      compact(), and measured by deadSpace().
+
+  The archive is modified in place: an error or a crash in the middle of
+  commit() may leave it unusable, so keep a copy of anything precious.
+  Encrypted entries can be removed and kept, but not renamed.
+  */
+class QUAZIP_EXPORT QuaZipEditor {
+public:
+  /// Constructs an editor of the archive file \a zipName.
+  explicit QuaZipEditor(const QString &zipName);
+  /// Destructor. The pending edits are dropped.
+  ~QuaZipEditor();
+  /// Sets the codec used to decode and encode the file names.
+  /**
+    The default is the one used by QuaZip, see
+    QuaZip::setDefaultFileNameCodec().
+    */
+  void setFileNameCodec(QTextCodec *fileNameCodec);
+  /// Returns the codec used to decode and encode the file names.
+  QTextCodec *getFileNameCodec() const;
+  /// Enables or disables the compaction of the archive on commit().
+  /**
+    Enabled by default. See the class description.
+    */
+  void setCompactionEnabled(bool enabled);
+  /// Returns whether commit() compacts the archive.
+  bool isCompactionEnabled() const;
+  /// Schedules the removal of the entries named \a name.
+  /**
+    Names are case sensitive and refer to the archive as it is before
+    commit(), which fails if there is no such entry.
+    */
+  void removeEntry(const QString &name);
+  /// Schedules renaming the entries named \a name to \a newName.
+  /**
+    Names are case sensitive and refer to the archive as it is before
+    commit(), which fails if there is no such entry. It fails with
+    ZIP_PARAMERROR as well if \a newName is already taken, by an entry
+    left in place or by another renamed or replaced one. The renamed
+    entries are moved after the kept ones.
+    */
+  void renameEntry(const QString &name, const QString &newName);
+  /// Schedules replacing the entries named \a info.name with \a data.
+  /**
+    If there is no such entry, the entry is added. The new entry is
+    deflated from the whole contents of \a data, which is opened for
+    reading if needed. The device must stay valid until commit() is
+    called.
+    */
+  void replaceEntry(const QuaZipNewInfo &info, QIODevice *data);
+  /// Returns whether there are edits waiting for commit().
+  bool hasPendingEdits() const;
+  /// Drops the pending edits.
+  void clear();
+  /// Applies the pending edits.
+  /**
+    Returns \c true on success, in which case the pending edits are
+    dropped. On failure, getZipError() tells why.
+    */
+  bool commit();
+  /// Applies the pending edits, if any, and removes all the dead space.
+  /**
+    This is what commit() does with compaction enabled.
+    */
+  bool compact();
+  /// Returns the number of bytes not used by any entry.
+  /**
+    This is the space that compact() would reclaim. Returns -1 on error.
+    */
+  qint64 deadSpace();
+  /// Returns the error code of the last operation.
+  /**
+    \c UNZ_OK if there was no error, \c UNZ_END_OF_LIST_OF_FILE if an
+    entry to remove or rename doesn't exist, \c UNZ_BADZIPFILE if the
+    archive layout can't be understood, \c UNZ_PARAMERROR if an encrypted
+    entry is renamed, or an error of QuaZip or QuaZipFile.
+    */
+  int getZipError() const;
+private:
+  // not implemented by design to disable copy
+  QuaZipEditor(const QuaZipEditor &that);
+  QuaZipEditor &operator=(const QuaZipEditor &that);
+  QuaZipEditorPrivate *d;
+};
+
+#endif // QUAZIP_QUAZIPEDITOR_H
@@ -0,0 +1,566 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipentrytable.h"
+#include "quazipfileinfo.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QRunnable>
+#include <QTextCodec>
+#include <QThread>
+#include <QThreadPool>
+
+#include <string.h>
+
+/// \cond internal
+
+/// Size of the fixed part of a central directory record.
+#define QUAZIP_CD_RECORD_SIZE 46
+/// Entries below which decoding is not worth spreading over threads.
+#define QUAZIP_CD_ENTRIES_PER_THREAD 8192
+/// Bytes of the end of central directory record stored in an index.
+#define QUAZIP_INDEX_EOCD_SIZE 64
+/// Version of the index file format.
+#define QUAZIP_INDEX_VERSION 2
+
+/// The header of an index file, followed by the column block.
+/** Index files are caches for the local machine, written in its byte
+  order. */
+struct QuaZipIndexHeader {
+  char magic[8];
+  quint32 version;
+  quint32 byteOrder;
+  qint64 archiveSize;
+  qint64 archiveMTime;
+  quint64 directoryPos;
+  quint64 directorySize;
+  quint32 entries;
+  qint32 codecMib;
+  uchar eocd[QUAZIP_INDEX_EOCD_SIZE];
+};
+
+static const char QuaZipIndex_magic[8] = {'Q', 'Z', 'I', 'D', 'X', '\r', '\n', '\x1a'};
+
+static inline quint16 QuaZipEntryTable_le16(const uchar *p)
+{
+  return static_cast<quint16>(p[0] | (p[1] << 8));
+}
+
+static inline quint32 QuaZipEntryTable_le32(const uchar *p)
+{
+  return static_cast<quint32>(QuaZipEntryTable_le16(p))
+    | (static_cast<quint32>(QuaZipEntryTable_le16(p + 2)) << 16);
+}
+
+static inline quint64 QuaZipEntryTable_le64(const uchar *p)
+{
+  return static_cast<quint64>(QuaZipEntryTable_le32(p))
+    | (static_cast<quint64>(QuaZipEntryTable_le32(p + 4)) << 32);
+}
+
+/// Fills the key fields of \a header for the archive \a zipName.
+static bool QuaZipIndex_getKey(const QString &zipName, unzFile unzFile,
+                               QuaZipIndexHeader *header)
+{
+  QFileInfo info(zipName);
+  ZPOS64_T eocdPos;
+  if (!info.isFile()
+      || unzGetEndOfCentralDirPos64(unzFile, &eocdPos) != UNZ_OK)
+    return false;
+  header->archiveSize = info.size();
+  header->archiveMTime = info.lastModified().toMSecsSinceEpoch();
+  memset(header->eocd, 0, QUAZIP_INDEX_EOCD_SIZE);
+  // a separate handle, so that the archive device position is untouched
+  QFile archive(zipName);
+  if (!archive.open(QIODevice::ReadOnly)
+      || !archive.seek(static_cast<qint64>(eocdPos)))
+    return false;
+  return archive.read(reinterpret_cast<char*>(header->eocd),
+                      QUAZIP_INDEX_EOCD_SIZE) > 0;
+}
+
+/// Decodes a range of records on a pool thread.
+class QuaZipEntryDecoder: public QRunnable {
+public:
+  QuaZipEntryDecoder(const QuaZipEntryTable *table,
+      QuaZipEntryTable::Task task, int begin, int end):
+    table(table), task(task), begin(begin), end(end) {}
+  virtual void run()
+  {
+    table->decode(task, begin, end);
+  }
+private:
+  const QuaZipEntryTable *table;
+  QuaZipEntryTable::Task task;
+  int begin;
+  int end;
+};
+
+QuaZipEntryTable::QuaZipEntryTable():
+  loaded(false),
+  entries(0),
+  slots(0),
+  codec(NULL),
+  directoryPos(0),
+  directorySize(0),
+  indexFile(NULL)
+{
+  setColumns(NULL, 0, 0);
+}
+
+QuaZipEntryTable::~QuaZipEntryTable()
+{
+  delete indexFile;
+}
+
+void QuaZipEntryTable::clear()
+{
+  storage.clear();
+  delete indexFile;
+  indexFile = NULL;
+  nameCache.clear();
+  setColumns(NULL, 0, 0);
+  entries = 0;
+  slots = 0;
+  codec = NULL;
+  directoryPos = 0;
+  directorySize = 0;
+  loaded = false;
+}
+
+int QuaZipEntryTable::slotCount(int entries)
+{
+  // a power of two, at most half full
+  int count = 1;
+  while (count < 2 * static_cast<qint64>(entries) && count < 0x40000000)
+    count *= 2;
+  return count;
+}
+
+qint64 QuaZipEntryTable::storageSize(int entries, qint64 directorySize)
+{
+  return static_cast<qint64>(entries)
+    * (3 * sizeof(quint64) + 5 * sizeof(quint32) + 9 * sizeof(quint16))
+    + static_cast<qint64>(slotCount(entries)) * sizeof(quint32)
+    + directorySize;
+}
+
+void QuaZipEntryTable::setColumns(uchar *base, int entries,
+                                  qint64 directorySize)
+{
+  if (base == NULL) {
+    headerOffsets = compressedSizes = uncompressedSizes = NULL;
+    recordOffsets = crcs = dosDates = externalAttrs = NULL;
+    nameHashes = nameSlots = NULL;
+    methods = flags = versionsCreated = versionsNeeded = internalAttrs
+      = diskNumbers = nameLengths = extraLengths = commentLengths = NULL;
+    directory = NULL;
+    return;
+  }
+  quint64 *wide = reinterpret_cast<quint64*>(base);
+  headerOffsets = wide;
+  compressedSizes = headerOffsets + entries;
+  uncompressedSizes = compressedSizes + entries;
+  quint32 *medium = reinterpret_cast<quint32*>(uncompressedSizes + entries);
+  recordOffsets = medium;
+  crcs = recordOffsets + entries;
+  dosDates = crcs + entries;
+  externalAttrs = dosDates + entries;
+  nameHashes = externalAttrs + entries;
+  nameSlots = nameHashes + entries;
+  quint16 *narrow = reinterpret_cast<quint16*>(nameSlots + slotCount(entries));
+  methods = narrow;
+  flags = methods + entries;
+  versionsCreated = flags + entries;
+  versionsNeeded = versionsCreated + entries;
+  internalAttrs = versionsNeeded + entries;
+  diskNumbers = internalAttrs + entries;
+  nameLengths = diskNumbers + entries;
+  extraLengths = nameLengths + entries;
+  commentLengths = extraLengths + entries;
+  directory = reinterpret_cast<uchar*>(commentLengths + entries);
+  Q_ASSERT(directory + directorySize
+           == base + storageSize(entries, directorySize));
+  Q_UNUSED(directorySize);
+}
+
+bool QuaZipEntryTable::load(unzFile unzFile, QTextCodec *fileNameCodec)
+{
+  clear();
+  unz_global_info64 globalInfo;
+  ZPOS64_T size;
+  if (unzGetGlobalInfo64(unzFile, &globalInfo) != UNZ_OK
+      || unzGetCentralDirInfo64(unzFile, &directoryPos, &size) != UNZ_OK)
+    return false;
+  if (size > static_cast<ZPOS64_T>(0x7fffffff)
+      || globalInfo.number_entry > size / QUAZIP_CD_RECORD_SIZE)
+    return false;
+  const int count = static_cast<int>(globalInfo.number_entry);
+  qint64 total = storageSize(count, static_cast<qint64>(size));
+  if (total > 0x7fffffff)
+    return false;
+  // zeroed, for the empty name slots
+  storage.fill('\0', static_cast<int>(total));
+  setColumns(reinterpret_cast<uchar*>(storage.data()), count,
+             static_cast<qint64>(size));
+  if (unzReadCentralDir64(unzFile, directory, size) != UNZ_OK) {
+    clear();
+    return false;
+  }
+  // Split the directory into records. Record boundaries follow from the
+  // variable lengths, the signatures only validate them.
+  ZPOS64_T offset = 0;
+  for (int i = 0; i < count; ++i) {
+    if (offset + QUAZIP_CD_RECORD_SIZE > size
+        || QuaZipEntryTable_le32(directory + offset) != 0x02014b50) {
+      clear();
+      return false;
+    }
+    recordOffsets[i] = static_cast<quint32>(offset);
+    offset += QUAZIP_CD_RECORD_SIZE
+      + QuaZipEntryTable_le16(directory + offset + 28)
+      + QuaZipEntryTable_le16(directory + offset + 30)
+      + QuaZipEntryTable_le16(directory + offset + 32);
+  }
+  if (offset > size) {
+    clear();
+    return false;
+  }
+  entries = count;
+  codec = fileNameCodec;
+  directorySize = static_cast<qint64>(size);
+  slots = slotCount(count);
+  nameCache.resize(count);
+  run(DecodeRecords);
+  fillSlots();
+  loaded = true;
+  return true;
+}
+
+bool QuaZipEntryTable::loadIndex(const QString &indexName,
+    const QString &zipName, unzFile unzFile, QTextCodec *fileNameCodec)
+{
+  clear();
+  QuaZipIndexHeader key;
+  unz_global_info64 globalInfo;
+  ZPOS64_T pos, size;
+  if (!QuaZipIndex_getKey(zipName, unzFile, &key)
+      || unzGetGlobalInfo64(unzFile, &globalInfo) != UNZ_OK
+      || unzGetCentralDirInfo64(unzFile, &pos, &size) != UNZ_OK)
+    return false;
+  QFile *file = new QFile(indexName);
+  if (!file->open(QIODevice::ReadOnly)
+      || file->size() < static_cast<qint64>(sizeof(QuaZipIndexHeader))) {
+    delete file;
+    return false;
+  }
+  uchar *map = file->map(0, file->size());
+  if (map == NULL) {
+    delete file;
+    return false;
+  }
+  const QuaZipIndexHeader *header =
+    reinterpret_cast<const QuaZipIndexHeader*>(map);
+  if (memcmp(header->magic, QuaZipIndex_magic, sizeof(header->magic)) != 0
+      || header->version != QUAZIP_INDEX_VERSION
+      || header->byteOrder != 0x01020304u
+      || header->entries > 0x7fffffffu
+      || header->archiveSize != key.archiveSize
+      || header->archiveMTime != key.archiveMTime
+      || memcmp(header->eocd, key.eocd, QUAZIP_INDEX_EOCD_SIZE) != 0
+      || header->entries != globalInfo.number_entry
+      || header->directoryPos != pos
+      || header->directorySize != size
+      || header->codecMib != fileNameCodec->mibEnum()
+      || file->size() != static_cast<qint64>(sizeof(QuaZipIndexHeader))
+           + storageSize(static_cast<int>(header->entries),
+                         static_cast<qint64>(size))) {
+    delete file;
+    return false;
+  }
+  indexFile = file;
+  entries = static_cast<int>(header->entries);
+  slots = slotCount(entries);
+  codec = fileNameCodec;
+  directoryPos = pos;
+  directorySize = static_cast<qint64>(size);
+  setColumns(map + sizeof(QuaZipIndexHeader), entries, directorySize);
+  loaded = true;
+  return true;
+}
+
+bool QuaZipEntryTable::saveIndex(const QString &indexName,
+    const QString &zipName, unzFile unzFile) const
+{
+  if (!loaded || indexFile != NULL)
+    return false;
+  QuaZipIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  if (!QuaZipIndex_getKey(zipName, unzFile, &header))
+    return false;
+  memcpy(header.magic, QuaZipIndex_magic, sizeof(header.magic));
+  header.version = QUAZIP_INDEX_VERSION;
+  header.byteOrder = 0x01020304u;
+  header.directoryPos = directoryPos;
+  header.directorySize = static_cast<quint64>(directorySize);
+  header.entries = static_cast<quint32>(entries);
+  header.codecMib = codec->mibEnum();
+  QSaveFile file(indexName);
+  if (!file.open(QIODevice::WriteOnly))
+    return false;
+  if (file.write(reinterpret_cast<const char*>(&header), sizeof(header))
+        != static_cast<qint64>(sizeof(header))
+      || file.write(storage) != storage.size()) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
+
+void QuaZipEntryTable::run(Task task) const
+{
+  // Each thread fills its own slice of the columns.
+  int threads = qMin(qMax(1, QThread::idealThreadCount()),
+      entries / QUAZIP_CD_ENTRIES_PER_THREAD);
+  if (threads <= 1) {
+    decode(task, 0, entries);
+    return;
+  }
+  // A pool of our own: waiting on the global one could deadlock a caller
+  // that runs on it, with every pool thread waiting for decoders.
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads - 1);
+  int chunk = (entries + threads - 1) / threads;
+  for (int t = 1; t < threads; ++t) {
+    pool.start(new QuaZipEntryDecoder(this, task,
+        t * chunk, qMin(entries, (t + 1) * chunk)));
+  }
+  decode(task, 0, chunk);
+  pool.waitForDone();
+}
+
+void QuaZipEntryTable::decode(Task task, int begin, int end) const
+{
+  for (int i = begin; i < end; ++i) {
+    const uchar *record = directory + recordOffsets[i];
+    if (task == DecodeNames) {
+      // skips the names past the end of a corrupt index
+      if (static_cast<quint64>(recordOffsets[i]) + QUAZIP_CD_RECORD_SIZE
+            + nameLengths[i] <= static_cast<quint64>(directorySize))
+        nameCache[i] = codec->toUnicode(
+            reinterpret_cast<const char*>(record + QUAZIP_CD_RECORD_SIZE),
+            nameLengths[i]);
+      continue;
+    }
+    versionsCreated[i] = QuaZipEntryTable_le16(record + 4);
+    versionsNeeded[i] = QuaZipEntryTable_le16(record + 6);
+    flags[i] = QuaZipEntryTable_le16(record + 8);
+    methods[i] = QuaZipEntryTable_le16(record + 10);
+    dosDates[i] = QuaZipEntryTable_le32(record + 12);
+    crcs[i] = QuaZipEntryTable_le32(record + 16);
+    quint64 compressedSize = QuaZipEntryTable_le32(record + 20);
+    quint64 uncompressedSize = QuaZipEntryTable_le32(record + 24);
+    quint16 nameLength = QuaZipEntryTable_le16(record + 28);
+    quint16 extraLength = QuaZipEntryTable_le16(record + 30);
+    nameLengths[i] = nameLength;
+    extraLengths[i] = extraLength;
+    commentLengths[i] = QuaZipEntryTable_le16(record + 32);
+    diskNumbers[i] = QuaZipEntryTable_le16(record + 34);
+    internalAttrs[i] = QuaZipEntryTable_le16(record + 36);
+    externalAttrs[i] = QuaZipEntryTable_le32(record + 38);
+    quint64 headerOffset = QuaZipEntryTable_le32(record + 42);
+    // the ZIP64 extra field, same rules as unzip.c
+    const uchar *extra = record + QUAZIP_CD_RECORD_SIZE + nameLength;
+    int acc = 0;
+    while (acc + 4 <= extraLength) {
+      quint16 headerId = QuaZipEntryTable_le16(extra + acc);
+      int dataSize = qMin<int>(QuaZipEntryTable_le16(extra + acc + 2),
+          extraLength - acc - 4);
+      if (headerId == 0x0001) {
+        const uchar *field = extra + acc + 4;
+        int pos = 0;
+        if (uncompressedSize == 0xFFFFFFFFu && pos + 8 <= dataSize) {
+          uncompressedSize = QuaZipEntryTable_le64(field + pos);
+          pos += 8;
+        }
+        if (compressedSize == 0xFFFFFFFFu && pos + 8 <= dataSize) {
+          compressedSize = QuaZipEntryTable_le64(field + pos);
+          pos += 8;
+        }
+        if (headerOffset == 0xFFFFFFFFu && pos + 8 <= dataSize) {
+          headerOffset = QuaZipEntryTable_le64(field + pos);
+          pos += 8;
+        }
+      }
+      acc += 4 + dataSize;
+    }
+    compressedSizes[i] = compressedSize;
+    uncompressedSizes[i] = uncompressedSize;
+    headerOffsets[i] = headerOffset;
+    nameCache[i] = codec->toUnicode(
+        reinterpret_cast<const char*>(record + QUAZIP_CD_RECORD_SIZE),
+        nameLength);
+    nameHashes[i] = hashName(nameCache.at(i));
+  }
+}
+
+void QuaZipEntryTable::fillSlots()
+{
+  // Entries are inserted in order, so that probing meets the entries of
+  // equal names in order too, and lookups find the first one.
+  const quint32 mask = static_cast<quint32>(slots - 1);
+  for (int i = 0; i < entries; ++i) {
+    quint32 slot = nameHashes[i] & mask;
+    while (nameSlots[slot] != 0)
+      slot = (slot + 1) & mask;
+    nameSlots[slot] = static_cast<quint32>(i) + 1;
+  }
+}
+
+quint32 QuaZipEntryTable::hashName(const QString &name)
+{
+  // FNV-1a over the case-folded code points
+  quint32 hash = 2166136261u;
+  const ushort *chars = name.utf16();
+  const int length = name.length();
+  for (int i = 0; i < length; ++i) {
+    uint c = chars[i];
+    if (QChar::isHighSurrogate(c) && i + 1 < length
+        && QChar::isLowSurrogate(chars[i + 1]))
+      c = QChar::surrogateToUcs4(static_cast<ushort>(c), chars[++i]);
+    hash = (hash ^ QChar::toCaseFolded(c)) * 16777619u;
+  }
+  return hash;
+}
+
+QByteArray QuaZipEntryTable::span(quint64 offset, int length) const
+{
+  // an index file is trusted only as far as its own bounds go
+  if (offset + length > static_cast<quint64>(directorySize))
+    return QByteArray();
+  return QByteArray(reinterpret_cast<const char*>(directory + offset),
+                    length);
+}
+
+unz64_file_pos QuaZipEntryTable::filePos(int i) const
+{
+  unz64_file_pos pos;
+  pos.pos_in_zip_directory = directoryPos + recordOffsets[i];
+  pos.num_of_file = i;
+  return pos;
+}
+
+QString QuaZipEntryTable::name(int i) const
+{
+  if (!nameCache.isEmpty())
+    return nameCache.at(i);
+  return codec->toUnicode(rawName(i));
+}
+
+const QVector<QString> &QuaZipEntryTable::names() const
+{
+  if (nameCache.size() != entries) {
+    nameCache.resize(entries);
+    run(DecodeNames);
+  }
+  return nameCache;
+}
+
+QByteArray QuaZipEntryTable::rawName(int i) const
+{
+  return span(static_cast<quint64>(recordOffsets[i]) + QUAZIP_CD_RECORD_SIZE,
+      nameLengths[i]);
+}
+
+QByteArray QuaZipEntryTable::extra(int i) const
+{
+  return span(static_cast<quint64>(recordOffsets[i]) + QUAZIP_CD_RECORD_SIZE
+      + nameLengths[i], extraLengths[i]);
+}
+
+QByteArray QuaZipEntryTable::rawComment(int i) const
+{
+  return span(static_cast<quint64>(recordOffsets[i]) + QUAZIP_CD_RECORD_SIZE
+      + nameLengths[i] + extraLengths[i], commentLengths[i]);
+}
+
+QByteArray QuaZipEntryTable::record(int i) const
+{
+  return span(recordOffsets[i], QUAZIP_CD_RECORD_SIZE + nameLengths[i]
+      + extraLengths[i] + commentLengths[i]);
+}
+
+void QuaZipEntryTable::fileInfo(int i, QuaZipFileInfo64 *info,
+    QTextCodec *commentCodec) const
+{
+  info->versionCreated = versionsCreated[i];
+  info->versionNeeded = versionsNeeded[i];
+  info->flags = flags[i];
+  info->method = methods[i];
+  info->crc = crcs[i];
+  info->compressedSize = compressedSizes[i];
+  info->uncompressedSize = uncompressedSizes[i];
+  info->diskNumberStart = diskNumbers[i];
+  info->internalAttr = internalAttrs[i];
+  info->externalAttr = externalAttrs[i];
+  info->name = name(i);
+  info->comment = commentCodec->toUnicode(rawComment(i));
+  info->extra = extra(i);
+  // same conversion as unzip.c and QuaZip::getCurrentFileInfo()
+  quint32 dosDate = dosDates[i];
+  quint32 date = dosDate >> 16;
+  info->dateTime = QDateTime(
+      QDate(((date & 0x0FE00) >> 9) + 1980, (date & 0x1E0) >> 5, date & 0x1f),
+      QTime((dosDate & 0xF800) >> 11, (dosDate & 0x7E0) >> 5,
+        2 * (dosDate & 0x1f)));
+}
+
+int QuaZipEntryTable::indexOf(const QString &name,
+    Qt::CaseSensitivity cs) const
+{
+  if (entries == 0)
+    return -1;
+  const quint32 hash = hashName(name);
+  const quint32 mask = static_cast<quint32>(slots - 1);
+  quint32 slot = hash & mask;
+  // bounded, in case a corrupt index has no empty slot
+  for (int probes = 0; probes < slots && nameSlots[slot] != 0; ++probes) {
+    quint32 i = nameSlots[slot] - 1;
+    if (i < static_cast<quint32>(entries) && nameHashes[i] == hash) {
+      if (nameCache.isEmpty()) {
+        if (name.compare(this->name(static_cast<int>(i)), cs) == 0)
+          return static_cast<int>(i);
+      } else if (name.compare(nameCache.at(static_cast<int>(i)), cs) == 0) {
+        return static_cast<int>(i);
+      }
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
+
+/// \endcond
@@ -0,0 +1,175 @@
+#ifndef QUAZIP_QUAZIPENTRYTABLE_H
+#define QUAZIP_QUAZIPENTRYTABLE_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "unzip.h"
+
+class QFile;
+class QTextCodec;
+struct QuaZipFileInfo64;
+
+/// \cond internal
+/// The whole central directory of an archive, decoded at once.
+/**
+  The central directory is read with a single read, split into records by
+  walking the central file headers (0x02014b50 signatures), and the
+  records are decoded on several threads. Each field is stored in its own
+  column (struct of arrays), so that scanning one field, such as the names,
+  stays cache-friendly. Names, extra fields and comments are spans into the
+  raw directory.
+
+  The columns and the raw directory live in one contiguous block, which
+  can be saved as an index file next to the archive (saveIndex()) and
+  mapped back as is (loadIndex()), so that reopening a huge archive
+  doesn't have to parse its central directory again.
+
+  Lookups by name go through an open-addressing table of entry indexes,
+  keyed on a hash of the case-folded names, which serves both the case
+  sensitive and insensitive lookups without allocating anything but the
+  compared names.
+
+  Used by QuaZip in the mdUnzip mode to serve listings and lookups without
+  walking the archive entry by entry.
+  */
+class QuaZipEntryTable {
+public:
+  /// Constructs an empty table.
+  QuaZipEntryTable();
+  /// Destroys the table, unmapping the index file if any.
+  ~QuaZipEntryTable();
+  /// Decodes the central directory of \a unzFile.
+  /** File names are decoded with \a fileNameCodec. Returns false if the
+    directory can't be read or is inconsistent, leaving the table empty. */
+  bool load(unzFile unzFile, QTextCodec *fileNameCodec);
+  /// Maps the index file \a indexName of the archive \a zipName.
+  /** The index is only used if it was saved for this very archive file:
+    same size, modification time and end of central directory record,
+    and names hashed with the same \a fileNameCodec.
+    No entry is decoded, so this takes constant time. Returns false if the
+    index is missing, stale or invalid, leaving the table empty. */
+  bool loadIndex(const QString &indexName, const QString &zipName,
+                 unzFile unzFile, QTextCodec *fileNameCodec);
+  /// Saves the table as the index file \a indexName of \a zipName.
+  /** Only a table decoded by load() can be saved. The file is replaced
+    atomically. Returns false on failure. */
+  bool saveIndex(const QString &indexName, const QString &zipName,
+                 unzFile unzFile) const;
+  /// Empties the table.
+  void clear();
+  /// Whether load() or loadIndex() succeeded.
+  inline bool isLoaded() const {return loaded;}
+  /// Whether the table was mapped from an index file.
+  inline bool isFromIndex() const {return indexFile != NULL;}
+  /// The number of entries.
+  inline int count() const {return entries;}
+  /// The position of entry \a i, for unzGoToFilePos64().
+  unz64_file_pos filePos(int i) const;
+  /// The local header offset of entry \a i.
+  inline quint64 headerOffset(int i) const {return headerOffsets[i];}
+  /// The compressed size of entry \a i.
+  inline quint64 compressedSize(int i) const {return compressedSizes[i];}
+  /// The uncompressed size of entry \a i.
+  inline quint64 uncompressedSize(int i) const
+  {return uncompressedSizes[i];}
+  /// The CRC-32 of entry \a i.
+  inline quint32 crc(int i) const {return crcs[i];}
+  /// The compression method of entry \a i.
+  inline quint16 method(int i) const {return methods[i];}
+  /// The decoded name of entry \a i.
+  QString name(int i) const;
+  /// All the decoded names, decoded on first use.
+  const QVector<QString> &names() const;
+  /// The raw name of entry \a i.
+  QByteArray rawName(int i) const;
+  /// The extra field of entry \a i.
+  QByteArray extra(int i) const;
+  /// The raw comment of entry \a i.
+  QByteArray rawComment(int i) const;
+  /// The whole central directory record of entry \a i, signature included.
+  QByteArray record(int i) const;
+  /// Fills \a info with entry \a i.
+  void fileInfo(int i, QuaZipFileInfo64 *info, QTextCodec *commentCodec) const;
+  /// The index of the first entry named \a name, or -1.
+  int indexOf(const QString &name, Qt::CaseSensitivity cs) const;
+  /// The hash of the case-folded \a name, as used by indexOf().
+  static quint32 hashName(const QString &name);
+private:
+  enum Task {DecodeRecords, DecodeNames};
+  static int slotCount(int entries);
+  static qint64 storageSize(int entries, qint64 directorySize);
+  void setColumns(uchar *base, int entries, qint64 directorySize);
+  void run(Task task) const;
+  void decode(Task task, int begin, int end) const;
+  void fillSlots();
+  QByteArray span(quint64 offset, int length) const;
+  QuaZipEntryTable(const QuaZipEntryTable &);
+  QuaZipEntryTable &operator=(const QuaZipEntryTable &);
+  bool loaded;
+  int entries;
+  int slots;
+  QTextCodec *codec;
+  /// The value of unz64_file_pos::pos_in_zip_directory of the first entry.
+  ZPOS64_T directoryPos;
+  qint64 directorySize;
+  /// The block holding the columns, when decoded by load().
+  QByteArray storage;
+  /// The mapped index file, when loaded by loadIndex().
+  QFile *indexFile;
+  // The columns, in the order of the block (widest first, so that every
+  // column is naturally aligned).
+  quint64 *headerOffsets;
+  quint64 *compressedSizes;
+  quint64 *uncompressedSizes;
+  quint32 *recordOffsets;
+  quint32 *crcs;
+  quint32 *dosDates;
+  quint32 *externalAttrs;
+  /// Name hashes, see hashName().
+  quint32 *nameHashes;
+  /// The open-addressing table, holding entry indexes plus one (0 for
+  /// empty slots), probed linearly.
+  quint32 *nameSlots;
+  quint16 *methods;
+  quint16 *flags;
+  quint16 *versionsCreated;
+  quint16 *versionsNeeded;
+  quint16 *internalAttrs;
+  quint16 *diskNumbers;
+  quint16 *nameLengths;
+  quint16 *extraLengths;
+  quint16 *commentLengths;
+  uchar *directory;
+  /// Decoded names, filled by load() or on first use.
+  mutable QVector<QString> nameCache;
+  friend class QuaZipEntryDecoder;
+};
+/// \endcond
+
+#endif // QUAZIP_QUAZIPENTRYTABLE_H
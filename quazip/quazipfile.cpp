@@ -23,9 +23,27 @@ quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
 #include "quazipfile.h"
+#include "quablockdeflater.h"
+#include "quacrc32engine.h"
+#include "quazipmethodpolicy.h"
+
+#include <QDataStream>
+#include <QThread>
+
+#include <limits.h>
+#include <string.h>
 
 using namespace std;
 
+/// A seek checkpoint of QuaZipFile, see unz_checkpoint.
+struct QuaZipFileCheckpoint {
+  quint64 uncompressedOffset;
+  quint64 compressedOffset;
+  int bits;
+  /// The data before the checkpoint, compressed with qCompress().
+  QByteArray window;
+};
+
 /// The implementation class for QuaZip.
 /**
 \internal
@@ -66,6 +84,81 @@ class QuaZipFilePrivate {
     bool internal;
     /// The last error.
     int zipError;
+    /// The number of threads used by the block-parallel compression.
+    int deflateThreads;
+    /// The input block size of the block-parallel compression.
+    int deflateBlockSize;
+    /// The block-parallel compressor, if the file is open with it.
+    QuaBlockDeflater *deflater;
+    /// The policy picking the compression method, if any.
+    const QuaZipMethodPolicy *methodPolicy;
+    /// Whether opening the entry waits for a sample of its data.
+    /**
+      Set by open() when a method policy is used, until \ref sample is
+      filled or the file is closed.
+      */
+    bool pending;
+    /// The beginning of the data of a pending entry.
+    QByteArray sample;
+    /// The arguments of open() for a pending entry.
+    QuaZipNewInfo pendingInfo;
+    QByteArray pendingPassword;
+    bool pendingHasPassword;
+    quint32 pendingCrc;
+    int pendingMethod;
+    int pendingLevel;
+    int pendingWindowBits;
+    int pendingMemLevel;
+    int pendingStrategy;
+    /// The least distance between two seek checkpoints, 0 if off.
+    qint64 checkpointSpan;
+    /// Whether the file is open for random access.
+    /**
+      Set by open() when the entry is stored, or when
+      setSeekCheckpointSpan() was called and the entry can be restarted
+      at checkpoints.
+      */
+    bool seekable;
+    /// Whether the entry open for random access is stored.
+    /**
+      A stored entry is seeked to directly, without any checkpoints.
+      */
+    bool stored;
+    /// The seek checkpoints, sorted by their uncompressed offsets.
+    /**
+      They always cover a prefix of the entry: from the beginning up to
+      the farthest position reached so far, possibly in an earlier run.
+      */
+    QList<QuaZipFileCheckpoint> checkpoints;
+    /// The CRC and the sizes of the entry \ref checkpoints belong to.
+    quint32 checkpointsCrc;
+    quint64 checkpointsCsize;
+    quint64 checkpointsUsize;
+    /// Writes the compressed blocks that are ready to the archive.
+    bool flushDeflater();
+    /// Opens the entry in the archive, see QuaZipFile::open().
+    bool openEntry(const QuaZipNewInfo& info, const char *password,
+        quint32 crc, int method, int level, bool raw,
+        int windowBits, int memLevel, int strategy);
+    /// Opens a pending entry and writes its sample.
+    /**
+      If \a complete is \c true, the sample is the whole entry, which is
+      then stored if deflating doesn't make it smaller.
+      */
+    bool openPending(bool complete);
+    /// Checks whether the entry just opened can be read at random.
+    /**
+      A stored entry always can, a deflated one only if
+      \a recordCheckpoints is set. Drops the checkpoints if they belong
+      to another entry.
+      */
+    bool openSeekable(bool recordCheckpoints);
+    /// Records a checkpoint reported by unzip.c, if it is a new one.
+    void addCheckpoint(const unz_checkpoint *checkpoint);
+    /// The unz_checkpoint_func passing checkpoints to addCheckpoint().
+    static void checkpointCallback(voidpf opaque, const unz_checkpoint *checkpoint);
+    /// Moves the decompressor to \a pos, from the nearest checkpoint.
+    bool seekTo(qint64 pos);
     /// Resets \ref zipError.
     inline void resetZipError() const {setZipError(UNZ_OK);}
     /// Sets the zip error.
@@ -85,7 +178,26 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK) {}
+      zipError(UNZ_OK),
+      deflateThreads(1),
+      deflateBlockSize(QuaBlockDeflater::DefaultBlockSize),
+      deflater(NULL),
+      methodPolicy(NULL),
+      pending(false),
+      pendingInfo(QString()),
+      pendingHasPassword(false),
+      pendingCrc(0),
+      pendingMethod(Z_DEFLATED),
+      pendingLevel(Z_DEFAULT_COMPRESSION),
+      pendingWindowBits(-MAX_WBITS),
+      pendingMemLevel(DEF_MEM_LEVEL),
+      pendingStrategy(Z_DEFAULT_STRATEGY),
+      checkpointSpan(0),
+      seekable(false),
+      stored(false),
+      checkpointsCrc(0),
+      checkpointsCsize(0),
+      checkpointsUsize(0) {}
     /// The constructor for the corresponding QuaZipFile constructor.
     inline QuaZipFilePrivate(QuaZipFile *q, const QString &zipName):
       q(q),
@@ -95,7 +207,26 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK)
+      zipError(UNZ_OK),
+      deflateThreads(1),
+      deflateBlockSize(QuaBlockDeflater::DefaultBlockSize),
+      deflater(NULL),
+      methodPolicy(NULL),
+      pending(false),
+      pendingInfo(QString()),
+      pendingHasPassword(false),
+      pendingCrc(0),
+      pendingMethod(Z_DEFLATED),
+      pendingLevel(Z_DEFAULT_COMPRESSION),
+      pendingWindowBits(-MAX_WBITS),
+      pendingMemLevel(DEF_MEM_LEVEL),
+      pendingStrategy(Z_DEFAULT_STRATEGY),
+      checkpointSpan(0),
+      seekable(false),
+      stored(false),
+      checkpointsCrc(0),
+      checkpointsCsize(0),
+      checkpointsUsize(0)
       {
         zip=new QuaZip(zipName);
       }
@@ -108,7 +239,26 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK)
+      zipError(UNZ_OK),
+      deflateThreads(1),
+      deflateBlockSize(QuaBlockDeflater::DefaultBlockSize),
+      deflater(NULL),
+      methodPolicy(NULL),
+      pending(false),
+      pendingInfo(QString()),
+      pendingHasPassword(false),
+      pendingCrc(0),
+      pendingMethod(Z_DEFLATED),
+      pendingLevel(Z_DEFAULT_COMPRESSION),
+      pendingWindowBits(-MAX_WBITS),
+      pendingMemLevel(DEF_MEM_LEVEL),
+      pendingStrategy(Z_DEFAULT_STRATEGY),
+      checkpointSpan(0),
+      seekable(false),
+      stored(false),
+      checkpointsCrc(0),
+      checkpointsCsize(0),
+      checkpointsUsize(0)
       {
         zip=new QuaZip(zipName);
         this->fileName=fileName;
@@ -125,15 +275,274 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(false),
-      zipError(UNZ_OK) {}
+      zipError(UNZ_OK),
+      deflateThreads(1),
+      deflateBlockSize(QuaBlockDeflater::DefaultBlockSize),
+      deflater(NULL),
+      methodPolicy(NULL),
+      pending(false),
+      pendingInfo(QString()),
+      pendingHasPassword(false),
+      pendingCrc(0),
+      pendingMethod(Z_DEFLATED),
+      pendingLevel(Z_DEFAULT_COMPRESSION),
+      pendingWindowBits(-MAX_WBITS),
+      pendingMemLevel(DEF_MEM_LEVEL),
+      pendingStrategy(Z_DEFAULT_STRATEGY),
+      checkpointSpan(0),
+      seekable(false),
+      stored(false),
+      checkpointsCrc(0),
+      checkpointsCsize(0),
+      checkpointsUsize(0) {}
     /// The destructor.
     inline ~QuaZipFilePrivate()
     {
+      delete deflater;
       if (internal)
         delete zip;
     }
 };
 
+
+void QuaZipFilePrivate::checkpointCallback(voidpf opaque, const unz_checkpoint *checkpoint)
+{
+  static_cast<QuaZipFilePrivate*>(opaque)->addCheckpoint(checkpoint);
+}
+
+/// The first bytes of a saved seek index, "QZSX".
+static const quint32 SEEK_INDEX_MAGIC=0x515A5358u;
+static const quint16 SEEK_INDEX_VERSION=1;
+
+bool QuaZipFilePrivate::openSeekable(bool recordCheckpoints)
+{
+  unz_file_info64 info_z;
+  stored=false;
+  if(unzGetCurrentFileInfo64(zip->getUnzFile(), &info_z, NULL, 0, NULL, 0, NULL, 0)!=UNZ_OK)
+    return false;
+  // encrypted data can't be restarted, the keys depend on all of it
+  if((info_z.flag&1)!=0)
+    return false;
+  stored=info_z.compression_method==0;
+  if(stored)
+    return true;
+  if(!recordCheckpoints||info_z.compression_method!=Z_DEFLATED)
+    return false;
+  if(info_z.crc!=checkpointsCrc||info_z.compressed_size!=checkpointsCsize
+      ||info_z.uncompressed_size!=checkpointsUsize) {
+    checkpoints.clear();
+    checkpointsCrc=(quint32)info_z.crc;
+    checkpointsCsize=info_z.compressed_size;
+    checkpointsUsize=info_z.uncompressed_size;
+  }
+  return true;
+}
+
+void QuaZipFilePrivate::addCheckpoint(const unz_checkpoint *checkpoint)
+{
+  // after a seek, the checkpoints already known come again
+  if(!checkpoints.isEmpty()
+      &&checkpoint->uncompressed_offset<=checkpoints.last().uncompressedOffset)
+    return;
+  QuaZipFileCheckpoint point;
+  point.uncompressedOffset=checkpoint->uncompressed_offset;
+  point.compressedOffset=checkpoint->compressed_offset;
+  point.bits=checkpoint->bits;
+  point.window=qCompress(checkpoint->window, (int)checkpoint->window_size);
+  checkpoints.append(point);
+}
+
+bool QuaZipFilePrivate::seekTo(qint64 pos)
+{
+  unzFile uf=zip->getUnzFile();
+  qint64 current=(qint64)unztell64(uf);
+  if(pos==current)
+    return true;
+  if(stored) {
+    // the uncompressed offset is the compressed one
+    unz_checkpoint checkpoint;
+    checkpoint.uncompressed_offset=(ZPOS64_T)pos;
+    checkpoint.compressed_offset=(ZPOS64_T)pos;
+    checkpoint.bits=0;
+    checkpoint.window=NULL;
+    checkpoint.window_size=0;
+    setZipError(unzSeekCurrentFile64(uf, &checkpoint));
+    return zipError==UNZ_OK;
+  }
+  // the last checkpoint at or before pos
+  int lo=0, hi=checkpoints.size();
+  while(lo<hi) {
+    int mid=(lo+hi)/2;
+    if(checkpoints.at(mid).uncompressedOffset<=(quint64)pos)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  const QuaZipFileCheckpoint *point=lo>0?&checkpoints.at(lo-1):NULL;
+  qint64 from=point!=NULL?(qint64)point->uncompressedOffset:0;
+  if(pos<current||from>current) {
+    QByteArray window;
+    unz_checkpoint checkpoint;
+    if(point!=NULL) {
+      window=qUncompress(point->window);
+      checkpoint.uncompressed_offset=point->uncompressedOffset;
+      checkpoint.compressed_offset=point->compressedOffset;
+      checkpoint.bits=point->bits;
+      checkpoint.window=reinterpret_cast<const unsigned char*>(window.constData());
+      checkpoint.window_size=(uInt)window.size();
+    }
+    setZipError(unzSeekCurrentFile64(uf, point!=NULL?&checkpoint:NULL));
+    if(zipError!=UNZ_OK)
+      return false;
+    current=from;
+  }
+  // inflate what is left up to pos, recording the checkpoints on the way
+  QByteArray skipped((int)qMin<qint64>(pos-current, 64*1024), Qt::Uninitialized);
+  while(current<pos) {
+    int read=unzReadCurrentFile(uf, skipped.data(),
+        (unsigned)qMin<qint64>(pos-current, skipped.size()));
+    if(read<=0) {
+      setZipError(read<0?read:UNZ_BADZIPFILE);
+      return false;
+    }
+    current+=read;
+  }
+  return true;
+}
+
+bool QuaZipFilePrivate::flushDeflater()
+{
+  QByteArray output = deflater->takeOutput();
+  if (output.isEmpty())
+    return true;
+  setZipError(zipWriteInFileInZip(zip->getZipFile(), output.constData(),
+        (uint)output.size()));
+  return zipError == ZIP_OK;
+}
+
+bool QuaZipFilePrivate::openEntry(const QuaZipNewInfo& info,
+    const char *password, quint32 crc, int method, int level, bool raw,
+    int windowBits, int memLevel, int strategy)
+{
+  zip_fileinfo info_z;
+  info_z.tmz_date.tm_year=info.dateTime.date().year();
+  info_z.tmz_date.tm_mon=info.dateTime.date().month() - 1;
+  info_z.tmz_date.tm_mday=info.dateTime.date().day();
+  info_z.tmz_date.tm_hour=info.dateTime.time().hour();
+  info_z.tmz_date.tm_min=info.dateTime.time().minute();
+  info_z.tmz_date.tm_sec=info.dateTime.time().second();
+  info_z.dosDate = 0;
+  info_z.internal_fa=(uLong)info.internalAttr;
+  info_z.external_fa=(uLong)info.externalAttr;
+  if (zip->isDataDescriptorWritingEnabled())
+      zipSetFlags(zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
+  else
+      zipClearFlags(zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
+  // The block-parallel mode writes the compressed blocks in raw mode.
+  bool parallel = deflateThreads > 1 && method == Z_DEFLATED && !raw
+      && password == NULL && windowBits == -MAX_WBITS;
+  zipSetDeflateBackend(zip->getZipFile(), (int)zip->getDeflateBackend(),
+      (ZPOS64_T)zip->getDeflateBudget());
+  // the size, if known, tells the one-shot backend whether to buffer
+  if (!raw && !parallel)
+      zipSetSizeHint(zip->getZipFile(), (ZPOS64_T)info.uncompressedSize);
+  setZipError(zipOpenNewFileInZip3_64(zip->getZipFile(),
+        zip->getFileNameCodec()->fromUnicode(info.name).constData(), &info_z,
+        info.extraLocal.constData(), info.extraLocal.length(),
+        info.extraGlobal.constData(), info.extraGlobal.length(),
+        zip->getCommentCodec()->fromUnicode(info.comment).constData(),
+        method, level, (int)(raw || parallel),
+        windowBits, memLevel, strategy,
+        password, (uLong)crc, zip->isZip64Enabled()));
+  if(zipError!=UNZ_OK)
+    return false;
+  this->raw=raw;
+  if(raw) {
+    this->crc=crc;
+    uncompressedSize=info.uncompressedSize;
+  }
+  if (parallel) {
+    deflater = new QuaBlockDeflater(level, deflateThreads,
+        deflateBlockSize, 0, memLevel, strategy);
+  }
+  return true;
+}
+
+/// Deflates the whole \a data at once, returns false on error.
+static bool QuaZipFile_deflate(const QByteArray &data, QByteArray *out,
+    int level, int windowBits, int memLevel, int strategy)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, memLevel,
+        strategy) != Z_OK)
+    return false;
+  out->resize((int)deflateBound(&stream, (uLong)data.size()));
+  stream.next_in = (Bytef*)data.constData();
+  stream.avail_in = (uInt)data.size();
+  stream.next_out = (Bytef*)out->data();
+  stream.avail_out = (uInt)out->size();
+  int err = deflate(&stream, Z_FINISH);
+  out->resize((int)stream.total_out);
+  deflateEnd(&stream);
+  return err == Z_STREAM_END;
+}
+
+bool QuaZipFilePrivate::openPending(bool complete)
+{
+  pending=false;
+  int method=pendingMethod;
+  int level=pendingLevel;
+  methodPolicy->choose(pendingInfo.name, sample, &method, &level);
+  const char *password=pendingHasPassword?pendingPassword.constData():NULL;
+  QByteArray data;
+  data.swap(sample);
+  // the encryption header needs the CRC, which is known for a whole entry
+  quint32 crc=pendingCrc;
+  if(complete) {
+    crc=(quint32)quacrc32(crc32(0L, Z_NULL, 0),
+        (const Bytef*)data.constData(), (uInt)data.size());
+  }
+  if(complete&&method==Z_DEFLATED) {
+    // The whole entry is known: keep it deflated only if it shrinks,
+    // and write it raw rather than deflate it twice.
+    QByteArray deflated;
+    if(!QuaZipFile_deflate(data, &deflated, level, pendingWindowBits,
+          pendingMemLevel, pendingStrategy)) {
+      setZipError(ZIP_INTERNALERROR);
+      return false;
+    }
+    if(deflated.size()>=data.size()) {
+      method=0;
+      level=0;
+    } else if(password==NULL&&pendingWindowBits==-MAX_WBITS) {
+      QuaZipNewInfo info(pendingInfo);
+      info.uncompressedSize=(quint64)data.size();
+      if(!openEntry(info, NULL, crc, method, level, true,
+            pendingWindowBits, pendingMemLevel, pendingStrategy))
+        return false;
+      setZipError(zipWriteInFileInZip(zip->getZipFile(),
+            deflated.constData(), (uint)deflated.size()));
+      return zipError==ZIP_OK;
+    }
+  }
+  if(!openEntry(pendingInfo, password, crc, method, level, false,
+        pendingWindowBits, pendingMemLevel, pendingStrategy))
+    return false;
+  if(data.isEmpty())
+    return true;
+  if(deflater!=NULL) {
+    if(!deflater->write(data.constData(), data.size())) {
+      setZipError(ZIP_INTERNALERROR);
+      return false;
+    }
+    return flushDeflater();
+  }
+  setZipError(zipWriteInFileInZip(zip->getZipFile(), data.constData(),
+        (uint)data.size()));
+  return zipError==ZIP_OK;
+}
+
 QuaZipFile::QuaZipFile():
   p(new QuaZipFilePrivate(this))
 {
@@ -289,13 +698,27 @@ bool QuaZipFile::open(OpenMode mode, int *method, int *level, bool raw, const ch
         return false;
       }
     }
+    unzSetInflateBackend(p->zip->getUnzFile(), (int)p->zip->getDeflateBackend(),
+        (ZPOS64_T)p->zip->getDeflateBudget());
+    bool recordCheckpoints=p->checkpointSpan>0&&!raw
+      &&unzSetCheckpointCallback(p->zip->getUnzFile(), (ZPOS64_T)p->checkpointSpan,
+          QuaZipFilePrivate::checkpointCallback, p)==UNZ_OK;
     p->setZipError(unzOpenCurrentFile3(p->zip->getUnzFile(), method, level, (int)raw, password));
     if(p->zipError==UNZ_OK) {
+      // must be known before setOpenMode(), which resets the access mode
+      p->seekable=p->openSeekable(recordCheckpoints);
+      if(recordCheckpoints&&(!p->seekable||p->stored))
+        unzSetCheckpointCallback(p->zip->getUnzFile(), 0, NULL, NULL);
       setOpenMode(mode);
+      if(p->seekable)
+        QIODevice::seek(0);
       p->raw=raw;
       return true;
-    } else
+    } else {
+      if(recordCheckpoints)
+        unzSetCheckpointCallback(p->zip->getUnzFile(), 0, NULL, NULL);
       return false;
+    }
   }
   qWarning("QuaZipFile::open(): open mode %d not supported by this function", (int)mode);
   return false;
@@ -306,7 +729,6 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
     int method, int level, bool raw,
     int windowBits, int memLevel, int strategy)
 {
-  zip_fileinfo info_z;
   p->resetZipError();
   if(isOpen()) {
     qWarning("QuaZipFile::open(): already opened");
@@ -326,35 +748,28 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
           (int)mode, (int)p->zip->getMode());
       return false;
     }
-    info_z.tmz_date.tm_year=info.dateTime.date().year();
-    info_z.tmz_date.tm_mon=info.dateTime.date().month() - 1;
-    info_z.tmz_date.tm_mday=info.dateTime.date().day();
-    info_z.tmz_date.tm_hour=info.dateTime.time().hour();
-    info_z.tmz_date.tm_min=info.dateTime.time().minute();
-    info_z.tmz_date.tm_sec=info.dateTime.time().second();
-    info_z.dosDate = 0;
-    info_z.internal_fa=(uLong)info.internalAttr;
-    info_z.external_fa=(uLong)info.externalAttr;
-    if (p->zip->isDataDescriptorWritingEnabled())
-        zipSetFlags(p->zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
-    else
-        zipClearFlags(p->zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
-    p->setZipError(zipOpenNewFileInZip3_64(p->zip->getZipFile(),
-          p->zip->getFileNameCodec()->fromUnicode(info.name).constData(), &info_z,
-          info.extraLocal.constData(), info.extraLocal.length(),
-          info.extraGlobal.constData(), info.extraGlobal.length(),
-          p->zip->getCommentCodec()->fromUnicode(info.comment).constData(),
-          method, level, (int)raw,
-          windowBits, memLevel, strategy,
-          password, (uLong)crc, p->zip->isZip64Enabled()));
-    if(p->zipError==UNZ_OK) {
+    if(p->methodPolicy!=NULL&&method==Z_DEFLATED&&!raw) {
+      // The entry is opened once a sample of its data is known.
+      p->pending=true;
+      p->sample.clear();
+      p->pendingInfo=info;
+      p->pendingHasPassword=password!=NULL;
+      p->pendingPassword=password!=NULL?QByteArray(password):QByteArray();
+      p->pendingCrc=crc;
+      p->pendingMethod=method;
+      p->pendingLevel=level;
+      p->pendingWindowBits=windowBits;
+      p->pendingMemLevel=memLevel;
+      p->pendingStrategy=strategy;
+      p->writePos=0;
+      p->raw=false;
+      setOpenMode(mode);
+      return true;
+    }
+    if(p->openEntry(info, password, crc, method, level, raw,
+          windowBits, memLevel, strategy)) {
       p->writePos=0;
       setOpenMode(mode);
-      p->raw=raw;
-      if(raw) {
-        p->crc=crc;
-        p->uncompressedSize=info.uncompressedSize;
-      }
       return true;
     } else
       return false;
@@ -363,9 +778,26 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
   return false;
 }
 
+bool QuaZipFile::isMethodSupported(int method)
+{
+  return zipIsMethodSupported(method) && unzIsMethodSupported(method);
+}
+
 bool QuaZipFile::isSequential()const
 {
-  return true;
+  return !p->seekable;
+}
+
+bool QuaZipFile::seek(qint64 pos)
+{
+  if(!p->seekable)
+    return QIODevice::seek(pos);
+  p->resetZipError();
+  if(pos<0||pos>size()) {
+    qWarning("QuaZipFile::seek(): position %lld is out of range", (long long)pos);
+    return false;
+  }
+  return p->seekTo(pos)&&QIODevice::seek(pos);
 }
 
 qint64 QuaZipFile::pos()const
@@ -378,6 +810,8 @@ qint64 QuaZipFile::pos()const
     qWarning("QuaZipFile::pos(): file is not open");
     return -1;
   }
+  if(p->seekable)
+    return QIODevice::pos();
   if(openMode()&ReadOnly)
       // QIODevice::pos() is broken for sequential devices,
       // but thankfully bytesAvailable() returns the number of
@@ -397,6 +831,8 @@ bool QuaZipFile::atEnd()const
     qWarning("QuaZipFile::atEnd(): file is not open");
     return false;
   }
+  if(p->seekable)
+    return QIODevice::atEnd();
   if(openMode()&ReadOnly)
       // the same problem as with pos()
     return QIODevice::bytesAvailable() == 0
@@ -439,6 +875,18 @@ qint64 QuaZipFile::usize()const
   return info_z.uncompressed_size;
 }
 
+QByteArray QuaZipFile::mappedData()const
+{
+  if(p->zip==NULL||p->zip->getMode()!=QuaZip::mdUnzip||!isOpen())
+    return QByteArray();
+  ZPOS64_T size = 0;
+  const void *data = unzGetCurrentFileMapping(p->zip->getUnzFile(), &size);
+  if(data==NULL||size>static_cast<ZPOS64_T>(INT_MAX))
+    return QByteArray();
+  return QByteArray::fromRawData(static_cast<const char*>(data),
+                                 static_cast<int>(size));
+}
+
 bool QuaZipFile::getFileInfo(QuaZipFileInfo *info)
 {
     QuaZipFileInfo64 info64;
@@ -466,16 +914,45 @@ void QuaZipFile::close()
     qWarning("QuaZipFile::close(): file isn't open");
     return;
   }
-  if(openMode()&ReadOnly)
+  if(openMode()&ReadOnly) {
+    if(p->seekable)
+      unzSetCheckpointCallback(p->zip->getUnzFile(), 0, NULL, NULL);
     p->setZipError(unzCloseCurrentFile(p->zip->getUnzFile()));
+  }
   else if(openMode()&WriteOnly)
-    if(isRaw()) p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(), p->uncompressedSize, p->crc));
+    if(p->pending&&!p->openPending(true)) {
+      // Keep the error, but don't leave the entry open in zip.c.
+      int zipError=p->zipError;
+      zipCloseFileInZip(p->zip->getZipFile());
+      delete p->deflater;
+      p->deflater=NULL;
+      setOpenMode(QIODevice::NotOpen);
+      p->setZipError(zipError);
+      return;
+    }
+    else if(p->deflater!=NULL) {
+      if(!p->deflater->finish())
+        p->setZipError(ZIP_INTERNALERROR);
+      else if(p->flushDeflater())
+        p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(),
+              p->deflater->totalIn(), p->deflater->crc()));
+      delete p->deflater;
+      p->deflater=NULL;
+    }
+    else if(isRaw()) p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(), p->uncompressedSize, p->crc));
     else p->setZipError(zipCloseFileInZip(p->zip->getZipFile()));
   else {
     qWarning("Wrong open mode: %d", (int)openMode());
     return;
   }
-  if(p->zipError==UNZ_OK) setOpenMode(QIODevice::NotOpen);
+  if(p->zipError==UNZ_OK) {
+    if(p->seekable) {
+      // setOpenMode() would keep the position and the read buffer
+      QIODevice::close();
+      p->seekable=false;
+    } else
+      setOpenMode(QIODevice::NotOpen);
+  }
   else return;
   if(p->internal) {
     p->zip->close();
@@ -497,6 +974,22 @@ qint64 QuaZipFile::readData(char *data, qint64 maxSize)
 qint64 QuaZipFile::writeData(const char* data, qint64 maxSize)
 {
   p->setZipError(ZIP_OK);
+  if(p->pending) {
+    p->sample.append(data, (int)maxSize);
+    p->writePos+=maxSize;
+    if(p->sample.size()>=p->methodPolicy->sampleSize()&&!p->openPending(false))
+      return -1;
+    return maxSize;
+  }
+  if(p->deflater!=NULL) {
+    if(!p->deflater->write(data, maxSize)) {
+      p->setZipError(ZIP_INTERNALERROR);
+      return -1;
+    }
+    if(!p->flushDeflater()) return -1;
+    p->writePos+=maxSize;
+    return maxSize;
+  }
   p->setZipError(zipWriteInFileInZip(p->zip->getZipFile(), data, (uint)maxSize));
   if(p->zipError!=ZIP_OK) return -1;
   else {
@@ -520,6 +1013,116 @@ bool QuaZipFile::isRaw() const
   return p->raw;
 }
 
+void QuaZipFile::setDeflateThreads(int threads, int blockSize)
+{
+  if(isOpen()) {
+    qWarning("QuaZipFile::setDeflateThreads(): file is already open - can not set thread count");
+    return;
+  }
+  p->deflateThreads=threads>0?threads:qMax(1, QThread::idealThreadCount());
+  p->deflateBlockSize=blockSize;
+}
+
+int QuaZipFile::getDeflateThreads() const
+{
+  return p->deflateThreads;
+}
+
+void QuaZipFile::setMethodPolicy(const QuaZipMethodPolicy *policy)
+{
+  if(isOpen()) {
+    qWarning("QuaZipFile::setMethodPolicy(): file is already open - can not set method policy");
+    return;
+  }
+  p->methodPolicy=policy;
+}
+
+const QuaZipMethodPolicy *QuaZipFile::getMethodPolicy() const
+{
+  return p->methodPolicy;
+}
+
+void QuaZipFile::setSeekCheckpointSpan(qint64 span)
+{
+  if(isOpen()) {
+    qWarning("QuaZipFile::setSeekCheckpointSpan(): file is already open - can not set checkpoint span");
+    return;
+  }
+  p->checkpointSpan=qMax<qint64>(0, span);
+}
+
+qint64 QuaZipFile::getSeekCheckpointSpan() const
+{
+  return p->checkpointSpan;
+}
+
+bool QuaZipFile::buildSeekIndex()
+{
+  p->resetZipError();
+  if(!p->seekable) {
+    qWarning("QuaZipFile::buildSeekIndex(): file is not open for random access");
+    return false;
+  }
+  if(p->stored)
+    return true;
+  qint64 here=pos();
+  return p->seekTo(size())&&seek(here);
+}
+
+int QuaZipFile::getSeekCheckpointCount() const
+{
+  return p->checkpoints.size();
+}
+
+void QuaZipFile::clearSeekIndex()
+{
+  p->checkpoints.clear();
+}
+
+bool QuaZipFile::saveSeekIndex(QIODevice *device) const
+{
+  QDataStream out(device);
+  out.setVersion(QDataStream::Qt_4_6);
+  out<<SEEK_INDEX_MAGIC<<SEEK_INDEX_VERSION<<p->checkpointsCrc
+     <<p->checkpointsCsize<<p->checkpointsUsize<<(quint32)p->checkpoints.size();
+  foreach(const QuaZipFileCheckpoint &point, p->checkpoints)
+    out<<point.uncompressedOffset<<point.compressedOffset<<(quint8)point.bits<<point.window;
+  return out.status()==QDataStream::Ok;
+}
+
+bool QuaZipFile::loadSeekIndex(QIODevice *device)
+{
+  QDataStream in(device);
+  in.setVersion(QDataStream::Qt_4_6);
+  quint32 magic=0, crc=0, count=0;
+  quint16 version=0;
+  quint64 csize=0, usize=0;
+  in>>magic>>version>>crc>>csize>>usize>>count;
+  if(in.status()!=QDataStream::Ok||magic!=SEEK_INDEX_MAGIC||version!=SEEK_INDEX_VERSION)
+    return false;
+  // an open entry can only take its own index
+  if(p->seekable&&(crc!=p->checkpointsCrc||csize!=p->checkpointsCsize
+      ||usize!=p->checkpointsUsize))
+    return false;
+  QList<QuaZipFileCheckpoint> checkpoints;
+  for(quint32 i=0; i<count; ++i) {
+    QuaZipFileCheckpoint point;
+    quint8 bits=0;
+    in>>point.uncompressedOffset>>point.compressedOffset>>bits>>point.window;
+    point.bits=bits;
+    if(in.status()!=QDataStream::Ok||bits>7||point.uncompressedOffset>usize
+        ||point.compressedOffset>csize||(!checkpoints.isEmpty()
+        &&point.uncompressedOffset<=checkpoints.last().uncompressedOffset))
+      return false;
+    checkpoints.append(point);
+  }
+  p->checkpoints=checkpoints;
+  p->checkpointsCrc=crc;
+  p->checkpointsCsize=csize;
+  p->checkpointsUsize=usize;
+  return true;
+}
+
 int QuaZipFile::getZipError() const
 {
   return p->zipError;
@@ -32,6 +32,7 @@ quazip/(un)zip.h files for details, basically it's zlib license.
 #include "quazipnewinfo.h"
 
 class QuaZipFilePrivate;
+class QuaZipMethodPolicy;
 
 /// A file inside ZIP archive.
 /** \class QuaZipFile quazipfile.h <quazip/quazipfile.h>
@@ -70,6 +71,13 @@ class QuaZipFilePrivate;
  * size() and pos() functions. This should be kept in mind while using
  * this class.
  *
+ * Stored entries that are not encrypted are the exception: there the
+ * position in the data is the position in the archive, so they are
+ * always open as regular random-access devices, and large reads go
+ * straight from the archive to the caller's buffer. Deflated entries can
+ * be read at random too, by recording access points along the way, see
+ * setSeekCheckpointSpan().
+ *
  **/
 class QUAZIP_EXPORT QuaZipFile: public QIODevice {
   friend class QuaZipFilePrivate;
@@ -281,6 +289,113 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * \sa QuaZip::setCurrentFile
      **/
     void setFileName(const QString& fileName, QuaZip::CaseSensitivity cs =QuaZip::csDefault);
+    /// Enables block-parallel compression for writing.
+    /** When \a threads is greater than 1, the next
+     * open(OpenMode,const QuaZipNewInfo&,const char*,quint32,int,int,bool,int,int,int)
+     * call for a non-raw, non-encrypted Z_DEFLATED entry cuts the data
+     * written into blocks of \a blockSize bytes and deflates them
+     * concurrently, pigz style. Each block is primed with the end of the
+     * previous one and the blocks are joined on sync flush boundaries,
+     * so the entry is still a single standard deflate stream, only
+     * slightly bigger. It only pays off for large entries.
+     *
+     * Pass 0 to use QThread::idealThreadCount() threads and 1 to turn
+     * the parallel mode off, which is the default.
+     *
+     * Will do nothing if the file is currently open.
+     **/
+    void setDeflateThreads(int threads, int blockSize = 128 * 1024);
+    /// Returns the number of threads set by setDeflateThreads().
+    int getDeflateThreads() const;
+    /// Lets \a policy pick the compression method when writing.
+    /** When a policy is set, the next
+     * open(OpenMode,const QuaZipNewInfo&,const char*,quint32,int,int,bool,int,int,int)
+     * call for a non-raw Z_DEFLATED entry doesn't open the entry in the
+     * archive right away: the data written is kept until
+     * QuaZipMethodPolicy::sampleSize() bytes are known, or until close()
+     * for smaller entries. The policy then picks the method and the level
+     * from the entry name and that sample, so that incompressible data is
+     * stored rather than deflated. Entries that fit in the sample are
+     * also stored if deflating them doesn't make them smaller.
+     *
+     * Since the entry is opened late, errors from the archive may be
+     * reported by write() or close() rather than open().
+     *
+     * The policy is not copied and must outlive the writing. Pass NULL,
+     * the default, to always use the method and level passed to open().
+     *
+     * Will do nothing if the file is currently open.
+     **/
+    void setMethodPolicy(const QuaZipMethodPolicy *policy);
+    /// Returns the policy set by setMethodPolicy().
+    const QuaZipMethodPolicy *getMethodPolicy() const;
+    /// Enables random access to deflated entries when reading.
+    /** When \a span is greater than 0, the next open() for reading of a
+     * non-raw, non-encrypted Z_DEFLATED entry makes this file a
+     * random-access device: isSequential() returns \c false and seek()
+     * goes anywhere in the uncompressed data.
+     *
+     * While the entry is read, a checkpoint is recorded at the end of the
+     * first deflate block at least \a span bytes after the previous one,
+     * along with the 32 KB of data before it (kept compressed). seek()
+     * restarts inflating at the last checkpoint before the target, so it
+     * never inflates much more than \a span bytes. Seeking past the last
+     * checkpoint inflates everything up to the target, recording the
+     * checkpoints on the way, so the first pass costs as much as a plain
+     * read. Call buildSeekIndex() to do it right away.
+     *
+     * The checkpoints are kept as long as the same entry is opened
+     * again, and saveSeekIndex() and loadSeekIndex() persist them in a
+     * sidecar file, so that the next run can seek right away:
+     * \code
+     * QuaZipFile file(&zip);
+     * file.setSeekCheckpointSpan(1024 * 1024);
+     * QFile sidecar(zip.getZipName() + ".idx");
+     * if (sidecar.open(QIODevice::ReadOnly))
+     *     file.loadSeekIndex(&sidecar);
+     * file.open(QIODevice::ReadOnly);
+     * file.seek(file.size() - 100 * 1024 * 1024);
+     * \endcode
+     *
+     * Smaller spans make seeking faster and the index bigger. Pass 0, the
+     * default, for plain sequential reading.
+     *
+     * Stored entries that are not encrypted need no checkpoints: they are
+     * random-access whatever the span is, raw or not.
+     *
+     * Will do nothing if the file is currently open.
+     **/
+    void setSeekCheckpointSpan(qint64 span);
+    /// Returns the span set by setSeekCheckpointSpan().
+    qint64 getSeekCheckpointSpan() const;
+    /// Records the checkpoints of the whole entry.
+    /** Inflates the rest of the entry after the last checkpoint, then
+     * goes back to the current position. The file must be open for
+     * random access, see setSeekCheckpointSpan(). Does nothing for a
+     * stored entry.
+     *
+     * Returns \c false on error, call getZipError() to get the error code.
+     **/
+    bool buildSeekIndex();
+    /// Returns the number of checkpoints recorded or loaded so far.
+    int getSeekCheckpointCount() const;
+    /// Forgets the checkpoints.
+    void clearSeekIndex();
+    /// Writes the checkpoints to \a device.
+    /** Saves what loadSeekIndex() needs, including the CRC and the sizes
+     * of the entry, to tell a stale index. Returns \c false if
+     * \a device can't be written.
+     **/
+    bool saveSeekIndex(QIODevice *device) const;
+    /// Reads the checkpoints saved by saveSeekIndex() from \a device.
+    /** If the file is open for random access, the index must belong to
+     * the entry open. Otherwise, it is checked by the next open(), which
+     * drops it if it belongs to another entry.
+     *
+     * Returns \c false if \a device doesn't hold a valid index, leaving
+     * the current one as is.
+     **/
+    bool loadSeekIndex(QIODevice *device);
     /// Opens a file for reading.
     /** Returns \c true on success, \c false otherwise.
      * Call getZipError() to get error code.
@@ -323,8 +438,13 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * use the raw mode (see below).
      *
      * Arguments \a method and \a level specify compression method and
-     * level. The only method supported is Z_DEFLATED, but you may also
-     * specify 0 for no compression. If all of the files in the archive
+     * level. The method is usually Z_DEFLATED, but you may also
+     * specify 0 for no compression, or Z_BZIP2ED and Z_LZMAED
+     * if QuaZIP was built with them (see isMethodSupported()). The
+     * level of these methods goes from 1 to 9,
+     * Z_DEFAULT_COMPRESSION picking their own default. Entries of a
+     * method QuaZIP wasn't built with can still be written and read raw.
+     * If all of the files in the archive
      * use both method 0 and either level 0 is explicitly specified or
      * data descriptor writing is disabled with
      * QuaZip::setDataDescriptorWritingEnabled(), then the
@@ -342,8 +462,27 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
         const char *password =NULL, quint32 crc =0,
         int method =Z_DEFLATED, int level =Z_DEFAULT_COMPRESSION, bool raw =false,
         int windowBits =-MAX_WBITS, int memLevel =DEF_MEM_LEVEL, int strategy =Z_DEFAULT_STRATEGY);
+    /// Whether entries compressed with \a method can be written and read.
+    /** 0 (stored) and Z_DEFLATED are always supported. Z_BZIP2ED and
+     * Z_LZMAED are supported when QuaZIP is built with HAVE_BZIP2 and
+     * HAVE_LZMA respectively (the quazip_bzip2 and quazip_lzma qmake
+     * configs, or the QUAZIP_BZIP2 and QUAZIP_LZMA CMake options).
+     **/
+    static bool isMethodSupported(int method);
     /// Returns \c true, but \ref quazipfile-sequential "beware"!
+    /** Returns \c false if the file is open for random access: the
+     * entry is stored and not encrypted, or see setSeekCheckpointSpan().
+     **/
     virtual bool isSequential()const;
+    /// Moves to \a pos in the uncompressed data.
+    /** Only works if the file is open for random access, see
+     * isSequential(). Returns \c false on error, or if \a pos is past
+     * the end of the file.
+     *
+     * Seeking in a stored entry only moves the archive offset. Note that
+     * the CRC can't be checked on close() once the file was seeked in.
+     **/
+    virtual bool seek(qint64 pos);
     /// Returns current position in the file.
     /** Implementation of the QIODevice::pos(). When reading, this
      * function is a wrapper to the ZIP/UNZIP unztell(), therefore it is
@@ -361,6 +500,9 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * and therefore pos() should always return zero, it does not,
      * because it would be misguiding. Keep this in mind.
      *
+     * A file open for random access (see isSequential()) keeps
+     * track of its position like any random-access device.
+     *
      * This function returns -1 if the file or archive is not open.
      *
      * Error code returned by getZipError() is not affected by this
@@ -418,6 +560,19 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * Returns -1 on error, call getZipError() to get error code.
      **/
     qint64 usize()const;
+    /// Returns the data of a stored file without copying it.
+    /** If the archive was opened in the
+     * \ref QuaZip::setMapped() "memory-mapped mode", and the file is
+     * stored (or opened in raw mode) and not encrypted, returns its whole
+     * data as a QByteArray referring to the mapping, whatever has already
+     * been read. The data is only valid until the archive is closed, and its
+     * CRC is not checked.
+     *
+     * Returns a null QByteArray otherwise.
+     *
+     * File must be open for reading before calling this function.
+     **/
+    QByteArray mappedData()const;
     /// Gets information about current file.
     /** This function does the same thing as calling
      * QuaZip::getCurrentFileInfo() on the associated QuaZip object,
@@ -0,0 +1,192 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipmethodpolicy.h"
+
+#include <QFileInfo>
+
+#include <math.h>
+#include <string.h>
+
+#include <zlib.h>
+
+/// \cond internal
+
+/// The smallest sample whose entropy is measured.
+#define QUAZIP_POLICY_MIN_SAMPLE 4096
+
+/// A signature of a compressed format.
+struct QuaZipMethodPolicySignature {
+  /// Where the signature starts.
+  int offset;
+  /// The signature.
+  const char *bytes;
+  /// The length of the signature.
+  int length;
+};
+
+static const QuaZipMethodPolicySignature QuaZipMethodPolicy_signatures[] = {
+  {0, "PK\x03\x04", 4},               // ZIP and its derivatives
+  {0, "\x1f\x8b", 2},                 // gzip
+  {0, "BZh", 3},                      // bzip2
+  {0, "\xfd" "7zXZ\x00", 6},          // xz
+  {0, "\x28\xb5\x2f\xfd", 4},         // Zstandard
+  {0, "7z\xbc\xaf\x27\x1c", 6},       // 7-Zip
+  {0, "Rar!\x1a\x07", 6},             // RAR
+  {0, "\xff\xd8\xff", 3},             // JPEG
+  {0, "\x89PNG\r\n\x1a\n", 8},        // PNG
+  {0, "GIF8", 4},                     // GIF
+  {8, "WEBP", 4},                     // WebP, in a RIFF container
+  {0, "ID3", 3},                      // MP3 with ID3v2 tags
+  {4, "ftyp", 4},                     // MP4, MOV, HEIC
+  {0, "\x1a\x45\xdf\xa3", 4},         // Matroska, WebM
+  {0, "OggS", 4},                     // Ogg
+  {0, "fLaC", 4},                     // FLAC
+};
+
+/// \endcond
+
+QuaZipMethodPolicy::QuaZipMethodPolicy():
+  sampleBytes(256 * 1024),
+  storeBits(7.9),
+  fastBits(7.2)
+{
+  stored << "7z" << "aac" << "apk" << "avi" << "br" << "bz2" << "docx"
+         << "flac" << "gif" << "gz" << "heic" << "jar" << "jpeg" << "jpg"
+         << "lz4" << "lzma" << "m4a" << "m4v" << "mkv" << "mov" << "mp3"
+         << "mp4" << "odp" << "ods" << "odt" << "ogg" << "opus" << "png"
+         << "pptx" << "rar" << "tgz" << "txz" << "webm" << "webp" << "xlsx"
+         << "xz" << "zip" << "zst";
+  deflated << "c" << "cpp" << "css" << "csv" << "h" << "hpp" << "htm"
+           << "html" << "ini" << "js" << "json" << "log" << "md" << "svg"
+           << "txt" << "xml";
+}
+
+void QuaZipMethodPolicy::setStoredSuffixes(const QStringList &suffixes)
+{
+  stored = suffixes;
+}
+
+QStringList QuaZipMethodPolicy::storedSuffixes() const
+{
+  return stored;
+}
+
+void QuaZipMethodPolicy::setDeflatedSuffixes(const QStringList &suffixes)
+{
+  deflated = suffixes;
+}
+
+QStringList QuaZipMethodPolicy::deflatedSuffixes() const
+{
+  return deflated;
+}
+
+void QuaZipMethodPolicy::setSampleSize(int bytes)
+{
+  sampleBytes = qMax(bytes, QUAZIP_POLICY_MIN_SAMPLE);
+}
+
+int QuaZipMethodPolicy::sampleSize() const
+{
+  return sampleBytes;
+}
+
+void QuaZipMethodPolicy::setStoreEntropy(double bitsPerByte)
+{
+  storeBits = bitsPerByte;
+}
+
+double QuaZipMethodPolicy::storeEntropy() const
+{
+  return storeBits;
+}
+
+void QuaZipMethodPolicy::setFastEntropy(double bitsPerByte)
+{
+  fastBits = bitsPerByte;
+}
+
+double QuaZipMethodPolicy::fastEntropy() const
+{
+  return fastBits;
+}
+
+void QuaZipMethodPolicy::choose(const QString &name, const QByteArray &sample,
+                                int *method, int *level) const
+{
+  if (*method != Z_DEFLATED)
+    return;
+  QString suffix = QFileInfo(name).suffix();
+  if (deflated.contains(suffix, Qt::CaseInsensitive))
+    return;
+  if (stored.contains(suffix, Qt::CaseInsensitive)
+      || isCompressedFormat(sample)) {
+    *method = 0;
+    *level = 0;
+    return;
+  }
+  if (sample.size() < QUAZIP_POLICY_MIN_SAMPLE)
+    return;
+  double bits = entropy(sample.left(sampleBytes));
+  if (bits >= storeBits) {
+    *method = 0;
+    *level = 0;
+  } else if (bits >= fastBits && *level != 0) {
+    *level = Z_BEST_SPEED;
+  }
+}
+
+bool QuaZipMethodPolicy::isCompressedFormat(const QByteArray &data)
+{
+  const int count = sizeof(QuaZipMethodPolicy_signatures)
+      / sizeof(QuaZipMethodPolicy_signatures[0]);
+  for (int i = 0; i < count; ++i) {
+    const QuaZipMethodPolicySignature &signature
+        = QuaZipMethodPolicy_signatures[i];
+    if (data.size() >= signature.offset + signature.length
+        && memcmp(data.constData() + signature.offset, signature.bytes,
+                  signature.length) == 0)
+      return true;
+  }
+  return false;
+}
+
+double QuaZipMethodPolicy::entropy(const QByteArray &data)
+{
+  if (data.isEmpty())
+    return 0;
+  qint64 counts[256] = {0};
+  const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+  for (int i = 0; i < data.size(); ++i)
+    ++counts[bytes[i]];
+  double bits = 0;
+  for (int i = 0; i < 256; ++i) {
+    if (counts[i] == 0)
+      continue;
+    double p = static_cast<double>(counts[i]) / data.size();
+    bits -= p * log(p);
+  }
+  return bits / log(2.0);
+}
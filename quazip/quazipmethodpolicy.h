@@ -0,0 +1,119 @@
+#ifndef QUAZIP_QUAZIPMETHODPOLICY_H
+#define QUAZIP_QUAZIPMETHODPOLICY_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "quazip_global.h"
+
+/// Picks the compression method of an entry from its contents.
+/** \class QuaZipMethodPolicy quazipmethodpolicy.h <quazip/quazipmethodpolicy.h>
+  Deflating data that is already compressed (JPEG pictures, videos,
+  nested archives, gzipped logs) costs a lot of CPU and gains nothing,
+  often even making the entry a little bigger. This policy looks at the
+  name and the beginning of an entry and tells whether it's worth
+  deflating:
+    - entries whose name has a suffix of deflatedSuffixes() are deflated
+      as requested;
+    - entries whose name has a suffix of storedSuffixes(), or whose data
+      starts with the signature of a known compressed format (see
+      isCompressedFormat()), are stored;
+    - otherwise, the byte entropy of a sample of up to sampleSize()
+      bytes is measured: the entry is stored if it reaches
+      storeEntropy(), deflated with Z_BEST_SPEED if it reaches
+      fastEntropy(), and deflated as requested if not.
+
+  Use it with QuaZipFile::setMethodPolicy(), which also falls back to
+  storing entries that turn out to be bigger once deflated, or call
+  choose() directly.
+  */
+class QUAZIP_EXPORT QuaZipMethodPolicy {
+public:
+  /// Constructs a policy with the default lists and thresholds.
+  QuaZipMethodPolicy();
+  /// Sets the suffixes of the names of the entries to store.
+  /** Suffixes are compared case insensitively, without the dot, to the
+    part of the name following its last dot. The default list holds the
+    common compressed formats: pictures, audio, video and archives.
+    */
+  void setStoredSuffixes(const QStringList &suffixes);
+  /// Returns the suffixes of the names of the entries to store.
+  QStringList storedSuffixes() const;
+  /// Sets the suffixes of the names of the entries always deflated.
+  /** These entries are deflated as requested without looking at their
+    data. The default list holds common text formats.
+    */
+  void setDeflatedSuffixes(const QStringList &suffixes);
+  /// Returns the suffixes of the names of the entries always deflated.
+  QStringList deflatedSuffixes() const;
+  /// Sets the maximum size of the sample measured, 256 KB by default.
+  void setSampleSize(int bytes);
+  /// Returns the maximum size of the sample measured.
+  int sampleSize() const;
+  /// Sets the entropy, in bits per byte, from which entries are stored.
+  /** The default is 7.9 bits per byte, which only random looking data
+    reaches.
+    */
+  void setStoreEntropy(double bitsPerByte);
+  /// Returns the entropy from which entries are stored.
+  double storeEntropy() const;
+  /// Sets the entropy, in bits per byte, from which entries are deflated
+  /// with Z_BEST_SPEED.
+  /** The default is 7.2 bits per byte: such data doesn't shrink much
+    whatever the level, so the fastest one is used.
+    */
+  void setFastEntropy(double bitsPerByte);
+  /// Returns the entropy from which entries are deflated with Z_BEST_SPEED.
+  double fastEntropy() const;
+  /// Picks the method and the level of an entry.
+  /** \a name is the name of the entry and \a sample the beginning of its
+    data (only sampleSize() bytes of it are looked at). \a method and
+    \a level hold the requested method and level on input, and receive
+    the ones to use on output. Nothing is changed unless \a method is
+    Z_DEFLATED. Samples shorter than 4 KB are too short for the entropy
+    to be meaningful, so they are only checked for signatures.
+    */
+  void choose(const QString &name, const QByteArray &sample,
+              int *method, int *level) const;
+  /// Returns whether \a data starts with the signature of a known
+  /// compressed format.
+  /** Recognized formats include ZIP, gzip, bzip2, xz, Zstandard, 7-Zip,
+    RAR, JPEG, PNG, GIF, WebP, MP3, MP4, Matroska, Ogg and FLAC.
+    */
+  static bool isCompressedFormat(const QByteArray &data);
+  /// Returns the Shannon entropy of the bytes of \a data, in bits per byte.
+  static double entropy(const QByteArray &data);
+private:
+  QStringList stored;
+  QStringList deflated;
+  int sampleBytes;
+  double storeBits;
+  double fastBits;
+};
+
+#endif // QUAZIP_QUAZIPMETHODPOLICY_H
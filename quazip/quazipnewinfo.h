@@ -80,6 +80,10 @@ struct QUAZIP_EXPORT QuaZipNewInfo {
   /// Uncompressed file size.
   /** This is only needed if you are using raw file zipping mode, i. e.
    * adding precompressed file in the zip archive.
+   *
+   * Otherwise, it is an optional hint for the
+   * \ref QuaZip::setDeflateBackend() "one-shot deflate backend": a file
+   * larger than its budget is streamed from the start.
    **/
   ulong uncompressedSize;
   /// Constructs QuaZipNewInfo instance.
@@ -0,0 +1,612 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipstreamreader.h"
+#include "quazip.h"
+#include "quacrc32engine.h"
+
+#include <QTextCodec>
+
+#include <zlib.h>
+#include <string.h>
+
+/// \cond internal
+
+/// Size of the chunks read from the source and decoded at once.
+#define QUAZIP_STREAM_CHUNK 65536
+/// Size of a local file header, without the name and the extra field.
+#define QUAZIP_STREAM_HEADER_SIZE 30
+/// Largest data descriptor: signature, CRC and 64-bit sizes.
+#define QUAZIP_STREAM_DESCRIPTOR_MAX 24
+
+static inline quint16 QuaZipStream_le16(const char *p)
+{
+  const uchar *u = reinterpret_cast<const uchar*>(p);
+  return static_cast<quint16>(u[0] | (u[1] << 8));
+}
+
+static inline quint32 QuaZipStream_le32(const char *p)
+{
+  return static_cast<quint32>(QuaZipStream_le16(p))
+    | (static_cast<quint32>(QuaZipStream_le16(p + 2)) << 16);
+}
+
+static inline quint64 QuaZipStream_le64(const char *p)
+{
+  return static_cast<quint64>(QuaZipStream_le32(p))
+    | (static_cast<quint64>(QuaZipStream_le32(p + 4)) << 32);
+}
+
+class QuaZipStreamEntry;
+
+class QuaZipStreamReaderPrivate {
+  friend class QuaZipStreamReader;
+  friend class QuaZipStreamEntry;
+  QuaZipStreamReaderPrivate(QIODevice *ioDevice);
+  ~QuaZipStreamReaderPrivate();
+  QIODevice *source;
+  QTextCodec *fileNameCodec;
+  int timeout;
+  int zipError;
+  /// Bytes read from the source, consumed up to inPos.
+  QByteArray in;
+  int inPos;
+  /// Whether the source has nothing more to give.
+  bool sourceEnd;
+  /// Whether a local header has been seen.
+  bool started;
+  /// Whether there are no more entries.
+  bool finished;
+  QuaZipStreamEntry *entry;
+  bool hasEntry;
+  QuaZipFileInfo64 info;
+  /// Whether the local header had a ZIP64 extra field.
+  bool zip64;
+  /// Whether a data descriptor follows the data.
+  bool descriptor;
+  /// Whether the compressed size is known before the data.
+  bool sizeKnown;
+  /// Whether the data can be decoded.
+  bool readable;
+  quint64 compressedLeft;
+  quint64 uncompressedRead;
+  uLong crc;
+  z_stream zs;
+  bool inflating;
+  /// Whether the data and the descriptor have been read.
+  bool dataEnd;
+  /// Decoded data, delivered up to outPos.
+  QByteArray out;
+  int outPos;
+  inline int available() const {return in.size() - inPos;}
+  bool fill(int count);
+  bool readHeader();
+  bool decode();
+  bool scanStored(int *produced, bool *ended);
+  bool skipCompressed();
+  bool readDescriptor();
+  void endData(bool check);
+  void fail(int error);
+  bool skip();
+  qint64 read(char *data, qint64 maxSize);
+  bool entryAtEnd();
+};
+
+/// The device of the current entry.
+class QuaZipStreamEntry: public QIODevice {
+public:
+  QuaZipStreamEntry(QuaZipStreamReaderPrivate *d): d(d) {}
+  virtual bool isSequential() const {return true;}
+  virtual bool atEnd() const {return d->entryAtEnd();}
+  virtual qint64 bytesAvailable() const
+  {
+    return d->out.size() - d->outPos + QIODevice::bytesAvailable();
+  }
+  /// The uncompressed size, if known yet.
+  virtual qint64 size() const
+  {
+    return static_cast<qint64>(d->info.uncompressedSize);
+  }
+protected:
+  virtual qint64 readData(char *data, qint64 maxSize)
+  {
+    return d->read(data, maxSize);
+  }
+  virtual qint64 writeData(const char *, qint64)
+  {
+    return -1;
+  }
+private:
+  QuaZipStreamReaderPrivate *d;
+};
+
+QuaZipStreamReaderPrivate::QuaZipStreamReaderPrivate(QIODevice *ioDevice):
+  source(ioDevice),
+  fileNameCodec(QuaZip().getFileNameCodec()),
+  timeout(30000),
+  zipError(UNZ_OK),
+  inPos(0),
+  sourceEnd(false),
+  started(false),
+  finished(false),
+  entry(NULL),
+  hasEntry(false),
+  zip64(false),
+  descriptor(false),
+  sizeKnown(false),
+  readable(false),
+  compressedLeft(0),
+  uncompressedRead(0),
+  crc(0),
+  inflating(false),
+  dataEnd(true),
+  outPos(0)
+{
+  zs.zalloc = (alloc_func) NULL;
+  zs.zfree = (free_func) NULL;
+  zs.opaque = NULL;
+  entry = new QuaZipStreamEntry(this);
+}
+
+QuaZipStreamReaderPrivate::~QuaZipStreamReaderPrivate()
+{
+  if (inflating)
+    inflateEnd(&zs);
+  delete entry;
+}
+
+bool QuaZipStreamReaderPrivate::fill(int count)
+{
+  while (available() < count) {
+    if (sourceEnd)
+      return false;
+    // drop what has been consumed
+    if (inPos > 0) {
+      in.remove(0, inPos);
+      inPos = 0;
+    }
+    int size = in.size();
+    int chunk = qMax(count - size, QUAZIP_STREAM_CHUNK);
+    in.resize(size + chunk);
+    qint64 got = source->read(in.data() + size, chunk);
+    in.resize(size + static_cast<int>(qMax<qint64>(got, 0)));
+    if (got < 0) {
+      sourceEnd = true;
+    } else if (got == 0 && !source->waitForReadyRead(timeout)
+               && source->bytesAvailable() <= 0) {
+      // nothing arrived in time, or nothing will ever arrive
+      sourceEnd = true;
+    }
+  }
+  return true;
+}
+
+void QuaZipStreamReaderPrivate::fail(int error)
+{
+  zipError = error;
+  if (inflating) {
+    inflateEnd(&zs);
+    inflating = false;
+  }
+  out.clear();
+  outPos = 0;
+  dataEnd = true;
+  finished = true;
+}
+
+bool QuaZipStreamReaderPrivate::readHeader()
+{
+  if (!fill(4)) {
+    // the end of the device, clean unless in the middle of a signature
+    if (available() > 0)
+      zipError = UNZ_BADZIPFILE;
+    return false;
+  }
+  quint32 signature = QuaZipStream_le32(in.constData() + inPos);
+  if (signature == 0x08074b50 && !started) {
+    // the marker of a split archive
+    inPos += 4;
+    if (!fill(4)) {
+      zipError = UNZ_BADZIPFILE;
+      return false;
+    }
+    signature = QuaZipStream_le32(in.constData() + inPos);
+  }
+  if (signature == 0x02014b50 || signature == 0x06054b50
+      || signature == 0x06064b50) {
+    // the central directory, the entries are over
+    return false;
+  }
+  if (signature != 0x04034b50 || !fill(QUAZIP_STREAM_HEADER_SIZE)) {
+    zipError = UNZ_BADZIPFILE;
+    return false;
+  }
+  started = true;
+  const char *header = in.constData() + inPos;
+  quint16 nameLength = QuaZipStream_le16(header + 26);
+  quint16 extraLength = QuaZipStream_le16(header + 28);
+  if (!fill(QUAZIP_STREAM_HEADER_SIZE + nameLength + extraLength)) {
+    zipError = UNZ_BADZIPFILE;
+    return false;
+  }
+  header = in.constData() + inPos;
+  info = QuaZipFileInfo64();
+  info.versionNeeded = QuaZipStream_le16(header + 4);
+  info.flags = QuaZipStream_le16(header + 6);
+  info.method = QuaZipStream_le16(header + 8);
+  quint32 dosDate = QuaZipStream_le32(header + 10);
+  info.crc = QuaZipStream_le32(header + 14);
+  info.compressedSize = QuaZipStream_le32(header + 18);
+  info.uncompressedSize = QuaZipStream_le32(header + 22);
+  info.name = fileNameCodec->toUnicode(header + QUAZIP_STREAM_HEADER_SIZE,
+                                       nameLength);
+  info.extra = QByteArray(header + QUAZIP_STREAM_HEADER_SIZE + nameLength,
+                          extraLength);
+  inPos += QUAZIP_STREAM_HEADER_SIZE + nameLength + extraLength;
+  // same conversion as unzip.c and QuaZip::getCurrentFileInfo()
+  quint32 date = dosDate >> 16;
+  info.dateTime = QDateTime(
+      QDate(((date & 0x0FE00) >> 9) + 1980, (date & 0x1E0) >> 5, date & 0x1f),
+      QTime((dosDate & 0xF800) >> 11, (dosDate & 0x7E0) >> 5,
+        2 * (dosDate & 0x1f)));
+  // the ZIP64 extra field
+  zip64 = false;
+  const char *extra = info.extra.constData();
+  int acc = 0;
+  while (acc + 4 <= extraLength) {
+    quint16 headerId = QuaZipStream_le16(extra + acc);
+    int dataSize = qMin<int>(QuaZipStream_le16(extra + acc + 2),
+        extraLength - acc - 4);
+    if (headerId == 0x0001) {
+      zip64 = true;
+      const char *field = extra + acc + 4;
+      int pos = 0;
+      if (info.uncompressedSize == 0xFFFFFFFFu && pos + 8 <= dataSize) {
+        info.uncompressedSize = QuaZipStream_le64(field + pos);
+        pos += 8;
+      }
+      if (info.compressedSize == 0xFFFFFFFFu && pos + 8 <= dataSize) {
+        info.compressedSize = QuaZipStream_le64(field + pos);
+        pos += 8;
+      }
+    }
+    acc += 4 + dataSize;
+  }
+  descriptor = (info.flags & 0x08) != 0;
+  sizeKnown = !descriptor || info.compressedSize != 0;
+  readable = (info.flags & 0x01) == 0
+    && (info.method == 0 || info.method == Z_DEFLATED);
+  compressedLeft = info.compressedSize;
+  uncompressedRead = 0;
+  crc = crc32(0L, Z_NULL, 0);
+  out.clear();
+  outPos = 0;
+  dataEnd = false;
+  if (readable && info.method == Z_DEFLATED) {
+    zs.next_in = Z_NULL;
+    zs.avail_in = 0;
+    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
+      zipError = UNZ_INTERNALERROR;
+      return false;
+    }
+    inflating = true;
+  }
+  return true;
+}
+
+bool QuaZipStreamReaderPrivate::readDescriptor()
+{
+  if (!descriptor)
+    return true;
+  if (!fill(4))
+    return false;
+  // the signature is optional
+  int pos = QuaZipStream_le32(in.constData() + inPos) == 0x08074b50 ? 4 : 0;
+  int size = zip64 ? 20 : 12;
+  if (!fill(pos + size))
+    return false;
+  const char *fields = in.constData() + inPos + pos;
+  info.crc = QuaZipStream_le32(fields);
+  if (zip64) {
+    info.compressedSize = QuaZipStream_le64(fields + 4);
+    info.uncompressedSize = QuaZipStream_le64(fields + 12);
+  } else {
+    info.compressedSize = QuaZipStream_le32(fields + 4);
+    info.uncompressedSize = QuaZipStream_le32(fields + 8);
+  }
+  inPos += pos + size;
+  return true;
+}
+
+void QuaZipStreamReaderPrivate::endData(bool check)
+{
+  if (inflating) {
+    inflateEnd(&zs);
+    inflating = false;
+  }
+  dataEnd = true;
+  if (!check)
+    return;
+  if (uncompressedRead != info.uncompressedSize)
+    zipError = UNZ_BADZIPFILE;
+  else if (crc != info.crc)
+    zipError = UNZ_CRCERROR;
+}
+
+bool QuaZipStreamReaderPrivate::scanStored(int *produced, bool *ended)
+{
+  // A stored entry of unknown size ends at the first descriptor that
+  // matches the data before it. At least one whole descriptor is kept
+  // ahead, unless the source ends first.
+  fill(QUAZIP_STREAM_DESCRIPTOR_MAX + 1);
+  const char *data = in.constData() + inPos;
+  const int avail = available();
+  if (avail == 0)
+    return false;
+  const int safe = sourceEnd ? qMin(avail, QUAZIP_STREAM_CHUNK)
+    : qMin(avail - (QUAZIP_STREAM_DESCRIPTOR_MAX - 1), QUAZIP_STREAM_CHUNK);
+  uLong runningCrc = crc;
+  int checked = 0;
+  for (int k = 0; k < safe; ++k) {
+    if (k + 16 > avail || QuaZipStream_le32(data + k) != 0x08074b50)
+      continue;
+    runningCrc = quacrc32(runningCrc, reinterpret_cast<const Bytef*>(data + checked),
+                          k - checked);
+    checked = k;
+    quint64 count = uncompressedRead + k;
+    if (QuaZipStream_le32(data + k + 4) != runningCrc)
+      continue;
+    int size = 0;
+    if (QuaZipStream_le32(data + k + 8) == count
+        && QuaZipStream_le32(data + k + 12) == count) {
+      size = 16;
+      info.compressedSize = info.uncompressedSize = count;
+    } else if (k + 24 <= avail && QuaZipStream_le64(data + k + 8) == count
+               && QuaZipStream_le64(data + k + 16) == count) {
+      size = 24;
+      info.compressedSize = info.uncompressedSize = count;
+    } else {
+      continue;
+    }
+    info.crc = QuaZipStream_le32(data + k + 4);
+    out.resize(k);
+    memcpy(out.data(), data, k);
+    inPos += k + size;
+    *produced = k;
+    *ended = true;
+    // the descriptor has been consumed along with the data
+    descriptor = false;
+    return true;
+  }
+  out.resize(safe);
+  memcpy(out.data(), data, safe);
+  inPos += safe;
+  *produced = safe;
+  return true;
+}
+
+bool QuaZipStreamReaderPrivate::decode()
+{
+  if (!readable) {
+    fail(UNZ_BADZIPFILE);
+    return false;
+  }
+  int produced = 0;
+  bool ended = false;
+  if (info.method == Z_DEFLATED) {
+    out.resize(QUAZIP_STREAM_CHUNK);
+    while (produced == 0 && !ended) {
+      if (available() == 0 && !fill(1)) {
+        fail(UNZ_BADZIPFILE);
+        return false;
+      }
+      int avail = available();
+      if (sizeKnown && static_cast<quint64>(avail) > compressedLeft)
+        avail = static_cast<int>(compressedLeft);
+      zs.next_in = reinterpret_cast<Bytef*>(in.data() + inPos);
+      zs.avail_in = avail;
+      zs.next_out = reinterpret_cast<Bytef*>(out.data());
+      zs.avail_out = QUAZIP_STREAM_CHUNK;
+      int err = inflate(&zs, Z_SYNC_FLUSH);
+      int consumed = avail - static_cast<int>(zs.avail_in);
+      inPos += consumed;
+      if (sizeKnown)
+        compressedLeft -= consumed;
+      produced = QUAZIP_STREAM_CHUNK - static_cast<int>(zs.avail_out);
+      if (err == Z_STREAM_END) {
+        ended = true;
+      } else if ((err != Z_OK && err != Z_BUF_ERROR)
+                 || (sizeKnown && compressedLeft == 0 && produced == 0)) {
+        fail(UNZ_BADZIPFILE);
+        return false;
+      }
+    }
+    out.resize(produced);
+  } else if (sizeKnown) {
+    out.clear();
+    if (compressedLeft > 0) {
+      if (!fill(1)) {
+        fail(UNZ_BADZIPFILE);
+        return false;
+      }
+      produced = static_cast<int>(qMin<quint64>(
+            qMin(available(), QUAZIP_STREAM_CHUNK), compressedLeft));
+      out = QByteArray(in.constData() + inPos, produced);
+      inPos += produced;
+      compressedLeft -= produced;
+    }
+    ended = compressedLeft == 0;
+  } else if (!scanStored(&produced, &ended)) {
+    fail(UNZ_BADZIPFILE);
+    return false;
+  }
+  outPos = 0;
+  crc = quacrc32(crc, reinterpret_cast<const Bytef*>(out.constData()), produced);
+  uncompressedRead += produced;
+  if (ended) {
+    // whatever follows the end of a deflated stream within its size
+    if (!skipCompressed() || !readDescriptor()) {
+      fail(UNZ_BADZIPFILE);
+      return false;
+    }
+    endData(true);
+  }
+  return true;
+}
+
+bool QuaZipStreamReaderPrivate::skipCompressed()
+{
+  if (!sizeKnown)
+    return true;
+  while (compressedLeft > 0) {
+    if (!fill(1))
+      return false;
+    int count = static_cast<int>(qMin<quint64>(available(), compressedLeft));
+    inPos += count;
+    compressedLeft -= count;
+  }
+  return true;
+}
+
+bool QuaZipStreamReaderPrivate::skip()
+{
+  if (dataEnd)
+    return true;
+  if (sizeKnown) {
+    // no need to decode what nobody reads
+    if (!skipCompressed() || !readDescriptor())
+      return false;
+    endData(false);
+    return true;
+  }
+  while (!dataEnd) {
+    if (!decode())
+      return false;
+  }
+  return true;
+}
+
+qint64 QuaZipStreamReaderPrivate::read(char *data, qint64 maxSize)
+{
+  qint64 done = 0;
+  while (done < maxSize) {
+    if (outPos == out.size()) {
+      // only wait for more data when there is nothing to return yet
+      if (dataEnd || done > 0)
+        break;
+      if (!decode())
+        return -1;
+      continue;
+    }
+    int count = static_cast<int>(qMin<qint64>(out.size() - outPos,
+                                              maxSize - done));
+    memcpy(data + done, out.constData() + outPos, count);
+    outPos += count;
+    done += count;
+  }
+  return done;
+}
+
+bool QuaZipStreamReaderPrivate::entryAtEnd()
+{
+  while (outPos == out.size() && !dataEnd) {
+    if (!decode())
+      break;
+  }
+  return outPos == out.size() && dataEnd;
+}
+
+/// \endcond
+
+QuaZipStreamReader::QuaZipStreamReader(QIODevice *ioDevice):
+  d(new QuaZipStreamReaderPrivate(ioDevice))
+{
+}
+
+QuaZipStreamReader::~QuaZipStreamReader()
+{
+  delete d;
+}
+
+void QuaZipStreamReader::setFileNameCodec(QTextCodec *fileNameCodec)
+{
+  d->fileNameCodec = fileNameCodec;
+}
+
+QTextCodec *QuaZipStreamReader::getFileNameCodec() const
+{
+  return d->fileNameCodec;
+}
+
+void QuaZipStreamReader::setTimeout(int msecs)
+{
+  d->timeout = msecs;
+}
+
+int QuaZipStreamReader::timeout() const
+{
+  return d->timeout;
+}
+
+bool QuaZipStreamReader::nextEntry()
+{
+  if (d->finished)
+    return false;
+  if (!d->source->isOpen() && !d->source->open(QIODevice::ReadOnly)) {
+    d->zipError = UNZ_ERRNO;
+    d->finished = true;
+    return false;
+  }
+  if (d->hasEntry) {
+    d->entry->close();
+    d->hasEntry = false;
+    if (!d->skip()) {
+      d->fail(UNZ_BADZIPFILE);
+      return false;
+    }
+  }
+  d->zipError = UNZ_OK;
+  if (!d->readHeader()) {
+    d->finished = true;
+    return false;
+  }
+  d->hasEntry = true;
+  d->entry->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+  return true;
+}
+
+QuaZipFileInfo64 QuaZipStreamReader::entryInfo() const
+{
+  return d->info;
+}
+
+QIODevice *QuaZipStreamReader::entry() const
+{
+  return d->hasEntry ? d->entry : NULL;
+}
+
+int QuaZipStreamReader::getZipError() const
+{
+  return d->zipError;
+}
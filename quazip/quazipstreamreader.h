@@ -0,0 +1,140 @@
+#ifndef QUAZIP_QUAZIPSTREAMREADER_H
+#define QUAZIP_QUAZIPSTREAMREADER_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QIODevice>
+
+#include "quazip_global.h"
+#include "quazipfileinfo.h"
+
+class QTextCodec;
+class QuaZipStreamReaderPrivate;
+
+/// Forward-only reader of a ZIP archive arriving on a sequential device.
+/**
+  QuaZip needs random access to the archive, because it starts from the
+  central directory at its end. This class reads the archive as it
+  arrives instead, from a pipe, a socket (QTcpSocket, QProcess output,
+  etc.) or any other QIODevice, by walking the local file headers and the
+  data descriptors that precede and follow the data of each entry. Nothing
+  is spooled to disk, so that extracting can overlap the transfer.
+
+  Entries are visited in turn with nextEntry(), and the data of the
+  current entry is read through the device returned by entry():
+
+  \code
+  QuaZipStreamReader reader(socket);
+  while (reader.nextEntry()) {
+      QuaZipFileInfo64 info = reader.entryInfo();
+      QIODevice *entry = reader.entry();
+      while (!entry->atEnd()) {
+          QByteArray data = entry->read(4096);
+          // ...
+      }
+  }
+  if (reader.getZipError() != UNZ_OK) {
+      // error
+  }
+  \endcode
+
+  Reads block until enough data has arrived, for at most timeout()
+  milliseconds at a time, using QIODevice::waitForReadyRead(), so the
+  reader is meant to be used in a thread of its own (or with a device
+  that has already received everything, such as a QBuffer).
+
+  The local headers hold less than the central directory: the version
+  made by, the attributes and the comment of the entries are unknown. If
+  an entry was written with a data descriptor, its CRC and sizes are only
+  known once its data has been read. Stored entries with a data
+  descriptor are delimited by looking for a descriptor that matches the
+  data read so far. Only the stored and deflated methods are supported,
+  encrypted entries can't be read.
+
+  The CRC of each entry is checked when its end is reached: on mismatch,
+  getZipError() returns \c UNZ_CRCERROR.
+  */
+class QUAZIP_EXPORT QuaZipStreamReader {
+public:
+  /// Constructs a reader of \a ioDevice.
+  /**
+    The device must be open for reading, or openable, in which case it is
+    opened by the first call to nextEntry(). It is not closed by the
+    reader.
+    */
+  explicit QuaZipStreamReader(QIODevice *ioDevice);
+  /// Destructor.
+  ~QuaZipStreamReader();
+  /// Sets the codec used to decode the file names.
+  /**
+    The default is the one used by QuaZip, see
+    QuaZip::setDefaultFileNameCodec().
+    */
+  void setFileNameCodec(QTextCodec *fileNameCodec);
+  /// Returns the codec used to decode the file names.
+  QTextCodec *getFileNameCodec() const;
+  /// Sets how long to wait for data before giving up, in milliseconds.
+  /**
+    The default is 30000. -1 waits forever.
+    */
+  void setTimeout(int msecs);
+  /// Returns how long to wait for data, in milliseconds.
+  int timeout() const;
+  /// Moves to the next entry.
+  /**
+    Whatever remains of the data of the current entry is skipped. Returns
+    \c false when there are no more entries, either because the central
+    directory or the end of the device is reached, in which case
+    getZipError() returns \c UNZ_OK, or on error.
+    */
+  bool nextEntry();
+  /// Returns the information about the current entry.
+  /**
+    The CRC and the sizes of an entry written with a data descriptor are
+    only set once the end of its data has been read.
+    */
+  QuaZipFileInfo64 entryInfo() const;
+  /// Returns the device to read the data of the current entry from.
+  /**
+    The device is sequential and owned by the reader. It is reused for
+    every entry, and reaches its end with the data of the current entry.
+    Returns NULL if there is no current entry.
+    */
+  QIODevice *entry() const;
+  /// Returns the error code of the last operation.
+  /**
+    \c UNZ_OK if there was no error, \c UNZ_BADZIPFILE if the data doesn't
+    look like an archive or is truncated, \c UNZ_CRCERROR if the CRC of
+    the last entry read doesn't match.
+    */
+  int getZipError() const;
+private:
+  // not implemented by design to disable copy
+  QuaZipStreamReader(const QuaZipStreamReader &that);
+  QuaZipStreamReader &operator=(const QuaZipStreamReader &that);
+  QuaZipStreamReaderPrivate *d;
+};
+
+#endif // QUAZIP_QUAZIPSTREAMREADER_H
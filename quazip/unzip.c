@@ -74,11 +74,16 @@
 #include <string.h>
 
 #include "zlib.h"
-#if (ZLIB_VERNUM < 0x1270)
-typedef uLongf z_crc_t;
-#endif
+#include "quacrc32engine.h"
 #include "unzip.h"
 
+#ifdef HAVE_LZMA
+#include "lzma.h"
+#endif
+#ifdef HAVE_LIBDEFLATE
+#include "libdeflate.h"
+#endif
+
 #ifdef STDC
 #  include <stddef.h>
 #  include <string.h>
@@ -108,6 +113,25 @@ typedef uLongf z_crc_t;
 #define UNZ_BUFSIZE (16384)
 #endif
 
+#ifndef UNZ_MAPPED_CHUNK
+/* bytes handed to inflate at once when reading from a mapping */
+#define UNZ_MAPPED_CHUNK (1024*1024)
+#endif
+
+/* the backend of UNZ_INFLATE_DEFAULT */
+#ifdef HAVE_LIBDEFLATE
+#define UNZ_INFLATE_BUILTIN UNZ_INFLATE_ONESHOT
+#else
+#define UNZ_INFLATE_BUILTIN UNZ_INFLATE_STREAM
+#endif
+
+#define UNZ_INFLATE_MAX_BUDGET (1024*1024*1024)
+
+/* inflateGetDictionary(), which checkpoints need, came with zlib 1.2.7.1 */
+#if ZLIB_VERNUM >= 0x1271
+#define UNZ_HAVE_CHECKPOINTS
+#endif
+
 #ifndef UNZ_MAXFILENAMEINZIP
 #define UNZ_MAXFILENAMEINZIP (256)
 #endif
@@ -143,6 +167,11 @@ typedef struct
 #ifdef HAVE_BZIP2
     bz_stream bstream;          /* bzLib stream structure for bziped */
 #endif
+#ifdef HAVE_LZMA
+    lzma_stream lstream;        /* liblzma stream structure for Z_LZMAED */
+    unsigned char lzma_header[9]; /* version, properties size, properties */
+    uInt lzma_header_size;      /* bytes of lzma_header read so far */
+#endif
 
     ZPOS64_T pos_in_zipfile;       /* position in byte on the zipfile, for fseek*/
     uLong stream_initialised;   /* flag set if stream structure is initialised*/
@@ -161,6 +190,11 @@ typedef struct
     uLong compression_method;   /* compression method (0==store) */
     ZPOS64_T byte_before_the_zipfile;/* byte before the zipfile, (>0 for sfx)*/
     int   raw;
+    const Bytef *mapped;        /* next compressed bytes in the mapping, NULL if not mapped */
+    int   oneshot;              /* 1 if the file is inflated at once by the first read */
+    Bytef *oneshot_data;        /* the uncompressed data of a one-shot file */
+    ZPOS64_T last_checkpoint;   /* uncompressed offset of the previous checkpoint */
+    int   seeked;               /* 1 if the data before the read position was skipped */
 } file_in_zip64_read_info_s;
 
 
@@ -191,6 +225,15 @@ typedef struct
     int isZip64;
     unsigned flags;
 
+    int inflate_backend;        /* UNZ_INFLATE_STREAM or UNZ_INFLATE_ONESHOT */
+    ZPOS64_T inflate_budget;    /* largest file inflated in one shot */
+#ifdef HAVE_LIBDEFLATE
+    struct libdeflate_decompressor* decompressor; /* kept from file to file */
+#endif
+    unz_checkpoint_func checkpoint_func; /* called at checkpoints, or NULL */
+    voidpf checkpoint_opaque;   /* passed to checkpoint_func */
+    ZPOS64_T checkpoint_span;   /* least uncompressed bytes between checkpoints */
+
 #    ifndef NOUNCRYPT
     unsigned long keys[3];     /* keys defining the pseudo-random sequence */
     const z_crc_t FAR * pcrc_32_tab;
@@ -202,6 +245,33 @@ typedef struct
 #include "minizip_crypt.h"
 #endif
 
+/* ===========================================================================
+   Decode little-endian fields of a record read in one go, to spare a read
+   callback per byte when parsing headers.
+*/
+#define unz64local_le16(p) ((uLong)(p)[0] | ((uLong)(p)[1]<<8))
+#define unz64local_le32(p) (unz64local_le16(p) | (unz64local_le16((p)+2)<<16))
+#define unz64local_le64(p) ((ZPOS64_T)unz64local_le32(p) | \
+                            ((ZPOS64_T)unz64local_le32((p)+4)<<32))
+
+local int unz64local_readRecord OF((
+    const zlib_filefunc64_32_def* pzlib_filefunc_def,
+    voidpf filestream,
+    unsigned char *buf,
+    uLong size));
+
+local int unz64local_readRecord(const zlib_filefunc64_32_def* pzlib_filefunc_def,
+                                voidpf filestream,
+                                unsigned char *buf,
+                                uLong size)
+{
+    if (ZREAD64(*pzlib_filefunc_def,filestream,buf,size)==size)
+        return UNZ_OK;
+    if (ZERROR64(*pzlib_filefunc_def,filestream))
+        return UNZ_ERRNO;
+    return UNZ_EOF;
+}
+
 /* ===========================================================================
      Read a byte from a gz_stream; update next_in and avail_in. Return EOF
    for end of file.
@@ -609,11 +679,23 @@ extern unzFile unzOpenInternal (voidpf file,
         return NULL;
 
     us.flags = flags;
+    us.inflate_backend = UNZ_INFLATE_BUILTIN;
+    us.inflate_budget = UNZ_INFLATE_DEFAULT_BUDGET;
+#ifdef HAVE_LIBDEFLATE
+    us.decompressor = NULL;
+#endif
+    us.checkpoint_func = NULL;
+    us.checkpoint_opaque = NULL;
+    us.checkpoint_span = 0;
     us.z_filefunc.zseek32_file = NULL;
     us.z_filefunc.ztell32_file = NULL;
-    if (pzlib_filefunc64_32_def==NULL)
-        fill_qiodevice64_filefunc(&us.z_filefunc.zfile_func64);
-    else
+    us.z_filefunc.zmap_file = NULL;
+    if (pzlib_filefunc64_32_def==NULL) {
+        if ((flags & UNZ_MAPPED) != 0)
+            fill_qiodevice64_mapped_filefunc(&us.z_filefunc);
+        else
+            fill_qiodevice64_filefunc(&us.z_filefunc.zfile_func64);
+    } else
         us.z_filefunc = *pzlib_filefunc64_32_def;
     us.is64bitOpenFunction = is64bitOpenFunction;
 
@@ -758,6 +840,11 @@ extern unzFile unzOpenInternal (voidpf file,
                             (us.offset_central_dir+us.size_central_dir);
     us.central_pos = central_pos;
     us.pfile_in_zip_read = NULL;
+
+    /* hint that the central directory is about to be read */
+    ZMAP64(us.z_filefunc, us.filestream,
+           us.offset_central_dir + us.byte_before_the_zipfile,
+           us.size_central_dir);
     us.encrypted = 0;
 
 
@@ -793,6 +880,7 @@ extern unzFile ZEXPORT unzOpen2_64 (voidpf file,
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        zlib_filefunc64_32_def_fill.zmap_file = NULL;
         return unzOpenInternal(file, &zlib_filefunc64_32_def_fill, 1, UNZ_DEFAULT_FLAGS);
     }
     else
@@ -828,6 +916,10 @@ extern int ZEXPORT unzClose (unzFile file)
         ZCLOSE64(s->z_filefunc, s->filestream);
     else
         ZFAKECLOSE64(s->z_filefunc, s->filestream);
+#ifdef HAVE_LIBDEFLATE
+    if (s->decompressor != NULL)
+        libdeflate_free_decompressor(s->decompressor);
+#endif
     TRYFREE(s);
     return UNZ_OK;
 }
@@ -905,7 +997,7 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
     int err=UNZ_OK;
     uLong uMagic;
     ZPOS64_T llSeek=0;
-    uLong uL;
+    unsigned char header[SIZECENTRALDIRITEM];
 
     if (file==NULL)
         return UNZ_PARAMERROR;
@@ -913,68 +1005,35 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
     if (ZSEEK64(s->z_filefunc, s->filestream,
               s->pos_in_central_dir+s->byte_before_the_zipfile,
               ZLIB_FILEFUNC_SEEK_SET)!=0)
-        err=UNZ_ERRNO;
+        return UNZ_ERRNO;
 
+    /* the fixed part of the record is read at once */
+    if (unz64local_readRecord(&s->z_filefunc, s->filestream,
+                              header, SIZECENTRALDIRITEM) != UNZ_OK)
+        return UNZ_ERRNO;
 
     /* we check the magic */
-    if (err==UNZ_OK)
-    {
-        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uMagic) != UNZ_OK)
-            err=UNZ_ERRNO;
-        else if (uMagic!=0x02014b50)
-            err=UNZ_BADZIPFILE;
-    }
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version_needed) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.flag) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.compression_method) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.dosDate) != UNZ_OK)
-        err=UNZ_ERRNO;
+    uMagic = unz64local_le32(header);
+    if (uMagic!=0x02014b50)
+        return UNZ_BADZIPFILE;
 
+    file_info.version = unz64local_le16(header + 4);
+    file_info.version_needed = unz64local_le16(header + 6);
+    file_info.flag = unz64local_le16(header + 8);
+    file_info.compression_method = unz64local_le16(header + 10);
+    file_info.dosDate = unz64local_le32(header + 12);
     unz64local_DosDateToTmuDate(file_info.dosDate,&file_info.tmu_date);
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.crc) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info.compressed_size = uL;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info.uncompressed_size = uL;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_filename) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_extra) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_comment) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.disk_num_start) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.internal_fa) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.external_fa) != UNZ_OK)
-        err=UNZ_ERRNO;
-
+    file_info.crc = unz64local_le32(header + 16);
+    file_info.compressed_size = unz64local_le32(header + 20);
+    file_info.uncompressed_size = unz64local_le32(header + 24);
+    file_info.size_filename = unz64local_le16(header + 28);
+    file_info.size_file_extra = unz64local_le16(header + 30);
+    file_info.size_file_comment = unz64local_le16(header + 32);
+    file_info.disk_num_start = unz64local_le16(header + 34);
+    file_info.internal_fa = unz64local_le16(header + 36);
+    file_info.external_fa = unz64local_le32(header + 38);
                 /* relative offset of local header */
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info_internal.offset_curfile = uL;
+    file_info_internal.offset_curfile = unz64local_le32(header + 42);
 
     llSeek+=file_info.size_filename;
     if ((err==UNZ_OK) && (szFileName!=NULL))
@@ -994,14 +1053,13 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
         llSeek -= uSizeRead;
     }
 
-    /* Read extrafield */
-    if ((err==UNZ_OK) && (extraField!=NULL))
+    /* The extra field is read at once, copied to the caller and searched
+       for the ZIP64 sizes in memory */
+    if ((err==UNZ_OK) && (file_info.size_file_extra != 0))
     {
-        ZPOS64_T uSizeRead ;
-        if (file_info.size_file_extra<extraFieldBufferSize)
-            uSizeRead = file_info.size_file_extra;
-        else
-            uSizeRead = extraFieldBufferSize;
+        unsigned char extraBuffer[256];
+        unsigned char *extra = extraBuffer;
+        uLong acc = 0;
 
         if (llSeek!=0)
         {
@@ -1011,83 +1069,73 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
                 err=UNZ_ERRNO;
         }
 
-        if ((file_info.size_file_extra>0) && (extraFieldBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,extraField,(uLong)uSizeRead)!=uSizeRead)
-                err=UNZ_ERRNO;
-
-        llSeek += file_info.size_file_extra - (uLong)uSizeRead;
-    }
-    else
-        llSeek += file_info.size_file_extra;
-
-
-    if ((err==UNZ_OK) && (file_info.size_file_extra != 0))
-    {
-                                uLong acc = 0;
-
-        /* since lSeek now points to after the extra field we need to move back */
-        llSeek -= file_info.size_file_extra;
-
-        if (llSeek!=0)
+        /* most extra fields are small enough for the stack */
+        if (file_info.size_file_extra > sizeof(extraBuffer))
         {
-            if (ZSEEK64(s->z_filefunc, s->filestream,llSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
-                llSeek=0;
-            else
-                err=UNZ_ERRNO;
+            extra = (unsigned char*)ALLOC(file_info.size_file_extra);
+            if (extra==NULL)
+                return UNZ_INTERNALERROR;
         }
+        if ((err==UNZ_OK) &&
+            (unz64local_readRecord(&s->z_filefunc, s->filestream, extra,
+                                   file_info.size_file_extra) != UNZ_OK))
+            err=UNZ_ERRNO;
 
-        while(acc < file_info.size_file_extra)
+        if ((err==UNZ_OK) && (extraField!=NULL) && (extraFieldBufferSize>0))
         {
-            uLong headerId;
-                                                uLong dataSize;
+            uLong uSizeCopy = file_info.size_file_extra;
+            if (uSizeCopy>extraFieldBufferSize)
+                uSizeCopy = extraFieldBufferSize;
+            memcpy(extraField, extra, uSizeCopy);
+        }
 
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&headerId) != UNZ_OK)
-                err=UNZ_ERRNO;
+        while((err==UNZ_OK) && (acc + 4 <= file_info.size_file_extra))
+        {
+            uLong headerId = unz64local_le16(extra + acc);
+            uLong dataSize = unz64local_le16(extra + acc + 2);
+            const unsigned char *data = extra + acc + 4;
+            uLong dataLeft = file_info.size_file_extra - acc - 4;
 
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&dataSize) != UNZ_OK)
-                err=UNZ_ERRNO;
+            if (dataSize > dataLeft)
+                dataSize = dataLeft;
 
             /* ZIP64 extra fields */
             if (headerId == 0x0001)
             {
-                uLong uL;
+                uLong pos = 0;
 
-                if(file_info.uncompressed_size == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info.uncompressed_size == (ZPOS64_T)0xFFFFFFFFu) &&
+                   (pos + 8 <= dataSize))
                 {
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.uncompressed_size) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info.uncompressed_size = unz64local_le64(data + pos);
+                    pos += 8;
                 }
 
-                if(file_info.compressed_size == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info.compressed_size == (ZPOS64_T)0xFFFFFFFFu) &&
+                   (pos + 8 <= dataSize))
                 {
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.compressed_size) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info.compressed_size = unz64local_le64(data + pos);
+                    pos += 8;
                 }
 
-                if(file_info_internal.offset_curfile == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info_internal.offset_curfile == (ZPOS64_T)0xFFFFFFFFu) &&
+                   (pos + 8 <= dataSize))
                 {
                     /* Relative Header offset */
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info_internal.offset_curfile) != UNZ_OK)
-                        err=UNZ_ERRNO;
-                }
-
-                if(file_info.disk_num_start == 0xFFFFFFFFu)
-                {
-                    /* Disk Start Number */
-                    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info_internal.offset_curfile = unz64local_le64(data + pos);
+                    pos += 8;
                 }
 
-            }
-            else
-            {
-                if (ZSEEK64(s->z_filefunc, s->filestream,dataSize,ZLIB_FILEFUNC_SEEK_CUR)!=0)
-                    err=UNZ_ERRNO;
+                /* Disk Start Number is not needed */
             }
 
             acc += 2 + 2 + dataSize;
         }
+        if (extra != extraBuffer)
+            TRYFREE(extra);
     }
+    else
+        llSeek += file_info.size_file_extra;
 
     if ((err==UNZ_OK) && (szComment!=NULL))
     {
@@ -1400,6 +1448,7 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
     uLong size_filename;
     uLong size_extra_field;
     int err=UNZ_OK;
+    unsigned char header[SIZEZIPLOCALHEADER];
 
     *piSizeVar = 0;
     *poffset_local_extrafield = 0;
@@ -1409,63 +1458,46 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
                                 s->byte_before_the_zipfile,ZLIB_FILEFUNC_SEEK_SET)!=0)
         return UNZ_ERRNO;
 
+    /* the whole fixed-size header is read at once */
+    if (unz64local_readRecord(&s->z_filefunc, s->filestream,
+                              header, SIZEZIPLOCALHEADER) != UNZ_OK)
+        return UNZ_ERRNO;
 
-    if (err==UNZ_OK)
-    {
-        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uMagic) != UNZ_OK)
-            err=UNZ_ERRNO;
-        else if (uMagic!=0x04034b50)
-            err=UNZ_BADZIPFILE;
-    }
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uData) != UNZ_OK)
-        err=UNZ_ERRNO;
-/*
-    else if ((err==UNZ_OK) && (uData!=s->cur_file_info.wVersion))
+    uMagic = unz64local_le32(header);
+    if (uMagic!=0x04034b50)
         err=UNZ_BADZIPFILE;
-*/
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uFlags) != UNZ_OK)
-        err=UNZ_ERRNO;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&uData) != UNZ_OK)
-        err=UNZ_ERRNO;
-    else if ((err==UNZ_OK) && (uData!=s->cur_file_info.compression_method))
-        err=UNZ_BADZIPFILE;
+    /* version needed at offset 4 is not checked */
+    uFlags = unz64local_le16(header + 6);
 
-    if ((err==UNZ_OK) && (s->cur_file_info.compression_method!=0) &&
-/* #ifdef HAVE_BZIP2 */
-                         (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
-/* #endif */
-                         (s->cur_file_info.compression_method!=Z_DEFLATED))
+    uData = unz64local_le16(header + 8);
+    if ((err==UNZ_OK) && (uData!=s->cur_file_info.compression_method))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* date/time */
-        err=UNZ_ERRNO;
+    /* the method itself is checked when the data is decompressed, files
+       with an unsupported method can still be read raw */
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* crc */
-        err=UNZ_ERRNO;
-    else if ((err==UNZ_OK) && (uData!=s->cur_file_info.crc) && ((uFlags & 8)==0))
+    /* date/time at offset 10 is not checked */
+
+    uData = unz64local_le32(header + 14); /* crc */
+    if ((err==UNZ_OK) && (uData!=s->cur_file_info.crc) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* size compr */
-        err=UNZ_ERRNO;
-    else if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.compressed_size) && ((uFlags & 8)==0))
+    uData = unz64local_le32(header + 18); /* size compr */
+    if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.compressed_size) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* size uncompr */
-        err=UNZ_ERRNO;
-    else if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.uncompressed_size) && ((uFlags & 8)==0))
+    uData = unz64local_le32(header + 22); /* size uncompr */
+    if (uData != 0xFFFFFFFF && (err==UNZ_OK) && (uData!=s->cur_file_info.uncompressed_size) && ((uFlags & 8)==0))
         err=UNZ_BADZIPFILE;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&size_filename) != UNZ_OK)
-        err=UNZ_ERRNO;
-    else if ((err==UNZ_OK) && (size_filename!=s->cur_file_info.size_filename))
+    size_filename = unz64local_le16(header + 26);
+    if ((err==UNZ_OK) && (size_filename!=s->cur_file_info.size_filename))
         err=UNZ_BADZIPFILE;
 
     *piSizeVar += (uInt)size_filename;
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&size_extra_field) != UNZ_OK)
-        err=UNZ_ERRNO;
+    size_extra_field = unz64local_le16(header + 28);
     *poffset_local_extrafield= s->cur_file_info_internal.offset_curfile +
                                     SIZEZIPLOCALHEADER + size_filename;
     *psize_local_extrafield = (uInt)size_extra_field;
@@ -1475,10 +1507,44 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
     return err;
 }
 
+extern int ZEXPORT unzIsMethodSupported (int method)
+{
+    switch (method)
+    {
+    case 0:
+    case Z_DEFLATED:
+#ifdef HAVE_BZIP2
+    case Z_BZIP2ED:
+#endif
+#ifdef HAVE_LZMA
+    case Z_LZMAED:
+#endif
+        return 1;
+    default:
+        return 0;
+    }
+}
+
 /*
   Open for reading data the current file in the zipfile.
   If there is no error and the file is opened, the return value is UNZ_OK.
 */
+/* Whether the current file, deflated, can be inflated in one shot. */
+local int unz64local_canInflateOneShot(const unz64_s* s)
+{
+#ifdef HAVE_LIBDEFLATE
+    return s->inflate_backend == UNZ_INFLATE_ONESHOT
+        && s->checkpoint_func == NULL
+        && s->cur_file_info.uncompressed_size > 0
+        && s->cur_file_info.uncompressed_size <= s->inflate_budget
+        && s->cur_file_info.compressed_size <= s->inflate_budget;
+#else
+    /* a single zlib inflate() call is no faster than streaming */
+    (void)s;
+    return 0;
+#endif
+}
+
 extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
                                             int* level, int raw, const char* password)
 {
@@ -1524,6 +1590,10 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     }
 
     pfile_in_zip_read_info->stream_initialised=0;
+    pfile_in_zip_read_info->oneshot=0;
+    pfile_in_zip_read_info->oneshot_data=NULL;
+    pfile_in_zip_read_info->last_checkpoint=0;
+    pfile_in_zip_read_info->seeked=0;
 
     if (method!=NULL)
         *method = (int)s->cur_file_info.compression_method;
@@ -1539,13 +1609,12 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
         }
     }
 
-    if ((s->cur_file_info.compression_method!=0) &&
-/* #ifdef HAVE_BZIP2 */
-        (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
-/* #endif */
-        (s->cur_file_info.compression_method!=Z_DEFLATED))
-
-        err=UNZ_BADZIPFILE;
+    if (!raw && !unzIsMethodSupported((int)s->cur_file_info.compression_method))
+    {
+        TRYFREE(pfile_in_zip_read_info->read_buffer);
+        TRYFREE(pfile_in_zip_read_info);
+        return UNZ_BADZIPFILE;
+    }
 
     pfile_in_zip_read_info->crc32_wait=s->cur_file_info.crc;
     pfile_in_zip_read_info->crc32=0;
@@ -1579,10 +1648,25 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
         TRYFREE(pfile_in_zip_read_info);
         return err;
       }
-#else
-      pfile_in_zip_read_info->raw=1;
 #endif
     }
+#ifdef HAVE_LZMA
+    else if ((s->cur_file_info.compression_method==Z_LZMAED) && (!raw))
+    {
+      /* the decoder is set up once the header preceding the LZMA stream
+         has been read, see unzReadCurrentFile() */
+      lzma_stream init = LZMA_STREAM_INIT;
+      pfile_in_zip_read_info->lstream = init;
+      pfile_in_zip_read_info->lzma_header_size = 0;
+      pfile_in_zip_read_info->stream_initialised=Z_LZMAED;
+    }
+#endif
+    else if ((s->cur_file_info.compression_method==Z_DEFLATED) && (!raw)
+             && unz64local_canInflateOneShot(s))
+    {
+      /* inflated by the first read, see unz64local_inflateOneShot() */
+      pfile_in_zip_read_info->oneshot=1;
+    }
     else if ((s->cur_file_info.compression_method==Z_DEFLATED) && (!raw))
     {
       pfile_in_zip_read_info->stream.zalloc = (alloc_func)0;
@@ -1620,6 +1704,12 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
 
     pfile_in_zip_read_info->stream.avail_in = (uInt)0;
 
+    /* with a mapped archive, the data is read in place */
+    pfile_in_zip_read_info->mapped = (const Bytef*)ZMAP64(s->z_filefunc, s->filestream,
+            pfile_in_zip_read_info->pos_in_zipfile +
+              pfile_in_zip_read_info->byte_before_the_zipfile,
+            s->cur_file_info.compressed_size);
+
     s->pfile_in_zip_read = pfile_in_zip_read_info;
                 s->encrypted = 0;
 
@@ -1627,7 +1717,7 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     if (password != NULL)
     {
         int i;
-        s->pcrc_32_tab = get_crc_table();
+        s->pcrc_32_tab = quacrc32_table();
         init_keys(password,s->keys,s->pcrc_32_tab);
         if (ZSEEK64(s->z_filefunc, s->filestream,
                   s->pfile_in_zip_read->pos_in_zipfile +
@@ -1642,6 +1732,8 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
 
         s->pfile_in_zip_read->pos_in_zipfile+=12;
         s->encrypted=1;
+        /* encrypted data has to be decoded in the buffer */
+        s->pfile_in_zip_read->mapped = NULL;
     }
 #    endif
 
@@ -1682,6 +1774,67 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64( unzFile file)
 
 /** Addition for GDAL : END */
 
+extern int ZEXPORT unzGetCentralDirInfo64 (unzFile file, ZPOS64_T *offset, ZPOS64_T *size)
+{
+    unz64_s* s;
+    if (file==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (offset!=NULL)
+        *offset = s->offset_central_dir;
+    if (size!=NULL)
+        *size = s->size_central_dir;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzGetEndOfCentralDirPos64 (unzFile file, ZPOS64_T *pos)
+{
+    unz64_s* s;
+    if (file==NULL || pos==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    *pos = s->central_pos;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzReadCentralDir64 (unzFile file, void *buf, ZPOS64_T size)
+{
+    unz64_s* s;
+    if (file==NULL || buf==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (size > s->size_central_dir || size != (uLong)size)
+        return UNZ_PARAMERROR;
+    if (ZSEEK64(s->z_filefunc, s->filestream,
+              s->offset_central_dir+s->byte_before_the_zipfile,
+              ZLIB_FILEFUNC_SEEK_SET)!=0)
+        return UNZ_ERRNO;
+    if (ZREAD64(s->z_filefunc, s->filestream, buf, (uLong)size)!=size)
+        return UNZ_ERRNO;
+    return UNZ_OK;
+}
+
+extern const void* ZEXPORT unzGetCurrentFileMapping (unzFile file, ZPOS64_T *size)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    if (file==NULL)
+        return NULL;
+    s=(unz64_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL || pfile_in_zip_read_info->mapped==NULL)
+        return NULL;
+    if ((pfile_in_zip_read_info->compression_method!=0) &&
+        (!pfile_in_zip_read_info->raw))
+        return NULL;
+    /* step back over what was already handed to the stream */
+    if (size!=NULL)
+        *size = s->cur_file_info.compressed_size;
+    return pfile_in_zip_read_info->mapped -
+           (s->cur_file_info.compressed_size -
+            pfile_in_zip_read_info->rest_read_compressed);
+}
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -1692,6 +1845,123 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64( unzFile file)
   return <0 with error code if there is an error
     (UNZ_ERRNO for IO error, or zLib error for uncompress error)
 */
+/*
+  Reads the whole compressed data of a one-shot file and inflates it at
+  once. The uncompressed data is then read like the data of a stored file.
+*/
+local int unz64local_inflateOneShot(unz64_s* s)
+{
+    file_in_zip64_read_info_s* pfile_in_zip_read_info = s->pfile_in_zip_read;
+    size_t size_in = (size_t)pfile_in_zip_read_info->rest_read_compressed;
+    size_t size_out = (size_t)pfile_in_zip_read_info->rest_read_uncompressed;
+    const Bytef* in;
+    Bytef* in_buffer = NULL;
+    int err = UNZ_OK;
+
+    pfile_in_zip_read_info->oneshot_data = (Bytef*)ALLOC(size_out);
+    if (pfile_in_zip_read_info->oneshot_data == NULL)
+        return UNZ_INTERNALERROR;
+
+    if (pfile_in_zip_read_info->mapped != NULL)
+    {
+        in = pfile_in_zip_read_info->mapped;
+        pfile_in_zip_read_info->mapped += size_in;
+    }
+    else
+    {
+        in_buffer = (Bytef*)ALLOC(size_in > 0 ? size_in : 1);
+        if (in_buffer == NULL)
+            err = UNZ_INTERNALERROR;
+        else if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                         pfile_in_zip_read_info->filestream,
+                         pfile_in_zip_read_info->pos_in_zipfile +
+                            pfile_in_zip_read_info->byte_before_the_zipfile,
+                         ZLIB_FILEFUNC_SEEK_SET)!=0)
+            err = UNZ_ERRNO;
+        else if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                         pfile_in_zip_read_info->filestream,
+                         in_buffer, (uLong)size_in)!=size_in)
+            err = UNZ_ERRNO;
+#    ifndef NOUNCRYPT
+        if ((err==UNZ_OK) && s->encrypted)
+        {
+            size_t i;
+            for (i=0;i<size_in;i++)
+                in_buffer[i] = (Bytef)zdecode(s->keys,s->pcrc_32_tab,in_buffer[i]);
+        }
+#    endif
+        in = in_buffer;
+    }
+    pfile_in_zip_read_info->pos_in_zipfile += size_in;
+    pfile_in_zip_read_info->rest_read_compressed = 0;
+
+    if (err==UNZ_OK)
+    {
+#ifdef HAVE_LIBDEFLATE
+        size_t actual_in;
+        if (s->decompressor == NULL)
+            s->decompressor = libdeflate_alloc_decompressor();
+        if (s->decompressor == NULL)
+            err = UNZ_INTERNALERROR;
+        /* the size must match the header exactly, trailing input is ignored */
+        else if (libdeflate_deflate_decompress_ex(s->decompressor, in, size_in,
+                     pfile_in_zip_read_info->oneshot_data, size_out,
+                     &actual_in, NULL) != LIBDEFLATE_SUCCESS)
+            err = Z_DATA_ERROR;
+#else
+        /* not reached, see unz64local_canInflateOneShot() */
+        (void)in;
+        err = UNZ_INTERNALERROR;
+#endif
+    }
+    TRYFREE(in_buffer);
+
+    /* on error, what follows reads as the end of the file */
+    if (err==UNZ_OK)
+    {
+        pfile_in_zip_read_info->stream.next_in = pfile_in_zip_read_info->oneshot_data;
+        pfile_in_zip_read_info->stream.avail_in = (uInt)size_out;
+    }
+    return err;
+}
+
+#ifdef UNZ_HAVE_CHECKPOINTS
+/*
+  Calls the checkpoint callback if inflate() stopped at the end of a block,
+  other than the last one, far enough from the previous checkpoint.
+*/
+local void unz64local_checkpoint(unz64_s* s)
+{
+    file_in_zip64_read_info_s* pfile_in_zip_read_info = s->pfile_in_zip_read;
+    z_stream* stream = &pfile_in_zip_read_info->stream;
+    unz_checkpoint checkpoint;
+    Bytef* window;
+    uInt window_size = 0;
+
+    if (((stream->data_type & 128) == 0) || ((stream->data_type & 64) != 0))
+        return;
+    if (pfile_in_zip_read_info->total_out_64 <
+        pfile_in_zip_read_info->last_checkpoint + s->checkpoint_span)
+        return;
+    window = (Bytef*)ALLOC(UNZ_CHECKPOINT_WINDOW);
+    if (window == NULL)
+        return;
+    if (inflateGetDictionary(stream, window, &window_size) == Z_OK)
+    {
+        checkpoint.uncompressed_offset = pfile_in_zip_read_info->total_out_64;
+        /* what was read from the archive, less what inflate() didn't take */
+        checkpoint.compressed_offset = s->cur_file_info.compressed_size -
+            pfile_in_zip_read_info->rest_read_compressed - stream->avail_in;
+        checkpoint.bits = stream->data_type & 7;
+        checkpoint.window = window;
+        checkpoint.window_size = window_size;
+        pfile_in_zip_read_info->last_checkpoint = checkpoint.uncompressed_offset;
+        s->checkpoint_func(s->checkpoint_opaque, &checkpoint);
+    }
+    TRYFREE(window);
+}
+#endif
+
 extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 {
     int err=UNZ_OK;
@@ -1712,6 +1982,14 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
     if (len==0)
         return 0;
 
+    if (pfile_in_zip_read_info->oneshot &&
+        (pfile_in_zip_read_info->oneshot_data == NULL))
+    {
+        err = unz64local_inflateOneShot(s);
+        if (err!=UNZ_OK)
+            return err;
+    }
+
     pfile_in_zip_read_info->stream.next_out = (Bytef*)buf;
 
     pfile_in_zip_read_info->stream.avail_out = (uInt)len;
@@ -1731,13 +2009,18 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
     while (pfile_in_zip_read_info->stream.avail_out>0)
     {
         if ((pfile_in_zip_read_info->stream.avail_in==0) &&
-            (pfile_in_zip_read_info->rest_read_compressed>0))
+            (pfile_in_zip_read_info->stream.avail_out>=UNZ_BUFSIZE) &&
+            (pfile_in_zip_read_info->mapped==NULL) &&
+            ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw)) &&
+            (!pfile_in_zip_read_info->oneshot))
         {
-            uInt uReadThis = UNZ_BUFSIZE;
+            /* large reads of stored data go straight to buf, skipping
+               read_buffer */
+            uInt uReadThis = pfile_in_zip_read_info->stream.avail_out;
             if (pfile_in_zip_read_info->rest_read_compressed<uReadThis)
                 uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
             if (uReadThis == 0)
-                return UNZ_EOF;
+                return (iRead==0) ? UNZ_EOF : iRead;
             if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
                       pfile_in_zip_read_info->filestream,
                       pfile_in_zip_read_info->pos_in_zipfile +
@@ -1746,35 +2029,97 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
                 return UNZ_ERRNO;
             if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
                       pfile_in_zip_read_info->filestream,
-                      pfile_in_zip_read_info->read_buffer,
+                      pfile_in_zip_read_info->stream.next_out,
                       uReadThis)!=uReadThis)
                 return UNZ_ERRNO;
 
-
 #            ifndef NOUNCRYPT
             if(s->encrypted)
             {
                 uInt i;
                 for(i=0;i<uReadThis;i++)
-                  pfile_in_zip_read_info->read_buffer[i] =
+                  pfile_in_zip_read_info->stream.next_out[i] =
                       zdecode(s->keys,s->pcrc_32_tab,
-                              pfile_in_zip_read_info->read_buffer[i]);
+                              pfile_in_zip_read_info->stream.next_out[i]);
             }
 #            endif
 
-
             pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+            pfile_in_zip_read_info->rest_read_compressed -= uReadThis;
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uReadThis;
+            pfile_in_zip_read_info->crc32 = quacrc32(pfile_in_zip_read_info->crc32,
+                                pfile_in_zip_read_info->stream.next_out,
+                                uReadThis);
+            pfile_in_zip_read_info->rest_read_uncompressed -= uReadThis;
+            pfile_in_zip_read_info->stream.avail_out -= uReadThis;
+            pfile_in_zip_read_info->stream.next_out += uReadThis;
+            pfile_in_zip_read_info->stream.total_out += uReadThis;
+            iRead += uReadThis;
+            continue;
+        }
 
-            pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+        if ((pfile_in_zip_read_info->stream.avail_in==0) &&
+            (pfile_in_zip_read_info->rest_read_compressed>0))
+        {
+            uInt uReadThis = UNZ_BUFSIZE;
+            if (pfile_in_zip_read_info->mapped != NULL)
+            {
+                /* hand over the mapped bytes directly, no buffer copy */
+                uReadThis = UNZ_MAPPED_CHUNK;
+                if (pfile_in_zip_read_info->rest_read_compressed<uReadThis)
+                    uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
+                pfile_in_zip_read_info->stream.next_in =
+                    (Bytef*)pfile_in_zip_read_info->mapped;
+                pfile_in_zip_read_info->stream.avail_in = uReadThis;
+                pfile_in_zip_read_info->mapped += uReadThis;
+                pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+                pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+            }
+            else
+            {
+                if (pfile_in_zip_read_info->rest_read_compressed<uReadThis)
+                    uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
+                if (uReadThis == 0)
+                    return UNZ_EOF;
+                if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                          pfile_in_zip_read_info->filestream,
+                          pfile_in_zip_read_info->pos_in_zipfile +
+                             pfile_in_zip_read_info->byte_before_the_zipfile,
+                             ZLIB_FILEFUNC_SEEK_SET)!=0)
+                    return UNZ_ERRNO;
+                if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                          pfile_in_zip_read_info->filestream,
+                          pfile_in_zip_read_info->read_buffer,
+                          uReadThis)!=uReadThis)
+                    return UNZ_ERRNO;
 
-            pfile_in_zip_read_info->stream.next_in =
-                (Bytef*)pfile_in_zip_read_info->read_buffer;
-            pfile_in_zip_read_info->stream.avail_in = (uInt)uReadThis;
+
+#            ifndef NOUNCRYPT
+                if(s->encrypted)
+                {
+                    uInt i;
+                    for(i=0;i<uReadThis;i++)
+                      pfile_in_zip_read_info->read_buffer[i] =
+                          zdecode(s->keys,s->pcrc_32_tab,
+                                  pfile_in_zip_read_info->read_buffer[i]);
+                }
+#            endif
+
+
+                pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+
+                pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+
+                pfile_in_zip_read_info->stream.next_in =
+                    (Bytef*)pfile_in_zip_read_info->read_buffer;
+                pfile_in_zip_read_info->stream.avail_in = (uInt)uReadThis;
+            }
         }
 
-        if ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw))
+        if ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw)
+            || (pfile_in_zip_read_info->oneshot))
         {
-            uInt uDoCopy,i ;
+            uInt uDoCopy;
 
             if ((pfile_in_zip_read_info->stream.avail_in == 0) &&
                 (pfile_in_zip_read_info->rest_read_compressed == 0))
@@ -1786,13 +2131,12 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             else
                 uDoCopy = pfile_in_zip_read_info->stream.avail_in ;
 
-            for (i=0;i<uDoCopy;i++)
-                *(pfile_in_zip_read_info->stream.next_out+i) =
-                        *(pfile_in_zip_read_info->stream.next_in+i);
+            memcpy(pfile_in_zip_read_info->stream.next_out,
+                   pfile_in_zip_read_info->stream.next_in, uDoCopy);
 
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uDoCopy;
 
-            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
+            pfile_in_zip_read_info->crc32 = quacrc32(pfile_in_zip_read_info->crc32,
                                 pfile_in_zip_read_info->stream.next_out,
                                 uDoCopy);
             pfile_in_zip_read_info->rest_read_uncompressed-=uDoCopy;
@@ -1829,7 +2173,7 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
 
-            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,bufBefore, (uInt)(uOutThis));
+            pfile_in_zip_read_info->crc32 = quacrc32(pfile_in_zip_read_info->crc32,bufBefore, (uInt)(uOutThis));
             pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
             iRead += (uInt)(uTotalOutAfter - uTotalOutBefore);
 
@@ -1846,6 +2190,90 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
               break;
 #endif
         } /* end Z_BZIP2ED */
+        else if (pfile_in_zip_read_info->compression_method==Z_LZMAED)
+        {
+#ifdef HAVE_LZMA
+            lzma_ret ret;
+            uInt uInThis, uOutThis;
+
+            if (pfile_in_zip_read_info->lzma_header_size < 9)
+            {
+                lzma_filter filters[2];
+                while ((pfile_in_zip_read_info->stream.avail_in > 0) &&
+                       (pfile_in_zip_read_info->lzma_header_size < 9))
+                {
+                    pfile_in_zip_read_info->lzma_header[pfile_in_zip_read_info->lzma_header_size++] =
+                        *pfile_in_zip_read_info->stream.next_in++;
+                    pfile_in_zip_read_info->stream.avail_in--;
+                    pfile_in_zip_read_info->stream.total_in++;
+                }
+                if (pfile_in_zip_read_info->lzma_header_size < 9)
+                {
+                    if (pfile_in_zip_read_info->rest_read_compressed == 0)
+                    {
+                        err = Z_DATA_ERROR;
+                        break;
+                    }
+                    continue;
+                }
+                /* only the 5 bytes of properties of LZMA1 are known */
+                if (unz64local_le16(pfile_in_zip_read_info->lzma_header + 2) != 5)
+                {
+                    err = Z_DATA_ERROR;
+                    break;
+                }
+                filters[0].id = LZMA_FILTER_LZMA1;
+                filters[0].options = NULL;
+                filters[1].id = LZMA_VLI_UNKNOWN;
+                filters[1].options = NULL;
+                if (lzma_properties_decode(&filters[0], NULL,
+                                           pfile_in_zip_read_info->lzma_header + 4, 5) != LZMA_OK)
+                {
+                    err = Z_DATA_ERROR;
+                    break;
+                }
+                ret = lzma_raw_decoder(&pfile_in_zip_read_info->lstream, filters);
+                free(filters[0].options);
+                if (ret != LZMA_OK)
+                {
+                    err = Z_MEM_ERROR;
+                    break;
+                }
+            }
+
+            pfile_in_zip_read_info->lstream.next_in = pfile_in_zip_read_info->stream.next_in;
+            pfile_in_zip_read_info->lstream.avail_in = pfile_in_zip_read_info->stream.avail_in;
+            pfile_in_zip_read_info->lstream.next_out = pfile_in_zip_read_info->stream.next_out;
+            pfile_in_zip_read_info->lstream.avail_out = pfile_in_zip_read_info->stream.avail_out;
+
+            ret = lzma_code(&pfile_in_zip_read_info->lstream, LZMA_RUN);
+
+            uInThis = pfile_in_zip_read_info->stream.avail_in - (uInt)pfile_in_zip_read_info->lstream.avail_in;
+            uOutThis = pfile_in_zip_read_info->stream.avail_out - (uInt)pfile_in_zip_read_info->lstream.avail_out;
+
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
+            pfile_in_zip_read_info->crc32 = quacrc32(pfile_in_zip_read_info->crc32,
+                                pfile_in_zip_read_info->stream.next_out, uOutThis);
+            pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
+            iRead += uOutThis;
+
+            pfile_in_zip_read_info->stream.next_in += uInThis;
+            pfile_in_zip_read_info->stream.avail_in -= uInThis;
+            pfile_in_zip_read_info->stream.total_in += uInThis;
+            pfile_in_zip_read_info->stream.next_out += uOutThis;
+            pfile_in_zip_read_info->stream.avail_out -= uOutThis;
+            pfile_in_zip_read_info->stream.total_out += uOutThis;
+
+            if (ret == LZMA_STREAM_END)
+                return (iRead==0) ? UNZ_EOF : iRead;
+            if ((ret != LZMA_OK) || (uInThis == 0 && uOutThis == 0))
+            {
+                /* corrupted or truncated data */
+                err = Z_DATA_ERROR;
+                break;
+            }
+#endif
+        } /* end Z_LZMAED */
         else
         {
             uInt uAvailOutBefore,uAvailOutAfter;
@@ -1853,6 +2281,12 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             uInt uOutThis;
             int flush=Z_SYNC_FLUSH;
 
+#ifdef UNZ_HAVE_CHECKPOINTS
+            /* stop at the end of every block to look for checkpoints */
+            if ((s->checkpoint_func != NULL) && !s->encrypted)
+                flush=Z_BLOCK;
+#endif
+
             uAvailOutBefore = pfile_in_zip_read_info->stream.avail_out;
             bufBefore = pfile_in_zip_read_info->stream.next_out;
 
@@ -1867,12 +2301,17 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
 
             pfile_in_zip_read_info->crc32
-                    = crc32(pfile_in_zip_read_info->crc32,bufBefore, uOutThis);
+                    = quacrc32(pfile_in_zip_read_info->crc32,bufBefore, uOutThis);
 
             pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
 
             iRead += uAvailOutBefore - uAvailOutAfter;
 
+#ifdef UNZ_HAVE_CHECKPOINTS
+            if ((err==Z_OK) && (flush==Z_BLOCK))
+                unz64local_checkpoint(s);
+#endif
+
             if (err==Z_STREAM_END)
                 return (iRead==0) ? UNZ_EOF : iRead;
             if (err!=Z_OK)
@@ -2020,7 +2459,7 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
 
 
     if ((pfile_in_zip_read_info->rest_read_uncompressed == 0) &&
-        (!pfile_in_zip_read_info->raw))
+        (!pfile_in_zip_read_info->raw) && (!pfile_in_zip_read_info->seeked))
     {
         if (pfile_in_zip_read_info->crc32 != pfile_in_zip_read_info->crc32_wait)
             err=UNZ_CRCERROR;
@@ -2029,12 +2468,18 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
 
     TRYFREE(pfile_in_zip_read_info->read_buffer);
     pfile_in_zip_read_info->read_buffer = NULL;
+    TRYFREE(pfile_in_zip_read_info->oneshot_data);
+    pfile_in_zip_read_info->oneshot_data = NULL;
     if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATED)
         inflateEnd(&pfile_in_zip_read_info->stream);
 #ifdef HAVE_BZIP2
     else if (pfile_in_zip_read_info->stream_initialised == Z_BZIP2ED)
         BZ2_bzDecompressEnd(&pfile_in_zip_read_info->bstream);
 #endif
+#ifdef HAVE_LZMA
+    else if (pfile_in_zip_read_info->stream_initialised == Z_LZMAED)
+        lzma_end(&pfile_in_zip_read_info->lstream);
+#endif
 
 
     pfile_in_zip_read_info->stream_initialised = 0;
@@ -2139,6 +2584,153 @@ int ZEXPORT unzSetFlags(unzFile file, unsigned flags)
 }
 
 
+extern int ZEXPORT unzSetInflateBackend(unzFile file, int backend, ZPOS64_T budget)
+{
+    unz64_s* s;
+    if (file == NULL || budget > UNZ_INFLATE_MAX_BUDGET)
+        return UNZ_PARAMERROR;
+    s = (unz64_s*)file;
+    switch (backend)
+    {
+    case UNZ_INFLATE_DEFAULT:
+        s->inflate_backend = UNZ_INFLATE_BUILTIN;
+        break;
+    case UNZ_INFLATE_STREAM:
+    case UNZ_INFLATE_ONESHOT:
+        s->inflate_backend = backend;
+        break;
+    default:
+        return UNZ_PARAMERROR;
+    }
+    s->inflate_budget = budget;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzSetCheckpointCallback(unzFile file, ZPOS64_T span,
+                                           unz_checkpoint_func func, voidpf opaque)
+{
+    unz64_s* s;
+    if (file == NULL)
+        return UNZ_PARAMERROR;
+    s = (unz64_s*)file;
+#ifdef UNZ_HAVE_CHECKPOINTS
+    s->checkpoint_func = func;
+    s->checkpoint_opaque = opaque;
+    s->checkpoint_span = span;
+    return UNZ_OK;
+#else
+    s->checkpoint_func = NULL;
+    return func == NULL ? UNZ_OK : UNZ_PARAMERROR;
+#endif
+}
+
+/*
+  Moves the reading of the compressed data of the current file to
+  compressed_offset, dropping what was read ahead.
+*/
+local void unz64local_restart(unz64_s* s, ZPOS64_T compressed_offset)
+{
+    file_in_zip64_read_info_s* pfile_in_zip_read_info = s->pfile_in_zip_read;
+    ZPOS64_T consumed = s->cur_file_info.compressed_size -
+        pfile_in_zip_read_info->rest_read_compressed;
+    if (pfile_in_zip_read_info->mapped != NULL)
+        pfile_in_zip_read_info->mapped += compressed_offset - consumed;
+    pfile_in_zip_read_info->pos_in_zipfile += compressed_offset - consumed;
+    pfile_in_zip_read_info->rest_read_compressed =
+        s->cur_file_info.compressed_size - compressed_offset;
+    pfile_in_zip_read_info->stream.avail_in = 0;
+}
+
+extern int ZEXPORT unzSeekCurrentFile64(unzFile file, const unz_checkpoint* checkpoint)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    ZPOS64_T uncompressed_offset = 0;
+    ZPOS64_T compressed_offset = 0;
+    int err;
+
+    if (file == NULL)
+        return UNZ_PARAMERROR;
+    s = (unz64_s*)file;
+    pfile_in_zip_read_info = s->pfile_in_zip_read;
+    if ((pfile_in_zip_read_info == NULL) || s->encrypted)
+        return UNZ_PARAMERROR;
+
+    if (pfile_in_zip_read_info->compression_method == 0)
+    {
+        /* stored: every offset is a checkpoint */
+        if (checkpoint != NULL)
+            uncompressed_offset = checkpoint->uncompressed_offset;
+        if (uncompressed_offset > s->cur_file_info.compressed_size)
+            return UNZ_PARAMERROR;
+        unz64local_restart(s, uncompressed_offset);
+        pfile_in_zip_read_info->rest_read_uncompressed =
+            s->cur_file_info.uncompressed_size - uncompressed_offset;
+        pfile_in_zip_read_info->stream.total_out = (uLong)uncompressed_offset;
+        pfile_in_zip_read_info->total_out_64 = uncompressed_offset;
+        pfile_in_zip_read_info->crc32 = 0;
+        pfile_in_zip_read_info->seeked = (uncompressed_offset != 0);
+        return UNZ_OK;
+    }
+
+    if (pfile_in_zip_read_info->stream_initialised != Z_DEFLATED)
+        return UNZ_PARAMERROR;
+    if (checkpoint != NULL)
+    {
+        uncompressed_offset = checkpoint->uncompressed_offset;
+        compressed_offset = checkpoint->compressed_offset;
+        if ((uncompressed_offset > s->cur_file_info.uncompressed_size) ||
+            (compressed_offset > s->cur_file_info.compressed_size) ||
+            (checkpoint->bits < 0) || (checkpoint->bits > 7) ||
+            ((checkpoint->bits > 0) && (compressed_offset == 0)) ||
+            (checkpoint->window_size > UNZ_CHECKPOINT_WINDOW))
+            return UNZ_PARAMERROR;
+    }
+
+    unz64local_restart(s, compressed_offset);
+    pfile_in_zip_read_info->rest_read_uncompressed =
+        s->cur_file_info.uncompressed_size - uncompressed_offset;
+
+    err = inflateReset(&pfile_in_zip_read_info->stream);
+    if ((err == Z_OK) && (checkpoint != NULL) && (checkpoint->bits > 0))
+    {
+        /* the block starts in the middle of the byte before */
+        unsigned char c;
+        if (pfile_in_zip_read_info->mapped != NULL)
+            c = pfile_in_zip_read_info->mapped[-1];
+        else if ((ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                          pfile_in_zip_read_info->filestream,
+                          pfile_in_zip_read_info->pos_in_zipfile - 1 +
+                             pfile_in_zip_read_info->byte_before_the_zipfile,
+                          ZLIB_FILEFUNC_SEEK_SET)!=0) ||
+                 (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                          pfile_in_zip_read_info->filestream, &c, 1)!=1))
+            err = UNZ_ERRNO;
+        if (err == Z_OK)
+            err = inflatePrime(&pfile_in_zip_read_info->stream, checkpoint->bits,
+                               c >> (8 - checkpoint->bits));
+    }
+    if ((err == Z_OK) && (checkpoint != NULL) && (checkpoint->window_size > 0))
+        err = inflateSetDictionary(&pfile_in_zip_read_info->stream,
+                                   checkpoint->window, checkpoint->window_size);
+    if (err != Z_OK)
+    {
+        /* the stream is lost, what follows reads as the end of the file */
+        pfile_in_zip_read_info->mapped = NULL;
+        pfile_in_zip_read_info->rest_read_compressed = 0;
+        pfile_in_zip_read_info->rest_read_uncompressed = 0;
+        pfile_in_zip_read_info->seeked = 1;
+        return err == UNZ_ERRNO ? UNZ_ERRNO : UNZ_INTERNALERROR;
+    }
+
+    pfile_in_zip_read_info->stream.total_out = (uLong)uncompressed_offset;
+    pfile_in_zip_read_info->total_out_64 = uncompressed_offset;
+    pfile_in_zip_read_info->last_checkpoint = uncompressed_offset;
+    pfile_in_zip_read_info->crc32 = 0;
+    pfile_in_zip_read_info->seeked = (uncompressed_offset != 0);
+    return UNZ_OK;
+}
+
 int ZEXPORT unzClearFlags(unzFile file, unsigned flags)
 {
     unz64_s* s;
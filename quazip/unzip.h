@@ -65,6 +65,7 @@ extern "C" {
 #endif
 
 #define Z_BZIP2ED 12
+#define Z_LZMAED 14
 
 #if defined(STRICTUNZIP) || defined(STRICTZIPUNZIP)
 /* like the STRICT of WIN32, we define a pointer that cannot be converted
@@ -86,6 +87,8 @@ typedef voidp unzFile;
 #define UNZ_CRCERROR                    (-105)
 
 #define UNZ_AUTO_CLOSE 0x01u
+/* Memory-map the archive when opening it (only with the default IO API) */
+#define UNZ_MAPPED 0x02u
 #define UNZ_DEFAULT_FLAGS UNZ_AUTO_CLOSE
 
 /* tm_unz contain date/time info */
@@ -342,6 +345,41 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64 OF((unzFile file));
 
 /** Addition for GDAL : END */
 
+extern int ZEXPORT unzGetCentralDirInfo64 OF((unzFile file,
+                                              ZPOS64_T *offset,
+                                              ZPOS64_T *size));
+/*
+  Gets the position of the central directory, as used by unz64_file_pos
+  (the pos_in_zip_directory of the first file), and its size in bytes.
+*/
+
+extern int ZEXPORT unzGetEndOfCentralDirPos64 OF((unzFile file,
+                                                  ZPOS64_T *pos));
+/*
+  Gets the position in the archive file of the end of central directory
+  record (the zip64 one for zip64 archives).
+*/
+
+extern int ZEXPORT unzReadCentralDir64 OF((unzFile file,
+                                           void *buf,
+                                           ZPOS64_T size));
+/*
+  Reads the first size bytes of the central directory into buf in a single
+  read, for callers that decode it by themselves.
+  return UNZ_OK if there is no problem.
+*/
+
+extern const void* ZEXPORT unzGetCurrentFileMapping OF((unzFile file,
+                                                        ZPOS64_T *size));
+/*
+  Returns the data of the current file, in place in the memory mapping of
+  the archive, without decompressing or copying it. The whole data is
+  returned, no matter how much of it has already been read.
+  Only available if the archive was opened with UNZ_MAPPED, the file is
+  stored or opened in raw mode, and it is not encrypted. Returns NULL
+  otherwise. The data remains valid until the archive is closed.
+*/
+
 
 /***************************************************************************/
 /* for reading the content of the current zipfile, you can open it, read data
@@ -389,6 +427,14 @@ extern int ZEXPORT unzOpenCurrentFile3 OF((unzFile file,
          but you CANNOT set method parameter as NULL
 */
 
+extern int ZEXPORT unzIsMethodSupported OF((int method));
+/*
+  Returns 1 if files compressed with method can be decompressed, 0
+  otherwise. 0 (stored) and Z_DEFLATED are always supported; Z_BZIP2ED
+  and Z_LZMAED when built with HAVE_BZIP2 and HAVE_LZMA respectively.
+  Files with any other method can only be opened raw.
+*/
+
 
 extern int ZEXPORT unzCloseCurrentFile OF((unzFile file));
 /*
@@ -451,6 +497,77 @@ extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 extern int ZEXPORT unzSetFlags(unzFile file, unsigned flags);
 extern int ZEXPORT unzClearFlags(unzFile file, unsigned flags);
 
+/*
+  The inflate backends, like the deflate backends of zip.h.
+  UNZ_INFLATE_STREAM decompresses through the zlib stream API, a buffer at
+  a time. UNZ_INFLATE_ONESHOT reads the whole compressed data of a deflated
+  file whose uncompressed size fits the budget on the first read and
+  decompresses it with libdeflate in one call. Without HAVE_LIBDEFLATE,
+  UNZ_INFLATE_ONESHOT streams every file.
+  UNZ_INFLATE_DEFAULT is UNZ_INFLATE_ONESHOT when built with libdeflate,
+  UNZ_INFLATE_STREAM otherwise.
+*/
+#define UNZ_INFLATE_DEFAULT 0
+#define UNZ_INFLATE_STREAM 1
+#define UNZ_INFLATE_ONESHOT 2
+#define UNZ_INFLATE_DEFAULT_BUDGET (16*1024*1024)
+
+extern int ZEXPORT unzSetInflateBackend OF((unzFile file, int backend, ZPOS64_T budget));
+/*
+  Selects the inflate backend of the files opened afterwards. budget is the
+  uncompressed size of the largest file inflated in one shot, up to 1 GiB.
+*/
+
+/*
+  Checkpoints, zran style access points into a deflated file, so that
+  reading can restart in the middle of it. A checkpoint is taken at the end
+  of a deflate block. compressed_offset is the offset of the first byte of
+  the next block in the compressed data, and bits is how many bits of the
+  byte before it belong to that block too (0 to 7). window holds the last
+  window_size bytes (up to UNZ_CHECKPOINT_WINDOW) of uncompressed data
+  before uncompressed_offset, which the next blocks may refer to.
+*/
+#define UNZ_CHECKPOINT_WINDOW 32768
+
+typedef struct unz_checkpoint_s
+{
+    ZPOS64_T uncompressed_offset; /* offset in the uncompressed data */
+    ZPOS64_T compressed_offset;   /* offset in the compressed data */
+    int bits;                     /* bits of the previous byte to use */
+    const unsigned char* window;  /* the data before uncompressed_offset */
+    uInt window_size;             /* the size of window */
+} unz_checkpoint;
+
+typedef void (*unz_checkpoint_func) OF((voidpf opaque,
+                                        const unz_checkpoint* checkpoint));
+
+extern int ZEXPORT unzSetCheckpointCallback OF((unzFile file,
+                                                ZPOS64_T span,
+                                                unz_checkpoint_func func,
+                                                voidpf opaque));
+/*
+  Makes unzReadCurrentFile() call func at the first block boundary at least
+  span bytes of uncompressed data after the previous checkpoint (or the
+  beginning of the file, or the checkpoint unzSeekCurrentFile64() went to),
+  while a deflated file opened afterwards is read. The window is only valid
+  during the call. Deflated files are then never inflated in one shot, and
+  encrypted ones have no checkpoints. Pass a NULL func to stop.
+  return UNZ_PARAMERROR if zlib is too old to give the window (before
+  1.2.7.1).
+*/
+
+extern int ZEXPORT unzSeekCurrentFile64 OF((unzFile file,
+                                            const unz_checkpoint* checkpoint));
+/*
+  Restarts reading the current file, deflated, not encrypted and not opened
+  raw, at checkpoint, or at the beginning of the file if checkpoint is NULL.
+  A stored file, not encrypted, can be restarted anywhere: only the
+  uncompressed_offset of checkpoint is used, whether it is opened raw or not.
+  Once the file was restarted anywhere else than at the beginning, its CRC
+  is not checked by unzCloseCurrentFile() anymore.
+  return UNZ_OK if there is no problem.
+*/
+
 #ifdef __cplusplus
 }
 #endif
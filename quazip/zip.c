@@ -33,11 +33,16 @@
 #include <string.h>
 #include <time.h>
 #include "zlib.h"
-#if (ZLIB_VERNUM < 0x1270)
-typedef uLongf z_crc_t;
-#endif
+#include "quacrc32engine.h"
 #include "zip.h"
 
+#ifdef HAVE_LZMA
+#include "lzma.h"
+#endif
+#ifdef HAVE_LIBDEFLATE
+#include "libdeflate.h"
+#endif
+
 #ifdef STDC
 #  include <stddef.h>
 #  include <string.h>
@@ -63,6 +68,15 @@ typedef uLongf z_crc_t;
 #define Z_BUFSIZE (64*1024) /* (16384) */
 #endif
 
+/* the backend of ZIP_DEFLATE_DEFAULT */
+#ifdef HAVE_LIBDEFLATE
+#define ZIP_DEFLATE_BUILTIN ZIP_DEFLATE_ONESHOT
+#else
+#define ZIP_DEFLATE_BUILTIN ZIP_DEFLATE_STREAM
+#endif
+
+#define ZIP_DEFLATE_MAX_BUDGET (1024*1024*1024)
+
 #ifndef Z_MAXFILENAMEINZIP
 #define Z_MAXFILENAMEINZIP (256)
 #endif
@@ -143,6 +157,9 @@ typedef struct
 #ifdef HAVE_BZIP2
     bz_stream bstream;          /* bzLib stream structure for bziped */
 #endif
+#ifdef HAVE_LZMA
+    lzma_stream lstream;        /* liblzma stream structure for Z_LZMAED */
+#endif
 
     int  stream_initialised;    /* 1 is stream is initialised */
     uInt pos_in_buffered_data;  /* last written byte in buffered_data */
@@ -157,6 +174,15 @@ typedef struct
 
     int  method;                /* compression method of file currenty wr.*/
     int  raw;                   /* 1 for directly writing raw data */
+    int  level;                 /* deflateInit2() parameters, kept for */
+    int  windowBits;            /* one-shot entries which may end up */
+    int  memLevel;              /* being streamed after all */
+    int  strategy;
+    int  oneshot;               /* 1 if the data is deflated at once on close */
+    Byte* oneshot_data;         /* uncompressed data of a one-shot entry */
+    ZPOS64_T oneshot_size;      /* bytes in oneshot_data */
+    ZPOS64_T oneshot_alloc;     /* bytes allocated for oneshot_data */
+    ZPOS64_T size_hint;         /* expected uncompressed size, 0 if unknown */
     Byte buffered_data[Z_BUFSIZE];/* buffer contain compressed data to be writ*/
     uLong dosDate;
     uLong crc32;
@@ -190,6 +216,14 @@ typedef struct
 
     unsigned flags;
 
+    int deflate_backend;        /* ZIP_DEFLATE_STREAM or ZIP_DEFLATE_ONESHOT */
+    ZPOS64_T deflate_budget;    /* largest entry deflated in one shot */
+    ZPOS64_T size_hint;         /* uncompressed size of the next entry, 0 if unknown */
+#ifdef HAVE_LIBDEFLATE
+    struct libdeflate_compressor* compressor; /* kept from entry to entry */
+    int compressor_level;
+#endif
+
 } zip64_internal;
 
 
@@ -356,6 +390,23 @@ local uLong zip64local_TmzDateToDosDate(const tm_zip* ptm)
 
 /****************************************************************************/
 
+/* Decode little-endian fields of a record read in one go */
+#define zip64local_le16(p) ((uLong)(p)[0] | ((uLong)(p)[1]<<8))
+#define zip64local_le32(p) (zip64local_le16(p) | (zip64local_le16((p)+2)<<16))
+#define zip64local_le64(p) ((ZPOS64_T)zip64local_le32(p) | \
+                            ((ZPOS64_T)zip64local_le32((p)+4)<<32))
+
+local int zip64local_readRecord OF((const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, unsigned char *buf, uLong size));
+
+local int zip64local_readRecord(const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, unsigned char *buf, uLong size)
+{
+    if (ZREAD64(*pzlib_filefunc_def,filestream,buf,size)==size)
+        return ZIP_OK;
+    if (ZERROR64(*pzlib_filefunc_def,filestream))
+        return ZIP_ERRNO;
+    return ZIP_EOF;
+}
+
 local int zip64local_getByte OF((const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, int *pi));
 
 local int zip64local_getByte(const zlib_filefunc64_32_def* pzlib_filefunc_def,voidpf filestream,int* pi)
@@ -380,28 +431,6 @@ local int zip64local_getByte(const zlib_filefunc64_32_def* pzlib_filefunc_def,vo
 /* ===========================================================================
    Reads a long in LSB order from the given gz_stream. Sets
 */
-local int zip64local_getShort OF((const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, uLong *pX));
-
-local int zip64local_getShort (const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, uLong* pX)
-{
-    uLong x ;
-    int i = 0;
-    int err;
-
-    err = zip64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x = (uLong)i;
-
-    if (err==ZIP_OK)
-        err = zip64local_getByte(pzlib_filefunc_def,filestream,&i);
-    x += ((uLong)i)<<8;
-
-    if (err==ZIP_OK)
-        *pX = x;
-    else
-        *pX = 0;
-    return err;
-}
-
 local int zip64local_getLong OF((const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, uLong *pX));
 
 local int zip64local_getLong (const zlib_filefunc64_32_def* pzlib_filefunc_def, voidpf filestream, uLong* pX)
@@ -658,7 +687,6 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
   ZPOS64_T size_central_dir;     /* size of the central directory  */
   ZPOS64_T offset_central_dir;   /* offset of start of central directory */
   ZPOS64_T central_pos;
-  uLong uL;
 
   uLong number_disk;          /* number of the current dist, used for
                               spaning ZIP, unsupported, always 0*/
@@ -668,8 +696,6 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
   ZPOS64_T number_entry_CD;      /* total number of entries in
                                 the central dir
                                 (same than number_entry on nospan) */
-  uLong VersionMadeBy;
-  uLong VersionNeeded;
   uLong size_comment;
 
   int hasZIP64Record = 0;
@@ -690,55 +716,43 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
             err=ZIP_ERRNO;
 */
 
+  /* The fixed part of the end of central directory records is read at once */
+  size_central_dir = 0;
+  offset_central_dir = 0;
+  number_entry = 0;
+  number_entry_CD = 0;
+  size_comment = 0;
   if(hasZIP64Record)
   {
-    ZPOS64_T sizeEndOfCentralDirectory;
+    unsigned char record[56];
     if (ZSEEK64(pziinit->z_filefunc, pziinit->filestream, central_pos, ZLIB_FILEFUNC_SEEK_SET) != 0)
       err=ZIP_ERRNO;
-
-    /* the signature, already checked */
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream,&uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* size of zip64 end of central directory record */
-    if (zip64local_getLong64(&pziinit->z_filefunc, pziinit->filestream, &sizeEndOfCentralDirectory)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* version made by */
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream, &VersionMadeBy)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* version needed to extract */
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream, &VersionNeeded)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* number of this disk */
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream,&number_disk)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* number of the disk with the start of the central directory */
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream,&number_disk_with_CD)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* total number of entries in the central directory on this disk */
-    if (zip64local_getLong64(&pziinit->z_filefunc, pziinit->filestream, &number_entry)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* total number of entries in the central directory */
-    if (zip64local_getLong64(&pziinit->z_filefunc, pziinit->filestream,&number_entry_CD)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    if ((number_entry_CD!=number_entry) || (number_disk_with_CD!=0) || (number_disk!=0))
-      err=ZIP_BADZIPFILE;
-
-    /* size of the central directory */
-    if (zip64local_getLong64(&pziinit->z_filefunc, pziinit->filestream,&size_central_dir)!=ZIP_OK)
+    else if (zip64local_readRecord(&pziinit->z_filefunc, pziinit->filestream, record, sizeof(record))!=ZIP_OK)
       err=ZIP_ERRNO;
 
-    /* offset of start of central directory with respect to the
-    starting disk number */
-    if (zip64local_getLong64(&pziinit->z_filefunc, pziinit->filestream,&offset_central_dir)!=ZIP_OK)
-      err=ZIP_ERRNO;
+    if (err==ZIP_OK)
+    {
+      /* the signature (offset 0), already checked, then the size of zip64
+         end of central directory record (4), version made by (12) and
+         version needed to extract (14) are not used */
+      /* number of this disk */
+      number_disk = zip64local_le32(record + 16);
+      /* number of the disk with the start of the central directory */
+      number_disk_with_CD = zip64local_le32(record + 20);
+      /* total number of entries in the central directory on this disk */
+      number_entry = zip64local_le64(record + 24);
+      /* total number of entries in the central directory */
+      number_entry_CD = zip64local_le64(record + 32);
+
+      if ((number_entry_CD!=number_entry) || (number_disk_with_CD!=0) || (number_disk!=0))
+        err=ZIP_BADZIPFILE;
+
+      /* size of the central directory */
+      size_central_dir = zip64local_le64(record + 40);
+      /* offset of start of central directory with respect to the
+      starting disk number */
+      offset_central_dir = zip64local_le64(record + 48);
+    }
 
     /* TODO.. */
     /* read the comment from the standard central header. */
@@ -746,57 +760,35 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
   }
   else
   {
+    unsigned char record[22];
     /* Read End of central Directory info */
     if (ZSEEK64(pziinit->z_filefunc, pziinit->filestream, central_pos,ZLIB_FILEFUNC_SEEK_SET)!=0)
       err=ZIP_ERRNO;
-
-    /* the signature, already checked */
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream,&uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* number of this disk */
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream,&number_disk)!=ZIP_OK)
-      err=ZIP_ERRNO;
-
-    /* number of the disk with the start of the central directory */
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream,&number_disk_with_CD)!=ZIP_OK)
+    else if (zip64local_readRecord(&pziinit->z_filefunc, pziinit->filestream, record, sizeof(record))!=ZIP_OK)
       err=ZIP_ERRNO;
 
-    /* total number of entries in the central dir on this disk */
-    number_entry = 0;
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream, &uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-    else
-      number_entry = uL;
-
-    /* total number of entries in the central dir */
-    number_entry_CD = 0;
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream, &uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-    else
-      number_entry_CD = uL;
-
-    if ((number_entry_CD!=number_entry) || (number_disk_with_CD!=0) || (number_disk!=0))
-      err=ZIP_BADZIPFILE;
-
-    /* size of the central directory */
-    size_central_dir = 0;
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream, &uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-    else
-      size_central_dir = uL;
-
-    /* offset of start of central directory with respect to the starting disk number */
-    offset_central_dir = 0;
-    if (zip64local_getLong(&pziinit->z_filefunc, pziinit->filestream, &uL)!=ZIP_OK)
-      err=ZIP_ERRNO;
-    else
-      offset_central_dir = uL;
-
-
-    /* zipfile global comment length */
-    if (zip64local_getShort(&pziinit->z_filefunc, pziinit->filestream, &size_comment)!=ZIP_OK)
-      err=ZIP_ERRNO;
+    if (err==ZIP_OK)
+    {
+      /* the signature (offset 0), already checked */
+      /* number of this disk */
+      number_disk = zip64local_le16(record + 4);
+      /* number of the disk with the start of the central directory */
+      number_disk_with_CD = zip64local_le16(record + 6);
+      /* total number of entries in the central dir on this disk */
+      number_entry = zip64local_le16(record + 8);
+      /* total number of entries in the central dir */
+      number_entry_CD = zip64local_le16(record + 10);
+
+      if ((number_entry_CD!=number_entry) || (number_disk_with_CD!=0) || (number_disk!=0))
+        err=ZIP_BADZIPFILE;
+
+      /* size of the central directory */
+      size_central_dir = zip64local_le32(record + 12);
+      /* offset of start of central directory with respect to the starting disk number */
+      offset_central_dir = zip64local_le32(record + 16);
+      /* zipfile global comment length */
+      size_comment = zip64local_le16(record + 20);
+    }
   }
 
   if ((central_pos<offset_central_dir+size_central_dir) &&
@@ -873,6 +865,7 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.flags = flags;
     ziinit.z_filefunc.zseek32_file = NULL;
     ziinit.z_filefunc.ztell32_file = NULL;
+    ziinit.z_filefunc.zmap_file = NULL;
     if (pzlib_filefunc64_32_def==NULL)
         fill_qiodevice64_filefunc(&ziinit.z_filefunc.zfile_func64);
     else
@@ -893,6 +886,15 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.begin_pos = ZTELL64(ziinit.z_filefunc,ziinit.filestream);
     ziinit.in_opened_file_inzip = 0;
     ziinit.ci.stream_initialised = 0;
+    ziinit.ci.oneshot = 0;
+    ziinit.ci.oneshot_data = NULL;
+    ziinit.deflate_backend = ZIP_DEFLATE_BUILTIN;
+    ziinit.deflate_budget = ZIP_DEFLATE_DEFAULT_BUDGET;
+    ziinit.size_hint = 0;
+#ifdef HAVE_LIBDEFLATE
+    ziinit.compressor = NULL;
+    ziinit.compressor_level = 0;
+#endif
     ziinit.number_entry = 0;
     ziinit.add_position_when_writting_offset = 0;
     init_linkedlist(&(ziinit.central_dir));
@@ -960,6 +962,7 @@ extern zipFile ZEXPORT zipOpen2_64 (voidpf file, int append, zipcharpc* globalco
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        zlib_filefunc64_32_def_fill.zmap_file = NULL;
         return zipOpen3(file, append, globalcomment, &zlib_filefunc64_32_def_fill, ZIP_DEFAULT_FLAGS);
     }
     else
@@ -1070,6 +1073,54 @@ int Write_LocalFileHeader(zip64_internal* zi, const char* filename,
   return err;
 }
 
+extern int ZEXPORT zipIsMethodSupported (int method)
+{
+    switch (method)
+    {
+    case 0:
+    case Z_DEFLATED:
+#ifdef HAVE_BZIP2
+    case Z_BZIP2ED:
+#endif
+#ifdef HAVE_LZMA
+    case Z_LZMAED:
+#endif
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Whether the current entry, deflated with windowBits and strategy, can be
+   deflated in one shot. Only with libdeflate: buffering the data for a
+   single zlib deflate() call would cost memory for nothing. */
+local int zip64local_canDeflateOneShot(const zip64_internal* zi, int windowBits, int strategy)
+{
+    if (zi->deflate_backend != ZIP_DEFLATE_ONESHOT || zi->deflate_budget == 0)
+        return 0;
+    if (zi->size_hint > zi->deflate_budget)
+        return 0;
+#ifdef HAVE_LIBDEFLATE
+    /* libdeflate always uses a 32K window and its own strategy */
+    if (windowBits != -MAX_WBITS || strategy != Z_DEFAULT_STRATEGY)
+        return 0;
+    return 1;
+#else
+    (void)windowBits;
+    (void)strategy;
+    return 0;
+#endif
+}
+
+local int zip64local_startDeflate(zip64_internal* zi)
+{
+    int err = deflateInit2(&zi->ci.stream, zi->ci.level, Z_DEFLATED,
+                           zi->ci.windowBits, zi->ci.memLevel, zi->ci.strategy);
+    if (err==Z_OK)
+        zi->ci.stream_initialised = Z_DEFLATED;
+    return err;
+}
+
 /*
  NOTE.
  When writing RAW the ZIP64 extended information in extrafield_local and extrafield_global needs to be stripped
@@ -1101,13 +1152,8 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     if (file == NULL)
         return ZIP_PARAMERROR;
 
-#ifdef HAVE_BZIP2
-    if ((method!=0) && (method!=Z_DEFLATED) && (method!=Z_BZIP2ED))
-      return ZIP_PARAMERROR;
-#else
-    if ((method!=0) && (method!=Z_DEFLATED))
+    if (!raw && !zipIsMethodSupported(method))
       return ZIP_PARAMERROR;
-#endif
 
     zi = (zip64_internal*)file;
 
@@ -1124,6 +1170,14 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     {
         version_to_extract = 10;
     }
+    else if (method == Z_BZIP2ED)
+    {
+        version_to_extract = 46;
+    }
+    else if (method == Z_LZMAED)
+    {
+        version_to_extract = 63;
+    }
     else
     {
         version_to_extract = 20;
@@ -1150,12 +1204,20 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     }
 
     zi->ci.flag = flagBase;
-    if ((level==8) || (level==9))
+    if (method == Z_LZMAED)
+    {
+      /* the end of the stream is marked */
       zi->ci.flag |= 2;
-    if (level==2)
-      zi->ci.flag |= 4;
-    if (level==1)
-      zi->ci.flag |= 6;
+    }
+    else
+    {
+      if ((level==8) || (level==9))
+        zi->ci.flag |= 2;
+      if (level==2)
+        zi->ci.flag |= 4;
+      if (level==1)
+        zi->ci.flag |= 6;
+    }
     if (password != NULL)
       zi->ci.flag |= 1;
     if (version_to_extract >= 20
@@ -1169,6 +1231,12 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     zi->ci.stream_initialised = 0;
     zi->ci.pos_in_buffered_data = 0;
     zi->ci.raw = raw;
+    zi->ci.oneshot = 0;
+    zi->ci.oneshot_data = NULL;
+    zi->ci.oneshot_size = 0;
+    zi->ci.oneshot_alloc = 0;
+    zi->ci.size_hint = zi->size_hint;
+    zi->size_hint = 0;
     zi->ci.pos_local_header = ZTELL64(zi->z_filefunc,zi->filestream);
 
     zi->ci.size_centralheader = SIZECENTRALHEADER + size_filename + size_extrafield_global + size_comment;
@@ -1263,10 +1331,16 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
           if (windowBits>0)
               windowBits = -windowBits;
 
-          err = deflateInit2(&zi->ci.stream, level, Z_DEFLATED, windowBits, memLevel, strategy);
+          zi->ci.level = level;
+          zi->ci.windowBits = windowBits;
+          zi->ci.memLevel = memLevel;
+          zi->ci.strategy = strategy;
 
-          if (err==Z_OK)
-              zi->ci.stream_initialised = Z_DEFLATED;
+          /* a one-shot entry is buffered, see zipWriteInFileInZip() */
+          if (zip64local_canDeflateOneShot(zi, windowBits, strategy))
+              zi->ci.oneshot = 1;
+          else
+              err = zip64local_startDeflate(zi);
         }
         else if(zi->ci.method == Z_BZIP2ED)
         {
@@ -1276,13 +1350,47 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
           zi->ci.bstream.bzfree = 0;
           zi->ci.bstream.opaque = (voidpf)0;
 
-          err = BZ2_bzCompressInit(&zi->ci.bstream, level, 0,35);
+          /* the block size, in units of 100k, goes from 1 to 9 */
+          err = BZ2_bzCompressInit(&zi->ci.bstream,
+                                   level < 0 ? 9 : (level == 0 ? 1 : level), 0,35);
           if(err == BZ_OK)
             zi->ci.stream_initialised = Z_BZIP2ED;
 #endif
         }
 
     }
+#ifdef HAVE_LZMA
+    else if ((err==ZIP_OK) && (zi->ci.method == Z_LZMAED) && (!zi->ci.raw))
+    {
+        /* A raw LZMA1 stream, preceded by the header of the ZIP
+           specification: the version of the library, the size of the
+           properties and the properties themselves. */
+        lzma_stream init = LZMA_STREAM_INIT;
+        lzma_options_lzma options;
+        lzma_filter filters[2];
+        unsigned char* header = zi->ci.buffered_data;
+        if (lzma_lzma_preset(&options, level < 0 ? LZMA_PRESET_DEFAULT : (uint32_t)level))
+            err = ZIP_PARAMERROR;
+        filters[0].id = LZMA_FILTER_LZMA1;
+        filters[0].options = &options;
+        filters[1].id = LZMA_VLI_UNKNOWN;
+        filters[1].options = NULL;
+        if (err == ZIP_OK && lzma_properties_encode(&filters[0], header + 4) != LZMA_OK)
+            err = ZIP_INTERNALERROR;
+        zi->ci.lstream = init;
+        if (err == ZIP_OK && lzma_raw_encoder(&zi->ci.lstream, filters) != LZMA_OK)
+            err = ZIP_INTERNALERROR;
+        if (err == ZIP_OK)
+        {
+            header[0] = LZMA_VERSION_MAJOR;
+            header[1] = LZMA_VERSION_MINOR;
+            header[2] = 5;
+            header[3] = 0;
+            zi->ci.pos_in_buffered_data = 9;
+            zi->ci.stream_initialised = Z_LZMAED;
+        }
+    }
+#endif
 
 #    ifndef NOCRYPT
     zi->ci.crypt_header_size = 0;
@@ -1291,7 +1399,7 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
         unsigned char bufHead[RAND_HEAD_LEN];
         unsigned int sizeHead;
         zi->ci.encrypt = 1;
-        zi->ci.pcrc_32_tab = get_crc_table();
+        zi->ci.pcrc_32_tab = quacrc32_table();
         /*init_keys(password,zi->ci.keys,zi->ci.pcrc_32_tab);*/
         if (crcForCrypting == 0) {
             crcForCrypting = (uLong)zi->ci.dosDate << 16; /* ATTANTION! Without this row, you don't unpack your password protected archive in other app. */
@@ -1446,20 +1554,36 @@ local int zip64FlushWriteBuffer(zip64_internal* zi)
     return err;
 }
 
-extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned int len)
+/* Compresses (or copies, in raw mode) len bytes of buf into the entry. */
+local int zip64local_writeData(zip64_internal* zi, const void* buf, unsigned int len)
 {
-    zip64_internal* zi;
     int err=ZIP_OK;
 
-    if (file == NULL)
-        return ZIP_PARAMERROR;
-    zi = (zip64_internal*)file;
-
-    if (zi->in_opened_file_inzip == 0)
-        return ZIP_PARAMERROR;
-
-    zi->ci.crc32 = crc32(zi->ci.crc32,buf,(uInt)len);
-
+#ifdef HAVE_LZMA
+    if(zi->ci.method == Z_LZMAED && (!zi->ci.raw))
+    {
+      zi->ci.lstream.next_in = (const uint8_t*)buf;
+      zi->ci.lstream.avail_in = len;
+      while ((err==ZIP_OK) && (zi->ci.lstream.avail_in>0))
+      {
+        if (zi->ci.pos_in_buffered_data == Z_BUFSIZE)
+        {
+          if (zip64FlushWriteBuffer(zi) == ZIP_ERRNO)
+          {
+            err = ZIP_ERRNO;
+            break;
+          }
+        }
+        zi->ci.lstream.next_out = zi->ci.buffered_data + zi->ci.pos_in_buffered_data;
+        zi->ci.lstream.avail_out = Z_BUFSIZE - zi->ci.pos_in_buffered_data;
+        if (lzma_code(&zi->ci.lstream, LZMA_RUN) != LZMA_OK)
+          err = ZIP_INTERNALERROR;
+        zi->ci.pos_in_buffered_data = Z_BUFSIZE - (uInt)zi->ci.lstream.avail_out;
+      }
+      zi->ci.totalUncompressedData += len;
+    }
+    else
+#endif
 #ifdef HAVE_BZIP2
     if(zi->ci.method == Z_BZIP2ED && (!zi->ci.raw))
     {
@@ -1547,6 +1671,149 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
     return err;
 }
 
+/* Appends len bytes of buf to the data of a one-shot entry. Returns 0 if
+   they do not fit the budget or the memory cannot be allocated. */
+local int zip64local_bufferOneShot(zip64_internal* zi, const void* buf, unsigned int len)
+{
+    ZPOS64_T needed = zi->ci.oneshot_size + len;
+    if (needed > zi->deflate_budget)
+        return 0;
+    if (needed > zi->ci.oneshot_alloc)
+    {
+        ZPOS64_T alloc = zi->ci.oneshot_alloc * 2;
+        Byte* data;
+        if (alloc < zi->ci.size_hint)
+            alloc = zi->ci.size_hint;
+        if (alloc < Z_BUFSIZE)
+            alloc = Z_BUFSIZE;
+        if (alloc < needed)
+            alloc = needed;
+        if (alloc > zi->deflate_budget)
+            alloc = zi->deflate_budget;
+        data = (Byte*)realloc(zi->ci.oneshot_data, (size_t)alloc);
+        if (data == NULL)
+            return 0;
+        zi->ci.oneshot_data = data;
+        zi->ci.oneshot_alloc = alloc;
+    }
+    if (len > 0)
+        memcpy(zi->ci.oneshot_data + zi->ci.oneshot_size, buf, len);
+    zi->ci.oneshot_size = needed;
+    return 1;
+}
+
+/* Gives up deflating the current entry in one shot: the data buffered so
+   far is streamed, like what follows. */
+local int zip64local_streamOneShot(zip64_internal* zi)
+{
+    int err;
+    zi->ci.oneshot = 0;
+    err = zip64local_startDeflate(zi);
+    if ((err==Z_OK) && (zi->ci.oneshot_size > 0))
+        err = zip64local_writeData(zi, zi->ci.oneshot_data, (unsigned int)zi->ci.oneshot_size);
+    TRYFREE(zi->ci.oneshot_data);
+    zi->ci.oneshot_data = NULL;
+    zi->ci.oneshot_size = 0;
+    zi->ci.oneshot_alloc = 0;
+    return err;
+}
+
+/* Deflates the data of a one-shot entry on close. If libdeflate runs out of
+   memory, the whole data is handed to the zlib stream at once and
+   zi->ci.oneshot is cleared: the caller finishes the stream. */
+local int zip64local_deflateOneShot(zip64_internal* zi)
+{
+    int err = ZIP_OK;
+#ifdef HAVE_LIBDEFLATE
+    static const Byte empty = 0;
+    int level = zi->ci.level < 0 ? 6 : zi->ci.level;
+    const void* in = zi->ci.oneshot_data != NULL ? (const void*)zi->ci.oneshot_data : (const void*)&empty;
+    size_t bound = 0, size;
+    Byte* out;
+    if ((zi->compressor != NULL) && (zi->compressor_level != level))
+    {
+        libdeflate_free_compressor(zi->compressor);
+        zi->compressor = NULL;
+    }
+    if (zi->compressor == NULL)
+    {
+        zi->compressor = libdeflate_alloc_compressor(level);
+        zi->compressor_level = level;
+    }
+    out = NULL;
+    if (zi->compressor != NULL)
+    {
+        bound = libdeflate_deflate_compress_bound(zi->compressor, (size_t)zi->ci.oneshot_size);
+        out = (Byte*)ALLOC(bound);
+    }
+    if (out != NULL)
+    {
+        size = libdeflate_deflate_compress(zi->compressor, in, (size_t)zi->ci.oneshot_size, out, bound);
+        if (size == 0)
+            err = ZIP_INTERNALERROR;
+        else if (zi->ci.encrypt == 0)
+        {
+            if (ZWRITE64(zi->z_filefunc,zi->filestream,out,(uLong)size) != size)
+                err = ZIP_ERRNO;
+            zi->ci.totalCompressedData += size;
+        }
+        else
+        {
+            /* through the buffer, where the data is encrypted */
+            size_t pos = 0;
+            while ((err==ZIP_OK) && (pos < size))
+            {
+                uInt copy_this = Z_BUFSIZE - zi->ci.pos_in_buffered_data;
+                if (copy_this > size - pos)
+                    copy_this = (uInt)(size - pos);
+                memcpy(zi->ci.buffered_data + zi->ci.pos_in_buffered_data, out + pos, copy_this);
+                zi->ci.pos_in_buffered_data += copy_this;
+                pos += copy_this;
+                if ((zi->ci.pos_in_buffered_data == Z_BUFSIZE) && (zip64FlushWriteBuffer(zi) == ZIP_ERRNO))
+                    err = ZIP_ERRNO;
+            }
+        }
+        zi->ci.totalUncompressedData += zi->ci.oneshot_size;
+        free(out);
+        return err;
+    }
+#endif
+    zi->ci.oneshot = 0;
+    err = zip64local_startDeflate(zi);
+    zi->ci.stream.next_in = zi->ci.oneshot_data;
+    zi->ci.stream.avail_in = (uInt)zi->ci.oneshot_size;
+    return err;
+}
+
+extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned int len)
+{
+    zip64_internal* zi;
+
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+
+    if (zi->in_opened_file_inzip == 0)
+        return ZIP_PARAMERROR;
+
+    /* in raw mode, the CRC is given to zipCloseFileInZipRaw64 */
+    if (!zi->ci.raw)
+        zi->ci.crc32 = quacrc32(zi->ci.crc32,buf,(uInt)len);
+
+    if (zi->ci.oneshot)
+    {
+        int err;
+        if (zip64local_bufferOneShot(zi, buf, len))
+            return ZIP_OK;
+        /* over the budget, the entry is streamed after all */
+        err = zip64local_streamOneShot(zi);
+        if (err != ZIP_OK)
+            return err;
+    }
+
+    return zip64local_writeData(zi, buf, len);
+}
+
 extern int ZEXPORT zipCloseFileInZipRaw (zipFile file, uLong uncompressed_size, uLong crc32)
 {
     return zipCloseFileInZipRaw64 (file, uncompressed_size, crc32);
@@ -1568,7 +1835,10 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
         return ZIP_PARAMERROR;
     zi->ci.stream.avail_in = 0;
 
-    if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw))
+    if (zi->ci.oneshot)
+        err = zip64local_deflateOneShot(zi);
+
+    if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw) && (!zi->ci.oneshot))
                 {
                         while (err==ZIP_OK)
                         {
@@ -1611,6 +1881,30 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
         err = ZIP_OK;
 #endif
     }
+#ifdef HAVE_LZMA
+    else if ((zi->ci.method == Z_LZMAED) && (!zi->ci.raw))
+    {
+      lzma_ret ret = LZMA_OK;
+      zi->ci.lstream.avail_in = 0;
+      while ((err==ZIP_OK) && (ret != LZMA_STREAM_END))
+      {
+        if (zi->ci.pos_in_buffered_data == Z_BUFSIZE)
+        {
+          if (zip64FlushWriteBuffer(zi) == ZIP_ERRNO)
+          {
+            err = ZIP_ERRNO;
+            break;
+          }
+        }
+        zi->ci.lstream.next_out = zi->ci.buffered_data + zi->ci.pos_in_buffered_data;
+        zi->ci.lstream.avail_out = Z_BUFSIZE - zi->ci.pos_in_buffered_data;
+        ret = lzma_code(&zi->ci.lstream, LZMA_FINISH);
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END)
+          err = ZIP_INTERNALERROR;
+        zi->ci.pos_in_buffered_data = Z_BUFSIZE - (uInt)zi->ci.lstream.avail_out;
+      }
+    }
+#endif
 
     if (err==Z_STREAM_END)
         err=ZIP_OK; /* this is normal */
@@ -1621,7 +1915,8 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
             err = ZIP_ERRNO;
                 }
 
-    if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw))
+    if ((zi->ci.method == Z_DEFLATED) && (!zi->ci.raw)
+            && (zi->ci.stream_initialised == Z_DEFLATED))
     {
         int tmp_err = deflateEnd(&zi->ci.stream);
         if (err == ZIP_OK)
@@ -1637,6 +1932,17 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
                         zi->ci.stream_initialised = 0;
     }
 #endif
+#ifdef HAVE_LZMA
+    else if((zi->ci.method == Z_LZMAED) && (!zi->ci.raw))
+    {
+      lzma_end(&zi->ci.lstream);
+      zi->ci.stream_initialised = 0;
+    }
+#endif
+
+    TRYFREE(zi->ci.oneshot_data);
+    zi->ci.oneshot_data = NULL;
+    zi->ci.oneshot = 0;
 
     if (!zi->ci.raw)
     {
@@ -2011,6 +2317,10 @@ extern int ZEXPORT zipClose (zipFile file, const char* global_comment)
 
 #ifndef NO_ADDFILEINEXISTINGZIP
     TRYFREE(zi->globalcomment);
+#endif
+#ifdef HAVE_LIBDEFLATE
+    if (zi->compressor != NULL)
+        libdeflate_free_compressor(zi->compressor);
 #endif
     TRYFREE(zi);
 
@@ -2105,3 +2415,69 @@ int ZEXPORT zipClearFlags(zipFile file, unsigned flags)
     }
     return ZIP_OK;
 }
+
+extern int ZEXPORT zipSetDeflateBackend(zipFile file, int backend, ZPOS64_T budget)
+{
+    zip64_internal* zi;
+    if (file == NULL || budget > ZIP_DEFLATE_MAX_BUDGET)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+    switch (backend)
+    {
+    case ZIP_DEFLATE_DEFAULT:
+        zi->deflate_backend = ZIP_DEFLATE_BUILTIN;
+        break;
+    case ZIP_DEFLATE_STREAM:
+    case ZIP_DEFLATE_ONESHOT:
+        zi->deflate_backend = backend;
+        break;
+    default:
+        return ZIP_PARAMERROR;
+    }
+    zi->deflate_budget = budget;
+    return ZIP_OK;
+}
+
+extern int ZEXPORT zipSetSizeHint(zipFile file, ZPOS64_T size)
+{
+    zip64_internal* zi;
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+    zi->size_hint = size;
+    return ZIP_OK;
+}
+
+#ifndef NO_ADDFILEINEXISTINGZIP
+extern int ZEXPORT zipResetCentralDir(zipFile file, ZPOS64_T pos)
+{
+    zip64_internal* zi;
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+    if (zi->in_opened_file_inzip == 1)
+        return ZIP_PARAMERROR;
+    free_linkedlist(&(zi->central_dir));
+    zi->number_entry = 0;
+    if (ZSEEK64(zi->z_filefunc, zi->filestream,
+                pos + zi->add_position_when_writting_offset,
+                ZLIB_FILEFUNC_SEEK_SET) != 0)
+        return ZIP_ERRNO;
+    return ZIP_OK;
+}
+
+extern int ZEXPORT zipAddCentralDirRecord(zipFile file, const void* record, uLong size)
+{
+    zip64_internal* zi;
+    int err;
+    if (file == NULL || record == NULL || size < SIZECENTRALHEADER)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+    if (zi->in_opened_file_inzip == 1)
+        return ZIP_PARAMERROR;
+    err = add_data_in_datablock(&zi->central_dir, record, size);
+    if (err == ZIP_OK)
+        zi->number_entry++;
+    return err;
+}
+#endif
@@ -65,6 +65,7 @@ extern "C" {
 #endif
 
 #define Z_BZIP2ED 12
+#define Z_LZMAED 14
 
 #if defined(STRICTZIP) || defined(STRICTZIPUNZIP)
 /* like the STRICT of WIN32, we define a pointer that cannot be converted
@@ -325,6 +326,14 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 OF((zipFile file,
     flag : value for flag field (compression level info will be added)
  */
 
+extern int ZEXPORT zipIsMethodSupported OF((int method));
+/*
+  Returns 1 if files can be compressed with method, 0 otherwise. 0 (stored)
+  and Z_DEFLATED are always supported; Z_BZIP2ED and Z_LZMAED when built
+  with HAVE_BZIP2 and HAVE_LZMA respectively.
+  Files with any other method can only be written raw.
+ */
+
 
 extern int ZEXPORT zipWriteInFileInZip OF((zipFile file,
                        const void* buf,
@@ -383,6 +392,62 @@ extern int ZEXPORT zipRemoveExtraInfoBlock OF((char* pData, int* dataLen, short
 extern int ZEXPORT zipSetFlags(zipFile file, unsigned flags);
 extern int ZEXPORT zipClearFlags(zipFile file, unsigned flags);
 
+/*
+  The deflate backends.
+  ZIP_DEFLATE_STREAM compresses through the zlib stream API, Z_BUFSIZE
+  bytes at a time. Linking zlib-ng built in zlib compatible mode instead of
+  zlib only changes the library behind that API.
+  ZIP_DEFLATE_ONESHOT keeps the data of each deflated entry in memory, up to
+  a budget, and compresses it with libdeflate in one call when the entry is
+  closed. An entry outgrowing the budget is streamed after all. Without
+  HAVE_LIBDEFLATE, ZIP_DEFLATE_ONESHOT streams every entry.
+  ZIP_DEFLATE_DEFAULT is ZIP_DEFLATE_ONESHOT when built with libdeflate,
+  ZIP_DEFLATE_STREAM otherwise.
+  The output is standard deflate in every case.
+*/
+#define ZIP_DEFLATE_DEFAULT 0
+#define ZIP_DEFLATE_STREAM 1
+#define ZIP_DEFLATE_ONESHOT 2
+#define ZIP_DEFLATE_DEFAULT_BUDGET (16*1024*1024)
+
+extern int ZEXPORT zipSetDeflateBackend OF((zipFile file, int backend, ZPOS64_T budget));
+/*
+  Selects the deflate backend of the entries opened afterwards. budget is
+  the size of the largest entry deflated in one shot, up to 1 GiB.
+  With libdeflate, entries with a windowBits other than -MAX_WBITS or a
+  strategy other than Z_DEFAULT_STRATEGY are always streamed.
+*/
+
+extern int ZEXPORT zipSetSizeHint OF((zipFile file, ZPOS64_T size));
+/*
+  Gives the uncompressed size of the next entry opened, 0 if unknown.
+  With ZIP_DEFLATE_ONESHOT, an entry larger than the budget is streamed from
+  the start, and the memory for a smaller one is allocated at once.
+  The data written may still differ from the hint.
+*/
+
+#ifndef NO_ADDFILEINEXISTINGZIP
+extern int ZEXPORT zipResetCentralDir OF((zipFile file, ZPOS64_T pos));
+/*
+  For an archive opened with APPEND_STATUS_ADDINZIP, before any file is
+  added: forgets the central directory read from the archive, so that it
+  can be rebuilt with zipAddCentralDirRecord(), and moves the write position
+  to pos. pos is relative to the beginning of the zip data, like the local
+  header offsets. The files added afterwards are written from pos on, then
+  the central directory.
+  The caller is responsible for the data left after the new end of the
+  archive, if any.
+*/
+
+extern int ZEXPORT zipAddCentralDirRecord OF((zipFile file,
+                                              const void* record,
+                                              uLong size));
+/*
+  Appends a central directory file header (signature included) for a file
+  already stored in the archive. The record is copied as is.
+*/
+#endif
+
 #ifdef __cplusplus
 }
 #endif
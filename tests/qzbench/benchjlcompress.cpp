@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "benchjlcompress.h"
+
+#include "qzbench.h"
+
+#include <quazip/JlCompress.h>
+
+#include <QDir>
+#include <QFile>
+
+#include <QtTest/QtTest>
+
+static const char benchDir[] = "benchtmp/jlcompress";
+
+// Creates the corpus of the current row, unless an earlier function did.
+static QString corpusDir(int fileCount, qint64 fileSize, int content)
+{
+    QString dir = QDir(benchDir).filePath(
+            QString("%1-corpus").arg(QTest::currentDataTag()));
+    if (!QDir(dir).exists()
+            && !createCorpus(dir, fileCount, fileSize,
+                             static_cast<CorpusContent>(content))) {
+        removeBenchDir(dir);
+        return QString();
+    }
+    return dir;
+}
+
+static QString archiveName()
+{
+    return QDir(benchDir).filePath(
+            QString("%1.zip").arg(QTest::currentDataTag()));
+}
+
+void BenchJlCompress::initTestCase()
+{
+    removeBenchDir(benchDir);
+    QVERIFY(QDir().mkpath(benchDir));
+}
+
+void BenchJlCompress::cleanupTestCase()
+{
+    removeBenchDir(benchDir);
+}
+
+void BenchJlCompress::compressDir_data()
+{
+    QTest::addColumn<int>("fileCount");
+    QTest::addColumn<qint64>("fileSize");
+    QTest::addColumn<int>("content");
+    // many tiny files stress the per-entry overhead, a few huge ones the
+    // compressor itself
+    int tinyCount = quickBench() ? 500 : 10000;
+    int hugeCount = quickBench() ? 2 : 3;
+    qint64 hugeSize = quickBench() ? 4 * 1024 * 1024 : 64 * 1024 * 1024;
+    QTest::newRow("tiny-compressible") << tinyCount << qint64(512)
+                                       << static_cast<int>(ccCompressible);
+    QTest::newRow("tiny-incompressible") << tinyCount << qint64(512)
+                                         << static_cast<int>(ccIncompressible);
+    QTest::newRow("huge-compressible") << hugeCount << hugeSize
+                                       << static_cast<int>(ccCompressible);
+    QTest::newRow("huge-incompressible") << hugeCount << hugeSize
+                                         << static_cast<int>(ccIncompressible);
+}
+
+void BenchJlCompress::compressDir()
+{
+    QFETCH(int, fileCount);
+    QFETCH(qint64, fileSize);
+    QFETCH(int, content);
+    QString dir = corpusDir(fileCount, fileSize, content);
+    QVERIFY(!dir.isEmpty());
+    QString zipName = archiveName();
+    setBenchmarkWork(fileCount * fileSize, "bytes");
+    QBENCHMARK {
+        QVERIFY(JlCompress::compressDir(zipName, dir));
+    }
+}
+
+void BenchJlCompress::extractDir_data()
+{
+    compressDir_data();
+}
+
+void BenchJlCompress::extractDir()
+{
+    QFETCH(int, fileCount);
+    QFETCH(qint64, fileSize);
+    QFETCH(int, content);
+    QString zipName = archiveName();
+    if (!QFile::exists(zipName)) {
+        QString dir = corpusDir(fileCount, fileSize, content);
+        QVERIFY(!dir.isEmpty());
+        QVERIFY(JlCompress::compressDir(zipName, dir));
+    }
+    QString outDir = QDir(benchDir).filePath(
+            QString("%1-extracted").arg(QTest::currentDataTag()));
+    setBenchmarkWork(fileCount * fileSize, "bytes");
+    QBENCHMARK {
+        QVERIFY(!JlCompress::extractDir(zipName, outDir).isEmpty());
+    }
+    removeBenchDir(outDir);
+}
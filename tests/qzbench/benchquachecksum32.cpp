@@ -0,0 +1,139 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "benchquachecksum32.h"
+
+#include "qzbench.h"
+
+#include <quazip/quaadler32.h>
+#include <quazip/quaadler32engine.h>
+#include <quazip/quacrc32.h>
+#include <quazip/quacrc32engine.h>
+
+#include <QByteArray>
+
+#include <QtTest/QtTest>
+
+// small buffers measure the call overhead, large ones the inner loop
+static void checksumData()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("64B") << 64;
+    QTest::newRow("4KiB") << 4 * 1024;
+    QTest::newRow("1MiB") << 1024 * 1024;
+    QTest::newRow("16MiB") << 16 * 1024 * 1024;
+}
+
+void BenchQuaChecksum32::crc32_data()
+{
+    checksumData();
+}
+
+void BenchQuaChecksum32::crc32()
+{
+    QFETCH(int, size);
+    QByteArray data = corpusData(ccIncompressible, size);
+    QuaCrc32 crc32;
+    setBenchmarkWork(size, "bytes");
+    QBENCHMARK {
+        crc32.update(data);
+    }
+    QVERIFY(crc32.value() != 0);
+}
+
+void BenchQuaChecksum32::crc32Engine_data()
+{
+    QTest::addColumn<int>("impl");
+    QTest::newRow("portable") << QUACRC32_PORTABLE;
+    QTest::newRow("pclmul") << QUACRC32_PCLMUL;
+    QTest::newRow("armv8") << QUACRC32_ARMV8;
+    QTest::newRow("zlib") << -1;
+}
+
+// each implementation on its own, against zlib's crc32()
+void BenchQuaChecksum32::crc32Engine()
+{
+    QFETCH(int, impl);
+    if (impl >= 0 && !quacrc32_available(impl))
+        QSKIP("This CRC-32 implementation is not available here");
+    const int size = 16 * 1024 * 1024;
+    QByteArray data = corpusData(ccIncompressible, size);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    uLong crc = 0;
+    setBenchmarkWork(size, "bytes");
+    QBENCHMARK {
+        if (impl >= 0)
+            crc = quacrc32_using(impl, crc, bytes, size);
+        else
+            crc = ::crc32(crc, bytes, size);
+    }
+    QVERIFY(crc != 0);
+}
+
+void BenchQuaChecksum32::adler32_data()
+{
+    checksumData();
+}
+
+void BenchQuaChecksum32::adler32()
+{
+    QFETCH(int, size);
+    QByteArray data = corpusData(ccIncompressible, size);
+    QuaAdler32 adler32;
+    setBenchmarkWork(size, "bytes");
+    QBENCHMARK {
+        adler32.update(data);
+    }
+    QVERIFY(adler32.value() != 0);
+}
+
+void BenchQuaChecksum32::adler32Engine_data()
+{
+    QTest::addColumn<int>("impl");
+    QTest::newRow("portable") << QUAADLER32_PORTABLE;
+    QTest::newRow("ssse3") << QUAADLER32_SSSE3;
+    QTest::newRow("avx2") << QUAADLER32_AVX2;
+    QTest::newRow("neon") << QUAADLER32_NEON;
+    QTest::newRow("zlib") << -1;
+}
+
+// each implementation on its own, against zlib's adler32()
+void BenchQuaChecksum32::adler32Engine()
+{
+    QFETCH(int, impl);
+    if (impl >= 0 && !quaadler32_available(impl))
+        QSKIP("This Adler-32 implementation is not available here");
+    const int size = 16 * 1024 * 1024;
+    QByteArray data = corpusData(ccIncompressible, size);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    uLong adler = 1;
+    setBenchmarkWork(size, "bytes");
+    QBENCHMARK {
+        if (impl >= 0)
+            adler = quaadler32_using(impl, adler, bytes, size);
+        else
+            adler = ::adler32(adler, bytes, size);
+    }
+    QVERIFY(adler != 1);
+}
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "benchquagzipfile.h"
+
+#include "qzbench.h"
+
+#include <quazip/quagzipfile.h>
+
+#include <QByteArray>
+#include <QDir>
+
+#include <QtTest/QtTest>
+
+static const char benchDir[] = "benchtmp/quagzipfile";
+
+static QByteArray gzipData(int content)
+{
+    qint64 size = quickBench() ? 4 * 1024 * 1024 : 32 * 1024 * 1024;
+    return corpusData(static_cast<CorpusContent>(content), size);
+}
+
+static QString gzipName()
+{
+    return QDir(benchDir).filePath(
+            QString("%1.gz").arg(QTest::currentDataTag()));
+}
+
+void BenchQuaGzipFile::initTestCase()
+{
+    removeBenchDir(benchDir);
+    QVERIFY(QDir().mkpath(benchDir));
+}
+
+void BenchQuaGzipFile::cleanupTestCase()
+{
+    removeBenchDir(benchDir);
+}
+
+void BenchQuaGzipFile::write_data()
+{
+    QTest::addColumn<int>("content");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("format");
+    QTest::newRow("compressible") << static_cast<int>(ccCompressible) << 1
+        << static_cast<int>(QuaGzipFile::SingleMember);
+    QTest::newRow("incompressible") << static_cast<int>(ccIncompressible)
+        << 1 << static_cast<int>(QuaGzipFile::SingleMember);
+    // 0 threads is one per core
+    QTest::newRow("compressible-mt") << static_cast<int>(ccCompressible)
+        << 0 << static_cast<int>(QuaGzipFile::SingleMember);
+    QTest::newRow("compressible-bgzf-mt") << static_cast<int>(ccCompressible)
+        << 0 << static_cast<int>(QuaGzipFile::BgzfMembers);
+}
+
+void BenchQuaGzipFile::write()
+{
+    QFETCH(int, content);
+    QFETCH(int, threads);
+    QFETCH(int, format);
+    QByteArray data = gzipData(content);
+    setBenchmarkWork(data.size(), "bytes");
+    QBENCHMARK {
+        QuaGzipFile gzip(gzipName());
+        gzip.setThreadCount(threads);
+        gzip.setWriteFormat(static_cast<QuaGzipFile::WriteFormat>(format));
+        QVERIFY(gzip.open(QIODevice::WriteOnly));
+        QCOMPARE(gzip.write(data), static_cast<qint64>(data.size()));
+        gzip.close();
+    }
+}
+
+void BenchQuaGzipFile::read_data()
+{
+    write_data();
+}
+
+void BenchQuaGzipFile::read()
+{
+    QFETCH(int, content);
+    QFETCH(int, threads);
+    QFETCH(int, format);
+    QByteArray data = gzipData(content);
+    {
+        QuaGzipFile gzip(gzipName());
+        gzip.setThreadCount(threads);
+        gzip.setWriteFormat(static_cast<QuaGzipFile::WriteFormat>(format));
+        QVERIFY(gzip.open(QIODevice::WriteOnly));
+        QCOMPARE(gzip.write(data), static_cast<qint64>(data.size()));
+        gzip.close();
+    }
+    setBenchmarkWork(data.size(), "bytes");
+    QBENCHMARK {
+        QuaGzipFile gzip(gzipName());
+        gzip.setThreadCount(threads);
+        QVERIFY(gzip.open(QIODevice::ReadOnly));
+        QCOMPARE(gzip.readAll().size(), data.size());
+        gzip.close();
+    }
+}
@@ -0,0 +1,94 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "benchquaziodevice.h"
+
+#include "qzbench.h"
+
+#include <quazip/quaziodevice.h>
+
+#include <QBuffer>
+#include <QByteArray>
+
+#include <QtTest/QtTest>
+
+static QByteArray streamData(int content)
+{
+    qint64 size = quickBench() ? 4 * 1024 * 1024 : 32 * 1024 * 1024;
+    return corpusData(static_cast<CorpusContent>(content), size);
+}
+
+static QByteArray compress(const QByteArray &data)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QuaZIODevice dev(&buffer);
+    dev.open(QIODevice::WriteOnly);
+    dev.write(data);
+    dev.close();
+    return buffer.data();
+}
+
+void BenchQuaZIODevice::write_data()
+{
+    QTest::addColumn<int>("content");
+    QTest::newRow("compressible") << static_cast<int>(ccCompressible);
+    QTest::newRow("incompressible") << static_cast<int>(ccIncompressible);
+}
+
+void BenchQuaZIODevice::write()
+{
+    QFETCH(int, content);
+    QByteArray data = streamData(content);
+    setBenchmarkWork(data.size(), "bytes");
+    QBENCHMARK {
+        QBuffer buffer;
+        QVERIFY(buffer.open(QIODevice::WriteOnly));
+        QuaZIODevice dev(&buffer);
+        QVERIFY(dev.open(QIODevice::WriteOnly));
+        QCOMPARE(dev.write(data), static_cast<qint64>(data.size()));
+        dev.close();
+    }
+}
+
+void BenchQuaZIODevice::read_data()
+{
+    write_data();
+}
+
+void BenchQuaZIODevice::read()
+{
+    QFETCH(int, content);
+    QByteArray data = streamData(content);
+    QByteArray compressed = compress(data);
+    setBenchmarkWork(data.size(), "bytes");
+    QBENCHMARK {
+        QBuffer buffer(&compressed);
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QuaZIODevice dev(&buffer);
+        QVERIFY(dev.open(QIODevice::ReadOnly));
+        QCOMPARE(dev.readAll().size(), data.size());
+        dev.close();
+    }
+}
@@ -0,0 +1,117 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "benchquazip.h"
+
+#include "qzbench.h"
+
+#include <quazip/quazip.h>
+
+#include <QDir>
+#include <QFile>
+
+#include <QtTest/QtTest>
+
+static const char benchDir[] = "benchtmp/quazip";
+
+// Creates the archive of the current row, unless an earlier function did.
+static QString entriesArchive(int entryCount)
+{
+    QString zipName = QDir(benchDir).filePath(
+            QString("entries%1.zip").arg(entryCount));
+    if (!QFile::exists(zipName) && !createEntriesArchive(zipName, entryCount)) {
+        QFile::remove(zipName);
+        return QString();
+    }
+    return zipName;
+}
+
+void BenchQuaZip::initTestCase()
+{
+    removeBenchDir(benchDir);
+    QVERIFY(QDir().mkpath(benchDir));
+}
+
+void BenchQuaZip::cleanupTestCase()
+{
+    removeBenchDir(benchDir);
+}
+
+void BenchQuaZip::getFileInfoList64_data()
+{
+    QTest::addColumn<int>("entryCount");
+    QTest::newRow("1k") << 1000;
+    if (quickBench())
+        return;
+    QTest::newRow("100k") << 100000;
+    QTest::newRow("1M") << 1000000;
+}
+
+void BenchQuaZip::getFileInfoList64()
+{
+    QFETCH(int, entryCount);
+    QString zipName = entriesArchive(entryCount);
+    QVERIFY(!zipName.isEmpty());
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QList<QuaZipFileInfo64> list;
+    setBenchmarkWork(entryCount, "entries");
+    QBENCHMARK {
+        list = zip.getFileInfoList64();
+    }
+    QCOMPARE(list.size(), entryCount);
+    zip.close();
+}
+
+void BenchQuaZip::setCurrentFile_data()
+{
+    getFileInfoList64_data();
+}
+
+void BenchQuaZip::setCurrentFile()
+{
+    QFETCH(int, entryCount);
+    QString zipName = entriesArchive(entryCount);
+    QVERIFY(!zipName.isEmpty());
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    // the same scattered names for every row, plus one that isn't there
+    QStringList names;
+    quint32 next = 1;
+    for (int i = 0; i < 1000; ++i) {
+        next = next * 1103515245u + 12345u;
+        names << entryName(static_cast<int>(next % entryCount));
+    }
+    // build the name index outside of the measurement
+    QVERIFY(zip.setCurrentFile(names.first()));
+    setBenchmarkWork(names.size() + 1, "lookups");
+    QBENCHMARK {
+        foreach (const QString &name, names) {
+            if (!zip.setCurrentFile(name))
+                QFAIL(qPrintable(name));
+        }
+        QVERIFY(!zip.setCurrentFile("missing/entry.txt"));
+    }
+    zip.close();
+}
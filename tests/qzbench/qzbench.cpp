@@ -0,0 +1,398 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "qzbench.h"
+#include "benchjlcompress.h"
+#include "benchquazip.h"
+#include "benchquaziodevice.h"
+#include "benchquagzipfile.h"
+#include "benchquachecksum32.h"
+
+#include <quazip/quazip.h>
+#include <quazip/quazipfile.h>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QPair>
+#include <QTextStream>
+
+#include <QtTest/QtTest>
+
+#include <string.h>
+
+namespace {
+
+// xorshift32, so that the corpus doesn't depend on the platform's rand()
+class CorpusRandom {
+public:
+    explicit CorpusRandom(quint32 seed): state(seed ^ 0x9E3779B9u)
+    {
+        if (state == 0)
+            state = 1;
+    }
+    quint32 next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+private:
+    quint32 state;
+};
+
+const char *const corpusWords[] = {
+    "archive", "entry", "central", "directory", "local", "header",
+    "deflate", "inflate", "stored", "method", "level", "window",
+    "the", "a", "of", "and", "to", "in", "is", "for", "with", "on",
+    "file", "name", "comment", "extra", "field", "size", "crc",
+    "zip64", "offset", "disk", "number", "version", "made", "by",
+    "needed", "extract", "flag", "time", "date", "attributes",
+    "internal", "external", "data", "descriptor", "signature", "end",
+    "record", "locator", "compressed", "uncompressed", "password",
+    "encrypted", "stream", "buffer", "block", "huffman", "literal",
+    "length", "distance", "match", "window", "dictionary"
+};
+const int corpusWordCount = sizeof(corpusWords) / sizeof(corpusWords[0]);
+
+// what setBenchmarkWork() recorded, by "function/tag"
+QMap<QString, QPair<qint64, QString> > benchmarkWork;
+
+QString workKey(const QString &function, const QString &tag)
+{
+    return function + QLatin1Char('/') + tag;
+}
+
+struct BenchmarkResult {
+    QString testCase;
+    QString function;
+    QString tag;
+    QString metric;
+    double value;
+    int iterations;
+    qint64 work;
+    QString unit;
+};
+
+// Splits a line of the QtTest CSV logger:
+// "function","tag","metric",value,total,iterations
+QStringList splitCsvLine(const QString &line)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    foreach (QChar c, line) {
+        if (c == QLatin1Char('"')) {
+            quoted = !quoted;
+        } else if (c == QLatin1Char(',') && !quoted) {
+            fields << field;
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields << field;
+    return fields;
+}
+
+bool readCsvResults(const QString &fileName, const QString &testCase,
+                    QList<BenchmarkResult> &results)
+{
+    QFile csv(fileName);
+    if (!csv.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+    QTextStream in(&csv);
+    while (!in.atEnd()) {
+        QStringList fields = splitCsvLine(in.readLine().trimmed());
+        if (fields.size() < 6)
+            continue;
+        BenchmarkResult result;
+        result.testCase = testCase;
+        result.function = fields.at(0);
+        result.tag = fields.at(1);
+        result.metric = fields.at(2);
+        result.value = fields.at(3).toDouble();
+        result.iterations = fields.at(5).toInt();
+        QPair<qint64, QString> work = benchmarkWork.value(
+                workKey(result.function, result.tag),
+                qMakePair(qint64(0), QString()));
+        result.work = work.first;
+        result.unit = work.second;
+        results << result;
+    }
+    return true;
+}
+
+// units per second, or 0 if the result isn't wall time or has no work
+double throughput(const BenchmarkResult &result)
+{
+    if (result.work <= 0 || result.value <= 0
+            || result.metric != QLatin1String("WalltimeMilliseconds"))
+        return 0;
+    return result.work * 1000.0 / result.value;
+}
+
+bool writeResults(const QString &fileName,
+                  const QList<BenchmarkResult> &results)
+{
+    QFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate
+                  | QIODevice::Text)) {
+        qWarning("Couldn't create %s", fileName.toUtf8().constData());
+        return false;
+    }
+    if (fileName.endsWith(QLatin1String(".json"), Qt::CaseInsensitive)) {
+        QJsonArray array;
+        foreach (const BenchmarkResult &result, results) {
+            QJsonObject object;
+            object.insert("testCase", result.testCase);
+            object.insert("function", result.function);
+            object.insert("tag", result.tag);
+            object.insert("metric", result.metric);
+            object.insert("value", result.value);
+            object.insert("iterations", result.iterations);
+            if (result.work > 0) {
+                object.insert("work", static_cast<double>(result.work));
+                object.insert("unit", result.unit);
+                object.insert("perSecond", throughput(result));
+            }
+            array.append(object);
+        }
+        QJsonObject root;
+        root.insert("qtVersion", QString::fromLatin1(qVersion()));
+        root.insert("quick", quickBench());
+        root.insert("results", array);
+        out.write(QJsonDocument(root).toJson());
+    } else {
+        QTextStream stream(&out);
+        stream << "testCase,function,tag,metric,value,iterations,"
+                  "work,unit,perSecond\n";
+        foreach (const BenchmarkResult &result, results) {
+            stream << result.testCase << ',' << result.function << ','
+                   << result.tag << ',' << result.metric << ','
+                   << QString::number(result.value, 'g', 13) << ','
+                   << result.iterations << ',' << result.work << ','
+                   << result.unit << ','
+                   << QString::number(throughput(result), 'g', 13) << '\n';
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+QByteArray corpusData(CorpusContent content, qint64 size, quint32 seed)
+{
+    QByteArray data;
+    data.reserve(static_cast<int>(size));
+    CorpusRandom random(seed);
+    if (content == ccIncompressible) {
+        data.resize(static_cast<int>(size));
+        char *bytes = data.data();
+        qint64 i = 0;
+        for (; i + 4 <= size; i += 4) {
+            quint32 r = random.next();
+            memcpy(bytes + i, &r, 4);
+        }
+        for (; i < size; ++i)
+            bytes[i] = static_cast<char>(random.next());
+        return data;
+    }
+    int column = 0;
+    while (data.size() < size) {
+        const char *word = corpusWords[random.next() % corpusWordCount];
+        data.append(word);
+        column += static_cast<int>(strlen(word)) + 1;
+        if (column > 72) {
+            data.append('\n');
+            column = 0;
+        } else {
+            data.append(' ');
+        }
+    }
+    data.truncate(static_cast<int>(size));
+    return data;
+}
+
+bool createCorpus(const QString &dir, int fileCount, qint64 fileSize,
+                  CorpusContent content, quint32 seed)
+{
+    QDir curDir;
+    for (int i = 0; i < fileCount; ++i) {
+        // at most 100 files per directory, like real trees
+        QString subDir = QDir(dir).filePath(
+                QString("d%1").arg(i / 100, 4, 10, QLatin1Char('0')));
+        if (i % 100 == 0 && !curDir.mkpath(subDir)) {
+            qWarning("Couldn't mkpath %s", subDir.toUtf8().constData());
+            return false;
+        }
+        QFile file(QDir(subDir).filePath(
+                QString("f%1.dat").arg(i, 7, 10, QLatin1Char('0'))));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning("Couldn't create %s",
+                     file.fileName().toUtf8().constData());
+            return false;
+        }
+        QByteArray data = corpusData(content, fileSize, seed + i);
+        if (file.write(data) != data.size()) {
+            qWarning("Couldn't write %s",
+                     file.fileName().toUtf8().constData());
+            return false;
+        }
+    }
+    return true;
+}
+
+QString entryName(int i)
+{
+    return QString("dir%1/entry%2.txt")
+            .arg(i / 1000, 4, 10, QLatin1Char('0'))
+            .arg(i, 7, 10, QLatin1Char('0'));
+}
+
+bool createEntriesArchive(const QString &zipName, int entryCount)
+{
+    QuaZip zip(zipName);
+    if (!zip.open(QuaZip::mdCreate)) {
+        qWarning("Couldn't open %s", zipName.toUtf8().constData());
+        return false;
+    }
+    for (int i = 0; i < entryCount; ++i) {
+        QuaZipFile zipFile(&zip);
+        if (!zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo(entryName(i)),
+                          NULL, 0, 0)) {
+            qWarning("Couldn't open %s in %s",
+                     entryName(i).toUtf8().constData(),
+                     zipName.toUtf8().constData());
+            return false;
+        }
+        zipFile.putChar('x');
+        zipFile.close();
+        if (zipFile.getZipError() != UNZ_OK)
+            return false;
+    }
+    zip.close();
+    return zip.getZipError() == ZIP_OK;
+}
+
+bool quickBench()
+{
+    return !qgetenv("QZBENCH_QUICK").isEmpty();
+}
+
+void setBenchmarkWork(qint64 amount, const char *unit)
+{
+    benchmarkWork.insert(workKey(QTest::currentTestFunction(),
+                                 QTest::currentDataTag()),
+                         qMakePair(amount, QString::fromLatin1(unit)));
+}
+
+void removeBenchDir(const QString &dir)
+{
+    QDir(dir).removeRecursively();
+}
+
+// Runs one benchmark class, collecting its results if resultsName is set.
+static int runBenchmark(QObject *bench, const QStringList &arguments,
+                        const QString &resultsName,
+                        QList<BenchmarkResult> &results)
+{
+    if (resultsName.isEmpty())
+        return QTest::qExec(bench, arguments);
+    QString testCase = QString::fromLatin1(bench->metaObject()->className());
+    QString csvName = QDir::temp().filePath(
+            QString("qzbench-%1-%2.csv").arg(testCase)
+            .arg(QCoreApplication::applicationPid()));
+    QStringList args = arguments;
+    args << "-o" << csvName + ",csv" << "-o" << "-,txt";
+    benchmarkWork.clear();
+    int err = QTest::qExec(bench, args);
+    if (!readCsvResults(csvName, testCase, results)) {
+        qWarning("Couldn't read the results of %s",
+                 testCase.toUtf8().constData());
+        err = qMax(err, 1);
+    }
+    QFile::remove(csvName);
+    return err;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    // -results file.json or -results file.csv collects every result into
+    // one file, the rest of the arguments go to QTest as usual
+    QStringList arguments = app.arguments();
+    QString resultsName;
+    int resultsIndex = arguments.indexOf("-results");
+    if (resultsIndex != -1) {
+        if (resultsIndex + 1 >= arguments.size()) {
+            qWarning("-results needs a file name ending in .json or .csv");
+            return 1;
+        }
+        resultsName = arguments.at(resultsIndex + 1);
+        arguments.erase(arguments.begin() + resultsIndex,
+                        arguments.begin() + resultsIndex + 2);
+    }
+    QList<BenchmarkResult> results;
+    int err = 0;
+    {
+        BenchQuaChecksum32 benchQuaChecksum32;
+        err = qMax(err, runBenchmark(&benchQuaChecksum32, arguments,
+                                     resultsName, results));
+    }
+    {
+        BenchQuaZIODevice benchQuaZIODevice;
+        err = qMax(err, runBenchmark(&benchQuaZIODevice, arguments,
+                                     resultsName, results));
+    }
+    {
+        BenchQuaGzipFile benchQuaGzipFile;
+        err = qMax(err, runBenchmark(&benchQuaGzipFile, arguments,
+                                     resultsName, results));
+    }
+    {
+        BenchQuaZip benchQuaZip;
+        err = qMax(err, runBenchmark(&benchQuaZip, arguments,
+                                     resultsName, results));
+    }
+    {
+        BenchJlCompress benchJlCompress;
+        err = qMax(err, runBenchmark(&benchJlCompress, arguments,
+                                     resultsName, results));
+    }
+    if (!resultsName.isEmpty() && !writeResults(resultsName, results))
+        err = qMax(err, 1);
+    if (err == 0) {
+        qDebug("All benchmarks executed successfully");
+    } else {
+        qWarning("There were errors in some of the benchmarks above.");
+    }
+    return err;
+}
@@ -0,0 +1,60 @@
+#ifndef QUAZIP_TEST_QZBENCH_H
+#define QUAZIP_TEST_QZBENCH_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QByteArray>
+#include <QString>
+
+/// What the synthetic corpus files are filled with.
+enum CorpusContent {
+    /// Words from a small vocabulary, compresses about 4:1.
+    ccCompressible,
+    /// Pseudo-random bytes, deflate can't do anything with them.
+    ccIncompressible
+};
+
+/// Returns size bytes of content, the same for the same seed on every platform.
+extern QByteArray corpusData(CorpusContent content, qint64 size,
+                             quint32 seed = 1);
+/// Creates fileCount files of fileSize bytes each in dir, in subdirectories.
+extern bool createCorpus(const QString &dir, int fileCount, qint64 fileSize,
+                         CorpusContent content, quint32 seed = 1);
+/// Creates zipName with entryCount one-byte stored entries.
+extern bool createEntriesArchive(const QString &zipName, int entryCount);
+/// The name of the entry number i in an archive made by createEntriesArchive().
+extern QString entryName(int i);
+/// Returns true if QZBENCH_QUICK is set, to keep the corpus small.
+extern bool quickBench();
+/// Records how much work one iteration of the current benchmark does.
+/**
+  The results file reports the amount and the unit next to the timing,
+  with the throughput in units per second for wall time measurements.
+  */
+extern void setBenchmarkWork(qint64 amount, const char *unit);
+/// Removes dir with everything in it.
+extern void removeBenchDir(const QString &dir);
+
+#endif // QUAZIP_TEST_QZBENCH_H
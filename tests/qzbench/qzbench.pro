@@ -0,0 +1,45 @@
+TEMPLATE = app
+QT -= gui
+CONFIG += qtestlib
+CONFIG += console
+CONFIG -= app_bundle
+DEPENDPATH += .
+INCLUDEPATH += .
+!win32: LIBS += -lz
+
+win32 {
+    # workaround for qdatetime.h macro bug
+    DEFINES += NOMINMAX
+
+    # by default the library is built as a dll.
+    DEFINES+=QUAZIP_USE_LIBRARY
+}
+
+# We use the Qt5 sources embedded version of zlib.
+INCLUDEPATH += $$absolute_path($$[QT_INSTALL_PREFIX]/../Src/qtbase/src/3rdparty/zlib/src)
+
+# Input
+HEADERS += qzbench.h \
+benchjlcompress.h \
+benchquachecksum32.h \
+benchquagzipfile.h \
+benchquaziodevice.h \
+benchquazip.h
+
+SOURCES += qzbench.cpp \
+benchjlcompress.cpp \
+benchquachecksum32.cpp \
+benchquagzipfile.cpp \
+benchquaziodevice.cpp \
+benchquazip.cpp
+
+OBJECTS_DIR = .obj
+MOC_DIR = .moc
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../quazip/release/ -lquazip
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../quazip/debug/ -lquazipd
+else:mac:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../quazip/ -lquazip_debug
+else:unix: LIBS += -L$$OUT_PWD/../../quazip/ -lquazip
+
+INCLUDEPATH += $$PWD/../..
+DEPENDPATH += $$PWD/../../quazip
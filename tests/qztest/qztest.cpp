@@ -27,11 +27,14 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "testquazipfile.h"
 #include "testquachecksum32.h"
 #include "testjlcompress.h"
+#include "testjlcompressobj.h"
 #include "testquazipdir.h"
 #include "testquagzipfile.h"
 #include "testquaziodevice.h"
 #include "testquazipnewinfo.h"
 #include "testquazipfileinfo.h"
+#include "testquazipstreamreader.h"
+#include "testquazipeditor.h"
 
 #include <quazip/quazip.h>
 #include <quazip/quazipfile.h>
@@ -208,6 +211,10 @@ int main(int argc, char **argv)
         TestJlCompress testJlCompress;
         err = qMax(err, QTest::qExec(&testJlCompress, app.arguments()));
     }
+    {
+        TestJlCompressObj testJlCompressObj;
+        err = qMax(err, QTest::qExec(&testJlCompressObj, app.arguments()));
+    }
     {
         TestQuaZipDir testQuaZipDir;
         err = qMax(err, QTest::qExec(&testQuaZipDir, app.arguments()));
@@ -228,6 +235,14 @@ int main(int argc, char **argv)
         TestQuaZipFileInfo testQuaZipFileInfo;
         err = qMax(err, QTest::qExec(&testQuaZipFileInfo, app.arguments()));
     }
+    {
+        TestQuaZipStreamReader testQuaZipStreamReader;
+        err = qMax(err, QTest::qExec(&testQuaZipStreamReader, app.arguments()));
+    }
+    {
+        TestQuaZipEditor testQuaZipEditor;
+        err = qMax(err, QTest::qExec(&testQuaZipEditor, app.arguments()));
+    }
     if (err == 0) {
         qDebug("All tests executed successfully");
     } else {
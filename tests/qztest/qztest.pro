@@ -29,24 +29,30 @@ INCLUDEPATH += $$absolute_path($$[QT_INSTALL_PREFIX]/../Src/qtbase/src/3rdparty/
 # Input
 HEADERS += qztest.h \
 testjlcompress.h \
+testjlcompressobj.h \
 testquachecksum32.h \
 testquagzipfile.h \
 testquaziodevice.h \
 testquazipdir.h \
+testquazipeditor.h \
 testquazipfile.h \
 testquazip.h \
     testquazipnewinfo.h \
+    testquazipstreamreader.h \
     testquazipfileinfo.h
 
 SOURCES += qztest.cpp \
 testjlcompress.cpp \
+testjlcompressobj.cpp \
 testquachecksum32.cpp \
 testquagzipfile.cpp \
 testquaziodevice.cpp \
 testquazip.cpp \
 testquazipdir.cpp \
+testquazipeditor.cpp \
 testquazipfile.cpp \
     testquazipnewinfo.cpp \
+    testquazipstreamreader.cpp \
     testquazipfileinfo.cpp
 
 OBJECTS_DIR = .obj
@@ -390,3 +390,156 @@ void TestJlCompress::zeroPermissions()
     curDir.remove("zero.zip");
     curDir.remove("zero.txt");
 }
+
+void TestJlCompress::mergeArchives()
+{
+    QStringList firstNames = QStringList() << "test0.txt" << "dup.txt";
+    QStringList secondNames = QStringList() << "dup.txt" << "testdir1/test1.txt";
+    QStringList allNames = QStringList() << "test0.txt" << "dup.txt" << "testdir1/test1.txt";
+    QDir curDir;
+    if (!createTestFiles(firstNames, -1, "jlmerge1")
+            || !createTestFiles(secondNames, -1, "jlmerge2")) {
+        QFAIL("Can't create test files");
+    }
+    {
+        QFile dup("jlmerge2/dup.txt");
+        QVERIFY(dup.open(QIODevice::WriteOnly | QIODevice::Append));
+        dup.write("This one is not kept\n");
+    }
+    if (!createTestArchive("jlmerge1.zip", firstNames, "jlmerge1")
+            || !createTestArchive("jlmerge2.zip", secondNames, "jlmerge2")) {
+        QFAIL("Can't create test archives");
+    }
+    QVERIFY(JlCompress::mergeArchives("jlmerged.zip",
+                                      QStringList() << "jlmerge1.zip" << "jlmerge2.zip"));
+    QCOMPARE(JlCompress::getFileList("jlmerged.zip"), allNames);
+    QStringList extracted = JlCompress::extractDir("jlmerged.zip", "jlmerge_ext");
+    QCOMPARE(extracted.count(), allNames.count());
+    // the first of the duplicates is kept
+    foreach (QString fileName, allNames) {
+        QString sourceDir = secondNames.contains(fileName) && !firstNames.contains(fileName)
+                ? "jlmerge2" : "jlmerge1";
+        QFile source(QDir(sourceDir).filePath(fileName));
+        QFile copy(QDir("jlmerge_ext").filePath(fileName));
+        QVERIFY(source.open(QIODevice::ReadOnly));
+        QVERIFY(copy.open(QIODevice::ReadOnly));
+        QCOMPARE(copy.readAll(), source.readAll());
+    }
+    // a missing archive fails the whole merge
+    QVERIFY(!JlCompress::mergeArchives("jlmerged.zip",
+                                       QStringList() << "jlmerge1.zip" << "jlmissing.zip"));
+    QVERIFY(!curDir.exists("jlmerged.zip"));
+    removeTestFiles(firstNames, "jlmerge1");
+    removeTestFiles(secondNames, "jlmerge2");
+    removeTestFiles(allNames, "jlmerge_ext");
+    curDir.remove("jlmerge1.zip");
+    curDir.remove("jlmerge2.zip");
+}
+
+void TestJlCompress::filterArchive()
+{
+    QStringList fileNames = QStringList() << "test0.txt" << "test0.dat"
+                                          << "testdir1/test1.txt" << "testdir1/test1.dat";
+    QDir curDir;
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Can't create test files");
+    }
+    if (!createTestArchive("jlfilter.zip", fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QVERIFY(JlCompress::filterArchive("jlfilter.zip", "jlfiltered.zip", QStringList() << "*.txt"));
+    QCOMPARE(JlCompress::getFileList("jlfiltered.zip"),
+             QStringList() << "test0.txt" << "testdir1/test1.txt");
+    QVERIFY(JlCompress::filterArchive("jlfilter.zip", "jlfiltered.zip", QStringList() << "testdir1/*"));
+    QCOMPARE(JlCompress::getFileList("jlfiltered.zip"),
+             QStringList() << "testdir1/test1.txt" << "testdir1/test1.dat");
+    QCOMPARE(JlCompress::extractFile("jlfiltered.zip", "testdir1/test1.dat", "jlfiltered.dat"),
+             QFileInfo("jlfiltered.dat").absoluteFilePath());
+    QFile source("tmp/testdir1/test1.dat");
+    QFile copy("jlfiltered.dat");
+    QVERIFY(source.open(QIODevice::ReadOnly));
+    QVERIFY(copy.open(QIODevice::ReadOnly));
+    QCOMPARE(copy.readAll(), source.readAll());
+    source.close();
+    copy.close();
+    removeTestFiles(fileNames);
+    curDir.remove("jlfilter.zip");
+    curDir.remove("jlfiltered.zip");
+    curDir.remove("jlfiltered.dat");
+}
+
+void TestJlCompress::updateDir()
+{
+    QStringList fileNames = QStringList() << "test0.txt" << "testdir1/test1.txt"
+                                          << "testdir2/test2.txt";
+    QDir curDir;
+    if (curDir.exists("jlupdate.zip")) {
+        if (!curDir.remove("jlupdate.zip"))
+            QFAIL("Can't remove zip file");
+    }
+    if (!createTestFiles(fileNames, -1, "updateDir_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    JlCompress::UpdateStats stats;
+    // no archive yet, everything is compressed
+    QVERIFY(JlCompress::updateDir("jlupdate.zip", "updateDir_tmp", true, 0, false, &stats));
+    QCOMPARE(stats.reusedFiles, 0);
+    QCOMPARE(stats.compressedFiles, 3);
+    // nothing changed, everything is reused
+    QVERIFY(JlCompress::updateDir("jlupdate.zip", "updateDir_tmp", true, 0, false, &stats));
+    QCOMPARE(stats.reusedFiles, 3);
+    QVERIFY(stats.reusedBytes > 0);
+    QCOMPARE(stats.compressedFiles, 0);
+    QCOMPARE(stats.compressedBytes, static_cast<qint64>(0));
+    QVERIFY(JlCompress::updateDir("jlupdate.zip", "updateDir_tmp", true, 0, true, &stats));
+    QCOMPARE(stats.reusedFiles, 3);
+    // one file modified, one removed
+    QFile modified("updateDir_tmp/testdir1/test1.txt");
+    QVERIFY(modified.open(QIODevice::Append));
+    modified.write("modified");
+    modified.close();
+    QVERIFY(curDir.remove("updateDir_tmp/test0.txt"));
+    QVERIFY(JlCompress::updateDir("jlupdate.zip", "updateDir_tmp", true, 0, false, &stats));
+    QCOMPARE(stats.reusedFiles, 1);
+    QCOMPARE(stats.compressedFiles, 1);
+    QCOMPARE(stats.compressedBytes, QFileInfo("updateDir_tmp/testdir1/test1.txt").size());
+    QStringList fileList = JlCompress::getFileList("jlupdate.zip");
+    QVERIFY(!fileList.contains("test0.txt"));
+    QVERIFY(fileList.contains("testdir1/test1.txt"));
+    QVERIFY(fileList.contains("testdir2/test2.txt"));
+    QCOMPARE(JlCompress::extractFile("jlupdate.zip", "testdir1/test1.txt", "jlupdate.txt"),
+             QFileInfo("jlupdate.txt").absoluteFilePath());
+    QFile copy("jlupdate.txt");
+    QVERIFY(modified.open(QIODevice::ReadOnly));
+    QVERIFY(copy.open(QIODevice::ReadOnly));
+    QCOMPARE(copy.readAll(), modified.readAll());
+    modified.close();
+    copy.close();
+    removeTestFiles(fileNames, "updateDir_tmp");
+    curDir.remove("jlupdate.zip");
+    curDir.remove("jlupdate.txt");
+}
+
+void TestJlCompress::updateDirInside()
+{
+    QStringList fileNames = QStringList() << "test0.txt" << "testdir1/test1.txt";
+    if (!createTestFiles(fileNames, -1, "updateDirInside_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    QString zipName = "updateDirInside_tmp/jlupdate.zip";
+    JlCompress::UpdateStats stats;
+    QVERIFY(JlCompress::updateDir(zipName, "updateDirInside_tmp", true, 0, false, &stats));
+    QCOMPARE(stats.compressedFiles, 2);
+    // the new archive is written while the directory is listed again
+    QVERIFY(JlCompress::updateDir(zipName, "updateDirInside_tmp", true, 0, false, &stats));
+    QCOMPARE(stats.reusedFiles, 2);
+    QCOMPARE(stats.compressedFiles, 0);
+    QStringList fileList = JlCompress::getFileList(zipName);
+    fileList.sort();
+    QCOMPARE(fileList, QStringList() << "test0.txt" << "testdir1/"
+                                     << "testdir1/test1.txt");
+    QDir dir("updateDirInside_tmp");
+    QCOMPARE(dir.entryList(QDir::Files), QStringList() << "jlupdate.zip" << "test0.txt");
+    QDir().remove(zipName);
+    removeTestFiles(fileNames, "updateDirInside_tmp");
+}
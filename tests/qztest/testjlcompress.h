@@ -43,6 +43,10 @@ private slots:
     void extractDir_data();
     void extractDir();
     void zeroPermissions();
+    void mergeArchives();
+    void filterArchive();
+    void updateDir();
+    void updateDirInside();
 };
 
 #endif // QUAZIP_TEST_JLCOMPRESS_H
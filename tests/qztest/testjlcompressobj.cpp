@@ -0,0 +1,445 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "testjlcompressobj.h"
+
+#include "qztest.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+#include <QtTest/QtTest>
+
+#include <quazip/JlCompress.h>
+#include <quazip/jlcompress_obj.hpp>
+#include <quazip/jlworkerpool.hpp>
+
+static bool createRandomFile(const QString &fileName, int size)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    // xorshift32 seeded with the size, qsrand() is deprecated
+    quint32 state = static_cast<quint32>(size) ^ 0x9E3779B9u;
+    QByteArray data(size, '\0');
+    for (int i = 0; i < size; ++i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        data[i] = static_cast<char>(state & 0xFF);
+    }
+    return file.write(data) == size;
+}
+
+static QByteArray fileContents(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void TestJlCompressObj::compressDirParallel_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<qint64>("memoryCeiling");
+    QTest::newRow("serial") << 1 << JLCOMPRESS_DEFAULT_MEMORY_CEILING;
+    QTest::newRow("4 threads") << 4 << JLCOMPRESS_DEFAULT_MEMORY_CEILING;
+    QTest::newRow("ideal threads") << 0 << JLCOMPRESS_DEFAULT_MEMORY_CEILING;
+    QTest::newRow("spill to disk") << 4 << Q_INT64_C(64 * 1024);
+}
+
+void TestJlCompressObj::compressDirParallel()
+{
+    QFETCH(int, threads);
+    QFETCH(qint64, memoryCeiling);
+    const QString zipName = "jlobjdir.zip";
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "testdir1/test1.txt" << "testdir2/test2.txt"
+        << "testdir2/subdir/test2sub.txt" << "emptydir/";
+    QDir curDir;
+    if (curDir.exists(zipName)) {
+        if (!curDir.remove(zipName))
+            QFAIL("Can't remove zip file");
+    }
+    if (!createTestFiles(fileNames, 100000, "jlobj_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    if (!createRandomFile("jlobj_tmp/random.bin", 300000)) {
+        QFAIL("Can't create random file");
+    }
+    JlCompressObj compressor(true);
+    compressor.setThreadCount(threads);
+    compressor.setMemoryCeiling(memoryCeiling);
+    QSignalSpy filesSpy(&compressor, SIGNAL(filesProgressChanged(int)));
+    QVERIFY(compressor.compressDir(zipName, "jlobj_tmp"));
+    QCOMPARE(filesSpy.count(), 5);
+    // the archive must be identical in contents to the serial one
+    QStringList expected = QStringList() << "test0.txt" << "random.bin"
+        << "testdir1/" << "testdir1/test1.txt" << "testdir2/"
+        << "testdir2/test2.txt" << "testdir2/subdir/"
+        << "testdir2/subdir/test2sub.txt" << "emptydir/";
+    QStringList fileList = JlCompress::getFileList(zipName);
+    qSort(fileList);
+    qSort(expected);
+    QCOMPARE(fileList, expected);
+    QStringList extracted = JlCompress::extractDir(zipName, "jlobj_ext");
+    QCOMPARE(extracted.count(), expected.count());
+    foreach (QString fileName, expected) {
+        if (fileName.endsWith('/'))
+            continue;
+        QCOMPARE(fileContents("jlobj_ext/" + fileName),
+                 fileContents("jlobj_tmp/" + fileName));
+    }
+    QDir("jlobj_ext").removeRecursively();
+    QDir("jlobj_tmp").removeRecursively();
+    curDir.remove(zipName);
+}
+
+void TestJlCompressObj::compressFilesParallel()
+{
+    const QString zipName = "jlobjfiles.zip";
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "test00.txt" << "subdir1/test1.txt";
+    if (!createTestFiles(fileNames, 70000)) {
+        QFAIL("Can't create test files");
+    }
+    QStringList realNames, shortNames;
+    foreach (QString fileName, fileNames) {
+        realNames << "tmp/" + fileName;
+        shortNames << QFileInfo(fileName).fileName();
+    }
+    JlCompressObj compressor;
+    compressor.setThreadCount(3);
+    QVERIFY(compressor.compressFiles(zipName, realNames));
+    // order is preserved
+    QCOMPARE(JlCompress::getFileList(zipName), shortNames);
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    for (int i = 0; i < fileNames.size(); ++i) {
+        QVERIFY(zip.setCurrentFile(shortNames.at(i)));
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), fileContents(realNames.at(i)));
+        file.close();
+        QCOMPARE(file.getZipError(), UNZ_OK);
+    }
+    zip.close();
+    // a missing file fails the whole operation
+    QVERIFY(!compressor.compressFiles(zipName, QStringList(realNames) << "tmp/missing.txt"));
+    QVERIFY(!QFileInfo(zipName).exists());
+    removeTestFiles(fileNames);
+}
+
+void TestJlCompressObj::copyBuffer_data()
+{
+    QTest::addColumn<int>("bufferSize");
+    QTest::addColumn<int>("expectedSize");
+    QTest::newRow("too small") << 1 << JLCOMPRESS_MIN_COPY_BUFFER;
+    QTest::newRow("64 KB") << 64 * 1024 << 64 * 1024;
+    QTest::newRow("default") << JLCOMPRESS_DEFAULT_COPY_BUFFER
+                             << JLCOMPRESS_DEFAULT_COPY_BUFFER;
+    QTest::newRow("too large") << 64 * 1024 * 1024 << JLCOMPRESS_MAX_COPY_BUFFER;
+}
+
+void TestJlCompressObj::copyBuffer()
+{
+    QFETCH(int, bufferSize);
+    QFETCH(int, expectedSize);
+    const QString zipName = "jlobjcopy.zip";
+    const QStringList fileNames = QStringList() << "small.txt" << "big.bin";
+    QDir("jlobj_tmp").removeRecursively();
+    if (!createTestFiles(QStringList() << "small.txt", 1000, "jlobj_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    // several buffers long whatever the size, except for the largest one
+    if (!createRandomFile("jlobj_tmp/big.bin", 3 * 1024 * 1024 + 17)) {
+        QFAIL("Can't create random file");
+    }
+    JlCompressObj compressor(true);
+    compressor.setCopyBufferSize(bufferSize);
+    QCOMPARE(compressor.copyBufferSize(), expectedSize);
+    QSignalSpy filesSpy(&compressor, SIGNAL(filesProgressChanged(int)));
+    QSignalSpy overallSpy(&compressor, SIGNAL(overallProgressChanged(int)));
+    QVERIFY(compressor.compressDir(zipName, "jlobj_tmp"));
+    QCOMPARE(filesSpy.count(), fileNames.count());
+    QVERIFY(!overallSpy.isEmpty());
+    QCOMPARE(overallSpy.last().at(0).toInt(), 100);
+    filesSpy.clear();
+    // the extraction goes through copyData too
+    QStringList extracted = compressor.extractDir(zipName, "jlobj_ext");
+    QCOMPARE(extracted.count(), fileNames.count());
+    QCOMPARE(filesSpy.count(), fileNames.count());
+    foreach (QString fileName, fileNames) {
+        QCOMPARE(fileContents("jlobj_ext/" + fileName),
+                 fileContents("jlobj_tmp/" + fileName));
+    }
+    QDir("jlobj_ext").removeRecursively();
+    QDir("jlobj_tmp").removeRecursively();
+    QDir().remove(zipName);
+}
+
+void TestJlCompressObj::extractDirParallel()
+{
+    const QString zipName = "jlobjextdir.zip";
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "testdir1/" << "testdir1/test1.txt" << "testdir2/test2.txt"
+        << "testdir2/subdir/test2sub.txt" << "big.txt";
+    if (!createTestFiles(fileNames, 150000)) {
+        QFAIL("Can't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    JlCompressObj extractor(true);
+    extractor.setThreadCount(4);
+    QSignalSpy filesSpy(&extractor, SIGNAL(filesProgressChanged(int)));
+    QSignalSpy overallSpy(&extractor, SIGNAL(overallProgressChanged(int)));
+    QStringList extracted = extractor.extractDir(zipName, "jlobj_ext");
+    QCOMPARE(extracted.count(), fileNames.count());
+    QCOMPARE(filesSpy.count(), 5);
+    QVERIFY(!overallSpy.isEmpty());
+    QCOMPARE(overallSpy.last().at(0).toInt(), 100);
+    for (int i = 0; i < fileNames.size(); ++i) {
+        // same order as the archive
+        QCOMPARE(extracted.at(i),
+                 QDir("jlobj_ext").absoluteFilePath(fileNames.at(i)));
+        if (fileNames.at(i).endsWith('/')) {
+            QVERIFY(QFileInfo(extracted.at(i)).isDir());
+            continue;
+        }
+        QCOMPARE(fileContents(extracted.at(i)),
+                 fileContents("tmp/" + fileNames.at(i)));
+        QCOMPARE(QFileInfo(extracted.at(i)).permissions(),
+                 QFileInfo("tmp/" + fileNames.at(i)).permissions());
+    }
+    QDir("jlobj_ext").removeRecursively();
+    removeTestFiles(fileNames);
+    QDir().remove(zipName);
+}
+
+void TestJlCompressObj::extractDirStream()
+{
+    const QString zipName = "jlobjextstream.zip";
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "testdir1/" << "testdir1/test1.txt" << "testdir2/test2.txt"
+        << "testdir2/subdir/test2sub.txt";
+    if (!createTestFiles(fileNames, 5000)) {
+        QFAIL("Can't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    // the archive arrives through a socket, which QuaZip can't open
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress(QHostAddress::LocalHost)));
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress(QHostAddress::LocalHost),
+                         server.serverPort());
+    QVERIFY(socket.waitForConnected());
+    QVERIFY(server.waitForNewConnection(30000));
+    QTcpSocket *client = server.nextPendingConnection();
+    socket.write(fileContents(zipName));
+    while (socket.bytesToWrite() > 0)
+        QVERIFY(socket.waitForBytesWritten());
+    socket.disconnectFromHost();
+    JlCompressObj extractor(true);
+    QSignalSpy filesSpy(&extractor, SIGNAL(filesProgressChanged(int)));
+    QStringList extracted = extractor.extractDir(client, "jlobj_stream");
+    QCOMPARE(extracted.count(), fileNames.count());
+    QCOMPARE(filesSpy.count(), 4);
+    for (int i = 0; i < fileNames.size(); ++i) {
+        QCOMPARE(extracted.at(i),
+                 QDir("jlobj_stream").absoluteFilePath(fileNames.at(i)));
+        if (fileNames.at(i).endsWith('/')) {
+            QVERIFY(QFileInfo(extracted.at(i)).isDir());
+            continue;
+        }
+        QCOMPARE(fileContents(extracted.at(i)),
+                 fileContents("tmp/" + fileNames.at(i)));
+    }
+    client->close();
+    QDir("jlobj_stream").removeRecursively();
+    removeTestFiles(fileNames);
+    QDir().remove(zipName);
+}
+
+void TestJlCompressObj::extractFilesParallel()
+{
+    const QString zipName = "jlobjextfiles.zip";
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "testdir1/test1.txt" << "testdir2/test2.txt"
+        << "testdir2/subdir/test2sub.txt";
+    const QStringList toExtract = QStringList() << "testdir2/test2.txt"
+        << "test0.txt" << "testdir2/subdir/test2sub.txt";
+    if (!createTestFiles(fileNames, 50000)) {
+        QFAIL("Can't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    JlCompressObj extractor;
+    extractor.setThreadCount(2);
+    QStringList extracted = extractor.extractFiles(zipName, toExtract,
+                                                   "jlobj_ext");
+    QCOMPARE(extracted.count(), toExtract.count());
+    foreach (QString fileName, toExtract) {
+        QCOMPARE(fileContents("jlobj_ext/" + fileName),
+                 fileContents("tmp/" + fileName));
+    }
+    QVERIFY(!QFileInfo("jlobj_ext/testdir1/test1.txt").exists());
+    // a missing entry fails the whole operation
+    QVERIFY(extractor.extractFiles(zipName, QStringList(toExtract)
+                                   << "missing.txt", "jlobj_ext2").isEmpty());
+    QDir("jlobj_ext").removeRecursively();
+    QDir("jlobj_ext2").removeRecursively();
+    removeTestFiles(fileNames);
+    QDir().remove(zipName);
+}
+
+void TestJlCompressObj::extractDuplicatesParallel()
+{
+    const QString zipName = "jlobjextdup.zip";
+    // the same name three times, with sizes that would spread it over buckets
+    const QStringList names = QStringList() << "dup.txt" << "a.txt"
+        << "dup.txt" << "b.txt" << "dup.txt";
+    const int sizes[] = {300000, 200000, 100000, 100000, 1000};
+    QList<QByteArray> contents;
+    {
+        QuaZip zip(zipName);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        quint32 seed = 1;
+        for (int i = 0; i < names.size(); ++i) {
+            QByteArray data(sizes[i], Qt::Uninitialized);
+            for (int j = 0; j < data.size(); ++j) {
+                seed = seed * 1103515245u + 12345u;
+                data[j] = static_cast<char>(seed >> 24);
+            }
+            contents << data;
+            QuaZipFile file(&zip);
+            QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(names.at(i))));
+            QCOMPARE(file.write(data), static_cast<qint64>(data.size()));
+            file.close();
+        }
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    JlCompressObj extractor;
+    extractor.setThreadCount(4);
+    QStringList extracted = extractor.extractDir(zipName, "jlobj_dup");
+    QCOMPARE(extracted.count(), names.count());
+    // the last one wins, as when extracting serially
+    QCOMPARE(fileContents("jlobj_dup/dup.txt"), contents.last());
+    QCOMPARE(fileContents("jlobj_dup/a.txt"), contents.at(1));
+    QCOMPARE(fileContents("jlobj_dup/b.txt"), contents.at(3));
+    QDir("jlobj_dup").removeRecursively();
+    QDir().remove(zipName);
+}
+
+void TestJlCompressObj::workerPool()
+{
+    const QStringList fileNames = QStringList() << "test0.txt"
+        << "testdir1/test1.txt" << "testdir2/test2.txt";
+    if (!createTestFiles(fileNames, 50000)) {
+        QFAIL("Can't create test files");
+    }
+    const int jobCount = 6;
+    QStringList zipNames;
+    for (int i = 0; i < jobCount; ++i)
+        zipNames << QString("jlpool%1.zip").arg(i);
+    {
+        JlWorkerPool pool(2);
+        QCOMPARE(pool.threadCount(), 2);
+        QSignalSpy finishedSpy(&pool, SIGNAL(jobFinished(int,bool)));
+        QSignalSpy allSpy(&pool, SIGNAL(allFinished()));
+        QSignalSpy overallSpy(&pool, SIGNAL(overallProgressChanged(int)));
+        QList<int> ids;
+        for (int i = 0; i < jobCount; ++i) {
+            int id = pool.submitCompression(zipNames.at(i), "tmp", true,
+                                            0, i % 3);
+            QVERIFY(id > 0);
+            QVERIFY(!ids.contains(id));
+            ids << id;
+        }
+        QVERIFY(pool.waitForDone(60000));
+        QCOMPARE(pool.pendingJobs(), 0);
+        QCOMPARE(pool.activeJobs(), 0);
+        QCOMPARE(finishedSpy.count(), jobCount);
+        QList<int> finished;
+        foreach (QList<QVariant> args, finishedSpy) {
+            finished << args.at(0).toInt();
+            QVERIFY(args.at(1).toBool());
+        }
+        foreach (int id, ids)
+            QVERIFY(finished.contains(id));
+        QCOMPARE(allSpy.count(), 1);
+        QCOMPARE(overallSpy.last().at(0).toInt(), 100);
+        foreach (QString zipName, zipNames) {
+            QCOMPARE(JlCompress::getFileList(zipName).count(),
+                     fileNames.count() + 2);
+        }
+        // extraction jobs report what they wrote
+        int extractId = pool.submitExtraction(zipNames.first(), QString(),
+                                              "jlpool_ext");
+        QVERIFY(extractId > 0);
+        QVERIFY(pool.waitForDone(60000));
+        QStringList extracted = pool.takeExtractedFiles(extractId);
+        QCOMPARE(extracted.count(), fileNames.count() + 2);
+        QVERIFY(pool.takeExtractedFiles(extractId).isEmpty());
+        QCOMPARE(fileContents("jlpool_ext/testdir2/test2.txt"),
+                 fileContents("tmp/testdir2/test2.txt"));
+    }
+    {
+        // bounded queue, canceled jobs are reported as failed
+        JlWorkerPool pool(1, 2);
+        QCOMPARE(pool.capacity(), 2);
+        QSignalSpy finishedSpy(&pool, SIGNAL(jobFinished(int,bool)));
+        QList<int> ids;
+        int id;
+        while ((id = pool.submitCompression("jlpoolcap.zip", "tmp")) != -1)
+            ids << id;
+        QVERIFY(ids.count() >= 2);
+        QVERIFY(pool.pendingJobs() <= 2);
+        pool.cancelAll();
+        QVERIFY(pool.waitForDone(60000));
+        QCOMPARE(finishedSpy.count(), ids.count());
+        int failed = 0;
+        foreach (QList<QVariant> args, finishedSpy) {
+            if (!args.at(1).toBool())
+                ++failed;
+        }
+        QVERIFY(failed >= 2);
+        QVERIFY(pool.submitCompression("jlpoolcap.zip", "tmp") > 0);
+        QVERIFY(pool.waitForDone(60000));
+        QCOMPARE(JlCompress::getFileList("jlpoolcap.zip").count(),
+                 fileNames.count() + 2);
+    }
+    foreach (QString zipName, zipNames)
+        QDir().remove(zipName);
+    QDir().remove("jlpoolcap.zip");
+    QDir("jlpool_ext").removeRecursively();
+    removeTestFiles(fileNames);
+}
@@ -25,7 +25,12 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "testquachecksum32.h"
 
 #include <quazip/quaadler32.h>
+#include <quazip/quaadler32engine.h>
 #include <quazip/quacrc32.h>
+#include <quazip/quacrc32engine.h>
+
+
+#include <string.h>
 
 #include <QtTest/QtTest>
 
@@ -48,3 +53,94 @@ void TestQuaChecksum32::update()
     adler32.update("pedia");
     QCOMPARE(adler32.value(), 0x11E60398u);
 }
+
+void TestQuaChecksum32::crc32Engine_data()
+{
+    QTest::addColumn<int>("impl");
+    QTest::newRow("portable") << QUACRC32_PORTABLE;
+    QTest::newRow("pclmul") << QUACRC32_PCLMUL;
+    QTest::newRow("armv8") << QUACRC32_ARMV8;
+}
+
+void TestQuaChecksum32::crc32Engine()
+{
+    QFETCH(int, impl);
+    if (!quacrc32_available(impl))
+        QSKIP("This CRC-32 implementation is not available here");
+    QByteArray data(1024 * 1024 + 37, Qt::Uninitialized);
+    qsrand(impl);
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(qrand() & 0xFF);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    // every length around the block sizes, at every alignment
+    for (int offset = 0; offset < 17; ++offset) {
+        for (int len = 0; len < 300; ++len) {
+            QCOMPARE(quacrc32_using(impl, 12345, bytes + offset, len),
+                     crc32(12345, bytes + offset, len));
+        }
+    }
+    QCOMPARE(quacrc32_using(impl, 0, bytes + 3, data.size() - 3),
+             crc32(0, bytes + 3, data.size() - 3));
+    QCOMPARE(quacrc32_using(impl, 0, NULL, 0), 0ul);
+    QVERIFY(quacrc32_available(quacrc32_implementation()));
+    QVERIFY(memcmp(quacrc32_table(), get_crc_table(), 256 * sizeof(z_crc_t)) == 0);
+}
+
+void TestQuaChecksum32::adler32Engine_data()
+{
+    QTest::addColumn<int>("impl");
+    QTest::newRow("portable") << QUAADLER32_PORTABLE;
+    QTest::newRow("ssse3") << QUAADLER32_SSSE3;
+    QTest::newRow("avx2") << QUAADLER32_AVX2;
+    QTest::newRow("neon") << QUAADLER32_NEON;
+}
+
+void TestQuaChecksum32::adler32Engine()
+{
+    QFETCH(int, impl);
+    if (!quaadler32_available(impl))
+        QSKIP("This Adler-32 implementation is not available here");
+    QByteArray data(1024 * 1024 + 37, Qt::Uninitialized);
+    qsrand(impl);
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(qrand() & 0xFF);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    // every length around the block sizes, at every alignment
+    for (int offset = 0; offset < 17; ++offset) {
+        for (int len = 0; len < 300; ++len) {
+            QCOMPARE(quaadler32_using(impl, 12345, bytes + offset, len),
+                     adler32(12345, bytes + offset, len));
+        }
+    }
+    QCOMPARE(quaadler32_using(impl, 1, bytes + 3, data.size() - 3),
+             adler32(1, bytes + 3, data.size() - 3));
+    // the largest sums before each reduction
+    QByteArray ones(3 * 5552 + 100, '\xff');
+    const unsigned char *high = reinterpret_cast<const unsigned char*>(ones.constData());
+    QCOMPARE(quaadler32_using(impl, 0xfff0fff0ul, high, ones.size()),
+             adler32(0xfff0fff0ul, high, ones.size()));
+    QCOMPARE(quaadler32_using(impl, 0, NULL, 0), 1ul);
+    QVERIFY(quaadler32_available(quaadler32_implementation()));
+}
+
+void TestQuaChecksum32::adler32Combine()
+{
+    QByteArray data(200000, Qt::Uninitialized);
+    qsrand(7);
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>(qrand() & 0xFF);
+    QuaAdler32 adler32;
+    const quint32 whole = adler32.calculate(data);
+    for (int split = 0; split <= data.size(); split += 4999) {
+        quint32 first = adler32.calculate(data.left(split));
+        quint32 second = adler32.calculate(data.mid(split));
+        QCOMPARE(QuaAdler32::combine(first, second, data.size() - split), whole);
+    }
+    // chunks, as if checksummed in parallel
+    quint32 total = adler32.calculate(QByteArray());
+    for (int pos = 0; pos < data.size(); pos += 65536) {
+        QByteArray chunk = data.mid(pos, 65536);
+        total = QuaAdler32::combine(total, adler32.calculate(chunk), chunk.size());
+    }
+    QCOMPARE(total, whole);
+}
@@ -32,6 +32,11 @@ class TestQuaChecksum32: public QObject {
 private slots:
     void calculate();
     void update();
+    void crc32Engine_data();
+    void crc32Engine();
+    void adler32Engine_data();
+    void adler32Engine();
+    void adler32Combine();
 };
 
 #endif // QUAZIP_TEST_QUACHECKSUM32_H
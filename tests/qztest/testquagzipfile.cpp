@@ -24,6 +24,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "testquagzipfile.h"
 #include <zlib.h>
+#include <QBuffer>
 #include <QDir>
 #include <quazip/quagzipfile.h>
 #include <QtTest/QtTest>
@@ -77,3 +78,307 @@ void TestQuaGzipFile::constructorDestructor()
     QuaGzipFile f2(&parent);
     QuaGzipFile f3("test.gz", &parent);
 }
+
+static QByteArray gzipMember(const QByteArray &data, int level)
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+                 Z_DEFAULT_STRATEGY);
+    QByteArray gzip(static_cast<int>(deflateBound(&stream, data.size())),
+                    '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(
+            const_cast<char*>(data.constData()));
+    stream.avail_in = data.size();
+    stream.next_out = reinterpret_cast<Bytef*>(gzip.data());
+    stream.avail_out = gzip.size();
+    deflate(&stream, Z_FINISH);
+    gzip.resize(gzip.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return gzip;
+}
+
+void TestQuaGzipFile::seekIndex_data()
+{
+    QTest::addColumn<int>("memberSize");
+    QTest::newRow("one member") << 0;
+    QTest::newRow("members") << 100000;
+}
+
+void TestQuaGzipFile::seekIndex()
+{
+    QFETCH(int, memberSize);
+    QByteArray data;
+    qsrand(1);
+    while (data.size() < 3 * 1024 * 1024) {
+        data.append(QByteArray::number(qrand() % 1000));
+        data.append(qrand() % 10 == 0 ? '\n' : ' ');
+    }
+    QDir curDir;
+    curDir.mkpath("tmp");
+    QFile gzip("tmp/test.gz");
+    QVERIFY(gzip.open(QIODevice::WriteOnly));
+    if (memberSize == 0) {
+        gzip.write(gzipMember(data, 6));
+    } else {
+        for (int i = 0; i < data.size(); i += memberSize)
+            gzip.write(gzipMember(data.mid(i, memberSize), 9));
+    }
+    gzip.close();
+    // sequential unless asked for
+    QuaGzipFile testFile("tmp/test.gz");
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QVERIFY(testFile.isSequential());
+    testFile.close();
+    testFile.setSeekCheckpointSpan(64 * 1024);
+    QCOMPARE(testFile.getSeekCheckpointSpan(), static_cast<qint64>(64 * 1024));
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QVERIFY(!testFile.isSequential());
+    // forward and backward, past what was read so far and within it
+    for (int i = 0; i < 200; ++i) {
+        qint64 pos = (static_cast<qint64>(qrand()) * 7919) % data.size();
+        QVERIFY(testFile.seek(pos));
+        QCOMPARE(testFile.pos(), pos);
+        QCOMPARE(testFile.read(1000), data.mid(static_cast<int>(pos), 1000));
+    }
+    QVERIFY(testFile.buildSeekIndex());
+    QCOMPARE(testFile.size(), static_cast<qint64>(data.size()));
+    int count = testFile.getSeekCheckpointCount();
+    QVERIFY(count >= 10);
+    QVERIFY(testFile.seek(0));
+    QCOMPARE(testFile.readAll(), data);
+    QVERIFY(testFile.atEnd());
+    QVERIFY(!testFile.seek(data.size() + 1));
+    // past the end before the size is known, nothing is skipped
+    QuaGzipFile fresh("tmp/test.gz");
+    fresh.setSeekCheckpointSpan(64 * 1024);
+    QVERIFY(fresh.open(QIODevice::ReadOnly));
+    QCOMPARE(fresh.read(1000), data.left(1000));
+    QVERIFY(!fresh.seek(data.size() + 1));
+    QCOMPARE(fresh.pos(), static_cast<qint64>(1000));
+    QCOMPARE(fresh.read(1000), data.mid(1000, 1000));
+    fresh.close();
+    QBuffer index;
+    QVERIFY(index.open(QIODevice::WriteOnly));
+    QVERIFY(testFile.saveSeekIndex(&index));
+    index.close();
+    testFile.close();
+    // a fresh file seeks with the saved checkpoints right away
+    QuaGzipFile loaded("tmp/test.gz");
+    loaded.setSeekCheckpointSpan(64 * 1024);
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QVERIFY(loaded.loadSeekIndex(&index));
+    index.close();
+    QVERIFY(loaded.open(QIODevice::ReadOnly));
+    QCOMPARE(loaded.getSeekCheckpointCount(), count);
+    QVERIFY(loaded.seek(data.size() - 5000));
+    QCOMPARE(loaded.read(5000), data.right(5000));
+    QVERIFY(loaded.seek(100));
+    QCOMPARE(loaded.read(100), data.mid(100, 100));
+    loaded.close();
+    // but not another one
+    QVERIFY(gzip.open(QIODevice::WriteOnly));
+    gzip.write(gzipMember(data.left(1000), 6));
+    gzip.close();
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QVERIFY(loaded.loadSeekIndex(&index));
+    index.close();
+    QVERIFY(loaded.open(QIODevice::ReadOnly));
+    QCOMPARE(loaded.getSeekCheckpointCount(), 0);
+    QCOMPARE(loaded.readAll(), data.left(1000));
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QVERIFY(!loaded.loadSeekIndex(&index));
+    index.close();
+    loaded.close();
+    curDir.remove("tmp/test.gz");
+    curDir.rmdir("tmp");
+}
+
+void TestQuaGzipFile::follow()
+{
+    QDir curDir;
+    curDir.mkpath("tmp");
+    gzFile file = gzopen("tmp/test.gz", "wb");
+    QuaGzipFile testFile("tmp/test.gz");
+    testFile.setSeekCheckpointSpan(64 * 1024);
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QVERIFY(testFile.atEnd());
+    char buf[1000];
+    QCOMPARE(testFile.read(buf, sizeof(buf)), static_cast<qint64>(0));
+    // a deflate stream in progress
+    QByteArray data;
+    for (int i = 0; i < 20; ++i) {
+        QByteArray line = QByteArray::number(i) + " test\n";
+        gzwrite(file, line.constData(), line.size());
+        gzflush(file, Z_SYNC_FLUSH);
+        data.append(line);
+        QVERIFY(!testFile.atEnd());
+        QCOMPARE(testFile.readLine(), line);
+        QVERIFY(testFile.atEnd());
+    }
+    gzclose(file);
+    QCOMPARE(testFile.read(buf, sizeof(buf)), static_cast<qint64>(0));
+    QCOMPARE(testFile.size(), static_cast<qint64>(data.size()));
+    // a member appended
+    file = gzopen("tmp/test.gz", "ab");
+    gzwrite(file, "test", 4);
+    gzclose(file);
+    QVERIFY(!testFile.atEnd());
+    QCOMPARE(testFile.read(buf, sizeof(buf)), static_cast<qint64>(4));
+    QCOMPARE(testFile.size(), static_cast<qint64>(data.size() + 4));
+    QVERIFY(testFile.seek(data.size() - 8));
+    QCOMPARE(testFile.read(12), QByteArray("19 test\ntest"));
+    testFile.close();
+    curDir.remove("tmp/test.gz");
+    curDir.rmdir("tmp");
+}
+
+void TestQuaGzipFile::ioDevice()
+{
+    QByteArray gzip = gzipMember("test", 6);
+    gzip.append(gzipMember("test2", 6));
+    QBuffer buffer(&gzip);
+    QuaGzipFile testFile(&buffer);
+    QCOMPARE(testFile.getIoDevice(), static_cast<QIODevice*>(&buffer));
+    QVERIFY(!testFile.open(QIODevice::ReadWrite));
+    // opened and closed along
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QVERIFY(buffer.isOpen());
+    QCOMPARE(testFile.readAll(), QByteArray("testtest2"));
+    QVERIFY(testFile.atEnd());
+    testFile.close();
+    QVERIFY(!buffer.isOpen());
+    // or left open, and read from the start
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(buffer.seek(10));
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QCOMPARE(testFile.readAll(), QByteArray("testtest2"));
+    testFile.close();
+    QVERIFY(buffer.isOpen());
+    buffer.close();
+    testFile.setFileName("test.gz");
+    QVERIFY(testFile.getIoDevice() == NULL);
+    testFile.setIoDevice(&buffer);
+    QVERIFY(testFile.getFileName().isEmpty());
+}
+
+void TestQuaGzipFile::parallelMembers_data()
+{
+    QTest::addColumn<int>("memberSize");
+    QTest::addColumn<bool>("fakeHeader");
+    QTest::addColumn<QByteArray>("trailer");
+    QTest::newRow("members") << 100000 << false << QByteArray();
+    QTest::newRow("one member") << 0 << false << QByteArray();
+    QTest::newRow("fake header") << 100000 << true << QByteArray();
+    QTest::newRow("garbage") << 100000 << false << QByteArray("garbage");
+}
+
+void TestQuaGzipFile::parallelMembers()
+{
+    QFETCH(int, memberSize);
+    QFETCH(bool, fakeHeader);
+    QFETCH(QByteArray, trailer);
+    QByteArray data;
+    qsrand(1);
+    while (data.size() < 6 * 1024 * 1024) {
+        data.append(QByteArray::number(qrand() % 1000));
+        data.append(qrand() % 10 == 0 ? '\n' : ' ');
+    }
+    QByteArray gzip;
+    if (fakeHeader) {
+        // stored as is, so that it looks like a member start
+        QByteArray stored = data.left(3 * 1024 * 1024);
+        stored.replace(1500000, 10, QByteArray("\x1f\x8b\x08\0\0\0\0\0\0\x03", 10));
+        data.replace(0, stored.size(), stored);
+        gzip.append(gzipMember(stored, 0));
+    }
+    int start = fakeHeader ? 3 * 1024 * 1024 : 0;
+    if (memberSize == 0) {
+        gzip.append(gzipMember(data.mid(start), 6));
+    } else {
+        for (int i = start; i < data.size(); i += memberSize)
+            gzip.append(gzipMember(data.mid(i, memberSize), 6));
+    }
+    gzip.append(trailer);
+    QBuffer buffer(&gzip);
+    QuaGzipFile testFile(&buffer);
+    testFile.setThreadCount(4);
+    QCOMPARE(testFile.getThreadCount(), 4);
+    QVERIFY(testFile.open(QIODevice::ReadOnly));
+    QCOMPARE(testFile.readAll(), data);
+    QVERIFY(testFile.atEnd());
+    testFile.close();
+    // a corrupted member is still an error
+    if (memberSize != 0 && trailer.isEmpty()) {
+        QByteArray &corrupted = buffer.buffer();
+        corrupted[corrupted.size() / 2] = corrupted.at(corrupted.size() / 2) ^ 0x55;
+        QVERIFY(testFile.open(QIODevice::ReadOnly));
+        char buf[64 * 1024];
+        qint64 read;
+        while ((read = testFile.read(buf, sizeof(buf))) > 0) {}
+        QCOMPARE(read, static_cast<qint64>(-1));
+        testFile.close();
+    }
+}
+
+void TestQuaGzipFile::writeParallel_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("format");
+    QTest::newRow("single member") << 4
+        << static_cast<int>(QuaGzipFile::SingleMember);
+    QTest::newRow("bgzf") << 4 << static_cast<int>(QuaGzipFile::BgzfMembers);
+    QTest::newRow("one thread") << 1
+        << static_cast<int>(QuaGzipFile::SingleMember);
+}
+
+void TestQuaGzipFile::writeParallel()
+{
+    QFETCH(int, threads);
+    QFETCH(int, format);
+    QByteArray data;
+    qsrand(1);
+    while (data.size() < 3 * 1024 * 1024) {
+        data.append(QByteArray::number(qrand() % 1000));
+        data.append(qrand() % 10 == 0 ? '\n' : ' ');
+    }
+    // to a device, with a flush in the middle
+    QBuffer buffer;
+    QuaGzipFile testFile(&buffer);
+    testFile.setThreadCount(threads);
+    testFile.setQueueDepth(3);
+    testFile.setWriteFormat(static_cast<QuaGzipFile::WriteFormat>(format));
+    QCOMPARE(testFile.getQueueDepth(), 3);
+    QCOMPARE(static_cast<int>(testFile.getWriteFormat()), format);
+    QVERIFY(testFile.open(QIODevice::WriteOnly));
+    QCOMPARE(testFile.write(data.left(100000)), static_cast<qint64>(100000));
+    QVERIFY(testFile.flush());
+    QCOMPARE(testFile.write(data.mid(100000)),
+             static_cast<qint64>(data.size() - 100000));
+    testFile.close();
+    QVERIFY(!buffer.isOpen());
+    if (format == QuaGzipFile::BgzfMembers) {
+        static const char eof[] = "\x1f\x8b\x08\x04\0\0\0\0\0\xff\x06\0"
+            "BC\x02\0\x1b\0\x03\0\0\0\0\0\0\0\0\0";
+        QCOMPARE(buffer.data().right(28), QByteArray(eof, 28));
+    }
+    QuaGzipFile readBack(&buffer);
+    readBack.setThreadCount(threads);
+    QVERIFY(readBack.open(QIODevice::ReadOnly));
+    QCOMPARE(readBack.readAll(), data);
+    readBack.close();
+    // to a file, that gzread() reads
+    QDir curDir;
+    curDir.mkpath("tmp");
+    testFile.setFileName("tmp/test.gz");
+    QVERIFY(testFile.open(QIODevice::WriteOnly));
+    QCOMPARE(testFile.write(data), static_cast<qint64>(data.size()));
+    testFile.close();
+    gzFile file = gzopen("tmp/test.gz", "rb");
+    QByteArray read(data.size() + 1, '\0');
+    QCOMPARE(gzread(file, read.data(), read.size()), data.size());
+    gzclose(file);
+    QCOMPARE(read.left(data.size()), data);
+    curDir.remove("tmp/test.gz");
+    curDir.rmdir("tmp");
+}
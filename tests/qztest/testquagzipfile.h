@@ -33,6 +33,14 @@ private slots:
     void read();
     void write();
     void constructorDestructor();
+    void seekIndex_data();
+    void seekIndex();
+    void follow();
+    void ioDevice();
+    void parallelMembers_data();
+    void parallelMembers();
+    void writeParallel_data();
+    void writeParallel();
 };
 
 #endif // QUAZIP_TEST_QUAGZIPFILE_H
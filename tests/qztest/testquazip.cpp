@@ -41,6 +41,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include <quazip/quazip.h>
 #include <quazip/JlCompress.h>
+#include <quazip/quazipdir.h>
 
 void TestQuaZip::getFileList_data()
 {
@@ -371,6 +372,374 @@ void TestQuaZip::setAutoClose()
     }
 }
 
+void TestQuaZip::setMapped()
+{
+    QString zipName = "testMapped.zip";
+    QByteArray stored, deflated;
+    for (int i = 0; i < 100000; ++i) {
+        stored.append(static_cast<char>(qrand()));
+        deflated.append(static_cast<char>('a' + i % 7));
+    }
+    {
+        QuaZip zip(zipName);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("stored.bin"),
+                          NULL, 0, 0));
+        QCOMPARE(file.write(stored), static_cast<qint64>(stored.size()));
+        file.close();
+        QVERIFY(file.open(QIODevice::WriteOnly,
+                          QuaZipNewInfo("deflated.txt")));
+        QCOMPARE(file.write(deflated), static_cast<qint64>(deflated.size()));
+        file.close();
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QuaZip zip(zipName);
+    QVERIFY(!zip.isMapped());
+    zip.setMapped(true);
+    QVERIFY(zip.isMapped());
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QCOMPARE(zip.getFileNameList(),
+             QStringList() << "stored.bin" << "deflated.txt");
+    QuaZipFile file(&zip);
+    QVERIFY(zip.setCurrentFile("stored.bin"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.mappedData(), stored);
+    // half read, still the whole data
+    QCOMPARE(file.read(1000), stored.left(1000));
+    QCOMPARE(file.mappedData(), stored);
+    QCOMPARE(file.readAll(), stored.mid(1000));
+    file.close();
+    QCOMPARE(file.getZipError(), UNZ_OK);
+    QVERIFY(zip.setCurrentFile("deflated.txt"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(file.mappedData().isNull());
+    QCOMPARE(file.readAll(), deflated);
+    file.close();
+    QCOMPARE(file.getZipError(), UNZ_OK);
+    zip.close();
+    // devices that can't be mapped are read as usual
+    QFile zipFile(zipName);
+    QVERIFY(zipFile.open(QIODevice::ReadOnly));
+    QBuffer buffer;
+    buffer.setData(zipFile.readAll());
+    zipFile.close();
+    QuaZip bufferZip(&buffer);
+    bufferZip.setMapped(true);
+    QVERIFY(bufferZip.open(QuaZip::mdUnzip));
+    QVERIFY(bufferZip.setCurrentFile("stored.bin"));
+    QuaZipFile bufferFile(&bufferZip);
+    QVERIFY(bufferFile.open(QIODevice::ReadOnly));
+    QVERIFY(bufferFile.mappedData().isNull());
+    QCOMPARE(bufferFile.readAll(), stored);
+    bufferFile.close();
+    bufferZip.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZip::entryTable()
+{
+    // enough entries for the central directory to be decoded on threads
+    QString zipName = "testEntryTable.zip";
+    const int count = 20000;
+    {
+        QuaZip zip(zipName);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        for (int i = 0; i < count; ++i) {
+            QString name = QString("dir%1/File%2.txt").arg(i % 10).arg(i);
+            QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+            file.write(name.toUtf8().repeated(i % 5));
+            file.close();
+        }
+        zip.setComment("comment");
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QList<QuaZipFileInfo64> infos = zip.getFileInfoList64();
+    QCOMPARE(infos.count(), count);
+    QStringList names = zip.getFileNameList();
+    QCOMPARE(names.count(), count);
+    // same as walking the archive
+    int i = 0;
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile(), ++i) {
+        QuaZipFileInfo64 info;
+        QVERIFY(zip.getCurrentFileInfo(&info));
+        QCOMPARE(names.at(i), info.name);
+        QCOMPARE(infos.at(i).name, info.name);
+        QCOMPARE(infos.at(i).crc, info.crc);
+        QCOMPARE(infos.at(i).compressedSize, info.compressedSize);
+        QCOMPARE(infos.at(i).uncompressedSize, info.uncompressedSize);
+        QCOMPARE(infos.at(i).method, info.method);
+        QCOMPARE(infos.at(i).externalAttr, info.externalAttr);
+        QCOMPARE(infos.at(i).dateTime, info.dateTime);
+        QCOMPARE(infos.at(i).extra, info.extra);
+    }
+    QCOMPARE(i, count);
+    // lookups
+    QVERIFY(zip.setCurrentFile("dir7/File12347.txt"));
+    QCOMPARE(zip.getCurrentFileName(), QString("dir7/File12347.txt"));
+    QVERIFY(zip.setCurrentFile("DIR3/file3.TXT", QuaZip::csInsensitive));
+    QCOMPARE(zip.getCurrentFileName(), QString("dir3/File3.txt"));
+    QVERIFY(!zip.setCurrentFile("dir3/file3.txt", QuaZip::csSensitive));
+    QCOMPARE(zip.getZipError(), UNZ_OK);
+    QVERIFY(zip.setCurrentFile("dir9/File19999.txt"));
+    QuaZipFile file(&zip);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("dir9/File19999.txt").repeated(4));
+    file.close();
+    QuaZipDir dir(&zip, "dir4");
+    QCOMPARE(dir.entryList().count(), count / 10);
+    QVERIFY(dir.exists("File14.txt"));
+    zip.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZip::indexFile()
+{
+    QString zipName = "testIndexFile.zip";
+    QString indexName = QuaZip::indexFileName(zipName);
+    QCOMPARE(indexName, QString("testIndexFile.zip.qzidx"));
+    QDir().remove(indexName);
+    const int count = 1000;
+    {
+        QuaZip zip(zipName);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        for (int i = 0; i < count; ++i) {
+            QString name = QString("dir%1/File%2.txt").arg(i % 10).arg(i);
+            QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+            file.write(name.toUtf8());
+            file.close();
+        }
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QStringList names;
+    QList<QuaZipFileInfo64> infos;
+    {
+        // no index yet: decoded, then saved
+        QuaZip zip(zipName);
+        zip.setIndexFileEnabled(true);
+        QVERIFY(zip.isIndexFileEnabled());
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        names = zip.getFileNameList();
+        infos = zip.getFileInfoList64();
+        QCOMPARE(names.count(), count);
+        zip.close();
+        QVERIFY(QFileInfo(indexName).exists());
+    }
+    {
+        // served from the index
+        QuaZip zip(zipName);
+        zip.setIndexFileEnabled(true);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QVERIFY(zip.setCurrentFile("dir7/File777.txt"));
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), QByteArray("dir7/File777.txt"));
+        file.close();
+        QCOMPARE(zip.getFileNameList(), names);
+        QList<QuaZipFileInfo64> indexed = zip.getFileInfoList64();
+        QCOMPARE(indexed.count(), count);
+        for (int i = 0; i < count; ++i) {
+            QCOMPARE(indexed.at(i).name, infos.at(i).name);
+            QCOMPARE(indexed.at(i).crc, infos.at(i).crc);
+            QCOMPARE(indexed.at(i).compressedSize, infos.at(i).compressedSize);
+            QCOMPARE(indexed.at(i).dateTime, infos.at(i).dateTime);
+        }
+        zip.close();
+    }
+    {
+        // the archive changes, the index becomes stale
+        QuaZip zip(zipName);
+        QVERIFY(zip.open(QuaZip::mdAdd));
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("added.txt")));
+        file.write("added");
+        file.close();
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    {
+        QuaZip zip(zipName);
+        zip.setIndexFileEnabled(true);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QStringList updated = zip.getFileNameList();
+        QCOMPARE(updated.count(), count + 1);
+        QCOMPARE(updated.last(), QString("added.txt"));
+        QVERIFY(zip.setCurrentFile("added.txt"));
+        zip.close();
+    }
+    {
+        // a garbled index is ignored too
+        QFile index(indexName);
+        QVERIFY(index.open(QIODevice::ReadWrite));
+        QVERIFY(index.seek(8));
+        index.write("garbage");
+        index.close();
+        QuaZip zip(zipName);
+        zip.setIndexFileEnabled(true);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QCOMPARE(zip.getFileNameList().count(), count + 1);
+        zip.close();
+    }
+    QDir().remove(zipName);
+    QDir().remove(indexName);
+}
+
+void TestQuaZip::eagerIndex()
+{
+    QString zipName = "testEagerIndex.zip";
+    const int count = 20000;
+    {
+        QuaZip zip(zipName);
+        zip.setFileNameCodec("UTF-8");
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        QStringList extra;
+        extra << QString::fromUtf8("\xc3\x84rger.txt")
+              << "dup.txt" << "DUP.txt" << "dup.txt";
+        for (int i = 0; i < count + extra.count(); ++i) {
+            QString name = i < count ? QString("dir%1/File%2.txt").arg(i % 10).arg(i)
+                                     : extra.at(i - count);
+            QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+            file.write(QByteArray::number(i));
+            file.close();
+        }
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QuaZip zip(zipName);
+    zip.setFileNameCodec("UTF-8");
+    zip.setEagerIndexEnabled(true);
+    QVERIFY(zip.isEagerIndexEnabled());
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    for (int i = 0; i < count; i += 7) {
+        QString name = QString("dir%1/File%2.txt").arg(i % 10).arg(i);
+        QVERIFY(zip.setCurrentFile(name));
+        QCOMPARE(zip.getCurrentFileName(), name);
+        QVERIFY(zip.setCurrentFile(name.toUpper(), QuaZip::csInsensitive));
+        QCOMPARE(zip.getCurrentFileName(), name);
+    }
+    QVERIFY(!zip.setCurrentFile("dir1/File2.txt"));
+    QCOMPARE(zip.getZipError(), UNZ_OK);
+    QVERIFY(!zip.setCurrentFile("DIR0/FILE0.TXT", QuaZip::csSensitive));
+    QVERIFY(zip.setCurrentFile(QString::fromUtf8("\xc3\xa4RGER.TXT"),
+                               QuaZip::csInsensitive));
+    QCOMPARE(zip.getCurrentFileName(), QString::fromUtf8("\xc3\x84rger.txt"));
+    // duplicates: the first one wins, whatever the case sensitivity
+    QuaZipFile file(&zip);
+    QVERIFY(zip.setCurrentFile("dup.txt", QuaZip::csInsensitive));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray::number(count + 1));
+    file.close();
+    QVERIFY(zip.setCurrentFile("DUP.txt", QuaZip::csSensitive));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray::number(count + 2));
+    file.close();
+    QVERIFY(zip.setCurrentFile("dup.txt", QuaZip::csSensitive));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray::number(count + 1));
+    file.close();
+    zip.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZip::copyEntryRaw()
+{
+    QString srcName = "testCopyRawSrc.zip";
+    QString destName = "testCopyRawDest.zip";
+    QByteArray text = QByteArray("some compressible text\n").repeated(5000);
+    QByteArray binary(30000, '\0');
+    for (int i = 0; i < binary.size(); ++i)
+        binary[i] = static_cast<char>(i * 7 % 251);
+    // a custom extra field block (ID 0xCAFE), to check it's carried over
+    QByteArray extra("\xfe\xca\x02\x00xy", 6);
+    {
+        QuaZip zip(srcName);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QuaZipFile file(&zip);
+        QuaZipNewInfo info("text.txt");
+        info.comment = "the comment";
+        info.extraLocal = info.extraGlobal = extra;
+        info.dateTime = QDateTime(QDate(2015, 6, 7), QTime(8, 9, 10));
+        QVERIFY(file.open(QIODevice::WriteOnly, info, NULL, 0, Z_DEFLATED,
+                          Z_BEST_COMPRESSION));
+        file.write(text);
+        file.close();
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("binary.bin"),
+                          NULL, 0, 0, 0));
+        file.write(binary);
+        file.close();
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("dir/")));
+        file.close();
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("secret.txt"),
+                          "password"));
+        file.write(text);
+        file.close();
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QuaZip source(srcName);
+    QVERIFY(source.open(QuaZip::mdUnzip));
+    QuaZip dest(destName);
+    QVERIFY(dest.open(QuaZip::mdCreate));
+    // out of order and renamed
+    QVERIFY(dest.copyEntryRaw(source, "binary.bin"));
+    QVERIFY(dest.copyEntryRaw(source, "text.txt", "renamed.txt"));
+    QVERIFY(source.setCurrentFile("dir/"));
+    QVERIFY(dest.copyEntryRaw(source, QString()));
+    QCOMPARE(dest.copyEntriesRaw(source, QStringList() << "*.bin"), 1);
+    QVERIFY(!dest.copyEntryRaw(source, "missing.txt"));
+    QVERIFY(!dest.copyEntryRaw(source, "secret.txt"));
+    QCOMPARE(dest.getZipError(), UNZ_PARAMERROR);
+    QCOMPARE(dest.copyEntriesRaw(source, QStringList() << "*.txt"), -1);
+    // the source must be open for reading
+    QVERIFY(!source.copyEntryRaw(dest, "binary.bin"));
+    dest.close();
+    QCOMPARE(dest.getZipError(), ZIP_OK);
+    QVERIFY(dest.open(QuaZip::mdUnzip));
+    QCOMPARE(dest.getFileNameList(), QStringList() << "binary.bin"
+             << "renamed.txt" << "dir/" << "binary.bin" << "text.txt");
+    QList<QuaZipFileInfo64> sourceInfo = source.getFileInfoList64();
+    QList<QuaZipFileInfo64> destInfo = dest.getFileInfoList64();
+    int sourceIndexes[] = {1, 0, 2, 1, 0};
+    for (int i = 0; i < destInfo.size(); ++i) {
+        const QuaZipFileInfo64 &expected = sourceInfo.at(sourceIndexes[i]);
+        const QuaZipFileInfo64 &actual = destInfo.at(i);
+        QCOMPARE(actual.crc, expected.crc);
+        QCOMPARE(actual.method, expected.method);
+        QCOMPARE(actual.compressedSize, expected.compressedSize);
+        QCOMPARE(actual.uncompressedSize, expected.uncompressedSize);
+        QCOMPARE(actual.dateTime, expected.dateTime);
+        QCOMPARE(actual.externalAttr, expected.externalAttr);
+        QCOMPARE(actual.comment, expected.comment);
+        QCOMPARE(actual.extra, expected.extra);
+    }
+    QCOMPARE(destInfo.at(1).extra, extra);
+    QCOMPARE(destInfo.at(1).comment, QString("the comment"));
+    // the data is read back through the normal mode, checking the CRC
+    QuaZipFile file(&dest);
+    QVERIFY(dest.setCurrentFile("renamed.txt"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), text);
+    file.close();
+    QCOMPARE(file.getZipError(), UNZ_OK);
+    QVERIFY(dest.setCurrentFile("binary.bin"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), binary);
+    file.close();
+    QCOMPARE(file.getZipError(), UNZ_OK);
+    dest.close();
+    source.close();
+    QDir().remove(srcName);
+    QDir().remove(destName);
+}
+
 #ifdef QUAZIP_TEST_QSAVEFILE
 void TestQuaZip::saveFileBug()
 {
@@ -46,6 +46,11 @@ private slots:
     void setIoDevice();
     void setCommentCodec();
     void setAutoClose();
+    void setMapped();
+    void entryTable();
+    void indexFile();
+    void eagerIndex();
+    void copyEntryRaw();
 #ifdef QUAZIP_TEST_QSAVEFILE
     void saveFileBug();
 #endif
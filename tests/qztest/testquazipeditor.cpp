@@ -0,0 +1,252 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "testquazipeditor.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QtTest/QtTest>
+
+#include <quazip/quazip.h>
+#include <quazip/quazipeditor.h>
+#include <quazip/quazipfile.h>
+
+typedef QMap<QString, QByteArray> Contents;
+
+static bool writeArchive(const QString &zipName, const Contents &contents,
+                         bool dataDescriptor)
+{
+    QuaZip zip(zipName);
+    zip.setDataDescriptorWritingEnabled(dataDescriptor);
+    if (!zip.open(QuaZip::mdCreate))
+        return false;
+    for (Contents::const_iterator i = contents.constBegin();
+            i != contents.constEnd(); ++i) {
+        QuaZipFile file(&zip);
+        if (!file.open(QIODevice::WriteOnly, QuaZipNewInfo(i.key())))
+            return false;
+        file.write(i.value());
+        file.close();
+        if (file.getZipError() != ZIP_OK)
+            return false;
+    }
+    zip.close();
+    return zip.getZipError() == ZIP_OK;
+}
+
+static Contents readArchive(const QString &zipName)
+{
+    Contents contents;
+    QuaZip zip(zipName);
+    if (!zip.open(QuaZip::mdUnzip))
+        return contents;
+    QuaZipFile file(&zip);
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+        if (!file.open(QIODevice::ReadOnly))
+            return Contents();
+        contents.insert(file.getActualFileName(), file.readAll());
+        file.close();
+        if (file.getZipError() != UNZ_OK)
+            return Contents();
+    }
+    if (zip.getZipError() != UNZ_OK)
+        return Contents();
+    return contents;
+}
+
+static Contents testContents()
+{
+    Contents contents;
+    for (int i = 0; i < 5; ++i) {
+        QByteArray data;
+        for (int j = 0; j <= i * 1000; ++j)
+            data += QByteArray::number(i * j);
+        contents.insert(QString("dir/file%1.txt").arg(i), data);
+    }
+    return contents;
+}
+
+void TestQuaZipEditor::edit_data()
+{
+    QTest::addColumn<bool>("compaction");
+    QTest::addColumn<bool>("dataDescriptor");
+    QTest::newRow("compaction") << true << false;
+    QTest::newRow("compaction, descriptor") << true << true;
+    QTest::newRow("dead space") << false << false;
+    QTest::newRow("dead space, descriptor") << false << true;
+}
+
+void TestQuaZipEditor::edit()
+{
+    QFETCH(bool, compaction);
+    QFETCH(bool, dataDescriptor);
+    QString zipName = "testEditor.zip";
+    Contents contents = testContents();
+    QVERIFY(writeArchive(zipName, contents, dataDescriptor));
+    qint64 originalSize = QFileInfo(zipName).size();
+    QByteArray replacement("replaced contents");
+    QBuffer buffer(&replacement);
+    QByteArray added("added contents");
+    QBuffer addedBuffer(&added);
+    QuaZipEditor editor(zipName);
+    editor.setCompactionEnabled(compaction);
+    editor.removeEntry("dir/file1.txt");
+    // more than one, each read after the previous one was written
+    editor.renameEntry("dir/file2.txt", "other/renamed.txt");
+    editor.renameEntry("dir/file4.txt", "other/renamed4.txt");
+    editor.replaceEntry(QuaZipNewInfo("dir/file3.txt"), &buffer);
+    editor.replaceEntry(QuaZipNewInfo("new.txt"), &addedBuffer);
+    QVERIFY(editor.hasPendingEdits());
+    QVERIFY(editor.commit());
+    QCOMPARE(editor.getZipError(), UNZ_OK);
+    QVERIFY(!editor.hasPendingEdits());
+    Contents expected = contents;
+    expected.remove("dir/file1.txt");
+    expected.insert("other/renamed.txt", expected.take("dir/file2.txt"));
+    expected.insert("other/renamed4.txt", expected.take("dir/file4.txt"));
+    expected.insert("dir/file3.txt", replacement);
+    expected.insert("new.txt", added);
+    QCOMPARE(readArchive(zipName), expected);
+    qint64 editedSize = QFileInfo(zipName).size();
+    if (compaction) {
+        QVERIFY(editedSize < originalSize);
+        QCOMPARE(editor.deadSpace(), static_cast<qint64>(0));
+    } else {
+        QVERIFY(editor.deadSpace() > 0);
+        QVERIFY(editor.compact());
+        QCOMPARE(editor.deadSpace(), static_cast<qint64>(0));
+        QVERIFY(QFileInfo(zipName).size() < editedSize);
+        QCOMPARE(readArchive(zipName), expected);
+    }
+    QDir().remove(zipName);
+}
+
+void TestQuaZipEditor::deadSpace()
+{
+    QString zipName = "testEditorDeadSpace.zip";
+    Contents contents = testContents();
+    QVERIFY(writeArchive(zipName, contents, false));
+    QuaZipEditor editor(zipName);
+    QCOMPARE(editor.deadSpace(), static_cast<qint64>(0));
+    editor.setCompactionEnabled(false);
+    editor.removeEntry("dir/file0.txt");
+    editor.removeEntry("dir/file4.txt");
+    QVERIFY(editor.commit());
+    qint64 dead = editor.deadSpace();
+    QVERIFY(dead > 0);
+    // removing entries without compaction leaves the data in place
+    qint64 size = QFileInfo(zipName).size();
+    QVERIFY(editor.compact());
+    QCOMPARE(QFileInfo(zipName).size(), size - dead);
+    contents.remove("dir/file0.txt");
+    contents.remove("dir/file4.txt");
+    QCOMPARE(readArchive(zipName), contents);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipEditor::missingEntry()
+{
+    QString zipName = "testEditorMissing.zip";
+    Contents contents = testContents();
+    QVERIFY(writeArchive(zipName, contents, false));
+    QByteArray original;
+    {
+        QFile file(zipName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        original = file.readAll();
+    }
+    QuaZipEditor editor(zipName);
+    editor.removeEntry("dir/file0.txt");
+    editor.renameEntry("no/such/file.txt", "whatever.txt");
+    QVERIFY(!editor.commit());
+    QCOMPARE(editor.getZipError(), UNZ_END_OF_LIST_OF_FILE);
+    QVERIFY(editor.hasPendingEdits());
+    // nothing was changed
+    QFile file(zipName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), original);
+    file.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZipEditor::renameConflict_data()
+{
+    QTest::addColumn<QString>("target");
+    QTest::addColumn<QString>("otherTarget");
+    QTest::addColumn<bool>("removeTarget");
+    QTest::addColumn<bool>("valid");
+    QTest::newRow("existing entry") << "dir/file3.txt" << QString() << false << false;
+    QTest::newRow("another rename") << "new.txt" << "new.txt" << false << false;
+    QTest::newRow("replaced entry") << "added.txt" << QString() << false << false;
+    QTest::newRow("removed entry") << "dir/file3.txt" << QString() << true << true;
+    QTest::newRow("swapped") << "dir/file1.txt" << "dir/file0.txt" << false << true;
+}
+
+void TestQuaZipEditor::renameConflict()
+{
+    QFETCH(QString, target);
+    QFETCH(QString, otherTarget);
+    QFETCH(bool, removeTarget);
+    QFETCH(bool, valid);
+    QString zipName = "testEditorConflict.zip";
+    Contents contents = testContents();
+    QVERIFY(writeArchive(zipName, contents, false));
+    QByteArray original;
+    {
+        QFile file(zipName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        original = file.readAll();
+    }
+    QByteArray replacement("added contents");
+    QBuffer buffer(&replacement);
+    QuaZipEditor editor(zipName);
+    editor.renameEntry("dir/file0.txt", target);
+    if (!otherTarget.isEmpty())
+        editor.renameEntry("dir/file1.txt", otherTarget);
+    if (removeTarget)
+        editor.removeEntry(target);
+    editor.replaceEntry(QuaZipNewInfo("added.txt"), &buffer);
+    Contents expected = contents;
+    if (valid) {
+        QVERIFY(editor.commit());
+        if (removeTarget)
+            expected.remove(target);
+        QByteArray first = expected.take("dir/file0.txt");
+        if (!otherTarget.isEmpty())
+            expected.insert(otherTarget, expected.take("dir/file1.txt"));
+        expected.insert(target, first);
+        expected.insert("added.txt", replacement);
+        QCOMPARE(readArchive(zipName), expected);
+    } else {
+        QVERIFY(!editor.commit());
+        QCOMPARE(editor.getZipError(), ZIP_PARAMERROR);
+        // nothing was changed
+        QFile file(zipName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), original);
+    }
+    QDir().remove(zipName);
+}
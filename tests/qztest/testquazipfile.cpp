@@ -29,7 +29,9 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include <quazip/JlCompress.h>
 #include <quazip/quazipfile.h>
 #include <quazip/quazip.h>
+#include <quazip/quazipmethodpolicy.h>
 
+#include <QBuffer>
 #include <QFile>
 #include <QString>
 #include <QStringList>
@@ -573,3 +575,534 @@ void TestQuaZipFile::largeFile()
     fakeLargeZip.close();
     curDir.remove("tmp/large.zip");
 }
+
+void TestQuaZipFile::parallelDeflate_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("blockSize");
+    QTest::addColumn<int>("size");
+    QTest::newRow("serial") << 1 << 65536 << 1000000;
+    QTest::newRow("empty") << 4 << 65536 << 0;
+    QTest::newRow("one block") << 4 << 65536 << 1000;
+    QTest::newRow("exact blocks") << 4 << 65536 << 4 * 65536;
+    QTest::newRow("many blocks") << 4 << 65536 << 1000000;
+    QTest::newRow("ideal threads") << 0 << 32768 << 300000;
+}
+
+void TestQuaZipFile::parallelDeflate()
+{
+    QFETCH(int, threads);
+    QFETCH(int, blockSize);
+    QFETCH(int, size);
+    QString zipName = "parallelDeflate.zip";
+    QByteArray data;
+    data.reserve(size);
+    qsrand(size);
+    for (int i = 0; i < size; ++i) // compressible, but not trivially
+        data.append(static_cast<char>('a' + (i / 7 + qrand() % 3) % 26));
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    outFile.setDeflateThreads(threads, blockSize);
+    QVERIFY(outFile.getDeflateThreads() >= 1);
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("data.txt")));
+    // odd-sized writes straddle the block boundaries
+    for (int pos = 0; pos < size; pos += 10007)
+        QCOMPARE(outFile.write(data.mid(pos, 10007)),
+                 static_cast<qint64>(qMin(10007, size - pos)));
+    QVERIFY(!outFile.isRaw());
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    QuaZipFile inFile(zipName, "data.txt");
+    QVERIFY(inFile.open(QIODevice::ReadOnly));
+    QuaZipFileInfo64 info;
+    QVERIFY(inFile.getFileInfo(&info));
+    QCOMPARE(info.method, static_cast<quint16>(Z_DEFLATED));
+    QCOMPARE(info.uncompressedSize, static_cast<quint64>(size));
+    QCOMPARE(info.crc, static_cast<quint32>(crc32(crc32(0L, Z_NULL, 0),
+            reinterpret_cast<const Bytef*>(data.constData()), size)));
+    QCOMPARE(inFile.readAll(), data);
+    inFile.close();
+    // the CRC check happens on close
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::methodPolicy_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QByteArray>("prefix");
+    QTest::addColumn<bool>("random");
+    QTest::addColumn<int>("size");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<int>("method");
+    QTest::newRow("text") << "text.dat" << QByteArray() << false << 300000 << 1
+        << static_cast<int>(Z_DEFLATED);
+    QTest::newRow("text, parallel") << "text.dat" << QByteArray() << false << 300000 << 4
+        << static_cast<int>(Z_DEFLATED);
+    QTest::newRow("small text") << "text.dat" << QByteArray() << false << 1000 << 1
+        << static_cast<int>(Z_DEFLATED);
+    // the entropy of the sample gives it away
+    QTest::newRow("random") << "random.dat" << QByteArray() << true << 300000 << 1 << 0;
+    // too small to measure, but stored once deflating it fails
+    QTest::newRow("small random") << "random.dat" << QByteArray() << true << 1000 << 1 << 0;
+    QTest::newRow("empty") << "empty.dat" << QByteArray() << false << 0 << 1 << 0;
+    QTest::newRow("suffix") << "picture.JPG" << QByteArray() << false << 300000 << 1 << 0;
+    QTest::newRow("signature") << "nested.dat" << QByteArray("PK\x03\x04", 4) << false << 300000 << 1 << 0;
+}
+
+void TestQuaZipFile::methodPolicy()
+{
+    QFETCH(QString, name);
+    QFETCH(QByteArray, prefix);
+    QFETCH(bool, random);
+    QFETCH(int, size);
+    QFETCH(int, threads);
+    QFETCH(int, method);
+    QString zipName = "methodPolicy.zip";
+    QByteArray data = prefix;
+    qsrand(size);
+    while (data.size() < size) {
+        if (random)
+            data.append(static_cast<char>(qrand() & 0xFF));
+        else
+            data.append(static_cast<char>('a' + (data.size() / 7 + qrand() % 3) % 26));
+    }
+    QuaZipMethodPolicy policy;
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    outFile.setDeflateThreads(threads);
+    outFile.setMethodPolicy(&policy);
+    QCOMPARE(outFile.getMethodPolicy(), static_cast<const QuaZipMethodPolicy*>(&policy));
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+    for (int pos = 0; pos < size; pos += 10007)
+        QCOMPARE(outFile.write(data.mid(pos, 10007)),
+                 static_cast<qint64>(qMin(10007, size - pos)));
+    QCOMPARE(outFile.pos(), static_cast<qint64>(size));
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    QuaZipFile inFile(zipName, name);
+    QVERIFY(inFile.open(QIODevice::ReadOnly));
+    QuaZipFileInfo64 info;
+    QVERIFY(inFile.getFileInfo(&info));
+    QCOMPARE(static_cast<int>(info.method), method);
+    QCOMPARE(info.uncompressedSize, static_cast<quint64>(size));
+    QCOMPARE(inFile.readAll(), data);
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+    QVERIFY(QuaZipMethodPolicy::entropy(QByteArray(1000, 'a')) < 0.001);
+    QVERIFY(QuaZipMethodPolicy::isCompressedFormat(QByteArray("\x1f\x8b\x08", 3)));
+    QVERIFY(!QuaZipMethodPolicy::isCompressedFormat(QByteArray("plain text")));
+}
+
+static quint32 crcByte(quint32 crc, uchar c)
+{
+    // crc32() inverts the CRC before and after
+    return ~static_cast<quint32>(crc32(~crc & 0xffffffffu, &c, 1));
+}
+
+static void updateKeys(quint32 *keys, uchar c)
+{
+    keys[0] = crcByte(keys[0], c);
+    keys[1] = (keys[1] + (keys[0] & 0xff)) * 134775813u + 1;
+    keys[2] = crcByte(keys[2], static_cast<uchar>(keys[1] >> 24));
+}
+
+/// Decrypts the traditional PKWARE encryption header of an entry.
+static QByteArray decryptHeader(const QByteArray &header, const char *password)
+{
+    quint32 keys[3] = {0x12345678u, 0x23456789u, 0x34567890u};
+    for (const char *p = password; *p != '\0'; ++p)
+        updateKeys(keys, static_cast<uchar>(*p));
+    QByteArray plain;
+    for (int i = 0; i < header.size(); ++i) {
+        quint32 temp = (keys[2] | 2) & 0xffff;
+        uchar c = static_cast<uchar>(header.at(i))
+            ^ static_cast<uchar>((temp * (temp ^ 1)) >> 8);
+        updateKeys(keys, c);
+        plain.append(static_cast<char>(c));
+    }
+    return plain;
+}
+
+void TestQuaZipFile::methodPolicyPassword_data()
+{
+    QTest::addColumn<int>("size");
+    // deflated in memory, with its CRC computed
+    QTest::newRow("whole") << 1000;
+    // opened once the sample is full, with the CRC passed to open()
+    QTest::newRow("sampled") << 300000;
+}
+
+void TestQuaZipFile::methodPolicyPassword()
+{
+    QFETCH(int, size);
+    QString zipName = "methodPolicyPassword.zip";
+    QByteArray data;
+    qsrand(size);
+    while (data.size() < size)
+        data.append(static_cast<char>('a' + (data.size() / 7 + qrand() % 3) % 26));
+    quint32 crc = static_cast<quint32>(crc32(0L,
+        reinterpret_cast<const Bytef*>(data.constData()), data.size()));
+    QuaZipMethodPolicy policy;
+    QuaZip zip(zipName);
+    zip.setDataDescriptorWritingEnabled(false);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    outFile.setMethodPolicy(&policy);
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("text.dat"),
+                         "secret", size > 1000 ? crc : 0));
+    QCOMPARE(outFile.write(data), static_cast<qint64>(size));
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    // other readers check the last byte of the header against the CRC
+    QFile file(zipName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QByteArray local = file.read(30);
+    QCOMPARE(local.left(4), QByteArray("PK\x03\x04"));
+    int skip = static_cast<uchar>(local.at(26)) | (static_cast<uchar>(local.at(27)) << 8);
+    skip += static_cast<uchar>(local.at(28)) | (static_cast<uchar>(local.at(29)) << 8);
+    QVERIFY(file.seek(30 + skip));
+    QByteArray header = decryptHeader(file.read(12), "secret");
+    file.close();
+    QCOMPARE(static_cast<uchar>(header.at(11)), static_cast<uchar>(crc >> 24));
+    QuaZipFile inFile(zipName, "text.dat");
+    QVERIFY(inFile.open(QIODevice::ReadOnly, "secret"));
+    QCOMPARE(inFile.readAll(), data);
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::compressionMethods_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<QByteArray>("password");
+    QTest::newRow("stored") << 0 << 0 << QByteArray();
+    QTest::newRow("deflated") << static_cast<int>(Z_DEFLATED)
+        << static_cast<int>(Z_DEFAULT_COMPRESSION) << QByteArray();
+    QTest::newRow("bzip2") << static_cast<int>(Z_BZIP2ED)
+        << static_cast<int>(Z_DEFAULT_COMPRESSION) << QByteArray();
+    QTest::newRow("bzip2, level 1") << static_cast<int>(Z_BZIP2ED) << 1 << QByteArray();
+    QTest::newRow("lzma") << static_cast<int>(Z_LZMAED)
+        << static_cast<int>(Z_DEFAULT_COMPRESSION) << QByteArray();
+    QTest::newRow("lzma, encrypted") << static_cast<int>(Z_LZMAED) << 9
+        << QByteArray("secret");
+    // Zstandard, which QuaZIP can't compress
+    QTest::newRow("method 93") << 93
+        << static_cast<int>(Z_DEFAULT_COMPRESSION) << QByteArray();
+}
+
+void TestQuaZipFile::compressionMethods()
+{
+    QFETCH(int, method);
+    QFETCH(int, level);
+    QFETCH(QByteArray, password);
+    QString zipName = "compressionMethods.zip";
+    const char *pw = password.isEmpty() ? NULL : password.constData();
+    QByteArray data;
+    qsrand(method);
+    while (data.size() < 300000)
+        data.append(static_cast<char>('a' + (data.size() / 7 + qrand() % 3) % 26));
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    if (!QuaZipFile::isMethodSupported(method)) {
+        // not built with this method
+        QVERIFY(!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("data.txt"),
+                              pw, 0, method, level));
+        QCOMPARE(outFile.getZipError(), ZIP_PARAMERROR);
+        zip.close();
+        QDir().remove(zipName);
+        return;
+    }
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("data.txt"),
+                         pw, 0, method, level));
+    for (int pos = 0; pos < data.size(); pos += 10007)
+        QVERIFY(outFile.write(data.mid(pos, 10007)) > 0);
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    QuaZipFile inFile(zipName, "data.txt");
+    int readMethod = -1;
+    QVERIFY(inFile.open(QIODevice::ReadOnly, &readMethod, NULL, false, pw));
+    QCOMPARE(readMethod, method);
+    if (method != 0)
+        QVERIFY(inFile.csize() < data.size() / 2);
+    QCOMPARE(inFile.readAll(), data);
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::deflateBackends_data()
+{
+    QTest::addColumn<int>("writeBackend");
+    QTest::addColumn<int>("readBackend");
+    QTest::addColumn<qint64>("budget");
+    QTest::addColumn<bool>("sizeHint");
+    QTest::addColumn<QByteArray>("password");
+    QTest::newRow("stream") << static_cast<int>(QuaZip::dbStream)
+        << static_cast<int>(QuaZip::dbStream) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray();
+    QTest::newRow("one-shot") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbOneShot) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray();
+    QTest::newRow("one-shot, size hint") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbOneShot) << QuaZip::DefaultDeflateBudget
+        << true << QByteArray();
+    QTest::newRow("one-shot, encrypted") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbOneShot) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray("secret");
+    QTest::newRow("one-shot written, streamed") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbStream) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray();
+    QTest::newRow("streamed, one-shot read") << static_cast<int>(QuaZip::dbStream)
+        << static_cast<int>(QuaZip::dbOneShot) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray();
+    // the data outgrows the budget, the entry is streamed after all
+    QTest::newRow("over budget") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbOneShot) << static_cast<qint64>(100000)
+        << false << QByteArray();
+    QTest::newRow("over budget, size hint") << static_cast<int>(QuaZip::dbOneShot)
+        << static_cast<int>(QuaZip::dbOneShot) << static_cast<qint64>(100000)
+        << true << QByteArray("secret");
+    QTest::newRow("default") << static_cast<int>(QuaZip::dbDefault)
+        << static_cast<int>(QuaZip::dbDefault) << QuaZip::DefaultDeflateBudget
+        << false << QByteArray();
+}
+
+void TestQuaZipFile::deflateBackends()
+{
+    QFETCH(int, writeBackend);
+    QFETCH(int, readBackend);
+    QFETCH(qint64, budget);
+    QFETCH(bool, sizeHint);
+    QFETCH(QByteArray, password);
+    QString zipName = "deflateBackends.zip";
+    const char *pw = password.isEmpty() ? NULL : password.constData();
+    QByteArray data;
+    qsrand(writeBackend);
+    while (data.size() < 300000)
+        data.append(static_cast<char>('a' + (data.size() / 7 + qrand() % 3) % 26));
+    QStringList names;
+    names << "data.txt" << "empty.txt" << "small.txt";
+    QList<QByteArray> contents;
+    contents << data << QByteArray() << data.left(1000);
+    QuaZip zip(zipName);
+    zip.setDeflateBackend(static_cast<QuaZip::DeflateBackend>(writeBackend), budget);
+    QCOMPARE(static_cast<int>(zip.getDeflateBackend()), writeBackend);
+    QCOMPARE(zip.getDeflateBudget(), budget);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    for (int i = 0; i < names.size(); ++i) {
+        QuaZipFile outFile(&zip);
+        QuaZipNewInfo info(names[i]);
+        if (sizeHint)
+            info.uncompressedSize = static_cast<ulong>(contents[i].size());
+        QVERIFY(outFile.open(QIODevice::WriteOnly, info, pw, 0, Z_DEFLATED));
+        for (int pos = 0; pos < contents[i].size(); pos += 10007)
+            QVERIFY(outFile.write(contents[i].mid(pos, 10007)) > 0);
+        outFile.close();
+        QCOMPARE(outFile.getZipError(), ZIP_OK);
+    }
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    QuaZip unzip(zipName);
+    unzip.setDeflateBackend(static_cast<QuaZip::DeflateBackend>(readBackend));
+    QVERIFY(unzip.open(QuaZip::mdUnzip));
+    for (int i = 0; i < names.size(); ++i) {
+        QVERIFY(unzip.setCurrentFile(names[i]));
+        QuaZipFile inFile(&unzip);
+        QVERIFY(inFile.open(QIODevice::ReadOnly, NULL, NULL, false, pw));
+        if (!contents[i].isEmpty())
+            QVERIFY(inFile.csize() < contents[i].size() / 2);
+        // small reads, which the one-shot backend serves from memory
+        QByteArray read;
+        while (!inFile.atEnd()) {
+            QByteArray part = inFile.read(4097);
+            QVERIFY(!part.isEmpty());
+            read += part;
+        }
+        QCOMPARE(read, contents[i]);
+        inFile.close();
+        QCOMPARE(inFile.getZipError(), UNZ_OK);
+    }
+    unzip.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::seekDeflated_data()
+{
+    QTest::addColumn<bool>("mapped");
+    QTest::addColumn<int>("level");
+    QTest::newRow("level 1") << false << 1;
+    QTest::newRow("level 9") << false << 9;
+    QTest::newRow("mapped") << true << 6;
+}
+
+void TestQuaZipFile::seekDeflated()
+{
+    QFETCH(bool, mapped);
+    QFETCH(int, level);
+    QString zipName = "seekDeflated.zip";
+    QByteArray data;
+    qsrand(level);
+    while (data.size() < 3 * 1024 * 1024) {
+        data.append(QByteArray::number(qrand() % 1000));
+        data.append(qrand() % 10 == 0 ? '\n' : ' ');
+    }
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("data.txt"),
+                         NULL, 0, Z_DEFLATED, level));
+    QCOMPARE(outFile.write(data), static_cast<qint64>(data.size()));
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QuaZip unzip(zipName);
+    unzip.setMapped(mapped);
+    QVERIFY(unzip.open(QuaZip::mdUnzip));
+    QVERIFY(unzip.setCurrentFile("data.txt"));
+    // sequential unless asked for
+    QuaZipFile inFile(&unzip);
+    QVERIFY(inFile.open(QIODevice::ReadOnly));
+    QVERIFY(inFile.isSequential());
+    inFile.close();
+    inFile.setSeekCheckpointSpan(64 * 1024);
+    QCOMPARE(inFile.getSeekCheckpointSpan(), static_cast<qint64>(64 * 1024));
+    QVERIFY(inFile.open(QIODevice::ReadOnly));
+    QVERIFY(!inFile.isSequential());
+    QCOMPARE(inFile.size(), static_cast<qint64>(data.size()));
+    // forward and backward, past what was read so far and within it
+    for (int i = 0; i < 200; ++i) {
+        qint64 pos = (static_cast<qint64>(qrand()) * 7919) % data.size();
+        QVERIFY(inFile.seek(pos));
+        QCOMPARE(inFile.pos(), pos);
+        QCOMPARE(inFile.read(1000), data.mid(static_cast<int>(pos), 1000));
+    }
+    QVERIFY(inFile.buildSeekIndex());
+    int count = inFile.getSeekCheckpointCount();
+    QVERIFY(count >= 10);
+    QVERIFY(inFile.seek(0));
+    QCOMPARE(inFile.readAll(), data);
+    QVERIFY(inFile.atEnd());
+    QVERIFY(!inFile.seek(data.size() + 1));
+    QBuffer index;
+    QVERIFY(index.open(QIODevice::WriteOnly));
+    QVERIFY(inFile.saveSeekIndex(&index));
+    index.close();
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    // a fresh file seeks with the saved checkpoints right away
+    QuaZipFile loaded(&unzip);
+    loaded.setSeekCheckpointSpan(64 * 1024);
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QVERIFY(loaded.loadSeekIndex(&index));
+    index.close();
+    QCOMPARE(loaded.getSeekCheckpointCount(), count);
+    QVERIFY(loaded.open(QIODevice::ReadOnly));
+    QCOMPARE(loaded.getSeekCheckpointCount(), count);
+    QVERIFY(loaded.seek(data.size() - 5000));
+    QCOMPARE(loaded.readAll(), data.right(5000));
+    QVERIFY(loaded.seek(100));
+    QCOMPARE(loaded.read(100), data.mid(100, 100));
+    loaded.close();
+    QCOMPARE(loaded.getZipError(), UNZ_OK);
+    QBuffer garbage;
+    garbage.setData("not an index");
+    QVERIFY(garbage.open(QIODevice::ReadOnly));
+    QVERIFY(!loaded.loadSeekIndex(&garbage));
+    QCOMPARE(loaded.getSeekCheckpointCount(), count);
+    unzip.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::seekStored_data()
+{
+    QTest::addColumn<bool>("mapped");
+    QTest::addColumn<bool>("raw");
+    QTest::addColumn<QByteArray>("password");
+    QTest::newRow("plain") << false << false << QByteArray();
+    QTest::newRow("raw") << false << true << QByteArray();
+    QTest::newRow("mapped") << true << false << QByteArray();
+    QTest::newRow("encrypted") << false << false << QByteArray("secret");
+}
+
+void TestQuaZipFile::seekStored()
+{
+    QFETCH(bool, mapped);
+    QFETCH(bool, raw);
+    QFETCH(QByteArray, password);
+    QString zipName = "seekStored.zip";
+    QByteArray data;
+    qsrand(2);
+    while (data.size() < 1024 * 1024)
+        data.append(static_cast<char>(qrand()));
+    const char *pwd = password.isEmpty() ? NULL : password.constData();
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile outFile(&zip);
+    QVERIFY(outFile.open(QIODevice::WriteOnly, QuaZipNewInfo("data.bin"),
+                         pwd, crc32(0, reinterpret_cast<const Bytef*>(
+                                 data.constData()), data.size()), 0, 0));
+    QCOMPARE(outFile.write(data), static_cast<qint64>(data.size()));
+    outFile.close();
+    QCOMPARE(outFile.getZipError(), ZIP_OK);
+    zip.close();
+    QuaZip unzip(zipName);
+    unzip.setMapped(mapped);
+    QVERIFY(unzip.open(QuaZip::mdUnzip));
+    QVERIFY(unzip.setCurrentFile("data.bin"));
+    // no checkpoints needed
+    QuaZipFile inFile(&unzip);
+    QVERIFY(inFile.open(QIODevice::ReadOnly, NULL, NULL, raw, pwd));
+    if (pwd != NULL) {
+        // the keys depend on all the data before
+        QVERIFY(inFile.isSequential());
+        QVERIFY(!inFile.seek(100));
+        QCOMPARE(inFile.readAll(), data);
+        inFile.close();
+        QCOMPARE(inFile.getZipError(), UNZ_OK);
+        unzip.close();
+        QDir().remove(zipName);
+        return;
+    }
+    QVERIFY(!inFile.isSequential());
+    QCOMPARE(inFile.size(), static_cast<qint64>(data.size()));
+    // big reads first, before the position is ever moved
+    QCOMPARE(inFile.read(200 * 1024), data.left(200 * 1024));
+    QCOMPARE(inFile.pos(), static_cast<qint64>(200 * 1024));
+    for (int i = 0; i < 200; ++i) {
+        qint64 pos = (static_cast<qint64>(qrand()) * 7919) % data.size();
+        int len = i % 2 == 0 ? 100 : 100 * 1024;
+        QVERIFY(inFile.seek(pos));
+        QCOMPARE(inFile.pos(), pos);
+        QCOMPARE(inFile.read(len), data.mid(static_cast<int>(pos), len));
+    }
+    QVERIFY(inFile.buildSeekIndex());
+    QCOMPARE(inFile.getSeekCheckpointCount(), 0);
+    QVERIFY(inFile.seek(0));
+    QCOMPARE(inFile.readAll(), data);
+    QVERIFY(inFile.atEnd());
+    QVERIFY(!inFile.seek(data.size() + 1));
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    // the CRC is checked again when read through from the start
+    QVERIFY(inFile.open(QIODevice::ReadOnly, NULL, NULL, raw));
+    QCOMPARE(inFile.readAll(), data);
+    inFile.close();
+    QCOMPARE(inFile.getZipError(), UNZ_OK);
+    unzip.close();
+    QDir().remove(zipName);
+}
@@ -48,6 +48,20 @@ private slots:
     void constructorDestructor();
     void setFileAttrs();
     void largeFile();
+    void parallelDeflate_data();
+    void parallelDeflate();
+    void methodPolicy_data();
+    void methodPolicy();
+    void methodPolicyPassword_data();
+    void methodPolicyPassword();
+    void compressionMethods_data();
+    void compressionMethods();
+    void deflateBackends_data();
+    void deflateBackends();
+    void seekDeflated_data();
+    void seekDeflated();
+    void seekStored_data();
+    void seekStored();
 };
 
 #endif // QUAZIP_TEST_QUAZIPFILE_H
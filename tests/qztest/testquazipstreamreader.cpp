@@ -0,0 +1,225 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZIP test suite.
+
+QuaZIP is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZIP is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZIP.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "testquazipstreamreader.h"
+
+#include <QBuffer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest/QtTest>
+
+#include <quazip/quazip.h>
+#include <quazip/quazipfile.h>
+#include <quazip/quazipstreamreader.h>
+
+/// A pipe with a fixed content.
+/**
+  QBuffer can't simply claim to be sequential: QIODevice would no longer
+  advance its position, so it keeps its own offset.
+  */
+class SequentialBuffer: public QIODevice {
+public:
+    SequentialBuffer(const QByteArray &data): data(data), offset(0) {}
+    virtual bool isSequential() const {return true;}
+    virtual qint64 bytesAvailable() const
+    {
+        return data.size() - offset + QIODevice::bytesAvailable();
+    }
+protected:
+    virtual qint64 readData(char *buffer, qint64 maxSize)
+    {
+        qint64 size = qMin<qint64>(maxSize, data.size() - offset);
+        memcpy(buffer, data.constData() + offset, static_cast<size_t>(size));
+        offset += static_cast<int>(size);
+        return size;
+    }
+    virtual qint64 writeData(const char *, qint64) {return -1;}
+private:
+    QByteArray data;
+    int offset;
+};
+
+static QByteArray makeArchive(const QStringList &names,
+                              const QList<QByteArray> &contents,
+                              int method, bool dataDescriptor)
+{
+    QByteArray archive;
+    QBuffer buffer(&archive);
+    QuaZip zip(&buffer);
+    zip.setDataDescriptorWritingEnabled(dataDescriptor);
+    if (!zip.open(QuaZip::mdCreate))
+        return QByteArray();
+    for (int i = 0; i < names.count(); ++i) {
+        QuaZipFile file(&zip);
+        if (!file.open(QIODevice::WriteOnly, QuaZipNewInfo(names.at(i)),
+                       NULL, 0, method))
+            return QByteArray();
+        file.write(contents.at(i));
+        file.close();
+    }
+    zip.close();
+    return archive;
+}
+
+void TestQuaZipStreamReader::read_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<bool>("dataDescriptor");
+    QTest::newRow("deflated") << static_cast<int>(Z_DEFLATED) << false;
+    QTest::newRow("deflated, descriptor") << static_cast<int>(Z_DEFLATED) << true;
+    QTest::newRow("stored") << 0 << false;
+    QTest::newRow("stored, descriptor") << 0 << true;
+}
+
+void TestQuaZipStreamReader::read()
+{
+    QFETCH(int, method);
+    QFETCH(bool, dataDescriptor);
+    QStringList names;
+    QList<QByteArray> contents;
+    names << "empty.txt" << "dir/" << "dir/small.txt" << "fake.bin"
+          << "dir/large.bin";
+    // fake.bin holds something that looks like a data descriptor
+    QByteArray large;
+    for (int i = 0; i < 300000; ++i)
+        large.append(static_cast<char>((i * 7919) >> 5));
+    contents << QByteArray() << QByteArray() << QByteArray("small")
+             << QByteArray("PK\x07\x08\0\0\0\0\x04\0\0\0\x04\0\0\0tail", 20)
+             << large;
+    QByteArray archive = makeArchive(names, contents, method,
+                                     dataDescriptor);
+    QVERIFY(!archive.isEmpty());
+    SequentialBuffer buffer(archive);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QuaZipStreamReader reader(&buffer);
+    QVERIFY(reader.entry() == NULL);
+    int i = 0;
+    while (reader.nextEntry()) {
+        QVERIFY(i < names.count());
+        QuaZipFileInfo64 info = reader.entryInfo();
+        QCOMPARE(info.name, names.at(i));
+        QIODevice *entry = reader.entry();
+        QVERIFY(entry != NULL);
+        QVERIFY(entry->isSequential());
+        QByteArray data;
+        while (!entry->atEnd()) {
+            QByteArray chunk = entry->read(1000);
+            QVERIFY(!chunk.isEmpty());
+            data += chunk;
+        }
+        QCOMPARE(reader.getZipError(), UNZ_OK);
+        QCOMPARE(data, contents.at(i));
+        info = reader.entryInfo();
+        QCOMPARE(info.uncompressedSize, static_cast<quint64>(data.size()));
+        QCOMPARE(info.crc, static_cast<quint32>(
+            crc32(0, reinterpret_cast<const Bytef*>(data.constData()),
+                  data.size())));
+        ++i;
+    }
+    QCOMPARE(reader.getZipError(), UNZ_OK);
+    QCOMPARE(i, names.count());
+    // skipping unread entries
+    SequentialBuffer skipBuffer(archive);
+    QVERIFY(skipBuffer.open(QIODevice::ReadOnly));
+    QuaZipStreamReader skipper(&skipBuffer);
+    QStringList skipped;
+    while (skipper.nextEntry())
+        skipped << skipper.entryInfo().name;
+    QCOMPARE(skipper.getZipError(), UNZ_OK);
+    QCOMPARE(skipped, names);
+}
+
+void TestQuaZipStreamReader::socket()
+{
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress(QHostAddress::LocalHost)));
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress(QHostAddress::LocalHost),
+                         server.serverPort());
+    QVERIFY(socket.waitForConnected());
+    QVERIFY(server.waitForNewConnection(30000));
+    QTcpSocket *client = server.nextPendingConnection();
+    // written straight to the socket: data descriptors everywhere
+    QuaZip zip(&socket);
+    zip.setAutoClose(false);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile zipFile(&zip);
+    QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("stored.txt"),
+                         NULL, 0, 0));
+    zipFile.write("stored data");
+    zipFile.close();
+    QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("deflated.txt")));
+    zipFile.write(QByteArray("deflated data ").repeated(100));
+    zipFile.close();
+    zip.close();
+    while (socket.bytesToWrite() > 0)
+        QVERIFY(socket.waitForBytesWritten());
+    socket.disconnectFromHost();
+    QuaZipStreamReader reader(client);
+    QVERIFY(reader.nextEntry());
+    QCOMPARE(reader.entryInfo().name, QString("stored.txt"));
+    QCOMPARE(reader.entry()->readAll(), QByteArray("stored data"));
+    QVERIFY(reader.nextEntry());
+    QCOMPARE(reader.entryInfo().name, QString("deflated.txt"));
+    QCOMPARE(reader.entry()->readAll(),
+             QByteArray("deflated data ").repeated(100));
+    QVERIFY(!reader.nextEntry());
+    QCOMPARE(reader.getZipError(), UNZ_OK);
+    client->close();
+}
+
+void TestQuaZipStreamReader::corrupt()
+{
+    QByteArray garbage("this is not an archive");
+    SequentialBuffer garbageBuffer(garbage);
+    QVERIFY(garbageBuffer.open(QIODevice::ReadOnly));
+    QuaZipStreamReader garbageReader(&garbageBuffer);
+    QVERIFY(!garbageReader.nextEntry());
+    QCOMPARE(garbageReader.getZipError(), UNZ_BADZIPFILE);
+    QStringList names;
+    names << "test.txt";
+    QList<QByteArray> contents;
+    contents << QByteArray("some test data");
+    // truncated
+    QByteArray truncated = makeArchive(names, contents, Z_DEFLATED, true);
+    truncated.truncate(40);
+    SequentialBuffer truncatedBuffer(truncated);
+    QVERIFY(truncatedBuffer.open(QIODevice::ReadOnly));
+    QuaZipStreamReader truncatedReader(&truncatedBuffer);
+    QVERIFY(truncatedReader.nextEntry());
+    truncatedReader.entry()->readAll();
+    QCOMPARE(truncatedReader.getZipError(), UNZ_BADZIPFILE);
+    QVERIFY(!truncatedReader.nextEntry());
+    // a damaged stored entry
+    QByteArray damaged = makeArchive(names, contents, 0, false);
+    int pos = damaged.indexOf("some test data");
+    QVERIFY(pos > 0);
+    damaged[pos] = 'S';
+    SequentialBuffer damagedBuffer(damaged);
+    QVERIFY(damagedBuffer.open(QIODevice::ReadOnly));
+    QuaZipStreamReader damagedReader(&damagedBuffer);
+    QVERIFY(damagedReader.nextEntry());
+    QCOMPARE(damagedReader.entry()->readAll(), QByteArray("Some test data"));
+    QCOMPARE(damagedReader.getZipError(), UNZ_CRCERROR);
+}
@@ -2,4 +2,5 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     qztest \
+    qzbench \
     jlworkerguitest